@@ -77,6 +77,8 @@
 #    undef CreateWindow
 #endif
 
+#include <algorithm>
+
 #include "BaseEngine.hpp"
 
 #include "GLFW/glfw3native.h"
@@ -312,6 +314,10 @@ void BaseEngine::Loop()
         //}
         }
 
+        const Uint32 NumTicks = m_SimulationClock.Advance(dt);
+        for (Uint32 t = 0; t < NumTicks; ++t)
+            Tick();
+
         Update(dt);
 
         int w, h;
@@ -368,12 +374,19 @@ void BaseEngine::Quit()
     glfwSetWindowShouldClose(m_Window, GLFW_TRUE);
 }
 
+bool BaseEngine::HasCommandLineFlag(const char* Flag) const
+{
+    return std::find(m_CommandLine.begin(), m_CommandLine.end(), Flag) != m_CommandLine.end();
+}
+
 bool BaseEngine::ProcessCommandLine(int argc, const char* const* argv, RENDER_DEVICE_TYPE& DevType)
 {
 #if PLATFORM_LINUX || PLATFORM_MACOS
 #    define _stricmp strcasecmp
 #endif
 
+    m_CommandLine.assign(argv, argv + argc);
+
     int arg = 0;
     while (arg < argc && strcmp(argv[arg], "--mode") != 0 && strcmp(argv[arg], "-m") != 0)
         ++arg;
@@ -42,6 +42,7 @@
 #include "Imgui/interface/ImGuiUtils.hpp"
 
 #include "ImGuiImplGLFW.hpp"
+#include "SimulationClock.hpp"
 
 #include "GLFW/glfw3.h"
 
@@ -62,6 +63,8 @@ namespace Diligent
         A       = GLFW_KEY_A,
         S       = GLFW_KEY_S,
         D       = GLFW_KEY_D,
+        F       = GLFW_KEY_F,
+        P       = GLFW_KEY_P,
 
         // arrows
         Left    = GLFW_KEY_LEFT,
@@ -103,6 +106,11 @@ public:
     ISwapChain*     GetSwapChain() { return m_pSwapChain; }
     bool*           GetVsync() {return &p_vsync;}
 
+    const SimulationClock& GetSimulationClock() const { return m_SimulationClock; }
+
+    // True if the argument was passed on the command line
+    bool HasCommandLineFlag(const char* Flag) const;
+
     void            SetInputModeGame();
     void            SetInputModeUI();
 
@@ -121,6 +129,9 @@ public:
 
     virtual bool Initialize() = 0;
 
+    // Called SimulationClock::TicksPerSecond times per second, before Update()
+    virtual void Tick()           = 0;
+    // Called once per frame; GetSimulationClock().GetAlpha() gives the interpolation factor
     virtual void Update(float dt) = 0;
     virtual void Draw()           = 0;
 
@@ -169,6 +180,10 @@ private:
 
     TClock::time_point m_LastUpdate = {};
 
+    SimulationClock m_SimulationClock;
+
+    std::vector<String> m_CommandLine;
+
     bool p_vsync = true;
     bool p_GameInput = false;
 };
@@ -0,0 +1,2638 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Benchmarks.hpp"
+#include "World.hpp"
+#include "TestWorld.hpp"
+#include "ChunkMesher.hpp"
+#include "FrustumCuller.hpp"
+#include "CpuFeatures.hpp"
+#include "VisibilityGraph.hpp"
+#include "RegionFile.hpp"
+#include "LightEngine.hpp"
+#include "Noise.hpp"
+#include "BiomeSource.hpp"
+#include "WorldGenerator.hpp"
+#include "GenerationScheduler.hpp"
+#include "FluidSimulator.hpp"
+#include "RandomTicker.hpp"
+#include "RedstoneEngine.hpp"
+#include "PlayerPhysics.hpp"
+#include "BlockRaycast.hpp"
+#include "MeshScheduler.hpp"
+#include "EntityStore.hpp"
+#include "Pathfinder.hpp"
+#include "ParticleSystem.hpp"
+#include "SimulationClock.hpp"
+#include "Common/interface/FastRand.hpp"
+#include "Common/interface/Timer.hpp"
+
+namespace Diligent
+{
+
+namespace
+{
+
+// Keeps the optimizer from discarding benchmark loops
+volatile Uint64 g_BenchmarkSink = 0;
+
+double MOpsPerSec(double NumOps, double Seconds)
+{
+    return Seconds > 0 ? NumOps / Seconds * 1e-6 : 0;
+}
+
+void ClearLight(World& Wrld)
+{
+    Wrld.ForEachChunk([](Chunk& Chnk) {
+        for (Int32 s = 0; s < Chunk::NumSections; ++s)
+        {
+            Chnk.GetSection(s).GetSkyLight().Fill(0);
+            Chnk.GetSection(s).GetBlockLight().Fill(0);
+        }
+    });
+}
+
+void LightWorld(World& Wrld, LightEngine& Engine)
+{
+    Wrld.ForEachChunk([&](const Chunk& Chnk) { Engine.QueueChunk(Chnk.GetX(), Chnk.GetZ()); });
+    Engine.Update(Wrld);
+}
+
+// Sky and block light of every loaded block, in ForEachChunk() order
+std::vector<Uint8> SnapshotLight(const World& Wrld)
+{
+    std::vector<Uint8> Light;
+    Wrld.ForEachChunk([&](const Chunk& Chnk) {
+        for (Int32 s = 0; s < Chunk::NumSections; ++s)
+        {
+            const ChunkSection& Section = Chnk.GetSection(s);
+            for (Uint32 i = 0; i < ChunkSection::Volume; ++i)
+                Light.push_back(static_cast<Uint8>(Section.GetSkyLight().Get(i) << 4u | Section.GetBlockLight().Get(i)));
+        }
+    });
+    return Light;
+}
+
+} // namespace
+
+BenchmarkResult RunBlockStorageBenchmark()
+{
+    BenchmarkResult Result{"Block storage"};
+
+    constexpr Uint32 NumPasses = 256;
+    constexpr Uint32 NumOps    = ChunkSection::Volume * NumPasses;
+
+    // Palette of 12 blocks -> 4 bits per block, the common case for underground sections
+    const BlockId Palette[] = {BLOCK_STONE, BLOCK_DIRT, BLOCK_GRAVEL, BLOCK_COBBLESTONE, BLOCK_SAND, BLOCK_AIR,
+                               BLOCK_LOG, BLOCK_LEAVES, BLOCK_PLANKS, BLOCK_GLASS, BLOCK_BEDROCK, BLOCK_GRASS};
+
+    FastRandInt Rand{1234, 0, ChunkSection::Volume - 1};
+
+    std::vector<Uint16>  RandomIndices(NumOps);
+    std::vector<BlockId> RandomBlocks(NumOps);
+    for (Uint32 i = 0; i < NumOps; ++i)
+    {
+        RandomIndices[i] = static_cast<Uint16>(Rand());
+        RandomBlocks[i]  = Palette[RandomIndices[i] % _countof(Palette)];
+    }
+
+    ChunkSection Section;
+    for (Uint32 i = 0; i < ChunkSection::Volume; ++i)
+        Section.SetBlock(i, Palette[i % _countof(Palette)]);
+
+    Uint64 Checksum = 0;
+    Timer  Tmr;
+
+    Tmr.Restart();
+    for (Uint32 p = 0; p < NumPasses; ++p)
+    {
+        for (Uint32 i = 0; i < ChunkSection::Volume; ++i)
+            Checksum += Section.GetBlock(i);
+    }
+    Result.Add("linear_get_mops", MOpsPerSec(NumOps, Tmr.GetElapsedTime()));
+
+    Tmr.Restart();
+    for (Uint32 i = 0; i < NumOps; ++i)
+        Checksum += Section.GetBlock(RandomIndices[i]);
+    Result.Add("random_get_mops", MOpsPerSec(NumOps, Tmr.GetElapsedTime()));
+
+    Tmr.Restart();
+    for (Uint32 p = 0; p < NumPasses; ++p)
+    {
+        for (Uint32 i = 0; i < ChunkSection::Volume; ++i)
+            Section.SetBlock(i, RandomBlocks[p * ChunkSection::Volume + i]);
+    }
+    Result.Add("linear_set_mops", MOpsPerSec(NumOps, Tmr.GetElapsedTime()));
+
+    Tmr.Restart();
+    for (Uint32 i = 0; i < NumOps; ++i)
+        Section.SetBlock(RandomIndices[i], RandomBlocks[NumOps - 1 - i]);
+    Result.Add("random_set_mops", MOpsPerSec(NumOps, Tmr.GetElapsedTime()));
+
+    Result.Add("section_bits_per_block", Section.GetBitsPerBlock());
+    Result.Add("section_bytes", static_cast<double>(Section.GetMemoryUsage()));
+
+    // World-level access goes through the chunk map as well
+    World Wrld;
+    CreateTestWorld(Wrld, 16);
+
+    constexpr Int32 Extent = 16 * 16;
+    FastRandInt     RandXZ{5678, -Extent, Extent + 15};
+    FastRandInt     RandY{9012, 0, Chunk::Height - 1};
+
+    std::vector<int3> RandomPositions(NumOps / 4);
+    for (auto& Pos : RandomPositions)
+        Pos = int3{RandXZ(), RandY(), RandXZ()};
+
+    Tmr.Restart();
+    for (const auto& Pos : RandomPositions)
+        Checksum += Wrld.GetBlock(Pos.x, Pos.y, Pos.z);
+    Result.Add("world_random_get_mops", MOpsPerSec(static_cast<double>(RandomPositions.size()), Tmr.GetElapsedTime()));
+
+    const double NumBlocks = static_cast<double>(Wrld.GetChunkCount()) * 16 * 16 * Chunk::Height;
+    Result.Add("world_bytes_per_block", static_cast<double>(Wrld.GetMemoryUsage()) / NumBlocks);
+
+    g_BenchmarkSink = g_BenchmarkSink + Checksum;
+    return Result;
+}
+
+BenchmarkResult RunChunkMeshingBenchmark()
+{
+    BenchmarkResult Result{"Chunk meshing"};
+
+    World Wrld;
+    CreateTestWorld(Wrld, 8);
+
+    // Light the world first so that smooth lighting sees real gradients
+    LightEngine Light{std::max(std::thread::hardware_concurrency(), 1u)};
+    LightWorld(Wrld, Light);
+
+    // The layout meshes used before packing: four float3 position + float2 uv vertices per
+    // face. Packed meshes upload one vertex per quad.
+    constexpr double NaiveVertexSize      = 20;
+    constexpr double NaiveVerticesPerQuad = 4;
+
+    ChunkMesher          Mesher;
+    ChunkMesh            Mesh;
+    std::vector<BlockId> Padded(ChunkMesher::PaddedVolume);
+    std::vector<Uint8>   PaddedLight(ChunkMesher::PaddedVolume);
+
+    double NaiveVertices       = 0;
+    double UnlitGreedyVertices = 0;
+    double GreedyVertices      = 0;
+    double NaiveTime           = 0;
+    double UnlitGreedyTime     = 0;
+    double GreedyTime          = 0;
+    Uint32 NumSections         = 0;
+
+    Timer Tmr;
+    Wrld.ForEachChunk([&](const Chunk& Chnk) {
+        for (Int32 s = 0; s < Chunk::NumSections; ++s)
+        {
+            if (Chnk.GetSection(s).IsEmpty())
+                continue;
+
+            const int3 SectionPos{Chnk.GetX(), s, Chnk.GetZ()};
+            const auto Sections = ChunkMesher::GetNeighbourhood(Wrld, SectionPos);
+            ChunkMesher::GatherBlocks(Sections, Padded.data());
+
+            Tmr.Restart();
+            Mesher.Mesh(Padded.data(), nullptr, Mesh, false);
+            NaiveTime += Tmr.GetElapsedTime();
+            NaiveVertices += static_cast<double>(Mesh.GetQuadCount()) * NaiveVerticesPerQuad;
+
+            // Without lighting every face merges with its neighbours of the same block
+            Tmr.Restart();
+            Mesher.Mesh(Padded.data(), nullptr, Mesh, true);
+            UnlitGreedyTime += Tmr.GetElapsedTime();
+            UnlitGreedyVertices += static_cast<double>(Mesh.Vertices.size());
+
+            // The smooth lit mesh is the one the game uploads. It pays for gathering the light
+            // as well as for the corner sampling.
+            Tmr.Restart();
+            ChunkMesher::GatherLight(Sections, PaddedLight.data());
+            Mesher.Mesh(Padded.data(), PaddedLight.data(), Mesh, true);
+            GreedyTime += Tmr.GetElapsedTime();
+            GreedyVertices += static_cast<double>(Mesh.Vertices.size());
+
+            ++NumSections;
+        }
+    });
+
+    Result.Add("sections", NumSections);
+    Result.Add("naive_vertices", NaiveVertices);
+    Result.Add("greedy_vertices", GreedyVertices);
+    Result.Add("vertex_reduction", GreedyVertices > 0 ? NaiveVertices / GreedyVertices : 0);
+    Result.Add("unlit_greedy_vertices", UnlitGreedyVertices);
+    Result.Add("unlit_vertex_reduction", UnlitGreedyVertices > 0 ? NaiveVertices / UnlitGreedyVertices : 0);
+    Result.Add("naive_vertex_mb", NaiveVertices * NaiveVertexSize / (1 << 20));
+    Result.Add("greedy_vertex_mb", GreedyVertices * sizeof(ChunkVertex) / (1 << 20));
+    Result.Add("bandwidth_reduction", GreedyVertices > 0 ? (NaiveVertices * NaiveVertexSize) / (GreedyVertices * sizeof(ChunkVertex)) : 0);
+    Result.Add("naive_us_per_section", NumSections > 0 ? NaiveTime * 1e6 / NumSections : 0);
+    Result.Add("unlit_greedy_us_per_section", NumSections > 0 ? UnlitGreedyTime * 1e6 / NumSections : 0);
+    Result.Add("greedy_us_per_section", NumSections > 0 ? GreedyTime * 1e6 / NumSections : 0);
+    // Budget: under 0.3 over unlit greedy meshing
+    Result.Add("smooth_light_overhead", UnlitGreedyTime > 0 ? GreedyTime / UnlitGreedyTime - 1 : 0);
+
+    return Result;
+}
+
+BenchmarkResult RunFrustumCullingBenchmark()
+{
+    BenchmarkResult Result{"Frustum culling"};
+
+    // 112 x 112 chunks of 8 sections, roughly the section count at a 32-chunk render
+    // distance with the full LCE world height loaded around the player
+    constexpr Int32  Radius      = 56;
+    constexpr Uint32 NumViews    = 16;
+    constexpr Uint32 NumRepeats  = 8;
+    constexpr float  SectionSize = 16;
+
+    FrustumCuller         Culler;
+    std::vector<BoundBox> Boxes;
+    for (Int32 z = -Radius; z < Radius; ++z)
+    {
+        for (Int32 x = -Radius; x < Radius; ++x)
+        {
+            for (Int32 y = 0; y < Chunk::NumSections; ++y)
+            {
+                const float3 Min{x * SectionSize, y * SectionSize, z * SectionSize};
+                Boxes.push_back(BoundBox{Min, Min + float3{SectionSize, SectionSize, SectionSize}});
+                Culler.Add(Boxes.back());
+            }
+        }
+    }
+
+    const Uint32        NumBoxes = Culler.GetCount();
+    std::vector<Uint32> Visible(NumBoxes);
+    std::vector<Uint8>  Reference(NumBoxes);
+
+    const bool HasAVX2 = GetCpuFeatures().AVX2;
+
+    double ReferenceTime  = 0;
+    double ScalarTime     = 0;
+    double AVX2Time       = 0;
+    double TotalVisible   = 0;
+    Uint32 ScalarMismatch = 0;
+    Uint32 AVX2Mismatch   = 0;
+
+    // Compares a kernel's output against the per-box reference visibility
+    auto CountMismatches = [&](Uint32 NumVisible) {
+        Uint32 Mismatches = 0;
+        Uint32 Next       = 0;
+        for (Uint32 i = 0; i < NumBoxes; ++i)
+        {
+            const bool KernelVisible = Next < NumVisible && Visible[Next] == i;
+            Next += KernelVisible ? 1 : 0;
+            Mismatches += (KernelVisible != (Reference[i] != 0)) ? 1 : 0;
+        }
+        return Mismatches;
+    };
+
+    Timer Tmr;
+    for (Uint32 v = 0; v < NumViews; ++v)
+    {
+        // Look around the horizon, tilted down a little as when walking
+        const float    Yaw  = static_cast<float>(v) / NumViews * 2.f * PI_F;
+        const float4x4 View = float4x4::Translation(0, -80, 0) * float4x4::RotationY(-Yaw) * float4x4::RotationX(0.3f);
+        const float4x4 Proj = float4x4::Projection(PI_F / 4.f, 16.f / 9.f, 0.1f, 1000.f, false);
+
+        ViewFrustum Frustum;
+        ExtractViewFrustumPlanesFromMatrix(View * Proj, Frustum, false);
+
+        Tmr.Restart();
+        for (Uint32 r = 0; r < NumRepeats; ++r)
+        {
+            for (Uint32 i = 0; i < NumBoxes; ++i)
+                Reference[i] = GetBoxVisibility(Frustum, Boxes[i]) != BoxVisibility::Invisible ? 1 : 0;
+        }
+        ReferenceTime += Tmr.GetElapsedTime();
+
+        Uint32 NumVisible = 0;
+        Tmr.Restart();
+        for (Uint32 r = 0; r < NumRepeats; ++r)
+            NumVisible = Culler.CullScalar(Frustum, Visible.data());
+        ScalarTime += Tmr.GetElapsedTime();
+        ScalarMismatch += CountMismatches(NumVisible);
+        TotalVisible += NumVisible;
+
+        if (HasAVX2)
+        {
+            Tmr.Restart();
+            for (Uint32 r = 0; r < NumRepeats; ++r)
+                NumVisible = Culler.CullAVX2(Frustum, Visible.data());
+            AVX2Time += Tmr.GetElapsedTime();
+            AVX2Mismatch += CountMismatches(NumVisible);
+        }
+    }
+
+    constexpr double NumCulls = NumViews * NumRepeats;
+
+    Result.Add("sections", NumBoxes);
+    Result.Add("visible_sections", TotalVisible / NumViews);
+    Result.Add("reference_ms", ReferenceTime * 1000.0 / NumCulls);
+    Result.Add("scalar_ms", ScalarTime * 1000.0 / NumCulls);
+    Result.Add("scalar_mismatches", ScalarMismatch);
+    if (HasAVX2)
+    {
+        Result.Add("avx2_ms", AVX2Time * 1000.0 / NumCulls);
+        Result.Add("avx2_speedup", AVX2Time > 0 ? ScalarTime / AVX2Time : 0);
+        Result.Add("avx2_mismatches", AVX2Mismatch);
+    }
+
+    return Result;
+}
+
+BenchmarkResult RunCaveCullingBenchmark()
+{
+    BenchmarkResult Result{"Cave culling"};
+
+    constexpr Int32  Radius     = 12;
+    constexpr Uint32 NumViews   = 8;
+    constexpr Uint32 NumRays    = 4096;
+    constexpr float  RayStep    = 0.05f;
+    constexpr float  MaxRayDist = Radius * 16.f;
+
+    World Wrld;
+    CreateTestWorld(Wrld, Radius + 1);
+
+    ChunkMesher          Mesher;
+    VisibilityGraph      Graph;
+    std::vector<BlockId> Padded(ChunkMesher::PaddedVolume);
+
+    Uint32 NumSections      = 0;
+    double ConnectivityTime = 0;
+
+    Timer Tmr;
+    Wrld.ForEachChunk([&](const Chunk& Chnk) {
+        for (Int32 s = 0; s < Chunk::NumSections; ++s)
+        {
+            if (Chnk.GetSection(s).IsEmpty())
+                continue;
+
+            const int3 SectionPos{Chnk.GetX(), s, Chnk.GetZ()};
+            ChunkMesher::GatherBlocks(ChunkMesher::GetNeighbourhood(Wrld, SectionPos), Padded.data());
+
+            Tmr.Restart();
+            Graph.SetConnectivity(SectionPos, Mesher.ComputeConnectivity(Padded.data()));
+            ConnectivityTime += Tmr.GetElapsedTime();
+            ++NumSections;
+        }
+    });
+
+    // One camera in the tunnel under the origin, one above the terrain
+    const float3 Cameras[] = {{0.5f, 24.5f, 0.5f}, {0.5f, 70.5f, 0.5f}};
+
+    double SearchTime = 0;
+    double InFrustum  = 0;
+    double Reached    = 0;
+    Uint32 Misses     = 0;
+
+    FastRandFloat Rand{42, -1.f, 1.f};
+    for (const float3& CameraPos : Cameras)
+    {
+        for (Uint32 v = 0; v < NumViews; ++v)
+        {
+            const float    Yaw  = static_cast<float>(v) / NumViews * 2.f * PI_F;
+            const float4x4 View = float4x4::Translation(-CameraPos) * float4x4::RotationY(-Yaw);
+            const float4x4 Proj = float4x4::Projection(PI_F / 3.f, 16.f / 9.f, 0.1f, 1000.f, false);
+
+            ViewFrustum Frustum;
+            ExtractViewFrustumPlanesFromMatrix(View * Proj, Frustum, false);
+
+            Tmr.Restart();
+            Graph.Update(CameraPos, Frustum, Radius);
+            SearchTime += Tmr.GetElapsedTime();
+
+            for (Int32 z = -Radius; z <= Radius; ++z)
+            {
+                for (Int32 x = -Radius; x <= Radius; ++x)
+                {
+                    for (Int32 y = 0; y < Chunk::NumSections; ++y)
+                    {
+                        const float3 Min{x * 16.f, y * 16.f, z * 16.f};
+                        if (GetBoxVisibility(Frustum, BoundBox{Min, Min + float3{16, 16, 16}}) == BoxVisibility::Invisible)
+                            continue;
+                        InFrustum += 1;
+                        Reached += Graph.IsVisible(int3{x, y, z}) ? 1 : 0;
+                    }
+                }
+            }
+
+            // Every section a ray from the camera passes through before hitting an
+            // opaque block must have been reached
+            for (Uint32 r = 0; r < NumRays; ++r)
+            {
+                const float3 Dir = normalize(float3{Rand(), Rand() * 0.5f, Rand()});
+                if (GetBoxVisibility(Frustum, BoundBox{CameraPos + Dir, CameraPos + Dir}) == BoxVisibility::Invisible)
+                    continue;
+
+                for (float t = 0; t < MaxRayDist; t += RayStep)
+                {
+                    const float3 P = CameraPos + Dir * t;
+                    const int3   Block{static_cast<Int32>(std::floor(P.x)), static_cast<Int32>(std::floor(P.y)), static_cast<Int32>(std::floor(P.z))};
+                    if (Block.y < 0 || Block.y >= Chunk::Height)
+                        break;
+
+                    const int3 SectionPos{World::BlockToChunk(Block.x), Block.y >> 4, World::BlockToChunk(Block.z)};
+                    if (std::abs(SectionPos.x) > Radius || std::abs(SectionPos.z) > Radius)
+                        break;
+                    if (!Graph.IsVisible(SectionPos))
+                    {
+                        ++Misses;
+                        break;
+                    }
+                    if (IsOpaqueBlock(Wrld.GetBlock(Block.x, Block.y, Block.z)))
+                        break;
+                }
+            }
+        }
+    }
+
+    constexpr double NumSearches = NumViews * _countof(Cameras);
+
+    Result.Add("sections", NumSections);
+    Result.Add("connectivity_us_per_section", NumSections > 0 ? ConnectivityTime * 1e6 / NumSections : 0);
+    Result.Add("search_ms", SearchTime * 1000.0 / NumSearches);
+    Result.Add("in_frustum_sections", InFrustum / NumSearches);
+    Result.Add("reached_sections", Reached / NumSearches);
+    Result.Add("culled_fraction", InFrustum > 0 ? 1.0 - Reached / InFrustum : 0);
+    Result.Add("ray_misses", Misses);
+
+    return Result;
+}
+
+BenchmarkResult RunRegionFileBenchmark()
+{
+    BenchmarkResult Result{"Region files"};
+
+    // 100x100 chunks spread over 4x4 region files
+    constexpr Int32 Side          = 100;
+    constexpr Int32 NumRegionsX   = (Side + RegionFile::Size - 1) / RegionFile::Size;
+    constexpr Int32 NumSources    = 8;
+    constexpr Int32 NumChunks     = Side * Side;
+    constexpr double BytesPerMB   = 1 << 20;
+
+    // Generating 10k chunks would dominate the run, so an 8x8 tile of distinct
+    // terrain is repeated across the regions
+    std::vector<std::unique_ptr<Chunk>> Sources;
+    for (Int32 i = 0; i < NumSources * NumSources; ++i)
+    {
+        Sources.emplace_back(std::make_unique<Chunk>((i % NumSources) * 3, (i / NumSources) * 3));
+        FillTestChunk(*Sources.back());
+    }
+    auto GetSource = [&](Int32 x, Int32 z) -> const Chunk& {
+        return *Sources[(z % NumSources) * NumSources + x % NumSources];
+    };
+
+    const std::filesystem::path Directory = std::filesystem::temp_directory_path() / "legacyoss_region_benchmark";
+    std::error_code             Error;
+    std::filesystem::remove_all(Directory, Error);
+    std::filesystem::create_directories(Directory, Error);
+
+    std::vector<std::unique_ptr<RegionFile>> Regions(NumRegionsX * NumRegionsX);
+    auto OpenRegions = [&]() {
+        for (size_t r = 0; r < Regions.size(); ++r)
+        {
+            Regions[r] = std::make_unique<RegionFile>();
+            Regions[r]->Open((Directory / ("r." + std::to_string(r) + ".region")).string());
+        }
+    };
+    auto GetRegion = [&](Int32 x, Int32 z) -> RegionFile& {
+        return *Regions[RegionFile::ChunkToRegion(z) * NumRegionsX + RegionFile::ChunkToRegion(x)];
+    };
+    auto GetSectorCount = [&]() {
+        Uint64 Count = 0;
+        for (const auto& pRegion : Regions)
+            Count += pRegion->GetSectorCount() - pRegion->GetFreeSectorCount();
+        return Count;
+    };
+
+    double RawBytes    = 0;
+    double StoredBytes = 0;
+    double SaveTime    = 0;
+    double RewriteTime = 0;
+    Uint32 Failures    = 0;
+
+    OpenRegions();
+    Timer Tmr;
+    for (Int32 Pass = 0; Pass < 2; ++Pass)
+    {
+        // The second pass rewrites every chunk, which must reuse the sectors the
+        // first one freed instead of growing the files
+        Tmr.Restart();
+        for (Int32 z = 0; z < Side; ++z)
+        {
+            for (Int32 x = 0; x < Side; ++x)
+            {
+                if (!GetRegion(x, z).WriteChunk(RegionFile::ChunkToLocal(x), RegionFile::ChunkToLocal(z), GetSource(x, z), 1))
+                    ++Failures;
+            }
+        }
+        (Pass == 0 ? SaveTime : RewriteTime) = Tmr.GetElapsedTime();
+    }
+
+    Uint64 FileSectors = 0;
+    for (Int32 z = 0; z < Side; ++z)
+    {
+        for (Int32 x = 0; x < Side; ++x)
+        {
+            const Chunk& Src = GetSource(x, z);
+            StoredBytes += GetRegion(x, z).GetChunkSize(RegionFile::ChunkToLocal(x), RegionFile::ChunkToLocal(z));
+
+            // Version word, then a record word and the block ids of every section
+            RawBytes += 2;
+            for (Int32 s = 0; s < Chunk::NumSections; ++s)
+                RawBytes += 2 * (1 + (Src.GetSection(s).IsUniform() ? 1 : ChunkSection::Volume));
+        }
+    }
+    const Uint64 UsedSectors = GetSectorCount();
+    for (const auto& pRegion : Regions)
+        FileSectors += pRegion->GetSectorCount();
+
+    // Reopen so that loads go through fresh mappings
+    OpenRegions();
+
+    std::vector<BlockId> Expected(ChunkSection::Volume);
+    std::vector<BlockId> Loaded(ChunkSection::Volume);
+
+    Chunk  Dst{0, 0};
+    double LoadTime   = 0;
+    Uint32 Mismatches = 0;
+    for (Int32 z = 0; z < Side; ++z)
+    {
+        for (Int32 x = 0; x < Side; ++x)
+        {
+            Tmr.Restart();
+            const bool Success = GetRegion(x, z).ReadChunk(RegionFile::ChunkToLocal(x), RegionFile::ChunkToLocal(z), Dst);
+            LoadTime += Tmr.GetElapsedTime();
+
+            if (!Success)
+            {
+                ++Failures;
+                continue;
+            }
+            for (Int32 s = 0; s < Chunk::NumSections; ++s)
+            {
+                GetSource(x, z).GetSection(s).Decode(Expected.data());
+                Dst.GetSection(s).Decode(Loaded.data());
+                Mismatches += Expected != Loaded ? 1 : 0;
+            }
+        }
+    }
+
+    Regions.clear();
+    std::filesystem::remove_all(Directory, Error);
+
+    Result.Add("chunks", NumChunks);
+    Result.Add("stored_mb", StoredBytes / BytesPerMB);
+    Result.Add("compression_ratio", StoredBytes > 0 ? RawBytes / StoredBytes : 0);
+    Result.Add("save_chunks_per_s", NumChunks / SaveTime);
+    Result.Add("save_mb_per_s", StoredBytes / BytesPerMB / SaveTime);
+    Result.Add("rewrite_chunks_per_s", NumChunks / RewriteTime);
+    Result.Add("load_chunks_per_s", NumChunks / LoadTime);
+    Result.Add("load_mb_per_s", StoredBytes / BytesPerMB / LoadTime);
+    Result.Add("load_raw_mb_per_s", RawBytes / BytesPerMB / LoadTime);
+    Result.Add("sector_utilization", FileSectors > 0 ? static_cast<double>(UsedSectors) / FileSectors : 0);
+    Result.Add("failures", Failures);
+    Result.Add("mismatches", Mismatches);
+
+    return Result;
+}
+
+BenchmarkResult RunLightingBenchmark()
+{
+    BenchmarkResult Result{"Lighting"};
+
+    constexpr Int32  Radius     = 4;
+    constexpr Uint32 NumTorches = 64;
+
+    World Wrld;
+    CreateTestWorld(Wrld, Radius);
+
+    const Uint32 NumThreads  = std::max(std::thread::hardware_concurrency(), 1u);
+    const double NumChunks   = static_cast<double>(Wrld.GetChunkCount());
+    Timer        Tmr;
+
+    {
+        LightEngine SingleThread{1};
+        Tmr.Restart();
+        LightWorld(Wrld, SingleThread);
+        Result.Add("full_light_1_thread_ms_per_chunk", Tmr.GetElapsedTime() * 1000.0 / NumChunks);
+    }
+
+    ClearLight(Wrld);
+    LightEngine Engine{NumThreads};
+    Tmr.Restart();
+    LightWorld(Wrld, Engine);
+    Result.Add("full_light_ms_per_chunk", Tmr.GetElapsedTime() * 1000.0 / NumChunks);
+    Result.Add("full_light_threads", NumThreads);
+    Result.Add("full_light_batches", Engine.GetLastBatchCount());
+
+    // Torches on the surface, away from the unlit edge of the test world
+    constexpr Int32 Extent = (Radius - 1) * 16;
+    FastRandInt     RandXZ{777, -Extent, Extent - 1};
+
+    auto GetSurfaceY = [&](Int32 x, Int32 z) {
+        Int32 y = Chunk::Height - 1;
+        while (y > 0 && Wrld.GetBlock(x, y, z) == BLOCK_AIR)
+            --y;
+        return y;
+    };
+
+    auto TimedChange = [&](Int32 x, Int32 y, Int32 z, BlockId Id) {
+        Wrld.SetBlock(x, y, z, Id);
+        Tmr.Restart();
+        Engine.QueueBlockChange(x, y, z);
+        Engine.Update(Wrld);
+        return Tmr.GetElapsedTime();
+    };
+
+    double PlaceTime    = 0;
+    double BreakTime    = 0;
+    double MaxPlaceTime = 0;
+    Uint32 NumChanged   = 0;
+    for (Uint32 t = 0; t < NumTorches; ++t)
+    {
+        const Int32 x = RandXZ();
+        const Int32 z = RandXZ();
+        const Int32 y = GetSurfaceY(x, z) + 1;
+
+        const double Place = TimedChange(x, y, z, BLOCK_TORCH);
+        NumChanged += static_cast<Uint32>(Engine.GetChangedSections().size());
+        PlaceTime += Place;
+        MaxPlaceTime = std::max(MaxPlaceTime, Place);
+        BreakTime += TimedChange(x, y, z, BLOCK_AIR);
+    }
+    Result.Add("torch_place_us", PlaceTime * 1e6 / NumTorches);
+    Result.Add("torch_place_max_us", MaxPlaceTime * 1e6);
+    Result.Add("torch_break_us", BreakTime * 1e6 / NumTorches);
+    Result.Add("torch_changed_sections", static_cast<double>(NumChanged) / NumTorches);
+
+    // A 1x1 shaft from the surface down to bedrock, one block per update, then a few
+    // light sources left in place for the consistency check below
+    const Int32 ShaftX = 5, ShaftZ = 5;
+    double      ShaftTime    = 0;
+    double      MaxShaftTime = 0;
+    Uint32      ShaftBlocks  = 0;
+    for (Int32 y = GetSurfaceY(ShaftX, ShaftZ); y > 0; --y, ++ShaftBlocks)
+    {
+        const double Dig = TimedChange(ShaftX, y, ShaftZ, BLOCK_AIR);
+        ShaftTime += Dig;
+        MaxShaftTime = std::max(MaxShaftTime, Dig);
+    }
+    Result.Add("shaft_blocks", ShaftBlocks);
+    Result.Add("shaft_us_per_block", ShaftBlocks > 0 ? ShaftTime * 1e6 / ShaftBlocks : 0);
+    Result.Add("shaft_max_us", MaxShaftTime * 1e6);
+
+    for (Uint32 t = 0; t < 8; ++t)
+    {
+        const Int32 x = RandXZ();
+        const Int32 z = RandXZ();
+        TimedChange(x, GetSurfaceY(x, z) + 1, z, t % 2 == 0 ? BLOCK_TORCH : BLOCK_GLOWSTONE);
+    }
+    TimedChange(ShaftX, 30, ShaftZ, BLOCK_STONE);
+
+    // Incremental updates must end up exactly where lighting from scratch does
+    const std::vector<Uint8> Incremental = SnapshotLight(Wrld);
+    ClearLight(Wrld);
+    LightWorld(Wrld, Engine);
+    const std::vector<Uint8> FromScratch = SnapshotLight(Wrld);
+
+    Uint32 Mismatches = 0;
+    for (size_t i = 0; i < Incremental.size(); ++i)
+        Mismatches += Incremental[i] != FromScratch[i] ? 1 : 0;
+    Result.Add("mismatches", Mismatches);
+
+    return Result;
+}
+
+BenchmarkResult RunRandomTickBenchmark()
+{
+    BenchmarkResult Result{"Random ticks"};
+
+    constexpr Int32 Radius = 8;
+
+    World Wrld;
+    CreateTestWorld(Wrld, Radius);
+
+    auto GetSurfaceY = [&](Int32 x, Int32 z) {
+        Int32 y = Chunk::Height - 1;
+        while (y > 0 && Wrld.GetBlock(x, y, z) == BLOCK_AIR)
+            --y;
+        return y;
+    };
+
+    // Trees and loose leaf blobs in the north half, covered grass and bare dirt in the
+    // south half, away from the edge of the world where leaves cannot decay
+    constexpr Int32  Extent   = (Radius - 1) * 16;
+    constexpr Uint32 NumSpots = 64;
+    FastRandInt      RandXZ{2468, -Extent, Extent - 1};
+    FastRandInt      RandNorth{1357, -Extent, -8};
+    FastRandInt      RandSouth{9753, 0, Extent - 1};
+
+    std::vector<int3> SupportedLeaves;
+    std::vector<int3> LooseLeaves;
+    for (Uint32 i = 0; i < NumSpots; ++i)
+    {
+        const bool  HasLog = i % 2 == 0;
+        const Int32 x      = (HasLog ? -1 : 1) * std::abs(RandXZ());
+        const Int32 z      = RandNorth();
+        const Int32 y      = GetSurfaceY(x, z) + 1;
+        if (HasLog)
+        {
+            for (Int32 dy = 0; dy < 5; ++dy)
+                Wrld.SetBlock(x, y + dy, z, BLOCK_LOG);
+        }
+        for (Int32 dy = 3; dy < 5; ++dy)
+        {
+            for (Int32 dz = -2; dz <= 2; ++dz)
+            {
+                for (Int32 dx = -2; dx <= 2; ++dx)
+                {
+                    const int3 Pos{x + dx, y + dy, z + dz};
+                    if (Wrld.GetBlock(Pos.x, Pos.y, Pos.z) != BLOCK_AIR)
+                        continue;
+                    Wrld.SetBlock(Pos.x, Pos.y, Pos.z, BLOCK_LEAVES);
+                    (HasLog ? SupportedLeaves : LooseLeaves).push_back(Pos);
+                }
+            }
+        }
+    }
+
+    std::vector<int3> CoveredGrass;
+    std::vector<int3> BareDirt;
+    for (Uint32 i = 0; i < NumSpots; ++i)
+    {
+        const Int32 x = RandXZ();
+        const Int32 z = RandSouth();
+        const Int32 y = GetSurfaceY(x, z);
+        if (Wrld.GetBlock(x, y, z) != BLOCK_GRASS)
+            continue;
+        if (i % 2 == 0)
+        {
+            Wrld.SetBlock(x, y + 1, z, BLOCK_STONE);
+            CoveredGrass.emplace_back(x, y, z);
+        }
+        else
+        {
+            Wrld.SetBlock(x, y, z, BLOCK_DIRT);
+            BareDirt.emplace_back(x, y, z);
+        }
+    }
+
+    const Uint32 NumThreads = std::max(std::thread::hardware_concurrency(), 1u);
+    {
+        LightEngine Engine{NumThreads};
+        LightWorld(Wrld, Engine);
+    }
+
+    // The counters kept as blocks are set must match a recount
+    Uint32 CounterMismatches = 0;
+    Wrld.ForEachChunk([&](const Chunk& Chnk) {
+        for (Int32 s = 0; s < Chunk::NumSections; ++s)
+        {
+            const ChunkSection& Section = Chnk.GetSection(s);
+
+            Uint32 Count = 0;
+            for (Uint32 i = 0; i < ChunkSection::Volume; ++i)
+                Count += IsRandomlyTickedBlock(Section.GetBlock(i)) ? 1 : 0;
+            CounterMismatches += Count != Section.GetRandomlyTickedCount() ? 1 : 0;
+        }
+    });
+    Result.Add("counter_mismatches", CounterMismatches);
+
+    const double     NumChunks = static_cast<double>(Wrld.GetChunkCount());
+    constexpr Uint32 NumTicks  = 200;
+    Timer            Tmr;
+
+    auto TimeTicks = [&](RandomTicker& Ticker) {
+        Tmr.Restart();
+        for (Uint32 t = 0; t < NumTicks; ++t)
+            Ticker.Tick(Wrld);
+        return Tmr.GetElapsedTime() * 1e6 / (NumTicks * NumChunks);
+    };
+
+    {
+        RandomTicker SingleThread{1, 1234};
+        Result.Add("us_per_chunk_1_thread", TimeTicks(SingleThread));
+    }
+    RandomTicker Ticker{NumThreads, 1234};
+    Result.Add("us_per_chunk", TimeTicks(Ticker));
+    Result.Add("threads", NumThreads);
+
+    const double NumSections = Ticker.GetLastTickedSectionCount() + Ticker.GetLastSkippedSectionCount();
+    Result.Add("ticked_sections_pct", NumSections > 0 ? Ticker.GetLastTickedSectionCount() * 100.0 / NumSections : 0);
+
+    // Picking blocks in every section against skipping sections by their counters,
+    // without the block rules
+    FastRand Rand{4321};
+    Uint64   Checksum  = 0;
+    auto     TimePicks = [&](bool UseCounters) {
+        Tmr.Restart();
+        for (Uint32 t = 0; t < NumTicks; ++t)
+        {
+            Wrld.ForEachChunk([&](const Chunk& Chnk) {
+                for (Int32 s = 0; s < Chunk::NumSections; ++s)
+                {
+                    const ChunkSection& Section = Chnk.GetSection(s);
+                    if (UseCounters && Section.GetRandomlyTickedCount() == 0)
+                        continue;
+                    for (Uint32 i = 0; i < RandomTicker::TicksPerSection; ++i)
+                        Checksum += IsRandomlyTickedBlock(Section.GetBlock(Rand() & (ChunkSection::Volume - 1))) ? 1 : 0;
+                }
+            });
+        }
+        return Tmr.GetElapsedTime() * 1e6 / (NumTicks * NumChunks);
+    };
+    const double AllPicks     = TimePicks(false);
+    const double CountedPicks = TimePicks(true);
+    Result.Add("pick_all_sections_us_per_chunk", AllPicks);
+    Result.Add("pick_counted_sections_us_per_chunk", CountedPicks);
+    Result.Add("skip_speedup", CountedPicks > 0 ? AllPicks / CountedPicks : 0);
+    g_BenchmarkSink = g_BenchmarkSink + Checksum;
+
+    // Long enough for most blocks to be picked a few times
+    for (Uint32 t = 0; t < 4000; ++t)
+        Ticker.Tick(Wrld);
+
+    auto Share = [&](const std::vector<int3>& Positions, BlockId Id) {
+        Uint32 Count = 0;
+        for (const int3& Pos : Positions)
+            Count += Wrld.GetBlock(Pos.x, Pos.y, Pos.z) == Id ? 1 : 0;
+        return Positions.empty() ? 0.0 : Count * 100.0 / Positions.size();
+    };
+    Result.Add("covered_grass_died_pct", Share(CoveredGrass, BLOCK_DIRT));
+    Result.Add("bare_dirt_grown_pct", Share(BareDirt, BLOCK_GRASS));
+    Result.Add("loose_leaves_decayed_pct", Share(LooseLeaves, BLOCK_AIR));
+    // Leaves next to a log must never decay
+    Result.Add("supported_leaves_decayed_pct", Share(SupportedLeaves, BLOCK_AIR));
+
+    return Result;
+}
+
+BenchmarkResult RunRedstoneBenchmark()
+{
+    BenchmarkResult Result{"Redstone"};
+
+    // Flat stone floor with a grid of torch clocks on it. Each clock is a torch on a
+    // block, feeding a loop of 11 wires that comes back down and points into the same
+    // block, so the torch switches every two ticks.
+    constexpr Int32 Radius = 4;
+    constexpr Int32 FloorY = 4;
+
+    struct Circuit
+    {
+        World             Wrld;
+        RedstoneEngine    Engine;
+        std::vector<int3> Torches;
+        std::vector<int3> Wires;
+        std::vector<int3> LastWires;
+
+        explicit Circuit(REDSTONE_MODE Mode) :
+            Engine{Mode}
+        {}
+
+        void Set(const int3& Pos, BlockId Id)
+        {
+            Wrld.SetBlock(Pos.x, Pos.y, Pos.z, Id);
+            Engine.OnBlockChanged(Pos.x, Pos.y, Pos.z);
+            if (Id == BLOCK_REDSTONE_WIRE)
+                Wires.push_back(Pos);
+        }
+
+        void Build()
+        {
+            for (Int32 cz = -Radius; cz < Radius; ++cz)
+            {
+                for (Int32 cx = -Radius; cx < Radius; ++cx)
+                {
+                    Chunk& Chnk = Wrld.GetOrCreateChunk(cx, cz);
+                    for (Uint32 z = 0; z < 16; ++z)
+                    {
+                        for (Uint32 x = 0; x < 16; ++x)
+                        {
+                            for (Int32 y = 0; y <= FloorY; ++y)
+                                Chnk.SetBlock(x, y, z, BLOCK_STONE);
+                        }
+                    }
+                }
+            }
+
+            constexpr Int32 Extent = Radius * 16;
+            for (Int32 oz = -Extent + 2; oz + 2 < Extent - 1; oz += 4)
+            {
+                for (Int32 ox = -Extent + 4; ox + 1 < Extent - 1; ox += 6)
+                {
+                    const Int32 y = FloorY + 1;
+                    Set({ox, y, oz}, BLOCK_STONE);
+                    Set({ox, y + 1, oz}, BLOCK_REDSTONE_TORCH);
+                    Torches.emplace_back(ox, y + 1, oz);
+
+                    // Raised loop on support blocks
+                    const int3 Raised[] = {
+                        {ox + 1, y + 1, oz}, {ox + 1, y + 1, oz + 1}, {ox + 1, y + 1, oz + 2}, {ox, y + 1, oz + 2}, {ox - 1, y + 1, oz + 2},
+                        {ox - 2, y + 1, oz + 2}, {ox - 3, y + 1, oz + 2}, {ox - 3, y + 1, oz + 1}, {ox - 3, y + 1, oz}, //
+                    };
+                    for (const int3& Pos : Raised)
+                    {
+                        Set(Pos - int3{0, 1, 0}, BLOCK_STONE);
+                        Set(Pos, BLOCK_REDSTONE_WIRE);
+                    }
+                    // Down onto the floor and into the block under the torch
+                    Set({ox - 2, y, oz}, BLOCK_REDSTONE_WIRE);
+                    Set({ox - 1, y, oz}, BLOCK_REDSTONE_WIRE);
+                    LastWires.emplace_back(ox - 1, y, oz);
+                }
+            }
+        }
+    };
+
+    Circuit Compiled{REDSTONE_MODE_COMPILED};
+    Circuit Naive{REDSTONE_MODE_NEIGHBOUR_UPDATES};
+    Compiled.Build();
+    Naive.Build();
+    Result.Add("clocks", static_cast<double>(Compiled.Torches.size()));
+    Result.Add("wires", static_cast<double>(Compiled.Wires.size()));
+
+    constexpr Uint32 NumTicks        = 400;
+    double           CompiledTime    = 0;
+    double           NaiveTime       = 0;
+    Uint64           CompiledUpdates = 0;
+    Uint64           NaiveUpdates    = 0;
+    Uint64           NumSwitches     = 0;
+    Uint32           NumCompiles     = 0;
+    Uint32           TorchMismatches = 0;
+    Timer            Tmr;
+    for (Uint32 t = 0; t < NumTicks; ++t)
+    {
+        // Halfway through, a quarter of the clocks lose their last wire and stop, which
+        // invalidates their networks
+        if (t == NumTicks / 2)
+        {
+            for (size_t i = 0; i < Compiled.LastWires.size(); i += 4)
+            {
+                Compiled.Set(Compiled.LastWires[i], BLOCK_AIR);
+                Naive.Set(Naive.LastWires[i], BLOCK_AIR);
+            }
+        }
+
+        Tmr.Restart();
+        Compiled.Engine.Tick(Compiled.Wrld);
+        CompiledTime += Tmr.GetElapsedTime();
+        Tmr.Restart();
+        Naive.Engine.Tick(Naive.Wrld);
+        NaiveTime += Tmr.GetElapsedTime();
+
+        CompiledUpdates += Compiled.Engine.GetLastUpdateCount();
+        NaiveUpdates += Naive.Engine.GetLastUpdateCount();
+        NumSwitches += Compiled.Engine.GetChangedBlocks().size();
+        NumCompiles += Compiled.Engine.GetLastCompileCount();
+
+        // Both modes must switch the same torches on the same ticks
+        for (const int3& Pos : Compiled.Torches)
+            TorchMismatches += Compiled.Wrld.GetBlock(Pos.x, Pos.y, Pos.z) != Naive.Wrld.GetBlock(Pos.x, Pos.y, Pos.z) ? 1 : 0;
+    }
+
+    Result.Add("networks", static_cast<double>(Compiled.Engine.GetNetworkCount()));
+    Result.Add("compiles", NumCompiles);
+    Result.Add("torch_switches_per_tick", static_cast<double>(NumSwitches) / NumTicks);
+    Result.Add("compiled_updates_per_tick", static_cast<double>(CompiledUpdates) / NumTicks);
+    Result.Add("naive_updates_per_tick", static_cast<double>(NaiveUpdates) / NumTicks);
+    Result.Add("update_reduction", CompiledUpdates > 0 ? static_cast<double>(NaiveUpdates) / CompiledUpdates : 0);
+    Result.Add("compiled_ms_per_tick", CompiledTime * 1000.0 / NumTicks);
+    Result.Add("naive_ms_per_tick", NaiveTime * 1000.0 / NumTicks);
+    Result.Add("speedup", CompiledTime > 0 ? NaiveTime / CompiledTime : 0);
+    Result.Add("torch_mismatches", TorchMismatches);
+
+    Uint32 PowerMismatches = 0;
+    for (const int3& Pos : Compiled.Wires)
+        PowerMismatches += Compiled.Engine.GetWirePower(Pos) != Naive.Engine.GetWirePower(Pos) ? 1 : 0;
+    Result.Add("power_mismatches", PowerMismatches);
+
+    return Result;
+}
+
+BenchmarkResult RunPlayerPhysicsBenchmark()
+{
+    BenchmarkResult Result{"Player physics"};
+
+    auto PlayerBox = [](const float3& Feet) {
+        return BoundBox{Feet - float3{PlayerPhysics::Width * 0.5f, 0, PlayerPhysics::Width * 0.5f},
+                        Feet + float3{PlayerPhysics::Width * 0.5f, PlayerPhysics::Height, PlayerPhysics::Width * 0.5f}};
+    };
+
+    // Random moves of a player-sized box through terrain with caves, from a tenth of a
+    // block to fast falls of 50 blocks
+    World Terrain;
+    CreateTestWorld(Terrain, 4);
+
+    constexpr Uint32 NumQueries = 10000;
+    FastRandFloat    RandXZ{1357, -56.f, 56.f};
+    FastRandFloat    RandY{2468, 20.f, 100.f};
+    FastRandFloat    RandDir{3579, -1.f, 1.f};
+    FastRandFloat    RandLog{4680, -1.f, 1.7f};
+
+    std::vector<BoundBox> Boxes(NumQueries);
+    std::vector<float3>   Deltas(NumQueries);
+    for (Uint32 i = 0; i < NumQueries; ++i)
+    {
+        Boxes[i] = PlayerBox(float3{RandXZ(), RandY(), RandXZ()});
+
+        float3 Dir = float3{RandDir(), RandDir(), RandDir()};
+        Dir        = length(Dir) > 1e-3f ? normalize(Dir) : float3{0, -1, 0};
+        Deltas[i]  = Dir * std::pow(10.f, RandLog());
+    }
+
+    float3 Checksum;
+    Timer  Tmr;
+    for (Uint32 i = 0; i < NumQueries; ++i)
+        Checksum += MoveBox(Terrain, Boxes[i], Deltas[i], PlayerPhysics::StepHeight);
+    const double QueryTime = Tmr.GetElapsedTime();
+
+    Result.Add("queries", NumQueries);
+    Result.Add("us_per_query", QueryTime * 1e6 / NumQueries);
+    Result.Add("checksum", Checksum.x + Checksum.y + Checksum.z);
+
+    return Result;
+}
+
+BenchmarkResult RunBlockPickingBenchmark()
+{
+    BenchmarkResult Result{"Block picking"};
+
+    constexpr Int32 Radius = 4;
+    World           Wrld;
+    CreateTestWorld(Wrld, Radius);
+
+    // Rays from random points in the terrain, caves included, in random directions
+    constexpr Uint32 NumRays = 100000;
+    FastRandFloat    RandXZ{1122, -48.f, 48.f};
+    FastRandFloat    RandY{3344, 30.f, 90.f};
+    FastRandFloat    RandDir{5566, -1.f, 1.f};
+
+    std::vector<float3> Origins(NumRays);
+    std::vector<float3> Directions(NumRays);
+    for (Uint32 i = 0; i < NumRays; ++i)
+    {
+        Origins[i] = float3{RandXZ(), RandY(), RandXZ()};
+
+        const float3 Dir = float3{RandDir(), RandDir(), RandDir()};
+        Directions[i]    = length(Dir) > 1e-3f ? normalize(Dir) : float3{0, -1, 0};
+    }
+
+    constexpr float LongReach = 64;
+    Uint32          NumHits   = 0;
+    Timer           Tmr;
+    for (Uint32 i = 0; i < NumRays; ++i)
+    {
+        BlockHit Hit;
+        NumHits += RaycastBlocks(Wrld, Origins[i], Directions[i], LongReach, Hit) ? 1 : 0;
+    }
+    const double RayTime = Tmr.GetElapsedTime();
+    Result.Add("us_per_ray", RayTime * 1e6 / NumRays);
+    Result.Add("hit_rate", static_cast<double>(NumHits) / NumRays);
+
+    // Checks short rays against a slab test of every cell around them: the hit cell must
+    // be entered at the reported distance, and no pickable cell may be crossed before it
+    constexpr Uint32 NumChecked   = 2000;
+    constexpr float  CheckedReach = 12;
+    constexpr float  Tolerance    = 1e-3f;
+    Uint32           NumWrong     = 0;
+    for (Uint32 i = 0; i < NumChecked; ++i)
+    {
+        const float3& Origin = Origins[i];
+        const float3& Dir    = Directions[i];
+
+        // Distances at which the ray enters and leaves the cell
+        auto Intersect = [&](const int3& Cell, float& Enter, float& Exit) {
+            Enter = 0;
+            Exit  = CheckedReach;
+            for (Uint32 Axis = 0; Axis < 3; ++Axis)
+            {
+                const float Min = static_cast<float>(Cell[Axis]);
+                if (Dir[Axis] == 0)
+                {
+                    if (Origin[Axis] < Min || Origin[Axis] >= Min + 1)
+                        Exit = -1;
+                    continue;
+                }
+                float t0 = (Min - Origin[Axis]) / Dir[Axis];
+                float t1 = (Min + 1 - Origin[Axis]) / Dir[Axis];
+                if (t0 > t1)
+                    std::swap(t0, t1);
+                Enter = std::max(Enter, t0);
+                Exit  = std::min(Exit, t1);
+            }
+        };
+
+        BlockHit    Hit;
+        const bool  IsHit = RaycastBlocks(Wrld, Origin, Dir, CheckedReach, Hit);
+        const float End   = IsHit ? Hit.Distance : CheckedReach;
+        if (IsHit)
+        {
+            float Enter, Exit;
+            Intersect(Hit.Pos, Enter, Exit);
+            if (std::abs(Enter - Hit.Distance) > Tolerance || Exit < Enter)
+                ++NumWrong;
+        }
+
+        const float3 Far = Origin + Dir * End;
+        const int3   Lo{static_cast<Int32>(std::floor(std::min(Origin.x, Far.x))), static_cast<Int32>(std::floor(std::min(Origin.y, Far.y))),
+                      static_cast<Int32>(std::floor(std::min(Origin.z, Far.z)))};
+        const int3   Hi{static_cast<Int32>(std::floor(std::max(Origin.x, Far.x))), static_cast<Int32>(std::floor(std::max(Origin.y, Far.y))),
+                      static_cast<Int32>(std::floor(std::max(Origin.z, Far.z)))};
+        bool         Missed = false;
+        for (Int32 y = Lo.y; y <= Hi.y && !Missed; ++y)
+        {
+            for (Int32 z = Lo.z; z <= Hi.z && !Missed; ++z)
+            {
+                for (Int32 x = Lo.x; x <= Hi.x && !Missed; ++x)
+                {
+                    if (!IsPickableBlock(Wrld.GetBlock(x, y, z)))
+                        continue;
+                    // Rays grazing an edge or a corner may go either way
+                    float Enter, Exit;
+                    Intersect(int3{x, y, z}, Enter, Exit);
+                    Missed = Exit - Enter > Tolerance && Enter < End - Tolerance;
+                }
+            }
+        }
+        NumWrong += Missed ? 1 : 0;
+    }
+    Result.Add("wrong_hits", NumWrong);
+
+    // Edit latency behind a full meshing backlog: the sections sampling an edited block far
+    // from the camera are requested once as urgent and once as normal jobs
+    const Uint32 NumThreads = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+    const int3   EditPos{Radius * 16 - 16, 64, Radius * 16 - 16};
+    for (bool IsUrgent : {true, false})
+    {
+        MeshScheduler Scheduler{NumThreads};
+        for (Int32 cz = -Radius; cz < Radius; ++cz)
+        {
+            for (Int32 cx = -Radius; cx < Radius; ++cx)
+            {
+                for (Int32 s = 0; s < Chunk::NumSections; ++s)
+                    Scheduler.RequestMesh(Wrld, int3{cx, s, cz});
+            }
+        }
+        const Uint32 Backlog = Scheduler.GetPendingCount();
+
+        Tmr.Restart();
+        std::vector<Uint64> EditedKeys;
+        ChunkMesher::ForEachSectionSampling(EditPos, [&](const int3& SectionPos) {
+            Scheduler.RequestMesh(Wrld, SectionPos, IsUrgent);
+            EditedKeys.push_back(World::PackSectionKey(SectionPos));
+        });
+
+        // Apply with no budget, as a frame would, until all edited sections are back
+        size_t NumApplied = 0;
+        Uint32 NumFrames  = 0;
+        while (NumApplied < EditedKeys.size())
+        {
+            Scheduler.WaitForUrgent();
+            Scheduler.ApplyCompleted(
+                [&](const int3& SectionPos, ChunkMesh&&) {
+                    const Uint64 Key = World::PackSectionKey(SectionPos);
+                    NumApplied += std::count(EditedKeys.begin(), EditedKeys.end(), Key);
+                },
+                0, 0);
+            ++NumFrames;
+            if (NumApplied < EditedKeys.size())
+                std::this_thread::yield();
+        }
+        const double Latency = Tmr.GetElapsedTime();
+
+        if (IsUrgent)
+        {
+            Result.Add("backlog_sections", Backlog);
+            Result.Add("urgent_remesh_ms", Latency * 1000.0);
+            Result.Add("urgent_remesh_frames", NumFrames);
+        }
+        else
+        {
+            Result.Add("queued_remesh_ms", Latency * 1000.0);
+            Result.Add("queued_remesh_frames", NumFrames);
+        }
+    }
+
+    return Result;
+}
+
+namespace
+{
+
+// Entities the way they are often written: one heap object each, updated through a
+// virtual call. The entity store is checked against these.
+class AosEntity
+{
+public:
+    virtual ~AosEntity() = default;
+
+    virtual void Tick(float TickTime) = 0;
+
+    float3 Pos;
+    float3 Velocity;
+    float  Width  = 0.25f;
+    float  Height = 0.25f;
+};
+
+class AosArrow : public AosEntity
+{
+public:
+    virtual void Tick(float TickTime) override
+    {
+        Pos += Velocity * TickTime;
+        Velocity.y -= Gravity * TickTime;
+        Velocity *= EntityStore::AirDrag;
+    }
+
+    float Gravity = 20.f;
+};
+
+class AosItem final : public AosArrow
+{
+public:
+    virtual void Tick(float TickTime) override
+    {
+        AosArrow::Tick(TickTime);
+        --Lifetime;
+    }
+
+    Uint32 Lifetime = 0;
+};
+
+} // namespace
+
+BenchmarkResult RunEntityBenchmark()
+{
+    BenchmarkResult Result{"Entities"};
+
+    // Half items, half arrows, flying without collision
+    constexpr Uint32 NumEntities = 50000;
+    constexpr Uint32 NumTicks    = 100;
+    constexpr float  TickTime    = static_cast<float>(SimulationClock::TickInterval);
+
+    FastRandFloat           RandPos{1470, -100.f, 100.f};
+    FastRandFloat           RandVel{2581, -10.f, 10.f};
+    std::vector<EntityDesc> Descs(NumEntities);
+    for (Uint32 i = 0; i < NumEntities; ++i)
+    {
+        EntityDesc& Desc = Descs[i];
+        Desc.Pos         = float3{RandPos(), RandPos() + 200.f, RandPos()};
+        Desc.Velocity    = float3{RandVel(), RandVel(), RandVel()};
+        if (i % 2 == 0)
+        {
+            Desc.Components = ENTITY_COMPONENT_GRAVITY | ENTITY_COMPONENT_LIFETIME;
+            Desc.Gravity    = 16.f;
+            Desc.Lifetime   = 6000;
+        }
+        else
+        {
+            Desc.Components = ENTITY_COMPONENT_GRAVITY;
+            Desc.Gravity    = 20.f;
+            Desc.Width      = 0.5f;
+            Desc.Height     = 0.5f;
+        }
+    }
+
+    auto CreateAosEntities = [&]() {
+        std::vector<std::unique_ptr<AosEntity>> Entities(NumEntities);
+        for (Uint32 i = 0; i < NumEntities; ++i)
+        {
+            const EntityDesc& Desc = Descs[i];
+            if (Desc.Components & ENTITY_COMPONENT_LIFETIME)
+            {
+                auto pItem      = std::make_unique<AosItem>();
+                pItem->Gravity  = Desc.Gravity;
+                pItem->Lifetime = Desc.Lifetime;
+                Entities[i]     = std::move(pItem);
+            }
+            else
+            {
+                auto pArrow     = std::make_unique<AosArrow>();
+                pArrow->Gravity = Desc.Gravity;
+                Entities[i]     = std::move(pArrow);
+            }
+            Entities[i]->Pos      = Desc.Pos;
+            Entities[i]->Velocity = Desc.Velocity;
+            Entities[i]->Width    = Desc.Width;
+            Entities[i]->Height   = Desc.Height;
+        }
+        return Entities;
+    };
+
+    World Empty;
+    Timer Tmr;
+
+    // Objects updated in the order they were allocated, which is mostly the order they
+    // sit in memory. The store is measured against this.
+    std::vector<std::unique_ptr<AosEntity>> AosEntities = CreateAosEntities();
+    Tmr.Restart();
+    for (Uint32 t = 0; t < NumTicks; ++t)
+    {
+        for (const auto& pEntity : AosEntities)
+            pEntity->Tick(TickTime);
+    }
+    const double AosTime = Tmr.GetElapsedTime();
+    Result.Add("entities", NumEntities);
+    Result.Add("aos_virtual_ms_per_tick", AosTime * 1000.0 / NumTicks);
+
+    // Objects updated out of memory order, as they would be after a while of spawning and
+    // dying. Measures the cache misses of scattered objects rather than the store.
+    double AosShuffledTime = 0;
+    {
+        std::vector<std::unique_ptr<AosEntity>> Entities = CreateAosEntities();
+        std::vector<AosEntity*>                 Order(NumEntities);
+        for (Uint32 i = 0; i < NumEntities; ++i)
+            Order[i] = Entities[i].get();
+        // FastRandInt only covers ranges up to 0x7FFF
+        std::shuffle(Order.begin(), Order.end(), std::mt19937{3692});
+
+        Tmr.Restart();
+        for (Uint32 t = 0; t < NumTicks; ++t)
+        {
+            for (AosEntity* pEntity : Order)
+                pEntity->Tick(TickTime);
+        }
+        AosShuffledTime = Tmr.GetElapsedTime();
+    }
+    Result.Add("aos_shuffled_ms_per_tick", AosShuffledTime * 1000.0 / NumTicks);
+
+    const Uint32        NumThreads = std::max(std::thread::hardware_concurrency(), 1u);
+    std::vector<Uint32> ThreadCounts{1};
+    if (NumThreads > 1)
+        ThreadCounts.push_back(NumThreads);
+    for (Uint32 Threads : ThreadCounts)
+    {
+        EntityStore               Store{Threads};
+        std::vector<EntityHandle> Handles(NumEntities);
+        for (Uint32 i = 0; i < NumEntities; ++i)
+            Handles[i] = Store.Create(Descs[i]);
+
+        Tmr.Restart();
+        for (Uint32 t = 0; t < NumTicks; ++t)
+            Store.Tick(Empty);
+        const double SoaTime = Tmr.GetElapsedTime();
+
+        if (Threads == 1)
+        {
+            Result.Add("soa_ms_per_tick", SoaTime * 1000.0 / NumTicks);
+            Result.Add("speedup", SoaTime > 0 ? AosTime / SoaTime : 0);
+            Result.Add("shuffled_speedup", SoaTime > 0 ? AosShuffledTime / SoaTime : 0);
+        }
+        else
+        {
+            Result.Add("threads", Threads);
+            Result.Add("soa_threaded_ms_per_tick", SoaTime * 1000.0 / NumTicks);
+            Result.Add("threaded_speedup", SoaTime > 0 ? AosTime / SoaTime : 0);
+        }
+
+        // Vectorized loops may round differently from the scalar objects
+        Uint32 NumMismatches = 0;
+        for (Uint32 i = 0; i < NumEntities; ++i)
+            NumMismatches += length(Store.GetPos(Handles[i]) - AosEntities[i]->Pos) > 1e-3f ? 1 : 0;
+        Result.Add(Threads == 1 ? "position_mismatches" : "threaded_position_mismatches", NumMismatches);
+    }
+
+    // Churn: destroying every third entity and creating as many again must keep every
+    // handle pointing at its own entity, and handles of destroyed ones dead
+    {
+        EntityStore               Store{NumThreads};
+        std::vector<EntityHandle> Handles(NumEntities);
+        for (Uint32 i = 0; i < NumEntities; ++i)
+            Handles[i] = Store.Create(Descs[i]);
+
+        Uint32                    NumErrors = 0;
+        std::vector<EntityHandle> Dead;
+        for (Uint32 i = 0; i < NumEntities; i += 3)
+        {
+            Store.Destroy(Handles[i]);
+            Dead.push_back(Handles[i]);
+        }
+        for (Uint32 i = 0; i < NumEntities; i += 3)
+            Handles[i] = Store.Create(Descs[(i + 1) % NumEntities]);
+
+        for (Uint32 i = 0; i < NumEntities; ++i)
+        {
+            const float3 Expected = Descs[i % 3 == 0 ? (i + 1) % NumEntities : i].Pos;
+            NumErrors += !Store.IsAlive(Handles[i]) || Store.GetPos(Handles[i]) != Expected ? 1 : 0;
+        }
+        for (const EntityHandle& Handle : Dead)
+            NumErrors += Store.IsAlive(Handle) ? 1 : 0;
+        NumErrors += Store.GetCount() != NumEntities ? 1 : 0;
+        Result.Add("handle_errors", NumErrors);
+    }
+
+    // Falling blocks dropped onto a stone floor land on top of it and report their block
+    {
+        World Floor;
+        for (Int32 cz = -1; cz < 1; ++cz)
+        {
+            for (Int32 cx = -1; cx < 1; ++cx)
+            {
+                Chunk& Chnk = Floor.GetOrCreateChunk(cx, cz);
+                for (Uint32 z = 0; z < 16; ++z)
+                {
+                    for (Uint32 x = 0; x < 16; ++x)
+                        Chnk.SetBlock(x, 10, z, BLOCK_STONE);
+                }
+            }
+        }
+
+        EntityStore Store{NumThreads};
+        FastRandInt RandXZ{4703, -16, 15};
+        FastRandInt RandY{5814, 12, 100};
+        std::vector<int3> Dropped;
+        for (Uint32 i = 0; i < 1000; ++i)
+        {
+            EntityDesc Desc;
+            Desc.Components = ENTITY_COMPONENT_GRAVITY | ENTITY_COMPONENT_BLOCK;
+            Dropped.emplace_back(RandXZ(), RandY(), RandXZ());
+            Desc.Pos    = float3{static_cast<float>(Dropped.back().x) + 0.5f, static_cast<float>(Dropped.back().y), static_cast<float>(Dropped.back().z) + 0.5f};
+            Desc.Width  = 0.98f;
+            Desc.Height = 0.98f;
+            Desc.Block  = BLOCK_SAND;
+            Store.Create(Desc);
+        }
+
+        Uint32 NumLanded = 0;
+        Uint32 NumWrong  = 0;
+        for (Uint32 t = 0; t < 200 && Store.GetCount() > 0; ++t)
+        {
+            Store.Tick(Floor);
+            for (const EntityStore::LandedBlock& Landed : Store.GetLandedBlocks())
+            {
+                ++NumLanded;
+                // Each must land straight below where it was dropped
+                const bool Found = std::any_of(Dropped.begin(), Dropped.end(), [&](const int3& Pos) {
+                    return Pos.x == Landed.Pos.x && Pos.z == Landed.Pos.z;
+                });
+                NumWrong += Landed.Pos.y != 11 || Landed.Block != BLOCK_SAND || !Found ? 1 : 0;
+            }
+        }
+        Result.Add("landing_errors", NumWrong + (NumLanded != Dropped.size() ? 1 : 0));
+    }
+
+    return Result;
+}
+
+BenchmarkResult RunEntityBroadphaseBenchmark()
+{
+    BenchmarkResult Result{"Entity broadphase"};
+
+    constexpr Uint32 NumEntities = 50000;
+    constexpr Uint32 NumQueries  = 2000;
+
+    // Items and mobs wandering over 256x256 blocks, ticked a few times so that many
+    // have moved to other cells since they were created
+    EntityStore               Store{1};
+    std::vector<EntityHandle> Handles(NumEntities);
+    std::vector<float2>       Sizes(NumEntities);
+    {
+        FastRandFloat RandXZ{6925, -128.f, 128.f};
+        FastRandFloat RandY{7036, 60.f, 80.f};
+        FastRandFloat RandVel{8147, -8.f, 8.f};
+        for (Uint32 i = 0; i < NumEntities; ++i)
+        {
+            EntityDesc Desc;
+            Desc.Components = ENTITY_COMPONENT_VELOCITY;
+            Desc.Pos        = float3{RandXZ(), RandY(), RandXZ()};
+            Desc.Velocity   = float3{RandVel(), RandVel() * 0.25f, RandVel()};
+            if (i % 4 == 0)
+            {
+                Desc.Width  = 0.6f;
+                Desc.Height = 1.8f;
+            }
+            Sizes[i]   = float2{Desc.Width * 0.5f, Desc.Height};
+            Handles[i] = Store.Create(Desc);
+        }
+    }
+    // Each tick is followed by a query, which brings the hash up to date, as pickup and
+    // targeting would in the game
+    World Empty;
+    Timer Tmr;
+    for (Uint32 t = 0; t < 20; ++t)
+    {
+        Store.Tick(Empty);
+        Store.QueryBox(BoundBox{float3{0, 0, 0}, float3{1, 1, 1}}, [](const EntityHandle&) { return false; });
+    }
+    Result.Add("entities", NumEntities);
+    Result.Add("tick_ms", Tmr.GetElapsedTime() * 1000.0 / 20);
+
+    std::vector<float3> Positions(NumEntities);
+    for (Uint32 i = 0; i < NumEntities; ++i)
+        Positions[i] = Store.GetPos(Handles[i]);
+
+    // Queries around where the entities are, a few blocks to a small explosion across
+    std::vector<float4> Queries(NumQueries);
+    {
+        FastRandFloat RandXZ{9258, -128.f, 128.f};
+        FastRandFloat RandY{369, 60.f, 80.f};
+        FastRandFloat RandSize{1470, 0.5f, 8.f};
+        for (float4& Query : Queries)
+            Query = float4{RandXZ(), RandY(), RandXZ(), RandSize()};
+    }
+    auto GetQueryBox = [](const float4& Query) {
+        const float3 Center{Query.x, Query.y, Query.z};
+        return BoundBox{Center - float3{Query.w, Query.w, Query.w}, Center + float3{Query.w, Query.w, Query.w}};
+    };
+    auto Overlaps = [&](Uint32 i, const BoundBox& Box) {
+        const float3& Pos = Positions[i];
+        return Pos.x - Sizes[i].x < Box.Max.x && Pos.x + Sizes[i].x > Box.Min.x &&
+            Pos.y < Box.Max.y && Pos.y + Sizes[i].y > Box.Min.y &&
+            Pos.z - Sizes[i].x < Box.Max.z && Pos.z + Sizes[i].x > Box.Min.z;
+    };
+    auto InRadius = [&](Uint32 i, const float4& Query) {
+        const float3 Center{Query.x, Query.y, Query.z};
+        const float3 Nearest{
+            std::clamp(Center.x, Positions[i].x - Sizes[i].x, Positions[i].x + Sizes[i].x),
+            std::clamp(Center.y, Positions[i].y, Positions[i].y + Sizes[i].y),
+            std::clamp(Center.z, Positions[i].z - Sizes[i].x, Positions[i].z + Sizes[i].x),
+        };
+        return dot(Nearest - Center, Nearest - Center) < Query.w * Query.w;
+    };
+
+    // Handles are compared by slot, which equals the creation index as nothing was destroyed
+    Uint32              NumMismatches = 0;
+    Uint32              NumFound      = 0;
+    std::vector<Uint32> Found, Expected;
+    for (const float4& Query : Queries)
+    {
+        for (int Radius = 0; Radius < 2; ++Radius)
+        {
+            Found.clear();
+            Expected.clear();
+            auto Collect = [&](const EntityHandle& Handle) {
+                Found.push_back(Handle.Slot);
+                return true;
+            };
+            if (Radius)
+                Store.QueryRadius(float3{Query.x, Query.y, Query.z}, Query.w, Collect);
+            else
+                Store.QueryBox(GetQueryBox(Query), Collect);
+            for (Uint32 i = 0; i < NumEntities; ++i)
+            {
+                if (Radius ? InRadius(i, Query) : Overlaps(i, GetQueryBox(Query)))
+                    Expected.push_back(i);
+            }
+            std::sort(Found.begin(), Found.end());
+            NumMismatches += Found != Expected ? 1 : 0;
+            NumFound += static_cast<Uint32>(Found.size());
+        }
+    }
+    Result.Add("query_mismatches", NumMismatches);
+    Result.Add("avg_found", static_cast<double>(NumFound) / (NumQueries * 2));
+
+    Uint32 NumHits = 0;
+    Tmr.Restart();
+    for (const float4& Query : Queries)
+    {
+        Store.QueryBox(GetQueryBox(Query), [&](const EntityHandle&) {
+            ++NumHits;
+            return true;
+        });
+    }
+    const double HashBoxTime = Tmr.GetElapsedTime();
+    Tmr.Restart();
+    for (const float4& Query : Queries)
+    {
+        Store.QueryRadius(float3{Query.x, Query.y, Query.z}, Query.w, [&](const EntityHandle&) {
+            ++NumHits;
+            return true;
+        });
+    }
+    const double HashRadiusTime = Tmr.GetElapsedTime();
+    Tmr.Restart();
+    for (const float4& Query : Queries)
+    {
+        const BoundBox Box = GetQueryBox(Query);
+        for (Uint32 i = 0; i < NumEntities; ++i)
+            NumHits += Overlaps(i, Box) ? 1 : 0;
+    }
+    const double ScanBoxTime = Tmr.GetElapsedTime();
+    Result.Add("box_query_us", HashBoxTime * 1e6 / NumQueries);
+    Result.Add("radius_query_us", HashRadiusTime * 1e6 / NumQueries);
+    Result.Add("scan_box_query_us", ScanBoxTime * 1e6 / NumQueries);
+    Result.Add("box_query_speedup", HashBoxTime > 0 ? ScanBoxTime / HashBoxTime : 0);
+    // Keeps the loops from being optimized away
+    Result.Add("hits", NumHits);
+
+    // Mob farm: 500 mobs dropped into a pit one block across, walled in with stone
+    {
+        constexpr Uint32 NumMobs  = 500;
+        constexpr Uint32 NumTicks = 100;
+
+        World Farm;
+        Chunk& Chnk = Farm.GetOrCreateChunk(0, 0);
+        for (Uint32 z = 0; z < 16; ++z)
+        {
+            for (Uint32 x = 0; x < 16; ++x)
+            {
+                Chnk.SetBlock(x, 10, z, BLOCK_STONE);
+                if (x != 8 || z != 8)
+                {
+                    for (Uint32 y = 11; y < 16; ++y)
+                        Chnk.SetBlock(x, y, z, BLOCK_STONE);
+                }
+            }
+        }
+
+        EntityStore               FarmStore{1};
+        std::vector<EntityHandle> Mobs(NumMobs);
+        FastRandFloat             RandXZ{2581, 8.3f, 8.7f};
+        for (EntityHandle& Mob : Mobs)
+        {
+            EntityDesc Desc;
+            Desc.Components = ENTITY_COMPONENT_GRAVITY | ENTITY_COMPONENT_COLLISION | ENTITY_COMPONENT_PUSHABLE;
+            Desc.Pos        = float3{RandXZ(), 11.f, RandXZ()};
+            Desc.Width      = 0.6f;
+            Desc.Height     = 1.8f;
+            Desc.Gravity    = 32.f;
+            Mob             = FarmStore.Create(Desc);
+        }
+
+        Tmr.Restart();
+        for (Uint32 t = 0; t < NumTicks; ++t)
+            FarmStore.Tick(Farm);
+        Result.Add("farm_mobs", NumMobs);
+        Result.Add("farm_ms_per_tick", Tmr.GetElapsedTime() * 1000.0 / NumTicks);
+
+        // Neighbours each mob's push looks at, against every overlapping pair
+        Uint32 NumVisited = 0;
+        Uint32 NumPairs   = 0;
+        for (const EntityHandle& Mob : Mobs)
+        {
+            const float3   Pos = FarmStore.GetPos(Mob);
+            const BoundBox Box{Pos - float3{0.3f, 0, 0.3f}, Pos + float3{0.3f, 1.8f, 0.3f}};
+            Uint32         NumNeighbours = 0;
+            FarmStore.QueryBox(Box, [&](const EntityHandle&) {
+                ++NumVisited;
+                return ++NumNeighbours <= EntityStore::MaxPushNeighbours;
+            });
+            FarmStore.QueryBox(Box, [&](const EntityHandle&) {
+                ++NumPairs;
+                return true;
+            });
+        }
+        Result.Add("farm_push_visits_per_mob", static_cast<double>(NumVisited) / NumMobs);
+        Result.Add("farm_overlaps_per_mob", static_cast<double>(NumPairs) / NumMobs);
+
+        // Pushing must not carry any mob through the walls or the floor
+        Uint32 NumEscaped = 0;
+        for (const EntityHandle& Mob : Mobs)
+        {
+            const float3 Pos = FarmStore.GetPos(Mob);
+            NumEscaped += Pos.x < 8.3f - 1e-3f || Pos.x > 8.7f + 1e-3f || Pos.z < 8.3f - 1e-3f || Pos.z > 8.7f + 1e-3f || Pos.y < 11.f - 1e-3f ? 1 : 0;
+        }
+        Result.Add("farm_escaped", NumEscaped);
+    }
+
+    return Result;
+}
+
+BenchmarkResult RunPathfindingBenchmark()
+{
+    BenchmarkResult Result{"Pathfinding"};
+
+    constexpr Int32  Radius       = 6;
+    constexpr Uint32 NumPairs     = 100;
+    constexpr Uint32 TickBudget   = 2000;
+    constexpr Int32  MinBlock     = -Radius * 16;
+    constexpr Int32  MaxBlock     = Radius * 16 + 15;
+    constexpr Int32  FlatDistance = 1 << 20;
+
+    World Wrld;
+    CreateTestWorld(Wrld, Radius);
+
+    // Highest block of a column a mob can stand in
+    auto FindSurface = [&](Int32 x, Int32 z, int3& Pos) {
+        for (Int32 y = Chunk::Height - 2; y > 0; --y)
+        {
+            if (Pathfinder::CanStandIn(Wrld, int3{x, y, z}))
+            {
+                Pos = int3{x, y, z};
+                return true;
+            }
+        }
+        return false;
+    };
+
+    // Short pairs are a few blocks apart, long ones across most of the world
+    std::vector<std::pair<int3, int3>> ShortPairs, LongPairs;
+    {
+        FastRandInt RandXZ{3581, MinBlock + 8, MaxBlock - 8};
+        FastRandInt RandOffset{4692, -12, 12};
+        while (ShortPairs.size() < NumPairs || LongPairs.size() < NumPairs)
+        {
+            int3 Start, Goal;
+            if (!FindSurface(RandXZ(), RandXZ(), Start))
+                continue;
+            if (ShortPairs.size() < NumPairs)
+            {
+                const Int32 x = std::clamp(Start.x + RandOffset(), MinBlock, MaxBlock);
+                const Int32 z = std::clamp(Start.z + RandOffset(), MinBlock, MaxBlock);
+                if (FindSurface(x, z, Goal))
+                    ShortPairs.emplace_back(Start, Goal);
+            }
+            else if (FindSurface(RandXZ(), RandXZ(), Goal) && std::abs(Goal.x - Start.x) + std::abs(Goal.z - Start.z) > 96)
+            {
+                LongPairs.emplace_back(Start, Goal);
+            }
+        }
+    }
+
+    // Each step must be a move a mob can make: one block across into a block it can stand
+    // in, at most one up and at most MaxDrop down
+    auto IsValidPath = [&](const std::vector<int3>& Path, const int3& Start, const int3& Goal) {
+        if (Path.empty() || Path.front() != Start || Path.back() != Goal)
+            return false;
+        for (size_t i = 1; i < Path.size(); ++i)
+        {
+            const int3 Step = Path[i] - Path[i - 1];
+            if (std::abs(Step.x) + std::abs(Step.z) != 1 || Step.y > 1 || Step.y < -Pathfinder::MaxDrop || !Pathfinder::CanStandIn(Wrld, Path[i]))
+                return false;
+        }
+        return true;
+    };
+    auto GetPathCost = [](const std::vector<int3>& Path) {
+        float Cost = 0;
+        for (size_t i = 1; i < Path.size(); ++i)
+        {
+            const Int32 dy = Path[i].y - Path[i - 1].y;
+            Cost += dy > 0 ? 2.f : 1.f + static_cast<float>(-dy) * 0.5f;
+        }
+        return Cost;
+    };
+
+    // One request at a time with an unlimited budget
+    struct SearchStats
+    {
+        Uint32             NumFound   = 0;
+        Uint32             NumInvalid = 0;
+        Uint64             NumNodes   = 0;
+        double             Time       = 0;
+        std::vector<float> Costs;
+    };
+    auto RunSearches = [&](Pathfinder& Finder, const std::vector<std::pair<int3, int3>>& Pairs) {
+        SearchStats       Stats;
+        std::vector<int3> Path;
+        for (const auto& Pair : Pairs)
+        {
+            const PathRequestId Id = Finder.RequestPath(Pair.first, Pair.second);
+            Timer               Tmr;
+            while (Finder.GetPendingCount() > 0)
+            {
+                Finder.Tick(Wrld, ~0u >> 1);
+                Stats.NumNodes += Finder.GetLastIterationCount();
+            }
+            Stats.Time += Tmr.GetElapsedTime();
+            const bool IsFound = Finder.TakePath(Id, Path) == PATH_STATUS_FOUND;
+            Stats.NumFound += IsFound ? 1 : 0;
+            Stats.NumInvalid += IsFound && !IsValidPath(Path, Pair.first, Pair.second) ? 1 : 0;
+            Stats.Costs.push_back(IsFound ? GetPathCost(Path) : -1.f);
+        }
+        return Stats;
+    };
+
+    {
+        Pathfinder        Flat{FlatDistance};
+        const SearchStats Short = RunSearches(Flat, ShortPairs);
+        Result.Add("short_found", Short.NumFound);
+        Result.Add("short_us_per_path", Short.Time * 1e6 / NumPairs);
+        Result.Add("short_nodes_per_path", static_cast<double>(Short.NumNodes) / NumPairs);
+
+        const SearchStats FlatLong = RunSearches(Flat, LongPairs);
+        Pathfinder        Hierarchical;
+        const SearchStats HierLong = RunSearches(Hierarchical, LongPairs);
+        Result.Add("long_found", FlatLong.NumFound);
+        Result.Add("flat_ms_per_long_path", FlatLong.Time * 1000.0 / NumPairs);
+        Result.Add("flat_nodes_per_long_path", static_cast<double>(FlatLong.NumNodes) / NumPairs);
+        Result.Add("hierarchical_ms_per_long_path", HierLong.Time * 1000.0 / NumPairs);
+        Result.Add("hierarchical_nodes_per_long_path", static_cast<double>(HierLong.NumNodes) / NumPairs);
+
+        // Routes through sections may miss the shortest path but must not lose any
+        Uint32 NumMissed   = 0;
+        double CostRatio   = 0;
+        Uint32 NumCompared = 0;
+        for (Uint32 i = 0; i < NumPairs; ++i)
+        {
+            if (FlatLong.Costs[i] < 0)
+                continue;
+            if (HierLong.Costs[i] < 0)
+            {
+                ++NumMissed;
+                continue;
+            }
+            CostRatio += HierLong.Costs[i] / std::max(FlatLong.Costs[i], 1.f);
+            ++NumCompared;
+        }
+        Result.Add("hierarchical_cost_ratio", NumCompared > 0 ? CostRatio / NumCompared : 0);
+        Result.Add("hierarchical_missed_paths", NumMissed);
+        Result.Add("invalid_paths", Short.NumInvalid + FlatLong.NumInvalid + HierLong.NumInvalid);
+    }
+
+    // All requests at once, as from many mobs, sharing the per-tick budget
+    {
+        Pathfinder                 Finder;
+        std::vector<PathRequestId> Ids;
+        for (Uint32 i = 0; i < NumPairs; ++i)
+        {
+            Ids.push_back(Finder.RequestPath(ShortPairs[i].first, ShortPairs[i].second));
+            Ids.push_back(Finder.RequestPath(LongPairs[i].first, LongPairs[i].second));
+        }
+
+        Uint32 NumTicks    = 0;
+        Uint32 NumOverruns = 0;
+        double MaxTickTime = 0;
+        double TotalTime   = 0;
+        while (Finder.GetPendingCount() > 0)
+        {
+            Finder.Tick(Wrld, TickBudget);
+            ++NumTicks;
+            NumOverruns += Finder.GetLastBudgetSpent() > TickBudget ? 1 : 0;
+            MaxTickTime = std::max(MaxTickTime, Finder.GetLastTickTime());
+            TotalTime += Finder.GetLastTickTime();
+        }
+        Result.Add("budget", TickBudget);
+        Result.Add("ticks_for_all", NumTicks);
+        Result.Add("avg_ms_per_tick", TotalTime * 1000.0 / NumTicks);
+        Result.Add("max_ms_per_tick", MaxTickTime * 1000.0);
+        Result.Add("budget_overruns", NumOverruns);
+
+        std::vector<int3> Path;
+        for (PathRequestId Id : Ids)
+            Finder.TakePath(Id, Path);
+    }
+
+    // Long paths asked for again from the start, or from one step along within the same
+    // section, are answered from the cache without a search. Asking from a block off the
+    // path reuses the route.
+    {
+        constexpr Uint32 NumCachedPairs = Pathfinder::MaxCachedPaths / 2;
+
+        Pathfinder                     Finder;
+        std::vector<std::vector<int3>> Paths(NumCachedPairs);
+        for (Uint32 i = 0; i < NumCachedPairs; ++i)
+        {
+            const PathRequestId Id = Finder.RequestPath(LongPairs[i].first, LongPairs[i].second);
+            while (Finder.GetPendingCount() > 0)
+                Finder.Tick(Wrld, TickBudget);
+            Finder.TakePath(Id, Paths[i]);
+        }
+
+        Uint32 NumAsked  = 0;
+        Uint32 NumCached = 0;
+        for (const std::vector<int3>& Path : Paths)
+        {
+            if (Path.size() < 2)
+                continue;
+            for (const int3& Start : {Path[0], Path[1]})
+            {
+                if ((Start.x >> 4) != (Path[0].x >> 4) || (Start.y >> 4) != (Path[0].y >> 4) || (Start.z >> 4) != (Path[0].z >> 4))
+                    continue;
+                std::vector<int3>   Cached;
+                const PathRequestId Id = Finder.RequestPath(Start, Path.back());
+                NumCached += Finder.TakePath(Id, Cached) == PATH_STATUS_FOUND && IsValidPath(Cached, Start, Path.back()) ? 1 : 0;
+                ++NumAsked;
+            }
+        }
+        Result.Add("cache_misses", NumAsked - NumCached);
+        Result.Add("path_reuses", static_cast<double>(Finder.GetPathReuseCount()));
+
+        Uint64 NumNodes = 0;
+        for (const std::vector<int3>& Path : Paths)
+        {
+            int3 Start;
+            if (Path.empty() || !FindSurface(Path[0].x ^ 1, Path[0].z, Start) || (Start.x >> 4) != (Path[0].x >> 4) || (Start.y >> 4) != (Path[0].y >> 4))
+                continue;
+            const PathRequestId Id = Finder.RequestPath(Start, Path.back());
+            while (Finder.GetPendingCount() > 0)
+            {
+                Finder.Tick(Wrld, TickBudget);
+                NumNodes += Finder.GetLastIterationCount();
+            }
+            std::vector<int3> Found;
+            Finder.TakePath(Id, Found);
+        }
+        Result.Add("route_reuses", static_cast<double>(Finder.GetRouteReuseCount()));
+        Result.Add("route_reuse_nodes_per_path", Finder.GetRouteReuseCount() > 0 ? static_cast<double>(NumNodes) / Finder.GetRouteReuseCount() : 0);
+
+        // Building a wall across a cached path drops it from the cache
+        const std::vector<int3>& Blocked = Paths[0];
+        if (Blocked.size() > 2)
+        {
+            const int3 Pos = Blocked[Blocked.size() / 2];
+            Wrld.SetBlock(Pos.x, Pos.y, Pos.z, BLOCK_STONE);
+            Wrld.SetBlock(Pos.x, Pos.y + 1, Pos.z, BLOCK_STONE);
+            Finder.OnBlockChanged(Pos);
+            Finder.OnBlockChanged(Pos + int3{0, 1, 0});
+
+            const PathRequestId Id = Finder.RequestPath(Blocked.front(), Blocked.back());
+            while (Finder.GetPendingCount() > 0)
+                Finder.Tick(Wrld, TickBudget);
+            std::vector<int3> Path;
+            const PATH_STATUS Status  = Finder.TakePath(Id, Path);
+            const bool        IsStale = Status == PATH_STATUS_FOUND && std::find(Path.begin(), Path.end(), Pos) != Path.end();
+            Result.Add("stale_cached_paths", IsStale ? 1 : 0);
+        }
+    }
+
+    // A goal on a block floating high above the terrain cannot be reached, so the route
+    // search summarizes every section it can get to before the block search gives up.
+    // Neither may take more than the budget in any tick.
+    {
+        const int3 Start = LongPairs[1].first;
+        const int3 Goal{LongPairs[1].second.x, Chunk::Height - 8, LongPairs[1].second.z};
+        Wrld.SetBlock(Goal.x, Goal.y - 1, Goal.z, BLOCK_STONE);
+
+        Pathfinder          Finder;
+        const PathRequestId Id          = Finder.RequestPath(Start, Goal);
+        Uint32              NumTicks    = 0;
+        Uint32              NumOverruns = 0;
+        double              MaxTickTime = 0;
+        while (Finder.GetPendingCount() > 0)
+        {
+            Finder.Tick(Wrld, TickBudget);
+            ++NumTicks;
+            NumOverruns += Finder.GetLastBudgetSpent() > TickBudget ? 1 : 0;
+            MaxTickTime = std::max(MaxTickTime, Finder.GetLastTickTime());
+        }
+        std::vector<int3> Path;
+        Result.Add("unreachable_found", Finder.TakePath(Id, Path) == PATH_STATUS_FOUND ? 1 : 0);
+        Result.Add("unreachable_ticks", NumTicks);
+        Result.Add("unreachable_max_ms_per_tick", MaxTickTime * 1000.0);
+        Result.Add("unreachable_budget_overruns", NumOverruns);
+    }
+
+    return Result;
+}
+
+BenchmarkResult RunParticleBenchmark()
+{
+    BenchmarkResult Result{"Particles"};
+
+    constexpr Int32  Radius       = 2;
+    constexpr Int32  Extent       = (Radius - 1) * 16;
+    constexpr Uint32 NumParticles = 100000;
+    constexpr Uint32 NumFrames    = 200;
+    constexpr float  FrameTime    = 1.f / 60.f;
+
+    World Wrld;
+    CreateTestWorld(Wrld, Radius);
+
+    // Bursts all over the test terrain, topped up every frame to keep the pool at
+    // NumParticles. The vector stands in for the mapped streaming buffer.
+    ParticleSystem                Particles;
+    std::vector<ParticleInstance> Instances(Particles.GetCapacity());
+    FastRandInt                   RandXZ{2552, -Extent, Extent - 1};
+    Uint32                        NumBursts = 0;
+    auto                          EmitBurst = [&]() {
+        const Int32 x = RandXZ();
+        const Int32 z = RandXZ();
+        Int32       y = Chunk::Height - 1;
+        while (y > 0 && Wrld.GetBlock(x, y, z) == BLOCK_AIR)
+            --y;
+
+        const float3 Top{static_cast<float>(x) + 0.5f, static_cast<float>(y + 1), static_cast<float>(z) + 0.5f};
+        switch (NumBursts++ % 8)
+        {
+            case 0: Particles.EmitExplosion(Wrld, Top, 4.f); break;
+            case 1: Particles.EmitSplash(Wrld, Top); break;
+            case 2: Particles.EmitSmoke(Wrld, Top); break;
+            default: Particles.EmitBlockBreak(Wrld, int3{x, y, z}, Wrld.GetBlock(x, y, z)); break;
+        }
+    };
+
+    while (Particles.GetCount() < NumParticles)
+        EmitBurst();
+
+    double UpdateTime  = 0;
+    double WriteTime   = 0;
+    double EmitTime    = 0;
+    Uint32 NumGrouping = 0;
+    Timer  Tmr;
+    for (Uint32 f = 0; f < NumFrames; ++f)
+    {
+        Tmr.Restart();
+        while (Particles.GetCount() < NumParticles)
+            EmitBurst();
+        EmitTime += Tmr.GetElapsedTime();
+
+        Tmr.Restart();
+        Particles.Update(FrameTime);
+        UpdateTime += Tmr.GetElapsedTime();
+
+        Tmr.Restart();
+        Particles.WriteInstances(Instances.data());
+        WriteTime += Tmr.GetElapsedTime();
+
+        // Debris shows a quarter of a block face, sprites a whole sprite layer
+        const Uint32 NumBlocks = Particles.GetCount(PARTICLE_TEXTURE_BLOCKS);
+        for (Uint32 i = 0; i < Particles.GetCount(); ++i)
+        {
+            const Uint32 TexExtent = Instances[i].TexCoord >> 18u;
+            const Uint32 Layer     = Instances[i].TexCoord & 1023u;
+            const bool   IsDebris  = i < NumBlocks;
+            if (IsDebris != (TexExtent == 4) || (!IsDebris && Layer >= PARTICLE_SPRITE_COUNT))
+                ++NumGrouping;
+        }
+    }
+    Result.Add("particles", NumParticles);
+    Result.Add("bursts_per_frame", static_cast<double>(NumBursts) / NumFrames);
+    Result.Add("emit_ms_per_frame", EmitTime * 1000.0 / NumFrames);
+    Result.Add("update_ms_per_frame", UpdateTime * 1000.0 / NumFrames);
+    Result.Add("write_ms_per_frame", WriteTime * 1000.0 / NumFrames);
+    Result.Add("cpu_ms_per_frame", (UpdateTime + WriteTime) * 1000.0 / NumFrames);
+    Result.Add("misgrouped_instances", NumGrouping);
+
+    // Every particle expires, however long it lasts
+    for (float t = 0; t < 4.f; t += FrameTime)
+        Particles.Update(FrameTime);
+    Result.Add("unexpired_particles", Particles.GetCount());
+
+    // A full pool drops new particles and keeps the old ones
+    ParticleSystem Small{1000};
+    ParticleDesc   Desc;
+    Desc.Lifetime = 10.f;
+    for (Uint32 i = 0; i < 1100; ++i)
+        Small.Emit(Desc);
+    Small.Update(FrameTime);
+    Result.Add("overflow_errors", Small.GetCount() == 1000 && Small.GetDroppedCount() == 100 ? 0 : 1);
+
+    return Result;
+}
+
+BenchmarkResult RunFluidBenchmark()
+{
+    BenchmarkResult Result{"Fluids"};
+
+    constexpr Int32 Radius = 4;
+
+    World Wrld;
+    CreateTestWorld(Wrld, Radius);
+
+    // A large cave with a grid of pillars, below the test terrain's own caves, flooded
+    // from water sources in the ceiling and a few lava sources in one corner
+    constexpr Int32 Extent = (Radius - 1) * 16;
+    constexpr Int32 MinY = 8, MaxY = 32;
+    for (Int32 z = -Extent; z < Extent; ++z)
+    {
+        for (Int32 x = -Extent; x < Extent; ++x)
+        {
+            const bool IsPillar = (x & 15) < 2 && (z & 15) < 2;
+            for (Int32 y = MinY; y < MaxY; ++y)
+                Wrld.SetBlock(x, y, z, IsPillar ? BLOCK_STONE : BLOCK_AIR);
+        }
+    }
+
+    FluidSimulator Fluids;
+    Uint32         NumSources = 0;
+    for (Int32 z = -Extent + 4; z < Extent; z += 12)
+    {
+        for (Int32 x = -Extent + 4; x < Extent; x += 12)
+        {
+            const BlockId Source = x < -Extent / 2 && z < -Extent / 2 ? BLOCK_LAVA : BLOCK_WATER;
+            Wrld.SetBlock(x, MaxY - 1, z, Source);
+            Fluids.OnBlockChanged(Wrld, x, MaxY - 1, z);
+            ++NumSources;
+        }
+    }
+    Result.Add("sources", NumSources);
+
+    // Runs until nothing is queued, summing the blocks and sections each tick changed
+    Uint64 NumUpdates         = 0;
+    Uint64 NumChangedBlocks   = 0;
+    Uint64 NumChangedSections = 0;
+    auto   Settle             = [&](Uint32 MaxTicks) {
+        Uint32 Ticks = 0;
+        for (; Ticks < MaxTicks && Fluids.GetQueuedCount() > 0; ++Ticks)
+        {
+            Fluids.Tick(Wrld);
+            NumUpdates += Fluids.GetLastUpdateCount();
+            NumChangedBlocks += Fluids.GetChangedBlocks().size();
+            NumChangedSections += Fluids.GetChangedSections().size();
+        }
+        return Ticks;
+    };
+
+    Timer        Tmr;
+    const Uint32 NumTicks = Settle(10000);
+    const double Time     = Tmr.GetElapsedTime();
+    Result.Add("ticks", NumTicks);
+    Result.Add("ticks_per_sec", Time > 0 ? NumTicks / Time : 0);
+    Result.Add("updates", static_cast<double>(NumUpdates));
+    Result.Add("updates_per_tick", NumTicks > 0 ? static_cast<double>(NumUpdates) / NumTicks : 0);
+    Result.Add("update_mops", MOpsPerSec(static_cast<double>(NumUpdates), Time));
+    Result.Add("peak_queued_updates", static_cast<double>(Fluids.GetPeakQueuedCount()));
+    Result.Add("changed_blocks", static_cast<double>(NumChangedBlocks));
+    // Remesh requests per changed block, with one request per section and tick
+    Result.Add("remeshes_per_changed_block", NumChangedBlocks > 0 ? static_cast<double>(NumChangedSections) / NumChangedBlocks : 0);
+
+    Uint32 NumFluidBlocks = 0;
+    for (Int32 z = -Extent; z < Extent; ++z)
+    {
+        for (Int32 x = -Extent; x < Extent; ++x)
+        {
+            for (Int32 y = 0; y < MaxY; ++y)
+                NumFluidBlocks += GetFluidType(Wrld.GetBlock(x, y, z)) != FLUID_NONE ? 1 : 0;
+        }
+    }
+    Result.Add("fluid_blocks", NumFluidBlocks);
+
+    // Once the queue is empty the flood must be at rest: waking every block of the cave
+    // must change nothing, or an update was missed
+    for (Int32 z = -Extent; z < Extent; ++z)
+    {
+        for (Int32 x = -Extent; x < Extent; ++x)
+        {
+            for (Int32 y = MinY; y < MaxY; ++y)
+                Fluids.OnBlockChanged(Wrld, x, y, z);
+        }
+    }
+    NumChangedBlocks = 0;
+    Settle(1000);
+    Result.Add("unsettled_blocks", static_cast<double>(NumChangedBlocks));
+
+    return Result;
+}
+
+BenchmarkResult RunNoiseBenchmark()
+{
+    BenchmarkResult Result{"Noise"};
+
+    // Terrain-like settings: warped 2D height noise and 3D density noise
+    NoiseDesc Desc2D;
+    Desc2D.Seed          = 1234;
+    Desc2D.Frequency     = 1.f / 128.f;
+    Desc2D.Octaves       = 6;
+    Desc2D.WarpAmplitude = 24.f;
+    Desc2D.WarpFrequency = 1.f / 256.f;
+    Desc2D.WarpOctaves   = 2;
+
+    NoiseDesc Desc3D   = Desc2D;
+    Desc3D.Frequency   = 1.f / 48.f;
+    Desc3D.Octaves     = 3;
+    Desc3D.WarpOctaves = 1;
+
+    constexpr Int32 GridChunks = 16;
+
+    // Reference values from the scalar kernel, with negative coordinates included
+    auto FillAll = [&](const NoiseGenerator& Gen2D, const NoiseGenerator& Gen3D, std::vector<float>& Values2D, std::vector<float>& Values3D) {
+        Values2D.resize(GridChunks * GridChunks * NoiseGenerator::ColumnGridSize);
+        Values3D.resize(GridChunks * GridChunks * NoiseGenerator::BlockSize);
+        for (Int32 cz = 0; cz < GridChunks; ++cz)
+        {
+            for (Int32 cx = 0; cx < GridChunks; ++cx)
+            {
+                const size_t Chunk = static_cast<size_t>(cz * GridChunks + cx);
+                Gen2D.FillColumnGrid((cx - GridChunks / 2) * 16, (cz - GridChunks / 2) * 16, &Values2D[Chunk * NoiseGenerator::ColumnGridSize]);
+                Gen3D.FillBlock((cx - GridChunks / 2) * 16, 48, (cz - GridChunks / 2) * 16, &Values3D[Chunk * NoiseGenerator::BlockSize]);
+            }
+        }
+    };
+
+    std::vector<float> Reference2D, Reference3D;
+    std::vector<float> Values2D, Values3D;
+    const double       NumSamples2D = GridChunks * GridChunks * NoiseGenerator::ColumnGridSize;
+    const double       NumSamples3D = GridChunks * GridChunks * NoiseGenerator::BlockSize;
+
+    Timer Tmr;
+    for (Uint32 Level = SIMD_LEVEL_SCALAR; Level < SIMD_LEVEL_COUNT; ++Level)
+    {
+        if (!IsSimdLevelSupported(static_cast<SIMD_LEVEL>(Level)))
+            continue;
+
+        const NoiseGenerator Gen2D{Desc2D, static_cast<SIMD_LEVEL>(Level)};
+        const NoiseGenerator Gen3D{Desc3D, static_cast<SIMD_LEVEL>(Level)};
+
+        std::vector<float>& Values2DOut = Level == SIMD_LEVEL_SCALAR ? Reference2D : Values2D;
+        std::vector<float>& Values3DOut = Level == SIMD_LEVEL_SCALAR ? Reference3D : Values3D;
+
+        Tmr.Restart();
+        FillAll(Gen2D, Gen3D, Values2DOut, Values3DOut);
+        const double Time = Tmr.GetElapsedTime();
+
+        const std::string Prefix = Level == SIMD_LEVEL_SCALAR ? "scalar" : (Level == SIMD_LEVEL_SSE2 ? "sse2" : "avx2");
+        Result.Add((Prefix + "_msamples_per_sec").c_str(), MOpsPerSec(NumSamples2D + NumSamples3D, Time));
+
+        if (Level == SIMD_LEVEL_SCALAR)
+            continue;
+
+        // Worldgen must be deterministic across machines, so any bit difference is an error
+        Uint32 Mismatches = 0;
+        for (size_t i = 0; i < Values2D.size(); ++i)
+            Mismatches += std::memcmp(&Values2D[i], &Reference2D[i], sizeof(float)) != 0 ? 1 : 0;
+        for (size_t i = 0; i < Values3D.size(); ++i)
+            Mismatches += std::memcmp(&Values3D[i], &Reference3D[i], sizeof(float)) != 0 ? 1 : 0;
+        Result.Add((Prefix + "_mismatches").c_str(), Mismatches);
+    }
+
+    // Single samples agree with the fills as well
+    const NoiseGenerator Gen2D{Desc2D};
+    const NoiseGenerator Gen3D{Desc3D};
+    FastRandInt          RandXZ{4321, 0, GridChunks * 16 - 1};
+    FastRandInt          RandY{8765, 0, 15};
+    Uint32               SampleMismatches = 0;
+    for (Uint32 i = 0; i < 1000; ++i)
+    {
+        // Offsets from the corner of the grid
+        const Int32  ox     = RandXZ();
+        const Int32  oz     = RandXZ();
+        const Int32  y      = RandY();
+        const size_t Chunk  = static_cast<size_t>((oz / 16) * GridChunks + ox / 16);
+        const float  Value2 = Gen2D.Sample2D(ox - GridChunks * 8, oz - GridChunks * 8);
+        const float  Value3 = Gen3D.Sample3D(ox - GridChunks * 8, 48 + y, oz - GridChunks * 8);
+        SampleMismatches += std::memcmp(&Value2, &Reference2D[Chunk * NoiseGenerator::ColumnGridSize + (oz % 16) * 16 + ox % 16], sizeof(float)) != 0 ? 1 : 0;
+        SampleMismatches += std::memcmp(&Value3, &Reference3D[Chunk * NoiseGenerator::BlockSize + (y * 16 + oz % 16) * 16 + ox % 16], sizeof(float)) != 0 ? 1 : 0;
+    }
+    Result.Add("sample_mismatches", SampleMismatches);
+
+    // Range check of the normalized sums
+    const auto MinMax2D = std::minmax_element(Reference2D.begin(), Reference2D.end());
+    const auto MinMax3D = std::minmax_element(Reference3D.begin(), Reference3D.end());
+    Result.Add("range_2d_min", *MinMax2D.first);
+    Result.Add("range_2d_max", *MinMax2D.second);
+    Result.Add("range_3d_min", *MinMax3D.first);
+    Result.Add("range_3d_max", *MinMax3D.second);
+    Result.Add("simd_level", GetMaxSimdLevel());
+
+    return Result;
+}
+
+BenchmarkResult RunFiniteWorldBenchmark()
+{
+    BenchmarkResult Result{"Finite world"};
+
+    WorldCreateInfo FiniteCI;
+    FiniteCI.Type = WORLD_TYPE_FINITE;
+
+    // The same 53x53 chunks in both worlds, filling the 54-chunk finite world but for the
+    // last row and column, which stay unloaded
+    constexpr Int32 Radius = 26;
+    World           Infinite;
+    World           Finite{FiniteCI};
+    CreateTestWorld(Infinite, Radius);
+    CreateTestWorld(Finite, Radius);
+
+    constexpr Int32  Extent  = Radius * 16;
+    constexpr Uint32 NumGets = 1 << 22;
+    FastRandInt      RandXZ{4321, -Extent, Extent + 15};
+    FastRandInt      RandY{8765, 0, Chunk::Height - 1};
+
+    std::vector<int3> RandomPositions(NumGets);
+    for (auto& Pos : RandomPositions)
+        Pos = int3{RandXZ(), RandY(), RandXZ()};
+
+    Uint64 Checksum = 0;
+    Timer  Tmr;
+
+    auto RandomGets = [&](const World& Wrld) {
+        Tmr.Restart();
+        for (const auto& Pos : RandomPositions)
+            Checksum += Wrld.GetBlock(Pos.x, Pos.y, Pos.z);
+        return MOpsPerSec(NumGets, Tmr.GetElapsedTime());
+    };
+
+    // Six neighbours of each position, the access pattern of collision and light probes
+    auto NeighbourGets = [&](const World& Wrld) {
+        Tmr.Restart();
+        for (Uint32 i = 0; i < NumGets / 6; ++i)
+        {
+            const int3& Pos = RandomPositions[i];
+            Checksum += Wrld.GetBlock(Pos.x - 1, Pos.y, Pos.z) + Wrld.GetBlock(Pos.x + 1, Pos.y, Pos.z) +
+                Wrld.GetBlock(Pos.x, Pos.y - 1, Pos.z) + Wrld.GetBlock(Pos.x, Pos.y + 1, Pos.z) +
+                Wrld.GetBlock(Pos.x, Pos.y, Pos.z - 1) + Wrld.GetBlock(Pos.x, Pos.y, Pos.z + 1);
+        }
+        return MOpsPerSec(NumGets / 6 * 6, Tmr.GetElapsedTime());
+    };
+
+    // Every block of a 256x256 area, x fastest
+    auto LinearGets = [&](const World& Wrld) {
+        Tmr.Restart();
+        for (Int32 y = 0; y < Chunk::Height; ++y)
+        {
+            for (Int32 z = -128; z < 128; ++z)
+            {
+                for (Int32 x = -128; x < 128; ++x)
+                    Checksum += Wrld.GetBlock(x, y, z);
+            }
+        }
+        return MOpsPerSec(256.0 * 256.0 * Chunk::Height, Tmr.GetElapsedTime());
+    };
+
+    const double InfiniteRandom = RandomGets(Infinite);
+    const double FiniteRandom   = RandomGets(Finite);
+    Result.Add("infinite_random_get_mops", InfiniteRandom);
+    Result.Add("finite_random_get_mops", FiniteRandom);
+    Result.Add("random_get_speedup", InfiniteRandom > 0 ? FiniteRandom / InfiniteRandom : 0);
+
+    const double InfiniteNeighbour = NeighbourGets(Infinite);
+    const double FiniteNeighbour   = NeighbourGets(Finite);
+    Result.Add("infinite_neighbour_get_mops", InfiniteNeighbour);
+    Result.Add("finite_neighbour_get_mops", FiniteNeighbour);
+    Result.Add("neighbour_get_speedup", InfiniteNeighbour > 0 ? FiniteNeighbour / InfiniteNeighbour : 0);
+
+    const double InfiniteLinear = LinearGets(Infinite);
+    const double FiniteLinear   = LinearGets(Finite);
+    Result.Add("infinite_linear_get_mops", InfiniteLinear);
+    Result.Add("finite_linear_get_mops", FiniteLinear);
+    Result.Add("linear_get_speedup", InfiniteLinear > 0 ? FiniteLinear / InfiniteLinear : 0);
+
+    const double NumBlocks = static_cast<double>(Finite.GetChunkCount()) * 16 * 16 * Chunk::Height;
+    Result.Add("infinite_bytes_per_block", static_cast<double>(Infinite.GetMemoryUsage()) / NumBlocks);
+    Result.Add("finite_bytes_per_block", static_cast<double>(Finite.GetMemoryUsage()) / NumBlocks);
+
+    // Both worlds must hold the same blocks, and lookups past the border must return
+    // the block at the border
+    Uint32 Mismatches = 0;
+    for (const auto& Pos : RandomPositions)
+        Mismatches += Infinite.GetBlock(Pos.x, Pos.y, Pos.z) != Finite.GetBlock(Pos.x, Pos.y, Pos.z) ? 1 : 0;
+    Result.Add("mismatches", Mismatches);
+
+    // Last block column inside the border, on the loaded side of the world
+    const Int32 MaxBorder        = (Radius + 1) * 16 - 1;
+    Uint32      BorderMismatches = 0;
+    for (Uint32 i = 0; i < 4096; ++i)
+    {
+        const int3& Pos = RandomPositions[i];
+        // East of the world, and north-east past the corner
+        BorderMismatches += Finite.GetBlock(MaxBorder + 1 + std::abs(Pos.x) * 7, Pos.y, Pos.z) != Finite.GetBlock(MaxBorder, Pos.y, Pos.z) ? 1 : 0;
+        BorderMismatches += Finite.GetBlock(MaxBorder + 100, Pos.y, MaxBorder + 5000) != Finite.GetBlock(MaxBorder, Pos.y, MaxBorder) ? 1 : 0;
+    }
+    Result.Add("border_mismatches", BorderMismatches);
+
+    g_BenchmarkSink = g_BenchmarkSink + Checksum;
+    return Result;
+}
+
+BenchmarkResult RunBiomeBenchmark()
+{
+    BenchmarkResult Result{"Biomes"};
+
+    constexpr Uint32 Seed    = 12345;
+    constexpr Int32  Regions = 48;
+    constexpr Int32  Cells   = Regions * BiomeSource::RegionCells;
+
+    Uint64 Checksum = 0;
+    Timer  Tmr;
+
+    // Uncached layer runs, one region at a time and as a whole, which must agree
+    const BiomeSource  Uncached{Seed, 0};
+    std::vector<BIOME> Whole(static_cast<size_t>(Cells) * Cells);
+    Uncached.GenerateBiomes(-Cells / 2, -Cells / 2, Cells, Cells, Whole.data());
+
+    std::vector<BIOME> Region(BiomeSource::RegionCells * BiomeSource::RegionCells);
+    Uint32             Mismatches = 0;
+    Tmr.Restart();
+    for (Int32 rz = 0; rz < Regions; ++rz)
+    {
+        for (Int32 rx = 0; rx < Regions; ++rx)
+        {
+            const Int32 CellX = -Cells / 2 + rx * BiomeSource::RegionCells;
+            const Int32 CellZ = -Cells / 2 + rz * BiomeSource::RegionCells;
+            Uncached.GenerateBiomes(CellX, CellZ, BiomeSource::RegionCells, BiomeSource::RegionCells, Region.data());
+            for (Int32 z = 0; z < BiomeSource::RegionCells; ++z)
+            {
+                for (Int32 x = 0; x < BiomeSource::RegionCells; ++x)
+                {
+                    const size_t WholeIdx = static_cast<size_t>(rz * BiomeSource::RegionCells + z) * Cells + rx * BiomeSource::RegionCells + x;
+                    Mismatches += Region[z * BiomeSource::RegionCells + x] != Whole[WholeIdx] ? 1 : 0;
+                }
+            }
+        }
+    }
+    Result.Add("region_generation_ms", Tmr.GetElapsedTime() * 1000.0 / (Regions * Regions));
+
+    Uint32 BiomeCells[BIOME_COUNT] = {};
+    for (BIOME Biome : Whole)
+        ++BiomeCells[Biome];
+    for (Uint32 b = 0; b < BIOME_COUNT; ++b)
+    {
+        std::string Name = std::string{GetBiomeInfo(static_cast<BIOME>(b)).Name} + "_percent";
+        std::transform(Name.begin(), Name.end(), Name.begin(), [](char c) { return static_cast<char>(std::tolower(c)); });
+        Result.Add(Name.c_str(), BiomeCells[b] * 100.0 / static_cast<double>(Whole.size()));
+    }
+
+    // Per-column lookups over an area that fits in the cache, as terrain shaping makes them
+    constexpr Uint32  NumLookups   = 1 << 20;
+    constexpr Int32   CachedExtent = 6 * BiomeSource::RegionCells * BiomeSource::CellSize;
+    const BiomeSource Cached{Seed};
+    FastRandInt       RandXZ{2468, -CachedExtent, CachedExtent - 1};
+
+    std::vector<int2> Columns(NumLookups);
+    for (auto& Column : Columns)
+        Column = int2{RandXZ(), RandXZ()};
+
+    Tmr.Restart();
+    for (const auto& Column : Columns)
+    {
+        const BIOME Biome = Cached.GetBiome(Column.x, Column.y);
+        Checksum += Biome;
+        Mismatches += Biome != Whole[static_cast<size_t>(BiomeSource::BlockToCell(Column.y) + Cells / 2) * Cells + BiomeSource::BlockToCell(Column.x) + Cells / 2] ? 1 : 0;
+    }
+    Result.Add("cached_lookup_mops", MOpsPerSec(NumLookups, Tmr.GetElapsedTime()));
+    Result.Add("cached_hit_percent", Cached.GetHitCount() * 100.0 / static_cast<double>(Cached.GetLookupCount()));
+
+    // The same lookups from several threads at once against a cold cache
+    const Uint32        NumThreads = std::max(std::thread::hardware_concurrency(), 4u);
+    const BiomeSource   Shared{Seed};
+    std::atomic<Uint32> ThreadMismatches{0};
+    {
+        std::vector<std::thread> Threads;
+        for (Uint32 t = 0; t < NumThreads; ++t)
+        {
+            Threads.emplace_back([&, t]() {
+                Uint32 Local = 0;
+                for (Uint32 i = t; i < NumLookups; i += NumThreads)
+                    Local += Shared.GetBiome(Columns[i].x, Columns[i].y) != Cached.GetBiome(Columns[i].x, Columns[i].y) ? 1 : 0;
+                ThreadMismatches += Local;
+            });
+        }
+        for (auto& Thread : Threads)
+            Thread.join();
+    }
+    Mismatches += ThreadMismatches;
+    Result.Add("mismatches", Mismatches);
+
+    // Hit rate of the lookups terrain generation makes
+    const WorldGenerator Generator{Seed};
+    std::vector<BlockId> Blocks(WorldGenerator::ChunkVolume);
+    Tmr.Restart();
+    for (Int32 cz = -6; cz <= 6; ++cz)
+    {
+        for (Int32 cx = -6; cx <= 6; ++cx)
+        {
+            Generator.GenerateNoise(cx, cz, Blocks.data());
+            Generator.ApplySurface(cx, cz, Blocks.data());
+        }
+    }
+    const BiomeSource& GenBiomes = Generator.GetBiomeSource();
+    Result.Add("terrain_hit_percent", GenBiomes.GetHitCount() * 100.0 / static_cast<double>(GenBiomes.GetLookupCount()));
+    Result.Add("terrain_biome_ms", GenBiomes.GetGenerationTime() * 1000.0);
+    Result.Add("terrain_total_ms", Tmr.GetElapsedTime() * 1000.0);
+
+    g_BenchmarkSink = g_BenchmarkSink + Checksum;
+    return Result;
+}
+
+BenchmarkResult RunWorldGenerationBenchmark()
+{
+    BenchmarkResult Result{"World generation"};
+
+    constexpr Int32 Radius    = 6;
+    constexpr Int32 NumChunks = (2 * Radius + 1) * (2 * Radius + 1);
+
+    WorldGenerator Generator{12345};
+
+    // Blocks of the requested chunks, which must not depend on the number of threads
+    std::vector<BlockId> Reference;
+    Uint32               Mismatches = 0;
+
+    auto Generate = [&](Uint32 NumThreads, const char* Metric, bool ReportStages, Uint32 MaxLitChunks, const char* MaxUpdateMetric) {
+        // Generation and lighting share their workers, as in the game
+        RefCntAutoPtr<IThreadPool> pThreadPool = CreateThreadPool(ThreadPoolCreateInfo{NumThreads});
+        World                      Wrld;
+        LightEngine                Light{pThreadPool, NumThreads};
+        GenerationScheduler        Scheduler{Generator, pThreadPool, NumThreads};
+        for (Int32 z = -Radius; z <= Radius; ++z)
+        {
+            for (Int32 x = -Radius; x <= Radius; ++x)
+                Scheduler.RequestChunk(x, z);
+        }
+
+        Timer  Tmr;
+        Timer  UpdateTmr;
+        double MaxUpdateTime = 0;
+        while (Scheduler.HasPendingWork() || Scheduler.GetRunningJobCount() > 0)
+        {
+            UpdateTmr.Restart();
+            Scheduler.Update(Wrld, Light, float3{0, 64, 0}, MaxLitChunks);
+            MaxUpdateTime = std::max(MaxUpdateTime, UpdateTmr.GetElapsedTime());
+            std::this_thread::yield();
+        }
+        Result.Add(Metric, NumChunks / Tmr.GetElapsedTime());
+        if (MaxUpdateMetric != nullptr)
+            Result.Add(MaxUpdateMetric, MaxUpdateTime * 1000.0);
+
+        std::vector<BlockId> Blocks(ChunkSection::Volume);
+        size_t               Offset = 0;
+        for (Int32 z = -Radius; z <= Radius; ++z)
+        {
+            for (Int32 x = -Radius; x <= Radius; ++x)
+            {
+                const Chunk* pChunk = Wrld.GetChunk(x, z);
+                for (Int32 s = 0; s < Chunk::NumSections; ++s)
+                {
+                    if (pChunk != nullptr && Scheduler.GetStatus(x, z) == CHUNK_STATUS_LIGHT)
+                        pChunk->GetSection(s).Decode(Blocks.data());
+                    else
+                        std::fill(Blocks.begin(), Blocks.end(), BlockId{0xFFFF});
+
+                    if (Reference.size() < Offset + Blocks.size())
+                        Reference.insert(Reference.end(), Blocks.begin(), Blocks.end());
+                    else
+                        Mismatches += std::equal(Blocks.begin(), Blocks.end(), Reference.begin() + Offset) ? 0 : 1;
+                    Offset += Blocks.size();
+                }
+            }
+        }
+
+        if (ReportStages)
+        {
+            // Includes the ring of partially generated chunks around the requested area
+            Result.Add("chunks_in_world", static_cast<double>(Wrld.GetChunkCount()));
+            const std::pair<CHUNK_STATUS, const char*> Stages[] = {
+                {CHUNK_STATUS_NOISE, "noise_ms_per_chunk"},
+                {CHUNK_STATUS_SURFACE, "surface_ms_per_chunk"},
+                {CHUNK_STATUS_CARVERS, "carvers_ms_per_chunk"},
+                {CHUNK_STATUS_FEATURES, "features_ms_per_chunk"},
+                {CHUNK_STATUS_LIGHT, "light_ms_per_chunk"},
+            };
+            for (const auto& Stage : Stages)
+            {
+                const Uint32 Count = Scheduler.GetStageCount(Stage.first);
+                Result.Add(Stage.second, Count > 0 ? Scheduler.GetStageTime(Stage.first) * 1000.0 / Count : 0);
+            }
+        }
+        pThreadPool->StopThreads();
+    };
+
+    const Uint32     NumThreads = std::max(std::thread::hardware_concurrency(), 1u);
+    constexpr Uint32 Unlimited  = std::numeric_limits<Uint32>::max();
+    Generate(1, "chunks_per_sec_1_thread", true, Unlimited, nullptr);
+    Generate(4, "chunks_per_sec_4_threads", false, Unlimited, nullptr);
+    Generate(NumThreads, "chunks_per_sec_all_threads", false, Unlimited, "max_update_ms");
+    // The game lights a few chunks per frame so that the main thread never stalls on a
+    // whole area at once
+    Generate(NumThreads, "chunks_per_sec_capped", false, 4, "capped_max_update_ms");
+    Result.Add("all_threads", NumThreads);
+    Result.Add("mismatched_sections", Mismatches);
+
+    return Result;
+}
+
+const std::vector<BenchmarkDesc>& GetBenchmarks()
+{
+    static const std::vector<BenchmarkDesc> Benchmarks{
+        {"Block storage", RunBlockStorageBenchmark},
+        {"Chunk meshing", RunChunkMeshingBenchmark},
+        {"Frustum culling", RunFrustumCullingBenchmark},
+        {"Cave culling", RunCaveCullingBenchmark},
+        {"Region files", RunRegionFileBenchmark},
+        {"Lighting", RunLightingBenchmark},
+        {"Noise", RunNoiseBenchmark},
+        {"Biomes", RunBiomeBenchmark},
+        {"World generation", RunWorldGenerationBenchmark},
+        {"Finite world", RunFiniteWorldBenchmark},
+        {"Fluids", RunFluidBenchmark},
+        {"Random ticks", RunRandomTickBenchmark},
+        {"Redstone", RunRedstoneBenchmark},
+        {"Player physics", RunPlayerPhysicsBenchmark},
+        {"Block picking", RunBlockPickingBenchmark},
+        {"Entities", RunEntityBenchmark},
+        {"Entity broadphase", RunEntityBroadphaseBenchmark},
+        {"Pathfinding", RunPathfindingBenchmark},
+        {"Particles", RunParticleBenchmark},
+    };
+    return Benchmarks;
+}
+
+} // namespace Diligent
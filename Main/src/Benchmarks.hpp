@@ -0,0 +1,148 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Diligent
+{
+
+struct BenchmarkResult
+{
+    explicit BenchmarkResult(std::string Name_) :
+        Name{std::move(Name_)}
+    {}
+
+    std::string Name;
+
+    std::vector<std::pair<std::string, double>> Metrics;
+
+    void Add(const char* Metric, double Value)
+    {
+        Metrics.emplace_back(Metric, Value);
+    }
+};
+
+struct BenchmarkDesc
+{
+    const char* Name = nullptr;
+    BenchmarkResult (*Run)() = nullptr;
+};
+
+// All benchmarks in the order they are listed in the debug panel
+const std::vector<BenchmarkDesc>& GetBenchmarks();
+
+// Random and linear get/set throughput of palette-compressed section storage
+BenchmarkResult RunBlockStorageBenchmark();
+
+// Greedy vs naive per-face meshing: vertex count, vertex bytes and meshing time of the
+// smooth lit meshes the game uploads, against four 20-byte vertices per face, and the
+// cost of smooth lighting over unlit greedy meshing
+BenchmarkResult RunChunkMeshingBenchmark();
+
+// Scalar and AVX2 section frustum culling, checked against GetBoxVisibility()
+BenchmarkResult RunFrustumCullingBenchmark();
+
+// Section connectivity cost and cave culling efficiency, with random rays checking
+// that no section seen by the camera is culled
+BenchmarkResult RunCaveCullingBenchmark();
+
+// Saves, rewrites and loads 10k chunks through region files and checks that every
+// loaded chunk matches the saved one
+BenchmarkResult RunRegionFileBenchmark();
+
+// Full and incremental lighting: torch place/break and shaft digging latency, checked
+// against lighting the same world from scratch
+BenchmarkResult RunLightingBenchmark();
+
+// Scalar, SSE2 and AVX2 fractal noise throughput, checked for bit-exact agreement
+BenchmarkResult RunNoiseBenchmark();
+
+// Biome layer generation time, cached lookup throughput from one and many threads, the
+// cache hit rate of terrain generation, and the share of each biome. Regions, cached
+// lookups and threads are checked against one uncached run over the whole area.
+BenchmarkResult RunBiomeBenchmark();
+
+// Generates and lights the same area with 1, 4 and all threads, reporting chunks/s, the
+// time per stage, the longest Update() with and without the per-update lighting cap and
+// whether the blocks depend on the number of threads
+BenchmarkResult RunWorldGenerationBenchmark();
+
+// Block lookups in a finite world against the same chunks in the infinite world's chunk
+// map, checking that both agree and that lookups past the border clamp to it
+BenchmarkResult RunFiniteWorldBenchmark();
+
+// Floods a large cave with water and lava until it comes to rest, reporting ticks/s, the
+// peak number of queued updates and how many remesh requests the changed blocks cost,
+// and checks that waking the whole flood afterwards changes nothing
+BenchmarkResult RunFluidBenchmark();
+
+// Random tick cost per chunk with one and all threads, and how much skipping sections by
+// their randomly ticked block counters saves. Checks the counters against a recount and
+// that covered grass dies, bare dirt grows grass and only leaves away from logs decay.
+BenchmarkResult RunRandomTickBenchmark();
+
+// Hundreds of torch clocks run by compiled wire networks and by neighbour updates side
+// by side, reporting updates and time per tick of both. Checks that both switch the same
+// torches on the same ticks, including after wires are removed halfway through.
+BenchmarkResult RunRedstoneBenchmark();
+
+// Cost of 10k player box moves through terrain. The collision checks are in
+// PlayerPhysicsTest.
+BenchmarkResult RunPlayerPhysicsBenchmark();
+
+// Block picking ray cost through terrain, checked against a slab test of every cell
+// around short rays, and how soon an edited block is remeshed behind a full meshing
+// backlog as an urgent and as a normal request
+BenchmarkResult RunBlockPickingBenchmark();
+
+// Ticks 50k simple entities in the structure-of-arrays entity store, with one and all
+// threads, against heap objects with a virtual Tick() updated in allocation order and in
+// shuffled order, and checks that both end up in the same places. Also checks handles
+// through heavy churn and falling block landings.
+BenchmarkResult RunEntityBenchmark();
+
+// Box and radius queries through the entity spatial hash among 50k moving entities,
+// checked against and timed with a scan of every entity, and 500 pushable mobs crammed
+// into one block space, where pushing must stay linear rather than visit every pair
+BenchmarkResult RunEntityBroadphaseBenchmark();
+
+// Short and long paths over test terrain found with and without the section graph,
+// checking every step, then all at once under a per-tick budget, and again from the
+// cache, which a wall built across a path must invalidate. A walled-in goal must not
+// take more than the budget in any tick either.
+BenchmarkResult RunPathfindingBenchmark();
+
+// Keeps 100k particles from every kind of burst alive over test terrain, timing the
+// update and the instance packing a frame takes, which must stay under 1 ms. Checks that
+// instances are grouped by texture, that all particles expire and that a full pool drops.
+BenchmarkResult RunParticleBenchmark();
+
+} // namespace Diligent
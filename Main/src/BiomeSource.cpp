@@ -0,0 +1,340 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+#include "BiomeSource.hpp"
+
+#include <vector>
+
+#include "Platforms/interface/PlatformDefinitions.h"
+#include "Common/interface/Timer.hpp"
+
+namespace Diligent
+{
+
+namespace
+{
+
+enum CLIMATE : Uint8
+{
+    CLIMATE_WARM = 0,
+    CLIMATE_TEMPERATE,
+    CLIMATE_COLD
+};
+
+enum LAYER_OP : Uint8
+{
+    // Climate zones from a hash of the cell position
+    LAYER_OP_CLIMATE = 0,
+
+    // Halves the cell size, taking each new cell from one of its parent's neighbours
+    LAYER_OP_ZOOM,
+
+    // Replaces climate zones with biomes of that climate
+    LAYER_OP_PICK_BIOME,
+
+    // Removes single-cell noise along borders
+    LAYER_OP_SMOOTH
+};
+
+struct Layer
+{
+    LAYER_OP Op;
+    Uint32   Salt;
+};
+
+// From the coarsest layer (1024-block cells) to the finest (4-block cells)
+// clang-format off
+constexpr Layer Layers[] = {
+    {LAYER_OP_CLIMATE,     0x1B873593u},
+    {LAYER_OP_ZOOM,        0xCC9E2D51u},
+    {LAYER_OP_ZOOM,        0xE6546B64u},
+    {LAYER_OP_PICK_BIOME,  0x85EBCA6Bu},
+    {LAYER_OP_ZOOM,        0xC2B2AE35u},
+    {LAYER_OP_ZOOM,        0x27D4EB2Fu},
+    {LAYER_OP_SMOOTH,      0x165667B1u},
+    {LAYER_OP_ZOOM,        0xD3A2646Cu},
+    {LAYER_OP_ZOOM,        0xFD7046C5u},
+    {LAYER_OP_ZOOM,        0xB55A4F09u},
+    {LAYER_OP_ZOOM,        0x9E3779B9u},
+    {LAYER_OP_SMOOTH,      0x7FEB352Du},
+};
+// clang-format on
+
+Uint32 CellHash(Uint32 Seed, Int32 x, Int32 z)
+{
+    Uint32 h = Seed ^ (static_cast<Uint32>(x) * 0x9E3779B1u) ^ (static_cast<Uint32>(z) * 0x85EBCA77u);
+    h ^= h >> 16u;
+    h *= 0x7FEB352Du;
+    h ^= h >> 15u;
+    h *= 0x846CA68Bu;
+    return h ^ (h >> 16u);
+}
+
+// Values of a layer over a rectangle of its cells
+struct LayerArea
+{
+    Int32 X      = 0;
+    Int32 Z      = 0;
+    Int32 Width  = 0;
+    Int32 Height = 0;
+
+    std::vector<Uint8> Values;
+
+    void Resize(Int32 _X, Int32 _Z, Int32 _Width, Int32 _Height)
+    {
+        X      = _X;
+        Z      = _Z;
+        Width  = _Width;
+        Height = _Height;
+        Values.resize(static_cast<size_t>(Width) * Height);
+    }
+
+    Uint8 Get(Int32 x, Int32 z) const
+    {
+        VERIFY_EXPR(x >= X && x < X + Width && z >= Z && z < Z + Height);
+        return Values[static_cast<size_t>(z - Z) * Width + (x - X)];
+    }
+
+    Uint8& At(Int32 x, Int32 z)
+    {
+        return Values[static_cast<size_t>(z - Z) * Width + (x - X)];
+    }
+};
+
+// The value most of the four share, or a random one of them when there is no majority
+Uint8 SelectModeOrRandom(Uint8 a, Uint8 b, Uint8 c, Uint8 d, Uint32 Hash)
+{
+    if (b == c && c == d)
+        return b;
+    if ((a == b && (a == c || a == d || c != d)) || (a == c && (a == d || b != d)) || (a == d && b != c))
+        return a;
+    if ((b == c && a != d) || (b == d && a != c))
+        return b;
+    if (c == d && a != b)
+        return c;
+
+    const Uint8 Values[] = {a, b, c, d};
+    return Values[Hash & 3u];
+}
+
+BIOME PickBiome(CLIMATE Climate, Uint32 Hash)
+{
+    // clang-format off
+    static constexpr BIOME Warm[]      = {BIOME_DESERT, BIOME_DESERT, BIOME_PLAINS};
+    static constexpr BIOME Temperate[] = {BIOME_PLAINS, BIOME_PLAINS, BIOME_FOREST, BIOME_FOREST, BIOME_MOUNTAINS};
+    static constexpr BIOME Cold[]      = {BIOME_TAIGA, BIOME_TAIGA, BIOME_MOUNTAINS};
+    // clang-format on
+
+    switch (Climate)
+    {
+        case CLIMATE_WARM: return Warm[Hash % _countof(Warm)];
+        case CLIMATE_COLD: return Cold[Hash % _countof(Cold)];
+        default: return Temperate[Hash % _countof(Temperate)];
+    }
+}
+
+// Fills Area with the values of layer LayerIdx, running the layers below it on the
+// rectangle each one needs
+void RunLayer(Uint32 Seed, Uint32 LayerIdx, LayerArea& Area)
+{
+    const Layer& L         = Layers[LayerIdx];
+    const Uint32 LayerSeed = Seed ^ L.Salt;
+
+    if (L.Op == LAYER_OP_CLIMATE)
+    {
+        for (Int32 z = Area.Z; z < Area.Z + Area.Height; ++z)
+        {
+            for (Int32 x = Area.X; x < Area.X + Area.Width; ++x)
+            {
+                const Uint32 r = CellHash(LayerSeed, x, z) % 6u;
+                Area.At(x, z)  = static_cast<Uint8>(r == 0 ? CLIMATE_WARM : (r < 4 ? CLIMATE_TEMPERATE : CLIMATE_COLD));
+            }
+        }
+        return;
+    }
+
+    VERIFY_EXPR(LayerIdx > 0);
+    LayerArea Parent;
+    switch (L.Op)
+    {
+        case LAYER_OP_ZOOM:
+        {
+            const Int32 px0 = Area.X >> 1;
+            const Int32 pz0 = Area.Z >> 1;
+            Parent.Resize(px0, pz0, ((Area.X + Area.Width - 1) >> 1) - px0 + 2, ((Area.Z + Area.Height - 1) >> 1) - pz0 + 2);
+            RunLayer(Seed, LayerIdx - 1, Parent);
+
+            for (Int32 z = Area.Z; z < Area.Z + Area.Height; ++z)
+            {
+                for (Int32 x = Area.X; x < Area.X + Area.Width; ++x)
+                {
+                    // All four cells of a 2x2 block share the parent's hash
+                    const Int32  px   = x >> 1;
+                    const Int32  pz   = z >> 1;
+                    const Uint32 Hash = CellHash(LayerSeed, px, pz);
+                    const Uint8  a    = Parent.Get(px, pz);
+                    switch (((z & 1) << 1) | (x & 1))
+                    {
+                        case 0: Area.At(x, z) = a; break;
+                        case 1: Area.At(x, z) = (Hash & 1u) ? a : Parent.Get(px + 1, pz); break;
+                        case 2: Area.At(x, z) = (Hash & 2u) ? a : Parent.Get(px, pz + 1); break;
+                        default:
+                            Area.At(x, z) = SelectModeOrRandom(a, Parent.Get(px + 1, pz), Parent.Get(px, pz + 1), Parent.Get(px + 1, pz + 1), Hash >> 2u);
+                    }
+                }
+            }
+            break;
+        }
+
+        case LAYER_OP_PICK_BIOME:
+        {
+            Parent.Resize(Area.X, Area.Z, Area.Width, Area.Height);
+            RunLayer(Seed, LayerIdx - 1, Parent);
+            for (Int32 z = Area.Z; z < Area.Z + Area.Height; ++z)
+            {
+                for (Int32 x = Area.X; x < Area.X + Area.Width; ++x)
+                    Area.At(x, z) = PickBiome(static_cast<CLIMATE>(Parent.Get(x, z)), CellHash(LayerSeed, x, z));
+            }
+            break;
+        }
+
+        case LAYER_OP_SMOOTH:
+        {
+            Parent.Resize(Area.X - 1, Area.Z - 1, Area.Width + 2, Area.Height + 2);
+            RunLayer(Seed, LayerIdx - 1, Parent);
+            for (Int32 z = Area.Z; z < Area.Z + Area.Height; ++z)
+            {
+                for (Int32 x = Area.X; x < Area.X + Area.Width; ++x)
+                {
+                    const Uint8 Left  = Parent.Get(x - 1, z);
+                    const Uint8 Right = Parent.Get(x + 1, z);
+                    const Uint8 Up    = Parent.Get(x, z - 1);
+                    const Uint8 Down  = Parent.Get(x, z + 1);
+
+                    Uint8 Value = Parent.Get(x, z);
+                    if (Left == Right && Up == Down)
+                        Value = (CellHash(LayerSeed, x, z) & 1u) ? Left : Up;
+                    else if (Left == Right)
+                        Value = Left;
+                    else if (Up == Down)
+                        Value = Up;
+                    Area.At(x, z) = Value;
+                }
+            }
+            break;
+        }
+
+        default:
+            UNEXPECTED("Unexpected layer operation");
+    }
+}
+
+} // namespace
+
+const BiomeInfo& GetBiomeInfo(BIOME Biome)
+{
+    // clang-format off
+    static const BiomeInfo Infos[] = {
+        // Name         BaseHeight  HeightScale  TopBlock     FillerBlock  MinTrees  MaxTrees
+        {"Plains",      58.f,       12.f,        BLOCK_GRASS, BLOCK_DIRT,  -3,       1},
+        {"Forest",      60.f,       20.f,        BLOCK_GRASS, BLOCK_DIRT,   4,       8},
+        {"Desert",      57.f,       10.f,        BLOCK_SAND,  BLOCK_SAND,   0,       0},
+        {"Taiga",       62.f,       24.f,        BLOCK_GRASS, BLOCK_DIRT,   2,       6},
+        {"Mountains",   72.f,       48.f,        BLOCK_GRASS, BLOCK_DIRT,  -1,       2},
+    };
+    // clang-format on
+    static_assert(_countof(Infos) == BIOME_COUNT, "Please add the new biome to the table");
+
+    VERIFY_EXPR(Biome < BIOME_COUNT);
+    return Infos[Biome < BIOME_COUNT ? Biome : BIOME_PLAINS];
+}
+
+BiomeSource::BiomeSource(Uint32 Seed, size_t CacheRegions) :
+    m_Seed{Seed},
+    m_Cache{CacheRegions * sizeof(RegionBiomes)}
+{
+}
+
+void BiomeSource::GenerateBiomes(Int32 CellX, Int32 CellZ, Int32 Width, Int32 Height, BIOME* pBiomes) const
+{
+    LayerArea Area;
+    Area.Resize(CellX, CellZ, Width, Height);
+    RunLayer(m_Seed, _countof(Layers) - 1, Area);
+    for (size_t i = 0; i < Area.Values.size(); ++i)
+        pBiomes[i] = static_cast<BIOME>(Area.Values[i]);
+}
+
+std::shared_ptr<const BiomeSource::RegionBiomes> BiomeSource::GetRegion(Int32 RegionX, Int32 RegionZ) const
+{
+    m_NumLookups.fetch_add(1, std::memory_order_relaxed);
+
+    const Uint64 Key = (Uint64{static_cast<Uint32>(RegionX)} << 32u) | Uint64{static_cast<Uint32>(RegionZ)};
+    return m_Cache.Get(Key, [&](std::shared_ptr<const RegionBiomes>& pRegion, size_t& Size) {
+        Timer Tmr;
+
+        auto pBiomes = std::make_shared<RegionBiomes>();
+        GenerateBiomes(RegionX * RegionCells, RegionZ * RegionCells, RegionCells, RegionCells, pBiomes->data());
+        pRegion = std::move(pBiomes);
+        Size    = sizeof(RegionBiomes);
+
+        m_NumGenerated.fetch_add(1, std::memory_order_relaxed);
+        m_GenerationNs.fetch_add(static_cast<Uint64>(Tmr.GetElapsedTime() * 1e9), std::memory_order_relaxed);
+    });
+}
+
+BIOME BiomeSource::GetBiome(Int32 x, Int32 z) const
+{
+    const Int32 CellX = BlockToCell(x);
+    const Int32 CellZ = BlockToCell(z);
+
+    const auto pRegion = GetRegion(CellX >> 5, CellZ >> 5);
+    return (*pRegion)[(CellZ & (RegionCells - 1)) * RegionCells + (CellX & (RegionCells - 1))];
+}
+
+void BiomeSource::GetBiomes(Int32 CellX, Int32 CellZ, Int32 Width, Int32 Height, BIOME* pBiomes) const
+{
+    static_assert(RegionCells == 32, "Region shifts below assume 32 cells per region");
+
+    // Copy the part of every region the rectangle overlaps
+    for (Int32 RegionZ = CellZ >> 5; RegionZ <= (CellZ + Height - 1) >> 5; ++RegionZ)
+    {
+        for (Int32 RegionX = CellX >> 5; RegionX <= (CellX + Width - 1) >> 5; ++RegionX)
+        {
+            const auto  pRegion = GetRegion(RegionX, RegionZ);
+            const Int32 x0      = std::max(CellX, RegionX * RegionCells);
+            const Int32 x1      = std::min(CellX + Width, (RegionX + 1) * RegionCells);
+            const Int32 z0      = std::max(CellZ, RegionZ * RegionCells);
+            const Int32 z1      = std::min(CellZ + Height, (RegionZ + 1) * RegionCells);
+            for (Int32 z = z0; z < z1; ++z)
+            {
+                for (Int32 x = x0; x < x1; ++x)
+                    pBiomes[(z - CellZ) * Width + (x - CellX)] = (*pRegion)[(z - RegionZ * RegionCells) * RegionCells + (x - RegionX * RegionCells)];
+            }
+        }
+    }
+}
+
+} // namespace Diligent
@@ -0,0 +1,121 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <memory>
+
+#include "Common/interface/LRUCache.hpp"
+#include "Block.hpp"
+
+namespace Diligent
+{
+
+enum BIOME : Uint8
+{
+    BIOME_PLAINS = 0,
+    BIOME_FOREST,
+    BIOME_DESERT,
+    BIOME_TAIGA,
+    BIOME_MOUNTAINS,
+    BIOME_COUNT
+};
+
+// Terrain parameters of a biome
+struct BiomeInfo
+{
+    const char* Name = nullptr;
+
+    // Terrain height is BaseHeight + HeightScale * noise, blended across biome borders
+    float BaseHeight  = 0;
+    float HeightScale = 0;
+
+    // Top block and the blocks under it on dry land
+    BlockId TopBlock    = BLOCK_GRASS;
+    BlockId FillerBlock = BLOCK_DIRT;
+
+    // Trees per chunk are drawn from [MinTrees, MaxTrees]; negative values make
+    // treeless chunks more likely
+    Int32 MinTrees = 0;
+    Int32 MaxTrees = 0;
+};
+
+const BiomeInfo& GetBiomeInfo(BIOME Biome);
+
+// Biomes at a resolution of one per 4x4 block column, built Legacy Console Edition style
+// by a stack of layers: climate zones 1024 blocks wide are zoomed twice, biomes are picked
+// for each climate, and the result is zoomed six more times down to 4x4 cells with two
+// smoothing passes. Zooms and picks take their randomness from hashes of absolute cell
+// coordinates, so any area comes out the same however it is split up.
+//
+// Biomes are generated in regions of RegionCells x RegionCells cells and kept in an LRU
+// cache, so the many lookups terrain shaping, surface rules and features make for the
+// same columns are served from memory. All methods may be called from any thread.
+class BiomeSource
+{
+public:
+    static constexpr Int32 CellSize    = 4;
+    static constexpr Int32 RegionCells = 32;
+
+    explicit BiomeSource(Uint32 Seed, size_t CacheRegions = 256);
+
+    // Biome of the cell containing block column (x, z)
+    BIOME GetBiome(Int32 x, Int32 z) const;
+
+    // Biomes of Width x Height cells starting at cell (CellX, CellZ), written row by row
+    void GetBiomes(Int32 CellX, Int32 CellZ, Int32 Width, Int32 Height, BIOME* pBiomes) const;
+
+    // Same as GetBiomes() but always runs the layers, bypassing the cache
+    void GenerateBiomes(Int32 CellX, Int32 CellZ, Int32 Width, Int32 Height, BIOME* pBiomes) const;
+
+    static Int32 BlockToCell(Int32 Coord) { return Coord >> 2; }
+
+    // Region lookups made by GetBiome() and GetBiomes() and how many were cache hits
+    Uint64 GetLookupCount() const { return m_NumLookups.load(std::memory_order_relaxed); }
+    Uint64 GetHitCount() const { return m_NumLookups.load(std::memory_order_relaxed) - m_NumGenerated.load(std::memory_order_relaxed); }
+
+    // Regions generated on cache misses and the total time spent generating them
+    Uint64 GetGeneratedRegionCount() const { return m_NumGenerated.load(std::memory_order_relaxed); }
+    double GetGenerationTime() const { return static_cast<double>(m_GenerationNs.load(std::memory_order_relaxed)) * 1e-9; }
+
+private:
+    using RegionBiomes = std::array<BIOME, RegionCells * RegionCells>;
+
+    std::shared_ptr<const RegionBiomes> GetRegion(Int32 RegionX, Int32 RegionZ) const;
+
+private:
+    const Uint32 m_Seed;
+
+    mutable LRUCache<Uint64, std::shared_ptr<const RegionBiomes>> m_Cache;
+
+    mutable std::atomic<Uint64> m_NumLookups{0};
+    mutable std::atomic<Uint64> m_NumGenerated{0};
+    mutable std::atomic<Uint64> m_GenerationNs{0};
+};
+
+} // namespace Diligent
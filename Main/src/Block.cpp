@@ -0,0 +1,132 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include <array>
+
+#include "Block.hpp"
+#include "Platforms/Basic/interface/DebugUtilities.hpp"
+
+namespace Diligent
+{
+
+namespace
+{
+
+std::array<BlockInfo, BLOCK_ID_COUNT> CreateBlockTable()
+{
+    std::array<BlockInfo, BLOCK_ID_COUNT> Table{};
+
+    // Top and bottom textures default to the side texture
+    auto Register = [&](BLOCK_ID Id, const char* Name, bool IsOpaque, const char* Side, const char* Top = nullptr, const char* Bottom = nullptr) {
+        Table[Id].Name         = Name;
+        Table[Id].IsOpaque     = IsOpaque;
+        Table[Id].IsSolid      = IsOpaque;
+        Table[Id].LightOpacity = IsOpaque ? 15 : 0;
+        for (Uint32 Face = 0; Face < BLOCK_FACE_COUNT; ++Face)
+            Table[Id].Textures[Face] = Side;
+        if (Top != nullptr)
+            Table[Id].Textures[BLOCK_FACE_POS_Y] = Top;
+        if (Bottom != nullptr)
+            Table[Id].Textures[BLOCK_FACE_NEG_Y] = Bottom;
+    };
+
+    // clang-format off
+    Register(BLOCK_AIR,                "air",                  false, nullptr);
+    Register(BLOCK_STONE,              "stone",                true,  "stone");
+    Register(BLOCK_GRASS,              "grass",                true,  "grass_side", "grass_top", "dirt");
+    Register(BLOCK_DIRT,               "dirt",                 true,  "dirt");
+    Register(BLOCK_COBBLESTONE,        "cobblestone",          true,  "cobblestone");
+    Register(BLOCK_PLANKS,             "planks",               true,  "planks");
+    Register(BLOCK_BEDROCK,            "bedrock",              true,  "bedrock");
+    Register(BLOCK_WATER,              "water",                false, "water");
+    Register(BLOCK_LAVA,               "lava",                 false, "lava");
+    Register(BLOCK_SAND,               "sand",                 true,  "sand");
+    Register(BLOCK_GRAVEL,             "gravel",               true,  "gravel");
+    Register(BLOCK_LOG,                "log",                  true,  "log_side", "log_top", "log_top");
+    Register(BLOCK_LEAVES,             "leaves",               false, "leaves");
+    Register(BLOCK_GLASS,              "glass",                false, "glass");
+    Register(BLOCK_TORCH,              "torch",                false, "torch");
+    Register(BLOCK_REDSTONE_WIRE,      "redstone_wire",        false, "redstone_dust");
+    Register(BLOCK_REDSTONE_TORCH_OFF, "unlit_redstone_torch", false, "redstone_torch_off");
+    Register(BLOCK_REDSTONE_TORCH,     "redstone_torch",       false, "redstone_torch_on");
+    Register(BLOCK_GLOWSTONE,          "glowstone",            true,  "glowstone");
+    Register(BLOCK_REDSTONE_BLOCK,     "redstone_block",       true,  "redstone_block");
+    // clang-format on
+
+    for (Uint32 Level = 1; Level <= FluidFallingLevel; ++Level)
+    {
+        Register(static_cast<BLOCK_ID>(GetFluidBlock(FLUID_WATER, Level)), "flowing_water", false, "water");
+        Register(static_cast<BLOCK_ID>(GetFluidBlock(FLUID_LAVA, Level)), "flowing_lava", false, "lava");
+    }
+    for (Uint32 Level = 0; Level <= FluidFallingLevel; ++Level)
+    {
+        Table[GetFluidBlock(FLUID_WATER, Level)].LightOpacity = 2;
+        Table[GetFluidBlock(FLUID_LAVA, Level)].LightOpacity  = 15;
+        Table[GetFluidBlock(FLUID_LAVA, Level)].LightEmission = 15;
+    }
+
+    Table[BLOCK_LEAVES].LightOpacity              = 1;
+    Table[BLOCK_TORCH].LightEmission              = 14;
+    Table[BLOCK_GLOWSTONE].LightEmission          = 15;
+    Table[BLOCK_REDSTONE_TORCH].LightEmission     = 7;
+
+    // Grass spreads and dies, leaves decay away from logs
+    Table[BLOCK_GRASS].IsRandomlyTicked  = true;
+    Table[BLOCK_LEAVES].IsRandomlyTicked = true;
+
+    // Leaves and glass show what is behind them but can be walked on
+    Table[BLOCK_LEAVES].IsSolid = true;
+    Table[BLOCK_GLASS].IsSolid  = true;
+
+    Table[BLOCK_SAND].HasGravity   = true;
+    Table[BLOCK_GRAVEL].HasGravity = true;
+
+    return Table;
+}
+
+BlockTextureLayerTable g_BlockTextureLayers = {};
+
+} // namespace
+
+const BlockInfo& GetBlockInfo(BlockId Id)
+{
+    static const std::array<BlockInfo, BLOCK_ID_COUNT> Table = CreateBlockTable();
+    return Table[Id < BLOCK_ID_COUNT ? Id : BlockId{BLOCK_AIR}];
+}
+
+void SetBlockTextureLayers(const BlockTextureLayerTable& Layers)
+{
+    g_BlockTextureLayers = Layers;
+}
+
+Uint32 GetBlockTextureLayer(BlockId Id, Uint32 Face)
+{
+    VERIFY_EXPR(Face < BLOCK_FACE_COUNT);
+    return g_BlockTextureLayers[Id < BLOCK_ID_COUNT ? Id : BlockId{BLOCK_AIR}][Face];
+}
+
+} // namespace Diligent
@@ -0,0 +1,177 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <array>
+
+#include "Primitives/interface/BasicTypes.h"
+#include "Platforms/Basic/interface/DebugUtilities.hpp"
+
+namespace Diligent
+{
+
+using BlockId = Uint16;
+
+// Numeric ids follow the Legacy Console Edition where a block exists there
+enum BLOCK_ID : BlockId
+{
+    BLOCK_AIR                = 0,
+    BLOCK_STONE              = 1,
+    BLOCK_GRASS              = 2,
+    BLOCK_DIRT               = 3,
+    BLOCK_COBBLESTONE        = 4,
+    BLOCK_PLANKS             = 5,
+    BLOCK_BEDROCK            = 7,
+    BLOCK_WATER              = 9,
+    BLOCK_LAVA               = 11,
+    BLOCK_SAND               = 12,
+    BLOCK_GRAVEL             = 13,
+    BLOCK_LOG                = 17,
+    BLOCK_LEAVES             = 18,
+    BLOCK_GLASS              = 20,
+    BLOCK_TORCH              = 50,
+    BLOCK_REDSTONE_WIRE      = 55,
+    BLOCK_REDSTONE_TORCH_OFF = 75,
+    BLOCK_REDSTONE_TORCH     = 76,
+    BLOCK_GLOWSTONE          = 89,
+    BLOCK_REDSTONE_BLOCK     = 152,
+
+    // The console editions keep the level of flowing fluids in block data, which
+    // sections do not store, so each level has its own id (see GetFluidBlock())
+    BLOCK_FLOWING_WATER_FIRST = 224,
+    BLOCK_FLOWING_LAVA_FIRST  = 232,
+
+    BLOCK_ID_COUNT = 256
+};
+
+enum BLOCK_FACE : Uint8
+{
+    BLOCK_FACE_NEG_X = 0,
+    BLOCK_FACE_POS_X,
+    BLOCK_FACE_NEG_Y,
+    BLOCK_FACE_POS_Y,
+    BLOCK_FACE_NEG_Z,
+    BLOCK_FACE_POS_Z,
+    BLOCK_FACE_COUNT
+};
+
+struct BlockInfo
+{
+    const char* Name = nullptr;
+
+    // Opaque blocks fill the whole cell and hide the faces of their neighbours
+    bool IsOpaque = false;
+
+    // Solid blocks fill the whole cell for collision. Fluids, torches and wires do not.
+    bool IsSolid = false;
+
+    // Randomly ticked blocks change on their own at random times (see RandomTicker)
+    bool IsRandomlyTicked = false;
+
+    // Falls as an entity when the block below stops being solid (sand and gravel)
+    bool HasGravity = false;
+
+    // Light levels the block removes from light passing through it (15 blocks light
+    // entirely) and the block light level it emits
+    Uint8 LightOpacity  = 0;
+    Uint8 LightEmission = 0;
+
+    // Texture name of each face, indexed by BLOCK_FACE; null for air
+    const char* Textures[BLOCK_FACE_COUNT] = {};
+};
+
+const BlockInfo& GetBlockInfo(BlockId Id);
+
+// Texture array layer of every block face, indexed by [BlockId][BLOCK_FACE]
+using BlockTextureLayerTable = std::array<std::array<Uint16, BLOCK_FACE_COUNT>, BLOCK_ID_COUNT>;
+
+// Set when a texture pack is loaded. Meshes built before that use layer 0.
+// Must not be called while meshes are being built.
+void SetBlockTextureLayers(const BlockTextureLayerTable& Layers);
+
+Uint32 GetBlockTextureLayer(BlockId Id, Uint32 Face);
+
+inline bool IsOpaqueBlock(BlockId Id)
+{
+    return GetBlockInfo(Id).IsOpaque;
+}
+
+inline bool IsSolidBlock(BlockId Id)
+{
+    return GetBlockInfo(Id).IsSolid;
+}
+
+inline bool IsRandomlyTickedBlock(BlockId Id)
+{
+    return GetBlockInfo(Id).IsRandomlyTicked;
+}
+
+inline bool HasBlockGravity(BlockId Id)
+{
+    return GetBlockInfo(Id).HasGravity;
+}
+
+enum FLUID_TYPE : Uint8
+{
+    FLUID_NONE = 0,
+    FLUID_WATER,
+    FLUID_LAVA
+};
+
+// Source blocks are level 0. Flowing fluid gets one level weaker per step away from its
+// source, down to level 7, and level 8 is fluid falling from the block above.
+constexpr Uint32 FluidSourceLevel  = 0;
+constexpr Uint32 FluidMaxLevel     = 7;
+constexpr Uint32 FluidFallingLevel = 8;
+
+inline FLUID_TYPE GetFluidType(BlockId Id)
+{
+    if (Id == BLOCK_WATER || (Id >= BLOCK_FLOWING_WATER_FIRST && Id < BLOCK_FLOWING_WATER_FIRST + FluidFallingLevel))
+        return FLUID_WATER;
+    if (Id == BLOCK_LAVA || (Id >= BLOCK_FLOWING_LAVA_FIRST && Id < BLOCK_FLOWING_LAVA_FIRST + FluidFallingLevel))
+        return FLUID_LAVA;
+    return FLUID_NONE;
+}
+
+// Level of a fluid block, see FluidSourceLevel
+inline Uint32 GetFluidLevel(BlockId Id)
+{
+    if (Id == BLOCK_WATER || Id == BLOCK_LAVA)
+        return FluidSourceLevel;
+    return Id - (GetFluidType(Id) == FLUID_WATER ? BLOCK_FLOWING_WATER_FIRST : BLOCK_FLOWING_LAVA_FIRST) + 1u;
+}
+
+inline BlockId GetFluidBlock(FLUID_TYPE Type, Uint32 Level)
+{
+    VERIFY_EXPR(Type != FLUID_NONE && Level <= FluidFallingLevel);
+    if (Level == FluidSourceLevel)
+        return Type == FLUID_WATER ? BLOCK_WATER : BLOCK_LAVA;
+    return static_cast<BlockId>((Type == FLUID_WATER ? BLOCK_FLOWING_WATER_FIRST : BLOCK_FLOWING_LAVA_FIRST) + Level - 1u);
+}
+
+} // namespace Diligent
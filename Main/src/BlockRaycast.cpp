@@ -0,0 +1,140 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include "BlockRaycast.hpp"
+
+#include <cmath>
+#include <limits>
+
+namespace Diligent
+{
+
+bool RaycastBlocks(const World& Wrld, const float3& Origin, const float3& Direction, float MaxDistance, BlockHit& Hit)
+{
+    VERIFY(std::abs(length(Direction) - 1.f) < 1e-3f, "Ray direction must be normalized");
+
+    constexpr float Infinity = std::numeric_limits<float>::infinity();
+
+    // Per axis: the step towards the ray, the distance along the ray to the next cell
+    // boundary, and the distance between boundaries
+    int3   Cell;
+    int3   Step;
+    float3 NextBoundary;
+    float3 BoundaryStep;
+    for (Uint32 Axis = 0; Axis < 3; ++Axis)
+    {
+        Cell[Axis] = static_cast<Int32>(std::floor(Origin[Axis]));
+        if (Direction[Axis] > 0)
+        {
+            Step[Axis]         = 1;
+            NextBoundary[Axis] = (static_cast<float>(Cell[Axis] + 1) - Origin[Axis]) / Direction[Axis];
+            BoundaryStep[Axis] = 1.f / Direction[Axis];
+        }
+        else if (Direction[Axis] < 0)
+        {
+            Step[Axis]         = -1;
+            NextBoundary[Axis] = (static_cast<float>(Cell[Axis]) - Origin[Axis]) / Direction[Axis];
+            BoundaryStep[Axis] = -1.f / Direction[Axis];
+        }
+        else
+        {
+            Step[Axis]         = 0;
+            NextBoundary[Axis] = Infinity;
+            BoundaryStep[Axis] = Infinity;
+        }
+    }
+
+    // Face a cell is entered through when stepping along each axis in the negative and
+    // in the positive direction
+    static constexpr BLOCK_FACE EnteredFaces[3][2] = {
+        {BLOCK_FACE_POS_X, BLOCK_FACE_NEG_X},
+        {BLOCK_FACE_POS_Y, BLOCK_FACE_NEG_Y},
+        {BLOCK_FACE_POS_Z, BLOCK_FACE_NEG_Z},
+    };
+
+    const Chunk* pChunk   = nullptr;
+    BLOCK_FACE   Face     = BLOCK_FACE_COUNT;
+    float        Distance = 0;
+    while (Distance <= MaxDistance)
+    {
+        if (Cell.y >= 0 && Cell.y < Chunk::Height)
+        {
+            const Int32 ChunkX = World::BlockToChunk(Cell.x);
+            const Int32 ChunkZ = World::BlockToChunk(Cell.z);
+            if (pChunk == nullptr || pChunk->GetX() != ChunkX || pChunk->GetZ() != ChunkZ)
+            {
+                pChunk = Wrld.GetChunk(ChunkX, ChunkZ);
+                if (pChunk == nullptr)
+                    return false;
+            }
+
+            if (IsPickableBlock(pChunk->GetBlock(World::BlockToLocal(Cell.x), Cell.y, World::BlockToLocal(Cell.z))))
+            {
+                Hit.Pos      = Cell;
+                Hit.Face     = Face;
+                Hit.Distance = Distance;
+                return true;
+            }
+        }
+        else if ((Cell.y < 0 && Step.y <= 0) || (Cell.y >= Chunk::Height && Step.y >= 0))
+        {
+            // Outside the world and not coming back
+            return false;
+        }
+
+        // Cross the nearest cell boundary
+        const Uint32 Axis = NextBoundary.x < NextBoundary.y ?
+            (NextBoundary.x < NextBoundary.z ? 0 : 2) :
+            (NextBoundary.y < NextBoundary.z ? 1 : 2);
+
+        Distance = NextBoundary[Axis];
+        Cell[Axis] += Step[Axis];
+        NextBoundary[Axis] += BoundaryStep[Axis];
+        Face = EnteredFaces[Axis][Step[Axis] > 0 ? 1 : 0];
+    }
+    return false;
+}
+
+int3 GetFaceNormal(BLOCK_FACE Face)
+{
+    switch (Face)
+    {
+        // clang-format off
+        case BLOCK_FACE_NEG_X: return int3{-1,  0,  0};
+        case BLOCK_FACE_POS_X: return int3{ 1,  0,  0};
+        case BLOCK_FACE_NEG_Y: return int3{ 0, -1,  0};
+        case BLOCK_FACE_POS_Y: return int3{ 0,  1,  0};
+        case BLOCK_FACE_NEG_Z: return int3{ 0,  0, -1};
+        case BLOCK_FACE_POS_Z: return int3{ 0,  0,  1};
+        // clang-format on
+        default:
+            UNEXPECTED("Unexpected face");
+            return int3{};
+    }
+}
+
+} // namespace Diligent
@@ -0,0 +1,63 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include "World.hpp"
+
+namespace Diligent
+{
+
+struct BlockHit
+{
+    int3 Pos;
+    // Face the ray entered the block through, BLOCK_FACE_COUNT if it started inside it
+    BLOCK_FACE Face = BLOCK_FACE_COUNT;
+    // Along the ray from its origin
+    float Distance = 0;
+};
+
+// Blocks the player can point at: anything but air and fluids. Torches and wires are
+// picked as whole cells.
+inline bool IsPickableBlock(BlockId Id)
+{
+    return Id != BLOCK_AIR && GetFluidType(Id) == FLUID_NONE;
+}
+
+// Finds the first pickable block along the ray within MaxDistance.
+//
+// Walks the cells the ray passes through in order (Amanatides and Woo's voxel traversal),
+// crossing one cell face per step, so the cost grows with the distance and not with a
+// sampling rate, and no block is skipped or read twice. Chunks are looked up once per
+// column the ray enters. The ray stops at unloaded chunks and when it leaves the world
+// vertically. Direction must be normalized.
+bool RaycastBlocks(const World& Wrld, const float3& Origin, const float3& Direction, float MaxDistance, BlockHit& Hit);
+
+// Offset to the neighbour across a face
+int3 GetFaceNormal(BLOCK_FACE Face);
+
+} // namespace Diligent
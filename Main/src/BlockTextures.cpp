@@ -0,0 +1,295 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+#include "BlockTextures.hpp"
+
+#include <algorithm>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "Common/interface/ThreadPool.hpp"
+#include "Common/interface/Timer.hpp"
+#include "Graphics/GraphicsTools/interface/GraphicsUtilities.h"
+#include "TextureLoader/interface/Image.h"
+#include "Platforms/interface/PlatformMisc.hpp"
+
+namespace Diligent
+{
+
+namespace
+{
+
+constexpr TEXTURE_FORMAT BlockTextureFormat = TEX_FORMAT_RGBA8_UNORM_SRGB;
+constexpr Uint32         DefaultResolution  = 16;
+// Keeps cut-out textures such as leaves from fading away in the smaller mips
+constexpr float AlphaCutoff = 0.5f;
+
+struct DecodedTexture
+{
+    // Zero if the texture could not be loaded
+    Uint32 Size = 0;
+
+    // RGBA8 pixels of every mip level, finest first
+    std::vector<std::vector<Uint8>> Mips;
+};
+
+bool IsPowerOfTwo(Uint32 Value)
+{
+    return Value != 0 && (Value & (Value - 1)) == 0;
+}
+
+Uint32 GetMipLevelCount(Uint32 Size)
+{
+    return PlatformMisc::GetMSB(Size) + 1;
+}
+
+void ComputeMipChain(DecodedTexture& Tex)
+{
+    const Uint32 NumMips = GetMipLevelCount(Tex.Size);
+    Tex.Mips.resize(NumMips);
+    for (Uint32 Mip = 1; Mip < NumMips; ++Mip)
+    {
+        const Uint32 FineSize   = Tex.Size >> (Mip - 1);
+        const Uint32 CoarseSize = Tex.Size >> Mip;
+        Tex.Mips[Mip].resize(size_t{CoarseSize} * CoarseSize * 4);
+
+        ComputeMipLevelAttribs Attribs;
+        Attribs.Format          = BlockTextureFormat;
+        Attribs.FineMipWidth    = FineSize;
+        Attribs.FineMipHeight   = FineSize;
+        Attribs.pFineMipData    = Tex.Mips[Mip - 1].data();
+        Attribs.FineMipStride   = size_t{FineSize} * 4;
+        Attribs.pCoarseMipData  = Tex.Mips[Mip].data();
+        Attribs.CoarseMipStride = size_t{CoarseSize} * 4;
+        Attribs.AlphaCutoff     = AlphaCutoff;
+        ComputeMipLevel(Attribs);
+    }
+}
+
+bool DecodeTexture(const std::string& Path, DecodedTexture& Tex)
+{
+    RefCntAutoPtr<Image> pImage;
+    CreateImageFromFile(Path.c_str(), &pImage);
+    if (!pImage)
+        return false;
+
+    const ImageDesc& Desc = pImage->GetDesc();
+    if (Desc.ComponentType != VT_UINT8 || Desc.NumComponents == 0 || Desc.NumComponents > 4)
+    {
+        LOG_WARNING_MESSAGE("Block texture '", Path, "' must have 8-bit components");
+        return false;
+    }
+    if (Desc.Width != Desc.Height || !IsPowerOfTwo(Desc.Width))
+    {
+        LOG_WARNING_MESSAGE("Block texture '", Path, "' must be square with a power-of-two size");
+        return false;
+    }
+
+    Tex.Size = Desc.Width;
+    Tex.Mips.resize(1);
+
+    auto& Pixels = Tex.Mips[0];
+    Pixels.resize(size_t{Tex.Size} * Tex.Size * 4);
+
+    // Expand grey, grey + alpha and RGB images to RGBA
+    const Uint8* pSrc = static_cast<const Uint8*>(pImage->GetData()->GetConstDataPtr());
+    for (Uint32 y = 0; y < Tex.Size; ++y)
+    {
+        const Uint8* pRow = pSrc + size_t{y} * Desc.RowStride;
+        for (Uint32 x = 0; x < Tex.Size; ++x)
+        {
+            const Uint8* pTexel = pRow + size_t{x} * Desc.NumComponents;
+            Uint8*       pDst   = &Pixels[(size_t{y} * Tex.Size + x) * 4];
+            if (Desc.NumComponents <= 2)
+            {
+                pDst[0] = pDst[1] = pDst[2] = pTexel[0];
+                pDst[3]                     = Desc.NumComponents == 2 ? pTexel[1] : 255;
+            }
+            else
+            {
+                pDst[0] = pTexel[0];
+                pDst[1] = pTexel[1];
+                pDst[2] = pTexel[2];
+                pDst[3] = Desc.NumComponents == 4 ? pTexel[3] : 255;
+            }
+        }
+    }
+
+    ComputeMipChain(Tex);
+    return true;
+}
+
+// Magenta and black checkerboard, 2x2 cells per texture
+DecodedTexture CreateMissingTexture(Uint32 Size)
+{
+    DecodedTexture Tex;
+    Tex.Size = Size;
+    Tex.Mips.resize(1);
+    Tex.Mips[0].resize(size_t{Size} * Size * 4);
+    for (Uint32 y = 0; y < Size; ++y)
+    {
+        for (Uint32 x = 0; x < Size; ++x)
+        {
+            const bool IsMagenta = ((x * 2 / Size) ^ (y * 2 / Size)) != 0;
+            Uint8*     pDst      = &Tex.Mips[0][(size_t{y} * Size + x) * 4];
+            pDst[0]              = IsMagenta ? 255 : 0;
+            pDst[1]              = 0;
+            pDst[2]              = IsMagenta ? 255 : 0;
+            pDst[3]              = 255;
+        }
+    }
+    ComputeMipChain(Tex);
+    return Tex;
+}
+
+} // namespace
+
+bool BlockTextureArray::LoadPack(IRenderDevice* pDevice, IDeviceContext* pContext, const std::string& PackDir)
+{
+    Timer Tmr;
+
+    // Every distinct texture name used by the block table, in first-use order
+    std::vector<std::string>                Names;
+    std::unordered_map<std::string, Uint32> NameIndices;
+    for (Uint32 Id = 0; Id < BLOCK_ID_COUNT; ++Id)
+    {
+        for (const char* Name : GetBlockInfo(static_cast<BlockId>(Id)).Textures)
+        {
+            if (Name != nullptr && NameIndices.emplace(Name, static_cast<Uint32>(Names.size())).second)
+                Names.emplace_back(Name);
+        }
+    }
+
+    // PNG decoding and mip generation dominate the load time and are independent per texture
+    std::vector<DecodedTexture> Decoded(Names.size());
+
+    const Uint32 NumThreads = std::clamp(std::thread::hardware_concurrency(), 1u, static_cast<Uint32>(std::max(Names.size(), size_t{1})));
+    {
+        RefCntAutoPtr<IThreadPool> pThreadPool = CreateThreadPool(ThreadPoolCreateInfo{NumThreads});
+        for (size_t i = 0; i < Names.size(); ++i)
+        {
+            EnqueueAsyncWork(pThreadPool, [&, i](Uint32 /*ThreadId*/) {
+                const std::string Path = PackDir + "/blocks/" + Names[i] + ".png";
+                if (!DecodeTexture(Path, Decoded[i]))
+                {
+                    LOG_WARNING_MESSAGE("Block texture '", Path, "' could not be loaded");
+                    Decoded[i] = {};
+                }
+            });
+        }
+        pThreadPool->WaitForAllTasks();
+        pThreadPool->StopThreads();
+    }
+
+    // The first texture decides the resolution of the pack
+    Uint32 Resolution = 0;
+    for (size_t i = 0; i < Names.size(); ++i)
+    {
+        if (Decoded[i].Size == 0)
+            continue;
+        if (Resolution == 0)
+            Resolution = Decoded[i].Size;
+        if (Decoded[i].Size != Resolution)
+        {
+            LOG_WARNING_MESSAGE("Block texture '", Names[i], "' is ", Decoded[i].Size, "px, the pack is ", Resolution, "px");
+            Decoded[i] = {};
+        }
+    }
+    const bool HasTextures = Resolution != 0;
+    if (!HasTextures)
+    {
+        LOG_ERROR_MESSAGE("Texture pack '", PackDir, "' has no usable block textures");
+        Resolution = DefaultResolution;
+    }
+
+    // Layer 0 is the missing texture, the loaded ones follow in name order
+    std::vector<const DecodedTexture*> Layers;
+    std::vector<Uint16>                NameLayers(Names.size(), 0);
+
+    const DecodedTexture MissingTexture = CreateMissingTexture(Resolution);
+    Layers.push_back(&MissingTexture);
+    for (size_t i = 0; i < Names.size(); ++i)
+    {
+        if (Decoded[i].Size != 0)
+        {
+            NameLayers[i] = static_cast<Uint16>(Layers.size());
+            Layers.push_back(&Decoded[i]);
+        }
+    }
+
+    BlockTextureLayerTable LayerTable = {};
+    for (Uint32 Id = 0; Id < BLOCK_ID_COUNT; ++Id)
+    {
+        const BlockInfo& Info = GetBlockInfo(static_cast<BlockId>(Id));
+        for (Uint32 Face = 0; Face < BLOCK_FACE_COUNT; ++Face)
+        {
+            if (Info.Textures[Face] != nullptr)
+                LayerTable[Id][Face] = NameLayers[NameIndices[Info.Textures[Face]]];
+        }
+    }
+    SetBlockTextureLayers(LayerTable);
+
+    const Uint32 NumMips = GetMipLevelCount(Resolution);
+    if (!m_pArray || m_pArray->GetDesc().Width != Resolution)
+    {
+        DynamicTextureArrayCreateInfo ArrayCI;
+        ArrayCI.Desc.Name      = "Block texture array";
+        ArrayCI.Desc.Type      = RESOURCE_DIM_TEX_2D_ARRAY;
+        ArrayCI.Desc.Width     = Resolution;
+        ArrayCI.Desc.Height    = Resolution;
+        ArrayCI.Desc.MipLevels = NumMips;
+        ArrayCI.Desc.Format    = BlockTextureFormat;
+        ArrayCI.Desc.BindFlags = BIND_SHADER_RESOURCE;
+        ArrayCI.Desc.Usage     = USAGE_DEFAULT;
+        m_pArray               = std::make_unique<DynamicTextureArray>(pDevice, ArrayCI);
+    }
+    m_pArray->Resize(pDevice, pContext, static_cast<Uint32>(Layers.size()), true);
+
+    ITexture* pTexture = m_pArray->GetTexture(pDevice, pContext);
+    for (Uint32 Layer = 0; Layer < Layers.size(); ++Layer)
+    {
+        for (Uint32 Mip = 0; Mip < NumMips; ++Mip)
+        {
+            const Uint32 MipSize = Resolution >> Mip;
+
+            TextureSubResData SubResData;
+            SubResData.pData  = Layers[Layer]->Mips[Mip].data();
+            SubResData.Stride = Uint64{MipSize} * 4;
+            pContext->UpdateTexture(pTexture, Mip, Layer, Box{0, MipSize, 0, MipSize}, SubResData,
+                                    RESOURCE_STATE_TRANSITION_MODE_NONE, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+        }
+    }
+    m_pSRV = pTexture->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE);
+
+    m_LoadTime = Tmr.GetElapsedTime();
+    LOG_INFO_MESSAGE("Loaded texture pack '", PackDir, "': ", Layers.size() - 1, " of ", Names.size(), " block textures, ",
+                     Resolution, "px, in ", m_LoadTime * 1000.0, " ms using ", NumThreads, " decode threads");
+
+    return HasTextures;
+}
+
+} // namespace Diligent
@@ -0,0 +1,68 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include "Graphics/GraphicsEngine/interface/RenderDevice.h"
+#include "Graphics/GraphicsEngine/interface/DeviceContext.h"
+#include "Graphics/GraphicsTools/interface/DynamicTextureArray.hpp"
+#include "Block.hpp"
+
+namespace Diligent
+{
+
+// All block textures in one 2D texture array with full mip chains.
+//
+// A texture pack is a directory with a blocks/ subdirectory holding one PNG per
+// texture name used in the block table (see BlockInfo::Textures). Every texture in a
+// pack must have the same square, power-of-two size. Layer 0 is a generated
+// "missing" texture used for names the pack does not provide.
+class BlockTextureArray
+{
+public:
+    // Decodes the pack on a temporary thread pool, uploads it and updates the block
+    // face layers (see SetBlockTextureLayers()). Returns false if the pack has no
+    // usable textures, in which case every face shows the missing texture.
+    bool LoadPack(IRenderDevice* pDevice, IDeviceContext* pContext, const std::string& PackDir);
+
+    ITextureView* GetSRV() const { return m_pSRV; }
+
+    Uint32 GetLayerCount() const { return m_pArray ? m_pArray->GetDesc().ArraySize : 0; }
+    Uint32 GetResolution() const { return m_pArray ? m_pArray->GetDesc().Width : 0; }
+    Uint64 GetMemoryUsage() const { return m_pArray ? m_pArray->GetMemoryUsage() : 0; }
+    // Wall-clock time of the last LoadPack(), in seconds
+    double GetLoadTime() const { return m_LoadTime; }
+
+private:
+    std::unique_ptr<DynamicTextureArray> m_pArray;
+    RefCntAutoPtr<ITextureView>          m_pSRV;
+    double                               m_LoadTime = 0;
+};
+
+} // namespace Diligent
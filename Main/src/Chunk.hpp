@@ -0,0 +1,91 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <array>
+
+#include "ChunkSection.hpp"
+
+namespace Diligent
+{
+
+// A 16-block wide column of sections spanning the full world height
+class Chunk
+{
+public:
+    static constexpr Int32 NumSections = 8;
+    static constexpr Int32 Height      = NumSections * ChunkSection::Size;
+
+    Chunk(Int32 X, Int32 Z) :
+        m_X{X},
+        m_Z{Z}
+    {}
+
+    Int32 GetX() const { return m_X; }
+    Int32 GetZ() const { return m_Z; }
+
+    // x and z are chunk-local, y is in [0, Height)
+    BlockId GetBlock(Uint32 x, Int32 y, Uint32 z) const
+    {
+        if (y < 0 || y >= Height)
+            return BLOCK_AIR;
+        return m_Sections[y >> 4].GetBlock(x, y & 15, z);
+    }
+
+    void SetBlock(Uint32 x, Int32 y, Uint32 z, BlockId Id)
+    {
+        VERIFY_EXPR(y >= 0 && y < Height);
+        m_Sections[y >> 4].SetBlock(x, y & 15, z, Id);
+    }
+
+    ChunkSection&       GetSection(Int32 Index) { return m_Sections[Index]; }
+    const ChunkSection& GetSection(Int32 Index) const { return m_Sections[Index]; }
+
+    // Set when a block is changed through World::SetBlock(), so that chunks that only
+    // hold generated terrain are never written to disk
+    bool IsModified() const { return m_IsModified; }
+    void SetModified(bool IsModified) { m_IsModified = IsModified; }
+
+    size_t GetMemoryUsage() const
+    {
+        size_t Size = sizeof(*this) - sizeof(m_Sections);
+        for (const auto& Section : m_Sections)
+            Size += Section.GetMemoryUsage();
+        return Size;
+    }
+
+private:
+    const Int32 m_X;
+    const Int32 m_Z;
+
+    bool m_IsModified = false;
+
+    std::array<ChunkSection, NumSections> m_Sections;
+};
+
+} // namespace Diligent
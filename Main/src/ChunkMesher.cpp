@@ -0,0 +1,523 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include <algorithm>
+
+#include "ChunkMesher.hpp"
+
+namespace Diligent
+{
+
+namespace
+{
+
+struct FaceAxes
+{
+    Uint32 Axis; // Axis the face normal points along
+    Uint32 U;    // In-plane axes, chosen so that U x V points along the normal and
+    Uint32 V;    // quads emitted as (u,v) (u+w,v) (u+w,v+h) (u,v+h) are front-facing
+    Int32  Sign;
+};
+
+// Must match the face axes in cube.vsh, which expands quads from their first block
+// clang-format off
+constexpr FaceAxes FaceAxesTable[BLOCK_FACE_COUNT] =
+{
+    {0, 2, 1, -1}, // BLOCK_FACE_NEG_X
+    {0, 1, 2, +1}, // BLOCK_FACE_POS_X
+    {1, 0, 2, -1}, // BLOCK_FACE_NEG_Y
+    {1, 2, 0, +1}, // BLOCK_FACE_POS_Y
+    {2, 1, 0, -1}, // BLOCK_FACE_NEG_Z
+    {2, 0, 1, +1}, // BLOCK_FACE_POS_Z
+};
+// clang-format on
+
+// Ambient occlusion of a corner from the opacity of the two side blocks and the
+// diagonal block in front of the face: bit 0 side 1, bit 1 side 2, bit 2 diagonal.
+// Two opaque sides fully occlude the corner whatever the diagonal is.
+// clang-format off
+constexpr Uint8 CornerAOTable[8] = {3, 2, 2, 0, 2, 1, 1, 0};
+// clang-format on
+
+// Rounded average of up to four light levels, indexed by [count][sum]
+struct LightAverageTable
+{
+    Uint8 Values[5][4 * 15 + 1] = {};
+
+    constexpr LightAverageTable()
+    {
+        for (Uint32 Count = 1; Count <= 4; ++Count)
+        {
+            for (Uint32 Sum = 0; Sum <= 4 * 15; ++Sum)
+                Values[Count][Sum] = static_cast<Uint8>((Sum + Count / 2) / Count);
+        }
+    }
+};
+constexpr LightAverageTable LightAverages;
+
+// Light unpacked to sky << 8 | block, so that both levels are summed with one add
+struct WideLightTable
+{
+    Uint16 Values[256] = {};
+
+    constexpr WideLightTable()
+    {
+        for (Uint32 i = 0; i < 256; ++i)
+            Values[i] = static_cast<Uint16>(((i >> 4u) << 8u) | (i & 15u));
+    }
+};
+constexpr WideLightTable WideLight;
+
+// Calls Handler(x, y, z) for the cells of the padded arrays outside the section, always
+// in the same order
+template <typename HandlerType>
+void ForEachBorderCell(HandlerType&& Handler)
+{
+    constexpr Int32 S = static_cast<Int32>(ChunkSection::Size);
+
+    for (Int32 y = -1; y <= S; ++y)
+    {
+        for (Int32 z = -1; z <= S; ++z)
+        {
+            if (y < 0 || y == S || z < 0 || z == S)
+            {
+                for (Int32 x = -1; x <= S; ++x)
+                    Handler(x, y, z);
+            }
+            else
+            {
+                Handler(-1, y, z);
+                Handler(S, y, z);
+            }
+        }
+    }
+}
+
+} // namespace
+
+ChunkMesher::Neighbourhood ChunkMesher::GetNeighbourhood(const World& Wrld, const int3& SectionPos)
+{
+    // Nothing can see the faces facing out of the bottom of the world
+    static const ChunkSection BelowWorld{BLOCK_BEDROCK};
+
+    Neighbourhood Sections{};
+    for (Int32 dy = -1; dy <= 1; ++dy)
+    {
+        for (Int32 dz = -1; dz <= 1; ++dz)
+        {
+            for (Int32 dx = -1; dx <= 1; ++dx)
+            {
+                const int3 Pos                                    = SectionPos + int3{dx, dy, dz};
+                Sections[(dy + 1) * 9 + (dz + 1) * 3 + (dx + 1)] = Pos.y < 0 ? &BelowWorld : Wrld.GetSection(Pos);
+            }
+        }
+    }
+    return Sections;
+}
+
+void ChunkMesher::GatherBlocks(const Neighbourhood& Sections, BlockId* pPadded)
+{
+    constexpr Int32 S = static_cast<Int32>(ChunkSection::Size);
+
+    for (Int32 dy = -1; dy <= 1; ++dy)
+    {
+        // Range of section-local coordinates this neighbour contributes along each axis
+        const Int32 y0 = dy < 0 ? S - 1 : 0;
+        const Int32 y1 = dy > 0 ? 0 : S - 1;
+        for (Int32 dz = -1; dz <= 1; ++dz)
+        {
+            const Int32 z0 = dz < 0 ? S - 1 : 0;
+            const Int32 z1 = dz > 0 ? 0 : S - 1;
+            for (Int32 dx = -1; dx <= 1; ++dx)
+            {
+                const Int32 x0 = dx < 0 ? S - 1 : 0;
+                const Int32 x1 = dx > 0 ? 0 : S - 1;
+
+                const ChunkSection* pSection = Sections[(dy + 1) * 9 + (dz + 1) * 3 + (dx + 1)];
+
+                if (pSection == nullptr || pSection->IsUniform())
+                {
+                    const BlockId Fill = pSection != nullptr ? pSection->GetUniformBlock() : BlockId{BLOCK_AIR};
+                    for (Int32 y = y0; y <= y1; ++y)
+                    {
+                        for (Int32 z = z0; z <= z1; ++z)
+                        {
+                            BlockId* pRow = pPadded + GetPaddedIndex(x0 + dx * S, y + dy * S, z + dz * S);
+                            std::fill_n(pRow, x1 - x0 + 1, Fill);
+                        }
+                    }
+                    continue;
+                }
+
+                for (Int32 y = y0; y <= y1; ++y)
+                {
+                    for (Int32 z = z0; z <= z1; ++z)
+                    {
+                        BlockId* pRow = pPadded + GetPaddedIndex(x0 + dx * S, y + dy * S, z + dz * S);
+                        for (Int32 x = x0; x <= x1; ++x)
+                            *pRow++ = pSection->GetBlock(x, y, z);
+                    }
+                }
+            }
+        }
+    }
+}
+
+void ChunkMesher::GatherLight(const Neighbourhood& Sections, Uint8* pPaddedLight)
+{
+    constexpr Int32 S = static_cast<Int32>(ChunkSection::Size);
+
+    for (Int32 dy = -1; dy <= 1; ++dy)
+    {
+        const Int32 y0 = dy < 0 ? S - 1 : 0;
+        const Int32 y1 = dy > 0 ? 0 : S - 1;
+        for (Int32 dz = -1; dz <= 1; ++dz)
+        {
+            const Int32 z0 = dz < 0 ? S - 1 : 0;
+            const Int32 z1 = dz > 0 ? 0 : S - 1;
+            for (Int32 dx = -1; dx <= 1; ++dx)
+            {
+                const Int32 x0 = dx < 0 ? S - 1 : 0;
+                const Int32 x1 = dx > 0 ? 0 : S - 1;
+
+                const ChunkSection* pSection = Sections[(dy + 1) * 9 + (dz + 1) * 3 + (dx + 1)];
+                if (pSection == nullptr || (pSection->GetSkyLight().IsUniform() && pSection->GetBlockLight().IsUniform()))
+                {
+                    const Uint8 Fill = pSection != nullptr ?
+                        static_cast<Uint8>(pSection->GetSkyLight().GetUniformValue() << 4u | pSection->GetBlockLight().GetUniformValue()) :
+                        Uint8{15u << 4u};
+                    for (Int32 y = y0; y <= y1; ++y)
+                    {
+                        for (Int32 z = z0; z <= z1; ++z)
+                            std::fill_n(pPaddedLight + GetPaddedIndex(x0 + dx * S, y + dy * S, z + dz * S), x1 - x0 + 1, Fill);
+                    }
+                    continue;
+                }
+
+                const NibbleArray& SkyLight   = pSection->GetSkyLight();
+                const NibbleArray& BlockLight = pSection->GetBlockLight();
+                for (Int32 y = y0; y <= y1; ++y)
+                {
+                    for (Int32 z = z0; z <= z1; ++z)
+                    {
+                        Uint8* pRow = pPaddedLight + GetPaddedIndex(x0 + dx * S, y + dy * S, z + dz * S);
+                        for (Int32 x = x0; x <= x1; ++x)
+                        {
+                            const Uint32 Index = ChunkSection::GetIndex(x, y, z);
+                            *pRow++            = static_cast<Uint8>(SkyLight.Get(Index) << 4u | BlockLight.Get(Index));
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+void ChunkMesher::GatherBorder(const Neighbourhood& Sections, SectionBorder& Border)
+{
+    constexpr Int32 S = static_cast<Int32>(ChunkSection::Size);
+
+    Uint32 i = 0;
+    ForEachBorderCell([&](Int32 x, Int32 y, Int32 z) {
+        const Int32 dx = x < 0 ? -1 : (x >= S ? 1 : 0);
+        const Int32 dy = y < 0 ? -1 : (y >= S ? 1 : 0);
+        const Int32 dz = z < 0 ? -1 : (z >= S ? 1 : 0);
+
+        const ChunkSection* pSection = Sections[(dy + 1) * 9 + (dz + 1) * 3 + (dx + 1)];
+        if (pSection == nullptr)
+        {
+            Border.Blocks[i] = BLOCK_AIR;
+            Border.Light[i]  = Uint8{15u << 4u};
+        }
+        else
+        {
+            const Uint32 Index = ChunkSection::GetIndex(x - dx * S, y - dy * S, z - dz * S);
+            Border.Blocks[i]   = pSection->GetBlock(Index);
+            Border.Light[i]    = static_cast<Uint8>(pSection->GetSkyLight().Get(Index) << 4u | pSection->GetBlockLight().Get(Index));
+        }
+        ++i;
+    });
+    VERIFY_EXPR(i == SectionBorder::Volume);
+}
+
+void ChunkMesher::GatherWithBorder(const ChunkSection* pSection, const SectionBorder& Border, BlockId* pPadded, Uint8* pPaddedLight)
+{
+    // Only the centre is read from a section; the border cells gathered as air are overwritten below
+    Neighbourhood Sections{};
+    Sections[13] = pSection;
+    GatherBlocks(Sections, pPadded);
+    GatherLight(Sections, pPaddedLight);
+
+    Uint32 i = 0;
+    ForEachBorderCell([&](Int32 x, Int32 y, Int32 z) {
+        const Uint32 Index  = GetPaddedIndex(x, y, z);
+        pPadded[Index]      = Border.Blocks[i];
+        pPaddedLight[Index] = Border.Light[i];
+        ++i;
+    });
+}
+
+void ChunkMesher::Mesh(const BlockId* pPadded, const Uint8* pPaddedLight, ChunkMesh& Mesh, bool Greedy)
+{
+    constexpr Int32 S = static_cast<Int32>(ChunkSection::Size);
+
+    Mesh.Vertices.clear();
+
+    // Faces between equal blocks are hidden, and all levels of a fluid count as equal
+    Uint8   IsOpaque[BLOCK_ID_COUNT];
+    BlockId FaceGroup[BLOCK_ID_COUNT];
+    for (Uint32 Id = 0; Id < BLOCK_ID_COUNT; ++Id)
+    {
+        const FLUID_TYPE Fluid = GetFluidType(static_cast<BlockId>(Id));
+
+        IsOpaque[Id]  = IsOpaqueBlock(static_cast<BlockId>(Id)) ? 1 : 0;
+        FaceGroup[Id] = Fluid != FLUID_NONE ? GetFluidBlock(Fluid, FluidSourceLevel) : static_cast<BlockId>(Id);
+    }
+
+    // Padded index step along each axis
+    const Int32 AxisStrides[3] = {
+        static_cast<Int32>(GetPaddedIndex(1, 0, 0) - GetPaddedIndex(0, 0, 0)),
+        static_cast<Int32>(GetPaddedIndex(0, 1, 0) - GetPaddedIndex(0, 0, 0)),
+        static_cast<Int32>(GetPaddedIndex(0, 0, 1) - GetPaddedIndex(0, 0, 0)),
+    };
+
+    for (Uint32 Face = 0; Face < BLOCK_FACE_COUNT; ++Face)
+    {
+        const FaceAxes& Axes = FaceAxesTable[Face];
+
+        const Int32 NeighbourOffset = AxisStrides[Axes.Axis] * Axes.Sign;
+
+        // Offsets from the block in front of the face to the side blocks of each corner,
+        // in the same order as the quad corners below
+        const Int32 StrideU = AxisStrides[Axes.U];
+        const Int32 StrideV = AxisStrides[Axes.V];
+        const Int32 CornerSides[4][2] = {
+            {-StrideU, -StrideV},
+            {+StrideU, -StrideV},
+            {+StrideU, +StrideV},
+            {-StrideU, +StrideV},
+        };
+
+        for (Int32 d = 0; d < S; ++d)
+        {
+            // Build the mask of visible faces in this slice
+            Int32 Pos[3];
+            Pos[Axes.Axis] = d;
+            for (Int32 v = 0; v < S; ++v)
+            {
+                Pos[Axes.V] = v;
+                for (Int32 u = 0; u < S; ++u)
+                {
+                    Pos[Axes.U] = u;
+
+                    const Int32   Idx       = static_cast<Int32>(GetPaddedIndex(Pos[0], Pos[1], Pos[2]));
+                    const Int32   FrontIdx  = Idx + NeighbourOffset;
+                    const BlockId Block     = pPadded[Idx];
+                    const BlockId Neighbour = pPadded[FrontIdx];
+
+                    const bool Visible = Block != BLOCK_AIR &&
+                        !(Neighbour < BLOCK_ID_COUNT && (IsOpaque[Neighbour] || FaceGroup[Neighbour] == FaceGroup[Block]));
+                    if (!Visible)
+                    {
+                        m_Mask[v * S + u] = 0;
+                        continue;
+                    }
+
+                    // Faces may only merge when they use the same texture and lighting
+                    Uint64 Key = Uint64{Block} + 1u;
+                    if (pPaddedLight != nullptr)
+                    {
+                        const Uint32 FrontLight = WideLight.Values[pPaddedLight[FrontIdx]];
+                        for (Uint32 c = 0; c < 4; ++c)
+                        {
+                            const Int32 Side1  = FrontIdx + CornerSides[c][0];
+                            const Int32 Side2  = FrontIdx + CornerSides[c][1];
+                            const Int32 Corner = Side1 + CornerSides[c][1];
+
+                            const Uint32 Opaque1      = IsOpaque[pPadded[Side1]];
+                            const Uint32 Opaque2      = IsOpaque[pPadded[Side2]];
+                            const Uint32 OpaqueCorner = IsOpaque[pPadded[Corner]];
+
+                            // Opaque blocks do not contribute light, and neither does the
+                            // diagonal when both sides hide it
+                            const Uint32 Lit1      = Opaque1 ^ 1u;
+                            const Uint32 Lit2      = Opaque2 ^ 1u;
+                            const Uint32 LitCorner = (OpaqueCorner ^ 1u) & (Lit1 | Lit2);
+
+                            const Uint32 Sum = FrontLight +
+                                Lit1 * WideLight.Values[pPaddedLight[Side1]] +
+                                Lit2 * WideLight.Values[pPaddedLight[Side2]] +
+                                LitCorner * WideLight.Values[pPaddedLight[Corner]];
+                            const Uint32 Count = 1u + Lit1 + Lit2 + LitCorner;
+
+                            const Uint32 Lighting = PackVertexLighting(std::max(LightAverages.Values[Count][Sum >> 8u],
+                                                                                LightAverages.Values[Count][Sum & 0xFFu]),
+                                                                       CornerAOTable[Opaque1 | (Opaque2 << 1u) | (OpaqueCorner << 2u)]);
+                            Key |= Uint64{Lighting} << (16u + c * 6u);
+                        }
+                    }
+                    else
+                    {
+                        for (Uint32 c = 0; c < 4; ++c)
+                            Key |= Uint64{FullVertexLighting} << (16u + c * 6u);
+                    }
+                    m_Mask[v * S + u] = Key;
+                }
+            }
+
+            // Grow rectangles along u first, then along v while whole rows match
+            for (Int32 v = 0; v < S; ++v)
+            {
+                for (Int32 u = 0; u < S;)
+                {
+                    const Uint64 Key = m_Mask[v * S + u];
+                    if (Key == 0)
+                    {
+                        ++u;
+                        continue;
+                    }
+
+                    Uint32 Lighting[4];
+                    for (Uint32 c = 0; c < 4; ++c)
+                        Lighting[c] = static_cast<Uint32>(Key >> (16u + c * 6u)) & 63u;
+
+                    // Corner values are interpolated across the quad, so faces can only be
+                    // merged along an axis their lighting does not change along
+                    const bool CanGrowU = Lighting[0] == Lighting[1] && Lighting[3] == Lighting[2];
+                    const bool CanGrowV = Lighting[0] == Lighting[3] && Lighting[1] == Lighting[2];
+
+                    Int32 w = 1;
+                    Int32 h = 1;
+                    if (Greedy && CanGrowU)
+                    {
+                        while (u + w < S && m_Mask[v * S + u + w] == Key)
+                            ++w;
+                    }
+                    if (Greedy && CanGrowV)
+                    {
+                        for (; v + h < S; ++h)
+                        {
+                            const Uint64* pRow = &m_Mask[(v + h) * S + u];
+                            if (!std::all_of(pRow, pRow + w, [Key](Uint64 k) { return k == Key; }))
+                                break;
+                        }
+                    }
+
+                    for (Int32 dv = 0; dv < h; ++dv)
+                        std::fill_n(&m_Mask[(v + dv) * S + u], w, Uint64{0});
+
+                    const Uint32 Layer = GetBlockTextureLayer(static_cast<BlockId>((Key & 0xFFFFu) - 1u), Face);
+
+                    // The shared index buffer splits quads along the 0-2 diagonal. The vertex
+                    // shader can start from corner 1 instead to split along 1-3, which is used
+                    // when that diagonal joins the brighter corners so occlusion does not bleed
+                    // across the quad.
+                    auto GetBrightness = [](Uint32 L) { return (L >> 4u) * 64u + (L & 15u); };
+                    const bool SplitAlong13 =
+                        GetBrightness(Lighting[0]) + GetBrightness(Lighting[2]) < GetBrightness(Lighting[1]) + GetBrightness(Lighting[3]);
+
+                    Pos[Axes.U] = u;
+                    Pos[Axes.V] = v;
+                    Mesh.Vertices.push_back(PackChunkVertex(static_cast<Uint32>(Pos[0]), static_cast<Uint32>(Pos[1]), static_cast<Uint32>(Pos[2]), Face,
+                                                            static_cast<Uint32>(w), static_cast<Uint32>(h), Layer, Lighting, SplitAlong13));
+
+                    u += w;
+                }
+            }
+        }
+    }
+}
+
+SectionConnectivity ChunkMesher::ComputeConnectivity(const BlockId* pPadded)
+{
+    constexpr Uint32 Size = ChunkSection::Size;
+
+    // Opaque blocks are marked visited up front so the flood fill never enters them
+    Uint32 NumOpaque = 0;
+    for (Uint32 i = 0; i < ChunkSection::Volume; ++i)
+    {
+        const bool IsOpaque = IsOpaqueBlock(pPadded[GetPaddedIndex(i & 15u, i >> 8u, (i >> 4u) & 15u)]);
+        m_Visited[i]        = IsOpaque;
+        NumOpaque += IsOpaque ? 1 : 0;
+    }
+
+    // Separating two faces takes at least a full 16x16 wall
+    if (NumOpaque < Size * Size)
+        return SectionConnectivity::AllConnected();
+
+    SectionConnectivity Connectivity;
+    if (NumOpaque == ChunkSection::Volume)
+        return Connectivity;
+
+    for (Uint32 Start = 0; Start < ChunkSection::Volume; ++Start)
+    {
+        if (m_Visited[Start])
+            continue;
+
+        Uint32 FaceMask = 0;
+        Uint32 Head     = 0;
+        Uint32 Tail     = 0;
+
+        m_Visited[Start]    = true;
+        m_FillQueue[Tail++] = static_cast<Uint16>(Start);
+        while (Head < Tail)
+        {
+            const Uint32 Index = m_FillQueue[Head++];
+            const Uint32 x     = Index & 15u;
+            const Uint32 z     = (Index >> 4u) & 15u;
+            const Uint32 y     = Index >> 8u;
+
+            // clang-format off
+            FaceMask |= (x == 0        ? 1u << BLOCK_FACE_NEG_X : 0u) | (x == Size - 1 ? 1u << BLOCK_FACE_POS_X : 0u) |
+                        (y == 0        ? 1u << BLOCK_FACE_NEG_Y : 0u) | (y == Size - 1 ? 1u << BLOCK_FACE_POS_Y : 0u) |
+                        (z == 0        ? 1u << BLOCK_FACE_NEG_Z : 0u) | (z == Size - 1 ? 1u << BLOCK_FACE_POS_Z : 0u);
+            // clang-format on
+
+            auto Visit = [&](Uint32 Neighbour) {
+                if (!m_Visited[Neighbour])
+                {
+                    m_Visited[Neighbour] = true;
+                    m_FillQueue[Tail++]  = static_cast<Uint16>(Neighbour);
+                }
+            };
+            // clang-format off
+            if (x > 0)        Visit(Index - 1);
+            if (x < Size - 1) Visit(Index + 1);
+            if (z > 0)        Visit(Index - Size);
+            if (z < Size - 1) Visit(Index + Size);
+            if (y > 0)        Visit(Index - Size * Size);
+            if (y < Size - 1) Visit(Index + Size * Size);
+            // clang-format on
+        }
+
+        Connectivity.Connect(FaceMask);
+    }
+
+    return Connectivity;
+}
+
+} // namespace Diligent
@@ -0,0 +1,209 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <array>
+#include <vector>
+
+#include "World.hpp"
+
+namespace Diligent
+{
+
+// Packed chunk vertex, 8 bytes, one per quad. The vertex shader pulls it from a structured
+// buffer and expands it into the quad's four corners. Must match the unpacking in cube.vsh.
+//
+//  Word 0:  [0..3] x  [4..7] y  [8..11] z  [12..14] face  [15..24] texture layer  [25] split along 1-3
+//  Word 1:  [0..5] corner 0 lighting  ...  [18..23] corner 3 lighting  [24..27] width - 1  [28..31] height - 1
+//
+// x, y, z is the section-local block of the quad's first face; the quad covers width
+// blocks along the face's U axis and height blocks along its V axis, with corners
+// (0,0) (w,0) (w,h) (0,h) in that order. UVs are in blocks and follow the block grid.
+// The quad is split into triangles along the 0-2 diagonal unless bit 25 is set.
+//
+// Corner lighting is [0..3] light, the brighter of sky and block light smoothed over the
+// four blocks around the corner, and [4..5] ambient occlusion from 0 (corner of three
+// opaque blocks) to 3 (unoccluded).
+struct ChunkVertex
+{
+    Uint32 PosFaceLayer = 0;
+    Uint32 LightingSize = 0;
+};
+static_assert(sizeof(ChunkVertex) == 8, "Chunk vertex must be 8 bytes");
+
+// Light and ambient occlusion of a quad corner, as stored in word 1
+inline Uint32 PackVertexLighting(Uint32 Light, Uint32 AO)
+{
+    VERIFY_EXPR(Light < 16 && AO < 4);
+    return Light | (AO << 4u);
+}
+
+// Fully lit and unoccluded
+constexpr Uint32 FullVertexLighting = 15u | (3u << 4u);
+
+inline ChunkVertex PackChunkVertex(Uint32 x, Uint32 y, Uint32 z, Uint32 Face, Uint32 Width, Uint32 Height, Uint32 Layer, const Uint32 (&Lighting)[4], bool SplitAlong13)
+{
+    VERIFY_EXPR(x < 16 && y < 16 && z < 16 && Face < BLOCK_FACE_COUNT && Width >= 1 && Width <= 16 && Height >= 1 && Height <= 16 && Layer < 1024);
+    ChunkVertex Vert;
+    Vert.PosFaceLayer = x | (y << 4u) | (z << 8u) | (Face << 12u) | (Layer << 15u) | (SplitAlong13 ? 1u << 25u : 0u);
+    Vert.LightingSize = ((Width - 1u) << 24u) | ((Height - 1u) << 28u);
+    for (Uint32 c = 0; c < 4; ++c)
+    {
+        VERIFY_EXPR(Lighting[c] < 64);
+        Vert.LightingSize |= Lighting[c] << (c * 6u);
+    }
+    return Vert;
+}
+
+// Which faces of a section are connected to each other through non-opaque blocks.
+// A line of sight can only pass through a section between two connected faces.
+struct SectionConnectivity
+{
+    // Bit b of Faces[a] is set when faces a and b are connected
+    Uint8 Faces[BLOCK_FACE_COUNT] = {};
+
+    bool IsConnected(Uint32 FaceA, Uint32 FaceB) const { return (Faces[FaceA] >> FaceB) & 1u; }
+
+    // Connects every pair of faces in the mask
+    void Connect(Uint32 FaceMask)
+    {
+        for (Uint32 f = 0; f < BLOCK_FACE_COUNT; ++f)
+        {
+            if (FaceMask & (1u << f))
+                Faces[f] |= static_cast<Uint8>(FaceMask);
+        }
+    }
+
+    static SectionConnectivity AllConnected()
+    {
+        SectionConnectivity Conn;
+        Conn.Connect((1u << BLOCK_FACE_COUNT) - 1u);
+        return Conn;
+    }
+};
+
+// One vertex per quad. Every quad is drawn with the same index pattern, so all sections
+// share one index buffer.
+struct ChunkMesh
+{
+    std::vector<ChunkVertex> Vertices;
+
+    SectionConnectivity Connectivity;
+
+    Uint32 GetQuadCount() const { return static_cast<Uint32>(Vertices.size()); }
+};
+
+class ChunkMesher
+{
+public:
+    static constexpr Uint32 PaddedSize   = ChunkSection::Size + 2;
+    static constexpr Uint32 PaddedVolume = PaddedSize * PaddedSize * PaddedSize;
+
+    // Worst case is every face of every block: only opaque neighbours and neighbours of
+    // the same face group hide a face, so e.g. alternating glass and leaves show them all
+    static constexpr Uint32 MaxQuadsPerSection = ChunkSection::Volume * 6;
+
+    // Section-local coordinates in [-1, 16]
+    static Uint32 GetPaddedIndex(Int32 x, Int32 y, Int32 z)
+    {
+        return static_cast<Uint32>(((y + 1) * PaddedSize + (z + 1)) * PaddedSize + (x + 1));
+    }
+
+    // Neighbourhood of a section, indexed by (dy + 1) * 9 + (dz + 1) * 3 + (dx + 1).
+    // Null entries (unloaded or above the world) are treated as air, below the world as bedrock.
+    using Neighbourhood = std::array<const ChunkSection*, 27>;
+
+    static Neighbourhood GetNeighbourhood(const World& Wrld, const int3& SectionPos);
+
+    // Calls Handler(SectionPos) for every section whose mesh depends on a block: its own
+    // section and, for blocks on a section edge, the sections next to it, including the
+    // diagonal ones that smooth lighting samples
+    template <typename HandlerType>
+    static void ForEachSectionSampling(const int3& BlockPos, HandlerType&& Handler)
+    {
+        const int3 Section{World::BlockToChunk(BlockPos.x), BlockPos.y >> 4, World::BlockToChunk(BlockPos.z)};
+        const int3 Local{World::BlockToLocal(BlockPos.x), BlockPos.y & 15, World::BlockToLocal(BlockPos.z)};
+        const int3 Min{Local.x == 0 ? -1 : 0, Local.y == 0 && Section.y > 0 ? -1 : 0, Local.z == 0 ? -1 : 0};
+        const int3 Max{Local.x == 15 ? 1 : 0, Local.y == 15 && Section.y + 1 < Chunk::NumSections ? 1 : 0, Local.z == 15 ? 1 : 0};
+        for (Int32 dy = Min.y; dy <= Max.y; ++dy)
+        {
+            for (Int32 dz = Min.z; dz <= Max.z; ++dz)
+            {
+                for (Int32 dx = Min.x; dx <= Max.x; ++dx)
+                    Handler(Section + int3{dx, dy, dz});
+            }
+        }
+    }
+
+    // Copies the section and a one block border around it into pPadded (PaddedVolume entries)
+    static void GatherBlocks(const Neighbourhood& Sections, BlockId* pPadded);
+
+    // Same as GatherBlocks() for light, packed as sky << 4 | block. Null sections are
+    // open sky.
+    static void GatherLight(const Neighbourhood& Sections, Uint8* pPaddedLight);
+
+    // Blocks and light of the one block border around a section, i.e. everything in the
+    // padded arrays that comes from its neighbours
+    struct SectionBorder
+    {
+        static constexpr Uint32 Volume = PaddedVolume - ChunkSection::Volume;
+
+        std::array<BlockId, Volume> Blocks;
+        std::array<Uint8, Volume>   Light;
+    };
+
+    static void GatherBorder(const Neighbourhood& Sections, SectionBorder& Border);
+
+    // Same as GatherBlocks() and GatherLight() with the border taken from Border. A null
+    // section is air lit as open sky.
+    static void GatherWithBorder(const ChunkSection* pSection, const SectionBorder& Border, BlockId* pPadded, Uint8* pPaddedLight);
+
+    // Emits one quad per visible face, merging coplanar faces with the same texture into
+    // rectangles along the axes their lighting does not change along when Greedy is true.
+    // Faces hidden by opaque neighbours, or by neighbours of the same non-opaque block,
+    // are culled.
+    //
+    // With pPaddedLight (see GatherLight()), every corner gets smooth light and ambient
+    // occlusion from the blocks in front of the face, and quads are split along the
+    // diagonal that keeps occlusion symmetric. Without it, faces are fully lit.
+    void Mesh(const BlockId* pPadded, const Uint8* pPaddedLight, ChunkMesh& Mesh, bool Greedy = true);
+
+    // Flood fills the non-opaque blocks of the section and connects the faces each region touches
+    SectionConnectivity ComputeConnectivity(const BlockId* pPadded);
+
+private:
+    // Face key of each cell in the current slice: block id + 1 in the low 16 bits and
+    // the 6-bit lighting of the four corners above; 0 means no visible face
+    std::array<Uint64, ChunkSection::Size * ChunkSection::Size> m_Mask;
+
+    // Flood fill state, indexed like ChunkSection
+    std::array<bool, ChunkSection::Volume>   m_Visited;
+    std::array<Uint16, ChunkSection::Volume> m_FillQueue;
+};
+
+} // namespace Diligent
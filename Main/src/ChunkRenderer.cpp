@@ -0,0 +1,381 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+#include "ChunkRenderer.hpp"
+
+#include <algorithm>
+
+#include "Common/interface/Timer.hpp"
+#include "World.hpp"
+
+namespace Diligent
+{
+
+namespace
+{
+
+// Initial pool sizes, both grow on demand
+constexpr Uint32 InitialQuadCount      = 1u << 18;
+constexpr Uint32 InitialInstanceCount  = 4096;
+constexpr Uint32 MinIndirectDrawCount  = 1024;
+constexpr Uint32 IndirectArgsAlignment = 4;
+
+} // namespace
+
+ChunkRenderer::ChunkRenderer(IRenderDevice* pDevice, IDeviceContext* pContext) :
+    m_pDevice{pDevice},
+    m_pContext{pContext}
+{
+    const auto& DrawCaps = pDevice->GetAdapterInfo().DrawCommand;
+    m_UseIndirectDraw    = (DrawCaps.CapFlags & DRAW_COMMAND_CAP_FLAG_DRAW_INDIRECT) != 0 &&
+        (DrawCaps.CapFlags & DRAW_COMMAND_CAP_FLAG_DRAW_INDIRECT_FIRST_INSTANCE) != 0;
+    m_MaxDrawIndirectCount = std::max(DrawCaps.MaxDrawIndirectCount, 1u);
+    if ((DrawCaps.CapFlags & DRAW_COMMAND_CAP_FLAG_NATIVE_MULTI_DRAW_INDIRECT) == 0)
+        LOG_INFO_MESSAGE("Multi-draw indirect is emulated by the device, chunk draws will be split on the CPU");
+
+    {
+        // One vertex per quad, read by the vertex shader rather than the input assembler
+        VertexPoolElementDesc VtxElem{sizeof(ChunkVertex), BIND_SHADER_RESOURCE, USAGE_DEFAULT, BUFFER_MODE_STRUCTURED};
+
+        VertexPoolCreateInfo PoolCI;
+        PoolCI.Desc.Name        = "Chunk quad pool";
+        PoolCI.Desc.pElements   = &VtxElem;
+        PoolCI.Desc.NumElements = 1;
+        PoolCI.Desc.VertexCount = InitialQuadCount;
+        // Thousands of sections come and go while moving, validating the whole
+        // pool on every allocation makes debug builds unusable
+        PoolCI.DisableDebugValidation = true;
+        CreateVertexPool(pDevice, PoolCI, &m_pVertexPool);
+        VERIFY_EXPR(m_pVertexPool);
+    }
+
+    {
+        BufferSuballocatorCreateInfo AllocatorCI;
+        AllocatorCI.Desc.Name      = "Chunk section instance buffer";
+        AllocatorCI.Desc.Usage     = USAGE_DEFAULT;
+        AllocatorCI.Desc.BindFlags = BIND_VERTEX_BUFFER;
+        AllocatorCI.Desc.Size      = InitialInstanceCount * sizeof(SectionInstance);
+
+        AllocatorCI.DisableDebugValidation = true;
+        CreateBufferSuballocator(pDevice, AllocatorCI, &m_pInstanceAllocator);
+        VERIFY_EXPR(m_pInstanceAllocator);
+    }
+
+    CreateQuadIndexBuffer();
+}
+
+void ChunkRenderer::CreateQuadIndexBuffer()
+{
+    // Every quad uses the same two triangles, (0,1,2) and (0,2,3), so one buffer large
+    // enough for the densest section serves all of them. The indices are vertex ids that
+    // the vertex shader turns into a quad and a corner. A dense section has more than
+    // 65536 of them, so indices are 32-bit.
+    std::vector<Uint32> Indices(ChunkMesher::MaxQuadsPerSection * 6);
+    for (Uint32 q = 0; q < ChunkMesher::MaxQuadsPerSection; ++q)
+    {
+        const Uint32 Base = q * 4;
+        // clang-format off
+        Uint32* pQuad = &Indices[q * 6];
+        pQuad[0] = Base;  pQuad[1] = Base + 1;  pQuad[2] = Base + 2;
+        pQuad[3] = Base;  pQuad[4] = Base + 2;  pQuad[5] = Base + 3;
+        // clang-format on
+    }
+
+    BufferDesc IndBuffDesc;
+    IndBuffDesc.Name      = "Quad index buffer";
+    IndBuffDesc.Usage     = USAGE_IMMUTABLE;
+    IndBuffDesc.BindFlags = BIND_INDEX_BUFFER;
+    IndBuffDesc.Size      = Indices.size() * sizeof(Indices[0]);
+    BufferData IBData;
+    IBData.pData    = Indices.data();
+    IBData.DataSize = IndBuffDesc.Size;
+    m_pDevice->CreateBuffer(IndBuffDesc, &IBData, &m_pQuadIndexBuffer);
+}
+
+void ChunkRenderer::SetSectionMesh(const int3& SectionPos, const ChunkMesh& Mesh)
+{
+    if (Mesh.Vertices.empty())
+    {
+        RemoveSection(SectionPos);
+        return;
+    }
+
+    const Uint64 Key = World::PackSectionKey(SectionPos);
+    auto         It  = m_SectionIndices.find(Key);
+    if (It == m_SectionIndices.end())
+    {
+        const float3 Min{static_cast<float>(SectionPos.x * 16), static_cast<float>(SectionPos.y * 16), static_cast<float>(SectionPos.z * 16)};
+        It = m_SectionIndices.emplace(Key, m_Culler.Add(BoundBox{Min, Min + float3{16, 16, 16}})).first;
+        auto& NewSection      = m_Sections.emplace_back();
+        NewSection.Key        = Key;
+        NewSection.SectionPos = SectionPos;
+    }
+    auto& Section = m_Sections[It->second];
+
+    // Old quads are released back to the pool when the allocation is replaced
+    Section.pVertices.Release();
+    m_pVertexPool->Allocate(static_cast<Uint32>(Mesh.Vertices.size()), &Section.pVertices);
+    VERIFY_EXPR(Section.pVertices);
+    Section.NumQuads = Mesh.GetQuadCount();
+    VERIFY(Section.NumQuads <= ChunkMesher::MaxQuadsPerSection, "The quad index buffer is too small for this section");
+
+    // Getting the buffer may grow the pool, so it has to happen after allocating
+    IBuffer* pQuadBuffer = m_pVertexPool->GetBuffer(0, m_pDevice, m_pContext);
+    m_pContext->UpdateBuffer(pQuadBuffer, Uint64{Section.pVertices->GetStartVertex()} * sizeof(ChunkVertex),
+                             Mesh.Vertices.size() * sizeof(ChunkVertex), Mesh.Vertices.data(),
+                             RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+
+    if (!Section.pInstance)
+    {
+        m_pInstanceAllocator->Allocate(sizeof(SectionInstance), sizeof(SectionInstance), &Section.pInstance);
+        VERIFY_EXPR(Section.pInstance);
+    }
+
+    // The first quad moves with every new allocation
+    SectionInstance Instance;
+    Instance.Origin    = float3{static_cast<float>(SectionPos.x * 16), static_cast<float>(SectionPos.y * 16), static_cast<float>(SectionPos.z * 16)};
+    Instance.FirstQuad = Section.pVertices->GetStartVertex();
+
+    IBuffer* pInstanceBuffer = m_pInstanceAllocator->GetBuffer(m_pDevice, m_pContext);
+    m_pContext->UpdateBuffer(pInstanceBuffer, Section.pInstance->GetOffset(), sizeof(Instance), &Instance,
+                             RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+}
+
+void ChunkRenderer::RemoveSection(const int3& SectionPos)
+{
+    auto It = m_SectionIndices.find(World::PackSectionKey(SectionPos));
+    if (It == m_SectionIndices.end())
+        return;
+
+    const Uint32 Index = It->second;
+    m_SectionIndices.erase(It);
+
+    const Uint32 Moved = m_Culler.Remove(Index);
+    if (Moved != Index)
+    {
+        m_Sections[Index]                       = std::move(m_Sections[Moved]);
+        m_SectionIndices[m_Sections[Index].Key] = Index;
+    }
+    m_Sections.pop_back();
+}
+
+Uint64 ChunkRenderer::GetVertexMemoryUsage() const
+{
+    VertexPoolUsageStats Stats;
+    m_pVertexPool->GetUsageStats(Stats);
+    return Stats.CommittedMemorySize;
+}
+
+void ChunkRenderer::PrepareIndirectArgsBuffer(Uint32 NumDraws)
+{
+    const Uint64 RequiredSize = Uint64{NumDraws} * sizeof(DrawIndexedIndirectArgs);
+    if (m_pIndirectArgsBuffer && m_pIndirectArgsBuffer->GetDesc().Size >= RequiredSize)
+        return;
+
+    BufferDesc ArgsBuffDesc;
+    ArgsBuffDesc.Name      = "Chunk indirect draw args";
+    ArgsBuffDesc.Usage     = USAGE_DEFAULT;
+    ArgsBuffDesc.BindFlags = BIND_INDIRECT_DRAW_ARGS;
+    // Grow geometrically so that streaming in new sections does not recreate the buffer every frame
+    ArgsBuffDesc.Size = std::max(RequiredSize * 2, Uint64{MinIndirectDrawCount} * sizeof(DrawIndexedIndirectArgs));
+
+    m_pIndirectArgsBuffer.Release();
+    m_pDevice->CreateBuffer(ArgsBuffDesc, nullptr, &m_pIndirectArgsBuffer);
+}
+
+void ChunkRenderer::Draw(const ViewFrustum& Frustum, const VisibilityGraph* pVisibility)
+{
+    Timer Tmr;
+
+    m_Stats             = {};
+    m_Stats.NumSections = static_cast<Uint32>(m_Sections.size());
+
+    m_VisibleSections.resize(m_Sections.size());
+    m_Stats.NumInFrustum = m_Culler.Cull(Frustum, m_VisibleSections.data());
+    m_Stats.NumVisible   = m_Stats.NumInFrustum;
+    if (pVisibility != nullptr)
+    {
+        m_Stats.NumVisible = 0;
+        for (Uint32 v = 0; v < m_Stats.NumInFrustum; ++v)
+        {
+            const Uint32 Index = m_VisibleSections[v];
+
+            m_VisibleSections[m_Stats.NumVisible] = Index;
+            m_Stats.NumVisible += pVisibility->IsVisible(m_Sections[Index].SectionPos) ? 1 : 0;
+        }
+    }
+    m_Stats.CullTime = Tmr.GetElapsedTime();
+    if (m_Stats.NumVisible == 0)
+        return;
+
+    IBuffer* pInstanceBuffer = m_pInstanceAllocator->GetBuffer(m_pDevice, m_pContext);
+    m_pContext->SetIndexBuffer(m_pQuadIndexBuffer, 0, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+
+    if (m_UseIndirectDraw)
+        DrawIndirect(pInstanceBuffer);
+    else
+        DrawDirect(pInstanceBuffer);
+
+    m_Stats.SubmitTime = Tmr.GetElapsedTime();
+}
+
+IBufferView* ChunkRenderer::GetQuadBufferSRV()
+{
+    return m_pVertexPool->GetBuffer(0, m_pDevice, m_pContext)->GetDefaultView(BUFFER_VIEW_SHADER_RESOURCE);
+}
+
+void ChunkRenderer::SetLooseBlocks(const std::vector<LooseBlock>& Blocks)
+{
+    m_NumLooseBlocks = static_cast<Uint32>(Blocks.size());
+    if (Blocks.empty())
+        return;
+
+    m_LooseQuadData.clear();
+    m_LooseInstanceData.clear();
+    for (const LooseBlock& Block : Blocks)
+    {
+        SectionInstance& Instance = m_LooseInstanceData.emplace_back();
+        Instance.Origin           = Block.Pos;
+        Instance.FirstQuad        = static_cast<Uint32>(m_LooseQuadData.size());
+
+        const Uint32 VertexLighting = PackVertexLighting(Block.Light, 3);
+        const Uint32 Lighting[4]    = {VertexLighting, VertexLighting, VertexLighting, VertexLighting};
+        for (Uint32 Face = 0; Face < BLOCK_FACE_COUNT; ++Face)
+            m_LooseQuadData.push_back(PackChunkVertex(0, 0, 0, Face, 1, 1, GetBlockTextureLayer(Block.Block, Face), Lighting, false));
+    }
+
+    // Grow geometrically, the number of falling blocks changes every tick
+    auto PrepareBuffer = [this](RefCntAutoPtr<IBuffer>& pBuffer, const BufferDesc& Desc, Uint64 RequiredSize) {
+        if (pBuffer && pBuffer->GetDesc().Size >= RequiredSize)
+            return;
+        BufferDesc NewDesc = Desc;
+        NewDesc.Size       = RequiredSize * 2;
+        pBuffer.Release();
+        m_pDevice->CreateBuffer(NewDesc, nullptr, &pBuffer);
+        VERIFY_EXPR(pBuffer);
+    };
+
+    BufferDesc QuadsDesc;
+    QuadsDesc.Name              = "Loose block quads";
+    QuadsDesc.Usage             = USAGE_DEFAULT;
+    QuadsDesc.BindFlags         = BIND_SHADER_RESOURCE;
+    QuadsDesc.Mode              = BUFFER_MODE_STRUCTURED;
+    QuadsDesc.ElementByteStride = sizeof(ChunkVertex);
+    PrepareBuffer(m_pLooseQuads, QuadsDesc, m_LooseQuadData.size() * sizeof(ChunkVertex));
+
+    BufferDesc InstancesDesc;
+    InstancesDesc.Name      = "Loose block instances";
+    InstancesDesc.Usage     = USAGE_DEFAULT;
+    InstancesDesc.BindFlags = BIND_VERTEX_BUFFER;
+    PrepareBuffer(m_pLooseInstances, InstancesDesc, m_LooseInstanceData.size() * sizeof(SectionInstance));
+
+    m_pContext->UpdateBuffer(m_pLooseQuads, 0, m_LooseQuadData.size() * sizeof(ChunkVertex), m_LooseQuadData.data(),
+                             RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+    m_pContext->UpdateBuffer(m_pLooseInstances, 0, m_LooseInstanceData.size() * sizeof(SectionInstance), m_LooseInstanceData.data(),
+                             RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+}
+
+IBufferView* ChunkRenderer::GetLooseBlockQuadSRV() const
+{
+    return m_pLooseQuads ? m_pLooseQuads->GetDefaultView(BUFFER_VIEW_SHADER_RESOURCE) : nullptr;
+}
+
+void ChunkRenderer::DrawLooseBlocks()
+{
+    if (m_NumLooseBlocks == 0)
+        return;
+
+    IBuffer*     pInstanceBuffer = m_pLooseInstances;
+    const Uint64 Offset          = 0;
+    m_pContext->SetVertexBuffers(0, 1, &pInstanceBuffer, &Offset, RESOURCE_STATE_TRANSITION_MODE_TRANSITION, SET_VERTEX_BUFFERS_FLAG_RESET);
+    m_pContext->SetIndexBuffer(m_pQuadIndexBuffer, 0, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+
+    // Each instance pulls its own six quads, starting from its first quad
+    DrawIndexedAttribs DrawAttrs;
+    DrawAttrs.IndexType    = VT_UINT32;
+    DrawAttrs.NumIndices   = BLOCK_FACE_COUNT * 6;
+    DrawAttrs.NumInstances = m_NumLooseBlocks;
+    DrawAttrs.Flags        = DRAW_FLAG_VERIFY_ALL;
+    m_pContext->DrawIndexed(DrawAttrs);
+}
+
+void ChunkRenderer::DrawIndirect(IBuffer* pInstanceBuffer)
+{
+    m_IndirectArgs.clear();
+    for (Uint32 v = 0; v < m_Stats.NumVisible; ++v)
+    {
+        const auto& Section = m_Sections[m_VisibleSections[v]];
+
+        DrawIndexedIndirectArgs Args;
+        Args.NumIndices            = Section.NumQuads * 6;
+        Args.NumInstances          = 1;
+        Args.FirstIndexLocation    = 0;
+        Args.BaseVertex            = 0;
+        Args.FirstInstanceLocation = Section.pInstance->GetOffset() / sizeof(SectionInstance);
+        m_IndirectArgs.push_back(Args);
+    }
+
+    const Uint32 NumDraws = static_cast<Uint32>(m_IndirectArgs.size());
+    PrepareIndirectArgsBuffer(NumDraws);
+    m_pContext->UpdateBuffer(m_pIndirectArgsBuffer, 0, NumDraws * sizeof(DrawIndexedIndirectArgs), m_IndirectArgs.data(),
+                             RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+
+    const Uint64 Offset = 0;
+    m_pContext->SetVertexBuffers(0, 1, &pInstanceBuffer, &Offset, RESOURCE_STATE_TRANSITION_MODE_TRANSITION, SET_VERTEX_BUFFERS_FLAG_RESET);
+
+    for (Uint32 FirstDraw = 0; FirstDraw < NumDraws; FirstDraw += m_MaxDrawIndirectCount)
+    {
+        DrawIndexedIndirectAttribs DrawAttrs{VT_UINT32, m_pIndirectArgsBuffer, DRAW_FLAG_VERIFY_ALL};
+        DrawAttrs.DrawCount                        = std::min(NumDraws - FirstDraw, m_MaxDrawIndirectCount);
+        DrawAttrs.DrawArgsOffset                   = Uint64{FirstDraw} * sizeof(DrawIndexedIndirectArgs);
+        DrawAttrs.DrawArgsStride                   = sizeof(DrawIndexedIndirectArgs);
+        DrawAttrs.AttribsBufferStateTransitionMode = RESOURCE_STATE_TRANSITION_MODE_TRANSITION;
+        m_pContext->DrawIndexedIndirect(DrawAttrs);
+        ++m_Stats.NumDrawCalls;
+    }
+}
+
+void ChunkRenderer::DrawDirect(IBuffer* pInstanceBuffer)
+{
+    // Without FirstInstanceLocation, the per-section data is selected by offsetting the
+    // instance buffer binding. It holds the section's first quad, so the quads need no offset.
+    for (Uint32 v = 0; v < m_Stats.NumVisible; ++v)
+    {
+        const auto& Section = m_Sections[m_VisibleSections[v]];
+
+        const Uint64 Offset = Section.pInstance->GetOffset();
+        m_pContext->SetVertexBuffers(0, 1, &pInstanceBuffer, &Offset, RESOURCE_STATE_TRANSITION_MODE_TRANSITION, SET_VERTEX_BUFFERS_FLAG_NONE);
+
+        DrawIndexedAttribs DrawAttrs;
+        DrawAttrs.IndexType  = VT_UINT32;
+        DrawAttrs.NumIndices = Section.NumQuads * 6;
+        DrawAttrs.Flags      = DRAW_FLAG_VERIFY_ALL;
+        m_pContext->DrawIndexed(DrawAttrs);
+        ++m_Stats.NumDrawCalls;
+    }
+}
+
+} // namespace Diligent
@@ -0,0 +1,176 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+
+#include "Graphics/GraphicsEngine/interface/RenderDevice.h"
+#include "Graphics/GraphicsEngine/interface/DeviceContext.h"
+#include "Graphics/GraphicsTools/interface/VertexPool.h"
+#include "Graphics/GraphicsTools/interface/BufferSuballocator.h"
+#include "Common/interface/RefCntAutoPtr.hpp"
+#include "ChunkMesher.hpp"
+#include "FrustumCuller.hpp"
+#include "VisibilityGraph.hpp"
+
+namespace Diligent
+{
+
+// Owns the GPU copies of all section meshes.
+//
+// Quad vertices of every section live in a single VertexPool structured buffer that the
+// vertex shader reads by quad index, and per-section origins and first quads in a single
+// BufferSuballocator-backed instance buffer. The whole terrain pass binds its buffers once
+// and is submitted with DrawIndexedIndirect: one command per section, with
+// FirstInstanceLocation selecting its instance data. Devices that cannot use
+// FirstInstanceLocation in indirect draws fall back to one DrawIndexed per section with
+// an offset instance buffer binding. Sections are kept in a
+// dense array alongside their bounds, which are frustum culled before building the draws.
+//
+// Loose blocks off the grid, such as falling sand, are drawn with the same pipeline: each
+// gets six full quads in a small buffer of its own and one instance whose origin is
+// anywhere, and all of them go in one instanced draw.
+class ChunkRenderer
+{
+public:
+    // Per-instance data, must match ATTRIB0 and ATTRIB1 in cube.vsh
+    struct SectionInstance
+    {
+        float3 Origin;
+        Uint32 FirstQuad = 0;
+    };
+    static_assert(sizeof(SectionInstance) == 16, "Section instance must be tightly packed");
+
+    struct LooseBlock
+    {
+        // Lowest corner
+        float3  Pos;
+        BlockId Block = BLOCK_AIR;
+        // Brighter of sky and block light, 0 to 15
+        Uint8 Light = 15;
+    };
+
+    struct DrawStats
+    {
+        Uint32 NumSections  = 0;
+        Uint32 NumInFrustum = 0;
+        Uint32 NumVisible   = 0;
+        Uint32 NumDrawCalls = 0;
+        // CPU time spent culling, in seconds
+        double CullTime = 0;
+        // CPU time spent building and submitting the draws, including culling, in seconds
+        double SubmitTime = 0;
+    };
+
+    ChunkRenderer(IRenderDevice* pDevice, IDeviceContext* pContext);
+
+    // clang-format off
+    ChunkRenderer           (const ChunkRenderer&)  = delete;
+    ChunkRenderer           (      ChunkRenderer&&) = delete;
+    ChunkRenderer& operator=(const ChunkRenderer&)  = delete;
+    ChunkRenderer& operator=(      ChunkRenderer&&) = delete;
+    // clang-format on
+
+    // Replaces the mesh of the section, an empty mesh removes it
+    void SetSectionMesh(const int3& SectionPos, const ChunkMesh& Mesh);
+    void RemoveSection(const int3& SectionPos);
+
+    // Draws sections inside the frustum that are also visible in pVisibility, if it is not null.
+    // The pipeline state and shader resources, including GetQuadBufferSRV() as g_Quads, must
+    // already be committed.
+    void Draw(const ViewFrustum& Frustum, const VisibilityGraph* pVisibility);
+
+    // The quad buffer is recreated when the pool grows, so this must be bound every frame
+    IBufferView* GetQuadBufferSRV();
+
+    // Replaces the loose blocks drawn by DrawLooseBlocks()
+    void SetLooseBlocks(const std::vector<LooseBlock>& Blocks);
+    // Same as Draw(), with GetLooseBlockQuadSRV() as g_Quads instead
+    void         DrawLooseBlocks();
+    IBufferView* GetLooseBlockQuadSRV() const;
+    Uint32       GetLooseBlockCount() const { return m_NumLooseBlocks; }
+
+    const DrawStats& GetStats() const { return m_Stats; }
+    size_t           GetSectionCount() const { return m_Sections.size(); }
+    bool             IsIndirectDrawEnabled() const { return m_UseIndirectDraw; }
+    Uint64           GetVertexMemoryUsage() const;
+
+private:
+    void CreateQuadIndexBuffer();
+    void PrepareIndirectArgsBuffer(Uint32 NumDraws);
+    void DrawIndirect(IBuffer* pInstanceBuffer);
+    void DrawDirect(IBuffer* pInstanceBuffer);
+
+    // Layout of one indirect draw command
+    struct DrawIndexedIndirectArgs
+    {
+        Uint32 NumIndices;
+        Uint32 NumInstances;
+        Uint32 FirstIndexLocation;
+        Uint32 BaseVertex;
+        Uint32 FirstInstanceLocation;
+    };
+    static_assert(sizeof(DrawIndexedIndirectArgs) == 20, "Indirect draw arguments must be tightly packed");
+
+    struct SectionAllocation
+    {
+        Uint64                               Key = 0;
+        int3                                 SectionPos;
+        RefCntAutoPtr<IVertexPoolAllocation> pVertices;
+        RefCntAutoPtr<IBufferSuballocation>  pInstance;
+        Uint32                               NumQuads = 0;
+    };
+
+    RefCntAutoPtr<IRenderDevice>  m_pDevice;
+    RefCntAutoPtr<IDeviceContext> m_pContext;
+
+    RefCntAutoPtr<IVertexPool>         m_pVertexPool;
+    RefCntAutoPtr<IBufferSuballocator> m_pInstanceAllocator;
+    RefCntAutoPtr<IBuffer>             m_pQuadIndexBuffer;
+    RefCntAutoPtr<IBuffer>             m_pIndirectArgsBuffer;
+
+    // Grown on demand, never shrunk
+    RefCntAutoPtr<IBuffer>       m_pLooseQuads;
+    RefCntAutoPtr<IBuffer>       m_pLooseInstances;
+    std::vector<ChunkVertex>     m_LooseQuadData;
+    std::vector<SectionInstance> m_LooseInstanceData;
+    Uint32                       m_NumLooseBlocks = 0;
+
+    // Sections and their bounds in m_Culler share indices
+    std::vector<SectionAllocation>       m_Sections;
+    std::unordered_map<Uint64, Uint32>   m_SectionIndices;
+    FrustumCuller                        m_Culler;
+    std::vector<Uint32>                  m_VisibleSections;
+    std::vector<DrawIndexedIndirectArgs> m_IndirectArgs;
+
+    bool      m_UseIndirectDraw      = false;
+    Uint32    m_MaxDrawIndirectCount = 0;
+    DrawStats m_Stats;
+};
+
+} // namespace Diligent
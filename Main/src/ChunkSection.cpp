@@ -0,0 +1,278 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include <algorithm>
+
+#include "ChunkSection.hpp"
+#include "Platforms/interface/PlatformMisc.hpp"
+
+namespace Diligent
+{
+
+void ChunkSection::SetBitsPerBlock(Uint32 BitsPerBlock)
+{
+    VERIFY_EXPR(BitsPerBlock == 1 || BitsPerBlock == 2 || BitsPerBlock == 4 || BitsPerBlock == 8 || BitsPerBlock == DirectBits);
+
+    const Uint32 IndicesPerWord = 64 / BitsPerBlock;
+
+    m_BitsPerBlock = static_cast<Uint8>(BitsPerBlock);
+    m_WordShift    = static_cast<Uint8>(PlatformMisc::GetLSB(IndicesPerWord));
+    m_WordMask     = static_cast<Uint8>(IndicesPerWord - 1);
+    m_ValueMask    = (1u << BitsPerBlock) - 1u;
+}
+
+void ChunkSection::Fill(BlockId Id)
+{
+    m_Data        = {};
+    m_Palette     = {};
+    m_PaletteRefs = {};
+
+    m_UniformBlock = Id;
+    m_NonAirCount  = static_cast<Uint16>(Id != BLOCK_AIR ? Volume : 0);
+    m_BitsPerBlock = 0;
+
+    m_RandomlyTickedCount = static_cast<Uint16>(IsRandomlyTickedBlock(Id) ? Volume : 0);
+}
+
+void ChunkSection::Repack(Uint32 NewBitsPerBlock)
+{
+    if (m_BitsPerBlock == 0)
+    {
+        VERIFY_EXPR(NewBitsPerBlock != DirectBits);
+        SetBitsPerBlock(NewBitsPerBlock);
+        // All indices point to the single palette entry
+        m_Data.assign(Volume / (64 / NewBitsPerBlock), 0);
+        m_Palette     = {m_UniformBlock};
+        m_PaletteRefs = {static_cast<Uint16>(Volume)};
+        return;
+    }
+
+    std::vector<Uint16> Values(Volume);
+    for (Uint32 i = 0; i < Volume; ++i)
+        Values[i] = static_cast<Uint16>(ReadIndex(i));
+
+    if (NewBitsPerBlock == DirectBits)
+    {
+        for (auto& Value : Values)
+            Value = m_Palette[Value];
+        m_Palette     = {};
+        m_PaletteRefs = {};
+    }
+
+    SetBitsPerBlock(NewBitsPerBlock);
+    m_Data.assign(Volume / (64 / NewBitsPerBlock), 0);
+    for (Uint32 i = 0; i < Volume; ++i)
+        WriteIndex(i, Values[i]);
+}
+
+Uint32 ChunkSection::FindOrAddPaletteEntry(BlockId Id)
+{
+    if (m_BitsPerBlock == DirectBits)
+        return Id;
+
+    const auto It = std::find(m_Palette.begin(), m_Palette.end(), Id);
+    if (It != m_Palette.end())
+        return static_cast<Uint32>(It - m_Palette.begin());
+
+    const auto FreeIt = std::find(m_PaletteRefs.begin(), m_PaletteRefs.end(), Uint16{0});
+    if (FreeIt != m_PaletteRefs.end())
+    {
+        const Uint32 FreeSlot = static_cast<Uint32>(FreeIt - m_PaletteRefs.begin());
+        m_Palette[FreeSlot]   = Id;
+        return FreeSlot;
+    }
+
+    const Uint32 PaletteSize = static_cast<Uint32>(m_Palette.size());
+    if (PaletteSize == (1u << m_BitsPerBlock))
+    {
+        if (m_BitsPerBlock == 8)
+        {
+            Repack(DirectBits);
+            return Id;
+        }
+        Repack(m_BitsPerBlock * 2u);
+    }
+
+    m_Palette.push_back(Id);
+    m_PaletteRefs.push_back(0);
+    return PaletteSize;
+}
+
+void ChunkSection::SetBlock(Uint32 Index, BlockId Id)
+{
+    VERIFY_EXPR(Index < Volume);
+
+    if (m_BitsPerBlock == 0)
+    {
+        if (Id == m_UniformBlock)
+            return;
+        Repack(1);
+    }
+
+    const Uint32  OldValue = ReadIndex(Index);
+    const BlockId OldId    = m_BitsPerBlock == DirectBits ? static_cast<BlockId>(OldValue) : m_Palette[OldValue];
+    if (OldId == Id)
+        return;
+
+    if (OldId == BLOCK_AIR)
+        ++m_NonAirCount;
+    else if (Id == BLOCK_AIR)
+        --m_NonAirCount;
+    m_RandomlyTickedCount = static_cast<Uint16>(m_RandomlyTickedCount - (IsRandomlyTickedBlock(OldId) ? 1 : 0) + (IsRandomlyTickedBlock(Id) ? 1 : 0));
+
+    const Uint32 NewValue = FindOrAddPaletteEntry(Id);
+    WriteIndex(Index, NewValue);
+
+    if (m_BitsPerBlock == DirectBits)
+        return;
+
+    // OldValue is still valid: palette growth keeps existing entries in place
+    --m_PaletteRefs[OldValue];
+    if (++m_PaletteRefs[NewValue] == Volume)
+    {
+        const Uint16 NonAirCount         = m_NonAirCount;
+        const Uint16 RandomlyTickedCount = m_RandomlyTickedCount;
+        Fill(Id);
+        VERIFY_EXPR(m_NonAirCount == NonAirCount && m_RandomlyTickedCount == RandomlyTickedCount);
+        (void)NonAirCount;
+        (void)RandomlyTickedCount;
+    }
+}
+
+void ChunkSection::Decode(BlockId* pDst) const
+{
+    if (m_BitsPerBlock == 0)
+    {
+        std::fill_n(pDst, Volume, m_UniformBlock);
+        return;
+    }
+
+    const Uint32 IndicesPerWord = m_WordMask + 1u;
+    const Uint32 Bits           = m_BitsPerBlock;
+    const Uint64 Mask           = m_ValueMask;
+    for (size_t w = 0; w < m_Data.size(); ++w)
+    {
+        Uint64 Word = m_Data[w];
+        if (Bits == DirectBits)
+        {
+            for (Uint32 i = 0; i < IndicesPerWord; ++i, Word >>= Bits)
+                *pDst++ = static_cast<BlockId>(Word & Mask);
+        }
+        else
+        {
+            for (Uint32 i = 0; i < IndicesPerWord; ++i, Word >>= Bits)
+                *pDst++ = m_Palette[Word & Mask];
+        }
+    }
+}
+
+void ChunkSection::Encode(const BlockId* pSrc)
+{
+    const BlockId First = pSrc[0];
+    if (std::all_of(pSrc, pSrc + Volume, [First](BlockId Id) { return Id == First; }))
+    {
+        Fill(First);
+        return;
+    }
+
+    // Build the palette up front so the indices are written only once
+    std::vector<BlockId> Palette;
+    std::vector<Uint16>  Refs;
+    Uint32               NonAirCount = 0;
+    bool                 Direct      = false;
+    for (Uint32 i = 0; i < Volume && !Direct; ++i)
+    {
+        const BlockId Id = pSrc[i];
+        NonAirCount += Id != BLOCK_AIR ? 1 : 0;
+
+        const auto It = std::find(Palette.begin(), Palette.end(), Id);
+        if (It != Palette.end())
+        {
+            ++Refs[It - Palette.begin()];
+        }
+        else if (Palette.size() < 256)
+        {
+            Palette.push_back(Id);
+            Refs.push_back(1);
+        }
+        else
+        {
+            Direct = true;
+        }
+    }
+
+    Fill(BLOCK_AIR);
+    if (Direct)
+    {
+        SetBitsPerBlock(DirectBits);
+        m_Data.assign(Volume / (64 / DirectBits), 0);
+        NonAirCount                = 0;
+        Uint32 RandomlyTickedCount = 0;
+        for (Uint32 i = 0; i < Volume; ++i)
+        {
+            WriteIndex(i, pSrc[i]);
+            NonAirCount += pSrc[i] != BLOCK_AIR ? 1 : 0;
+            RandomlyTickedCount += IsRandomlyTickedBlock(pSrc[i]) ? 1 : 0;
+        }
+        m_NonAirCount         = static_cast<Uint16>(NonAirCount);
+        m_RandomlyTickedCount = static_cast<Uint16>(RandomlyTickedCount);
+        return;
+    }
+
+    Uint32 Bits = 1;
+    while ((1u << Bits) < Palette.size())
+        Bits *= 2;
+
+    SetBitsPerBlock(Bits);
+    m_Data.assign(Volume / (64 / Bits), 0);
+    m_Palette     = std::move(Palette);
+    m_PaletteRefs = std::move(Refs);
+    m_NonAirCount = static_cast<Uint16>(NonAirCount);
+
+    Uint32 RandomlyTickedCount = 0;
+    for (size_t i = 0; i < m_Palette.size(); ++i)
+        RandomlyTickedCount += IsRandomlyTickedBlock(m_Palette[i]) ? m_PaletteRefs[i] : 0;
+    m_RandomlyTickedCount = static_cast<Uint16>(RandomlyTickedCount);
+
+    for (Uint32 i = 0; i < Volume; ++i)
+    {
+        const auto It = std::find(m_Palette.begin(), m_Palette.end(), pSrc[i]);
+        WriteIndex(i, static_cast<Uint32>(It - m_Palette.begin()));
+    }
+}
+
+size_t ChunkSection::GetMemoryUsage() const
+{
+    return sizeof(*this) +
+        m_Data.capacity() * sizeof(m_Data[0]) +
+        m_Palette.capacity() * sizeof(m_Palette[0]) +
+        m_PaletteRefs.capacity() * sizeof(m_PaletteRefs[0]) +
+        m_SkyLight.GetMemoryUsage() +
+        m_BlockLight.GetMemoryUsage();
+}
+
+} // namespace Diligent
@@ -0,0 +1,205 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "Common/interface/BasicMath.hpp"
+#include "Block.hpp"
+
+namespace Diligent
+{
+
+// One 4-bit value per block of a section, used for light levels. Arrays holding the
+// same value everywhere (full sky above the terrain, no block light underground)
+// store no data.
+class NibbleArray
+{
+public:
+    static constexpr Uint32 Volume = 16 * 16 * 16;
+
+    explicit NibbleArray(Uint8 Fill = 0) :
+        m_UniformValue{Fill}
+    {}
+
+    Uint8 Get(Uint32 Index) const
+    {
+        VERIFY_EXPR(Index < Volume);
+        if (m_Data.empty())
+            return m_UniformValue;
+        return (m_Data[Index >> 1u] >> ((Index & 1u) << 2u)) & 15u;
+    }
+
+    void Set(Uint32 Index, Uint8 Value)
+    {
+        VERIFY_EXPR(Index < Volume && Value < 16);
+        if (m_Data.empty())
+        {
+            if (Value == m_UniformValue)
+                return;
+            m_Data.assign(Volume / 2, static_cast<Uint8>(m_UniformValue * 0x11u));
+        }
+
+        const Uint32 Shift = (Index & 1u) << 2u;
+        Uint8&       Byte  = m_Data[Index >> 1u];
+        Byte               = static_cast<Uint8>((Byte & ~(15u << Shift)) | (Uint32{Value} << Shift));
+    }
+
+    void Fill(Uint8 Value)
+    {
+        m_Data         = {};
+        m_UniformValue = Value;
+    }
+
+    bool  IsUniform() const { return m_Data.empty(); }
+    Uint8 GetUniformValue() const { return m_UniformValue; }
+
+    size_t GetMemoryUsage() const { return m_Data.capacity(); }
+
+private:
+    std::vector<Uint8> m_Data;
+    Uint8              m_UniformValue = 0;
+};
+
+// 16x16x16 block storage with a per-section palette.
+//
+// Blocks are stored as bit-packed palette indices that grow 1 -> 2 -> 4 -> 8 bits as
+// the palette fills up, and switch to raw 16-bit ids if a section ever holds more
+// than 256 distinct blocks. A section made of a single block (most notably, all air)
+// stores no index data at all. Indices never straddle 64-bit words, so both reads and
+// writes are a shift and a mask.
+class ChunkSection
+{
+public:
+    static constexpr Uint32 Size   = 16;
+    static constexpr Uint32 Volume = Size * Size * Size;
+
+    ChunkSection() = default;
+    explicit ChunkSection(BlockId Fill) :
+        m_UniformBlock{Fill},
+        m_NonAirCount{static_cast<Uint16>(Fill != BLOCK_AIR ? Volume : 0)},
+        m_RandomlyTickedCount{static_cast<Uint16>(IsRandomlyTickedBlock(Fill) ? Volume : 0)}
+    {}
+
+    // YZX order: a horizontal layer is contiguous, which is what terrain fills touch
+    static Uint32 GetIndex(Uint32 x, Uint32 y, Uint32 z)
+    {
+        return (y << 8u) | (z << 4u) | x;
+    }
+
+    BlockId GetBlock(Uint32 x, Uint32 y, Uint32 z) const
+    {
+        return GetBlock(GetIndex(x, y, z));
+    }
+
+    BlockId GetBlock(Uint32 Index) const
+    {
+        VERIFY_EXPR(Index < Volume);
+        if (m_BitsPerBlock == 0)
+            return m_UniformBlock;
+
+        const Uint32 Value = ReadIndex(Index);
+        return m_BitsPerBlock == DirectBits ? static_cast<BlockId>(Value) : m_Palette[Value];
+    }
+
+    void SetBlock(Uint32 x, Uint32 y, Uint32 z, BlockId Id)
+    {
+        SetBlock(GetIndex(x, y, z), Id);
+    }
+
+    void SetBlock(Uint32 Index, BlockId Id);
+
+    // Resets the whole section to a single block
+    void Fill(BlockId Id);
+
+    // Unpacks all blocks in GetIndex() order into pDst, which must hold Volume entries
+    void Decode(BlockId* pDst) const;
+
+    // Replaces the section contents with Volume blocks in GetIndex() order
+    void Encode(const BlockId* pSrc);
+
+    bool    IsUniform() const { return m_BitsPerBlock == 0; }
+    bool    IsEmpty() const { return m_NonAirCount == 0; }
+    BlockId GetUniformBlock() const { return m_UniformBlock; }
+    Uint32  GetNonAirCount() const { return m_NonAirCount; }
+    // Sections with no randomly ticked blocks are skipped by random ticks
+    Uint32  GetRandomlyTickedCount() const { return m_RandomlyTickedCount; }
+    Uint32  GetBitsPerBlock() const { return m_BitsPerBlock; }
+    Uint32  GetPaletteSize() const { return static_cast<Uint32>(m_Palette.size()); }
+
+    // Sky and block light, 0-15 per block in GetIndex() order (see LightEngine)
+    NibbleArray&       GetSkyLight() { return m_SkyLight; }
+    const NibbleArray& GetSkyLight() const { return m_SkyLight; }
+    NibbleArray&       GetBlockLight() { return m_BlockLight; }
+    const NibbleArray& GetBlockLight() const { return m_BlockLight; }
+
+    // Heap and inline bytes held by the section
+    size_t GetMemoryUsage() const;
+
+private:
+    static constexpr Uint32 DirectBits = 16;
+
+    Uint32 ReadIndex(Uint32 Index) const
+    {
+        const Uint32 Shift = (Index & m_WordMask) * m_BitsPerBlock;
+        return static_cast<Uint32>(m_Data[Index >> m_WordShift] >> Shift) & m_ValueMask;
+    }
+
+    void WriteIndex(Uint32 Index, Uint32 Value)
+    {
+        const Uint32 Shift = (Index & m_WordMask) * m_BitsPerBlock;
+        Uint64&      Word  = m_Data[Index >> m_WordShift];
+        Word               = (Word & ~(Uint64{m_ValueMask} << Shift)) | (Uint64{Value} << Shift);
+    }
+
+    Uint32 FindOrAddPaletteEntry(BlockId Id);
+    void   Repack(Uint32 NewBitsPerBlock);
+    void   SetBitsPerBlock(Uint32 BitsPerBlock);
+
+private:
+    std::vector<Uint64>  m_Data;
+    std::vector<BlockId> m_Palette;
+    // Number of blocks referencing each palette entry. Entries with no references
+    // are recycled before the palette is allowed to grow.
+    std::vector<Uint16> m_PaletteRefs;
+
+    BlockId m_UniformBlock        = BLOCK_AIR;
+    Uint16  m_NonAirCount         = 0;
+    Uint16  m_RandomlyTickedCount = 0;
+
+    Uint8 m_BitsPerBlock = 0;
+    Uint8 m_WordShift    = 0; // log2(indices per 64-bit word)
+    Uint8 m_WordMask     = 0; // indices per 64-bit word - 1
+
+    Uint32 m_ValueMask = 0;
+
+    NibbleArray m_SkyLight;
+    NibbleArray m_BlockLight;
+};
+
+} // namespace Diligent
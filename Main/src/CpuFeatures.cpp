@@ -0,0 +1,104 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+#include "CpuFeatures.hpp"
+
+#if SIMD_X86 && defined(_MSC_VER)
+#    include <intrin.h>
+#    include <immintrin.h>
+#endif
+
+namespace Diligent
+{
+
+namespace
+{
+
+CpuFeatures DetectCpuFeatures()
+{
+    CpuFeatures Features;
+#if SIMD_X86 && defined(_MSC_VER)
+    int Info[4] = {};
+    __cpuid(Info, 0);
+    const int MaxLeaf = Info[0];
+
+    __cpuid(Info, 1);
+    Features.SSE2  = (Info[3] & (1 << 26)) != 0;
+    Features.SSE41 = (Info[2] & (1 << 19)) != 0;
+
+    // AVX state must be enabled by the OS (OSXSAVE + XCR0 bits 1 and 2)
+    const bool OSSavesYMM = (Info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 6) == 6;
+    if (OSSavesYMM && MaxLeaf >= 7)
+    {
+        __cpuidex(Info, 7, 0);
+        Features.AVX2 = (Info[1] & (1 << 5)) != 0;
+    }
+#elif SIMD_X86
+    __builtin_cpu_init();
+    Features.SSE2  = __builtin_cpu_supports("sse2") != 0;
+    Features.SSE41 = __builtin_cpu_supports("sse4.1") != 0;
+    Features.AVX2  = __builtin_cpu_supports("avx2") != 0;
+#endif
+    return Features;
+}
+
+} // namespace
+
+const CpuFeatures& GetCpuFeatures()
+{
+    static const CpuFeatures Features = DetectCpuFeatures();
+    return Features;
+}
+
+SIMD_LEVEL GetMaxSimdLevel()
+{
+    const CpuFeatures& Features = GetCpuFeatures();
+    if (Features.AVX2)
+        return SIMD_LEVEL_AVX2;
+    if (Features.SSE2)
+        return SIMD_LEVEL_SSE2;
+    return SIMD_LEVEL_SCALAR;
+}
+
+bool IsSimdLevelSupported(SIMD_LEVEL Level)
+{
+    return Level <= GetMaxSimdLevel();
+}
+
+const char* GetSimdLevelName(SIMD_LEVEL Level)
+{
+    switch (Level)
+    {
+        // clang-format off
+        case SIMD_LEVEL_SCALAR: return "Scalar";
+        case SIMD_LEVEL_SSE2:   return "SSE2";
+        case SIMD_LEVEL_AVX2:   return "AVX2";
+        default:                return "Unknown";
+        // clang-format on
+    }
+}
+
+} // namespace Diligent
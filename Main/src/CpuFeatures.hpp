@@ -0,0 +1,80 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+#pragma once
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#    define SIMD_X86 1
+#else
+#    define SIMD_X86 0
+#endif
+
+// Functions using instructions above the baseline are compiled with a per-function
+// target so the rest of the program keeps running on any x86-64 CPU. MSVC does not
+// need this, intrinsics are always available there.
+#if SIMD_X86 && (defined(__GNUC__) || defined(__clang__))
+#    define SIMD_TARGET_SSE2  __attribute__((target("sse2")))
+#    define SIMD_TARGET_SSE41 __attribute__((target("sse4.1")))
+#    define SIMD_TARGET_AVX2  __attribute__((target("avx2")))
+#else
+#    define SIMD_TARGET_SSE2
+#    define SIMD_TARGET_SSE41
+#    define SIMD_TARGET_AVX2
+#endif
+
+#include "Primitives/interface/BasicTypes.h"
+
+namespace Diligent
+{
+
+struct CpuFeatures
+{
+    bool SSE2  = false;
+    bool SSE41 = false;
+    // Also implies that the OS saves the YMM registers
+    bool AVX2 = false;
+};
+
+// Detected once, on first use
+const CpuFeatures& GetCpuFeatures();
+
+// Kernel variants of code that is vectorized for several instruction sets
+enum SIMD_LEVEL : Uint8
+{
+    SIMD_LEVEL_SCALAR = 0,
+    SIMD_LEVEL_SSE2,
+    SIMD_LEVEL_AVX2,
+    SIMD_LEVEL_COUNT
+};
+
+// Highest level the CPU supports
+SIMD_LEVEL GetMaxSimdLevel();
+
+bool IsSimdLevelSupported(SIMD_LEVEL Level);
+
+const char* GetSimdLevelName(SIMD_LEVEL Level);
+
+} // namespace Diligent
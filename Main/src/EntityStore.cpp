@@ -0,0 +1,498 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include "EntityStore.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "PlayerPhysics.hpp"
+#include "SimulationClock.hpp"
+#include "Common/interface/Timer.hpp"
+
+namespace Diligent
+{
+
+namespace
+{
+
+// Motion, gravity and drag of entities that go through blocks, in one pass over their
+// arrays. The arrays are marked as not overlapping, which is more than the compiler will
+// check at run time, so the loop stays vectorized.
+template <bool HasGravity>
+void IntegrateFreeRows(Uint32 Count, float dt,
+                       float* __restrict PosX, float* __restrict PosY, float* __restrict PosZ,
+                       float* __restrict VelX, float* __restrict VelY, float* __restrict VelZ,
+                       const float* __restrict Gravity)
+{
+    for (Uint32 i = 0; i < Count; ++i)
+    {
+        PosX[i] += VelX[i] * dt;
+        PosY[i] += VelY[i] * dt;
+        PosZ[i] += VelZ[i] * dt;
+        float NewVelY = VelY[i];
+        if constexpr (HasGravity)
+            NewVelY -= Gravity[i] * dt;
+        VelX[i] *= EntityStore::AirDrag;
+        VelY[i] = NewVelY * EntityStore::AirDrag;
+        VelZ[i] *= EntityStore::AirDrag;
+    }
+}
+
+} // namespace
+
+EntityStore::EntityStore(Uint32 NumThreads) :
+    EntityStore{CreateThreadPool(ThreadPoolCreateInfo{std::max(NumThreads, 1u)}), NumThreads}
+{
+    m_OwnsThreadPool = true;
+}
+
+EntityStore::EntityStore(IThreadPool* pThreadPool, Uint32 NumThreads) :
+    m_NumThreads{std::max(NumThreads, 1u)},
+    m_pThreadPool{pThreadPool},
+    m_BucketStarts(NumHashBuckets + 1, 0)
+{
+    VERIFY_EXPR(m_pThreadPool);
+}
+
+EntityStore::~EntityStore()
+{
+    if (m_OwnsThreadPool)
+        m_pThreadPool->StopThreads();
+}
+
+EntityHandle EntityStore::Create(const EntityDesc& Desc)
+{
+    // Falling blocks land by colliding, and falling, colliding and being pushed need a velocity
+    EntityComponentMask Components = Desc.Components;
+    if ((Components & ENTITY_COMPONENT_BLOCK) != 0)
+        Components |= ENTITY_COMPONENT_COLLISION;
+    if ((Components & (ENTITY_COMPONENT_GRAVITY | ENTITY_COMPONENT_COLLISION | ENTITY_COMPONENT_PUSHABLE)) != 0)
+        Components |= ENTITY_COMPONENT_VELOCITY;
+
+    Uint32 ArchetypeIdx = 0;
+    while (ArchetypeIdx < m_Archetypes.size() && m_Archetypes[ArchetypeIdx]->Components != Components)
+        ++ArchetypeIdx;
+    if (ArchetypeIdx == m_Archetypes.size())
+    {
+        m_Archetypes.emplace_back(std::make_unique<EntityArchetype>());
+        m_Archetypes.back()->Components = Components;
+    }
+    EntityArchetype& Archetype = *m_Archetypes[ArchetypeIdx];
+
+    Uint32 SlotIdx = 0;
+    if (!m_FreeSlots.empty())
+    {
+        SlotIdx = m_FreeSlots.back();
+        m_FreeSlots.pop_back();
+    }
+    else
+    {
+        SlotIdx = static_cast<Uint32>(m_Slots.size());
+        m_Slots.emplace_back();
+    }
+    Slot& S     = m_Slots[SlotIdx];
+    S.Archetype = ArchetypeIdx;
+    S.Row       = Archetype.GetCount();
+
+    Archetype.PosX.push_back(Desc.Pos.x);
+    Archetype.PosY.push_back(Desc.Pos.y);
+    Archetype.PosZ.push_back(Desc.Pos.z);
+    Archetype.HalfWidth.push_back(Desc.Width * 0.5f);
+    Archetype.Height.push_back(Desc.Height);
+    if (Archetype.Has(ENTITY_COMPONENT_VELOCITY))
+    {
+        Archetype.VelX.push_back(Desc.Velocity.x);
+        Archetype.VelY.push_back(Desc.Velocity.y);
+        Archetype.VelZ.push_back(Desc.Velocity.z);
+    }
+    if (Archetype.Has(ENTITY_COMPONENT_GRAVITY))
+        Archetype.Gravity.push_back(Desc.Gravity);
+    if (Archetype.Has(ENTITY_COMPONENT_COLLISION))
+        Archetype.OnGround.push_back(0);
+    if (Archetype.Has(ENTITY_COMPONENT_LIFETIME))
+        Archetype.Lifetime.push_back(std::max(Desc.Lifetime, 1u));
+    if (Archetype.Has(ENTITY_COMPONENT_BLOCK))
+        Archetype.Block.push_back(Desc.Block);
+    Archetype.Slots.push_back(SlotIdx);
+    m_IsHashStale  = true;
+    m_MaxHalfWidth = std::max(m_MaxHalfWidth, Desc.Width * 0.5f);
+    m_MaxHeight    = std::max(m_MaxHeight, Desc.Height);
+
+    ++m_NumEntities;
+    return EntityHandle{SlotIdx, S.Generation};
+}
+
+void EntityStore::Destroy(const EntityHandle& Handle)
+{
+    // Destroying an entity twice is allowed, e.g. when it expires and lands in one tick
+    if (!IsAlive(Handle))
+        return;
+
+    Slot&            S         = m_Slots[Handle.Slot];
+    EntityArchetype& Archetype = *m_Archetypes[S.Archetype];
+    const Uint32     Row       = S.Row;
+    const Uint32     Last      = Archetype.GetCount() - 1;
+
+    auto SwapRemove = [Row, Last](auto& Values) {
+        if (!Values.empty())
+        {
+            Values[Row] = Values[Last];
+            Values.pop_back();
+        }
+    };
+    SwapRemove(Archetype.PosX);
+    SwapRemove(Archetype.PosY);
+    SwapRemove(Archetype.PosZ);
+    SwapRemove(Archetype.HalfWidth);
+    SwapRemove(Archetype.Height);
+    SwapRemove(Archetype.VelX);
+    SwapRemove(Archetype.VelY);
+    SwapRemove(Archetype.VelZ);
+    SwapRemove(Archetype.Gravity);
+    SwapRemove(Archetype.OnGround);
+    SwapRemove(Archetype.Lifetime);
+    SwapRemove(Archetype.Block);
+    SwapRemove(Archetype.Slots);
+    if (Row != Last)
+        m_Slots[Archetype.Slots[Row]].Row = Row;
+
+    // Old handles to the slot no longer match it
+    ++S.Generation;
+    S.Archetype = ~0u;
+    m_FreeSlots.push_back(Handle.Slot);
+    m_IsHashStale = true;
+    --m_NumEntities;
+}
+
+void EntityStore::RebuildHash() const
+{
+    m_RowBuckets.resize(m_NumEntities);
+    m_BucketSlots.resize(m_NumEntities);
+
+    // Bucket of every entity, in archetype and row order
+    Uint32 Offset = 0;
+    for (const auto& pArchetype : m_Archetypes)
+    {
+        const EntityArchetype& Archetype = *pArchetype;
+        Uint32* const          pBuckets  = m_RowBuckets.data() + Offset;
+        for (Uint32 i = 0; i < Archetype.GetCount(); ++i)
+            pBuckets[i] = GetHashBucket(GetHashCell(Archetype.PosX[i], Archetype.PosY[i], Archetype.PosZ[i]));
+        Offset += Archetype.GetCount();
+    }
+
+    // Counts become the ends of the buckets, which placing the slots from the back moves
+    // down to their starts. Each bucket keeps its entities in archetype and row order.
+    std::fill(m_BucketStarts.begin(), m_BucketStarts.end(), 0u);
+    for (Uint32 Bucket : m_RowBuckets)
+        ++m_BucketStarts[Bucket];
+    Uint32 End = 0;
+    for (Uint32& Start : m_BucketStarts)
+    {
+        End += Start;
+        Start = End;
+    }
+    for (auto It = m_Archetypes.rbegin(); It != m_Archetypes.rend(); ++It)
+    {
+        const EntityArchetype& Archetype = **It;
+        Offset -= Archetype.GetCount();
+        for (Uint32 i = Archetype.GetCount(); i-- > 0;)
+            m_BucketSlots[--m_BucketStarts[m_RowBuckets[Offset + i]]] = Archetype.Slots[i];
+    }
+    m_IsHashStale = false;
+}
+
+bool EntityStore::IsAlive(const EntityHandle& Handle) const
+{
+    return Handle.Slot < m_Slots.size() && m_Slots[Handle.Slot].Generation == Handle.Generation && m_Slots[Handle.Slot].Archetype != ~0u;
+}
+
+const EntityStore::Slot& EntityStore::GetSlot(const EntityHandle& Handle) const
+{
+    VERIFY(IsAlive(Handle), "The entity has been destroyed");
+    return m_Slots[Handle.Slot];
+}
+
+float3 EntityStore::GetPos(const EntityHandle& Handle) const
+{
+    const Slot&            S         = GetSlot(Handle);
+    const EntityArchetype& Archetype = *m_Archetypes[S.Archetype];
+    return float3{Archetype.PosX[S.Row], Archetype.PosY[S.Row], Archetype.PosZ[S.Row]};
+}
+
+float3 EntityStore::GetVelocity(const EntityHandle& Handle) const
+{
+    const Slot&            S         = GetSlot(Handle);
+    const EntityArchetype& Archetype = *m_Archetypes[S.Archetype];
+    if (!Archetype.Has(ENTITY_COMPONENT_VELOCITY))
+        return float3{};
+    return float3{Archetype.VelX[S.Row], Archetype.VelY[S.Row], Archetype.VelZ[S.Row]};
+}
+
+void EntityStore::SetVelocity(const EntityHandle& Handle, const float3& Velocity)
+{
+    const Slot&      S         = GetSlot(Handle);
+    EntityArchetype& Archetype = *m_Archetypes[S.Archetype];
+    VERIFY(Archetype.Has(ENTITY_COMPONENT_VELOCITY), "The entity has no velocity");
+    Archetype.VelX[S.Row] = Velocity.x;
+    Archetype.VelY[S.Row] = Velocity.y;
+    Archetype.VelZ[S.Row] = Velocity.z;
+}
+
+EntityComponentMask EntityStore::GetComponents(const EntityHandle& Handle) const
+{
+    return m_Archetypes[GetSlot(Handle).Archetype]->Components;
+}
+
+void EntityStore::BuildJobs(EntityComponentMask Required)
+{
+    m_Jobs.clear();
+    for (const auto& pArchetype : m_Archetypes)
+    {
+        if (!pArchetype->Has(Required))
+            continue;
+        for (Uint32 Begin = 0; Begin < pArchetype->GetCount(); Begin += JobSize)
+            m_Jobs.push_back(Job{pArchetype.get(), Begin, std::min(Begin + JobSize, pArchetype->GetCount())});
+    }
+}
+
+void EntityStore::Tick(const World& Wrld)
+{
+    Timer Tmr;
+
+    // Pushing queries the hash from the jobs concurrently, so they must not find it stale
+    const bool HasPushable = std::any_of(m_Archetypes.begin(), m_Archetypes.end(), [](const auto& pArchetype) {
+        return pArchetype->Has(ENTITY_COMPONENT_PUSHABLE) && pArchetype->GetCount() > 0;
+    });
+    if (HasPushable && m_IsHashStale)
+        RebuildHash();
+
+    // Without worker threads every archetype is ticked whole on this thread, all writing
+    // to the first output in archetype and row order, so there are no jobs to build and
+    // no outputs to merge
+    const bool IsSingleThreaded = m_NumThreads == 1;
+
+    // Pushing reads the positions of other entities, so it is done for all entities
+    // before any of them move
+    if (HasPushable && IsSingleThreaded)
+    {
+        for (const auto& pArchetype : m_Archetypes)
+        {
+            if (pArchetype->Has(ENTITY_COMPONENT_PUSHABLE))
+                PushRows(*pArchetype, 0, pArchetype->GetCount());
+        }
+    }
+    else if (HasPushable)
+    {
+        BuildJobs(ENTITY_COMPONENT_PUSHABLE);
+        RunJobs([&](EntityArchetype& Archetype, Uint32 Begin, Uint32 End, Uint32) {
+            PushRows(Archetype, Begin, End);
+        });
+    }
+
+    size_t NumOutputs = 1;
+    if (!IsSingleThreaded)
+    {
+        BuildJobs(ENTITY_COMPONENT_NONE);
+        NumOutputs = m_Jobs.size();
+    }
+    if (m_JobOutputs.size() < NumOutputs)
+        m_JobOutputs.resize(NumOutputs);
+    for (size_t i = 0; i < NumOutputs; ++i)
+    {
+        m_JobOutputs[i].Expired.clear();
+        m_JobOutputs[i].Landed.clear();
+    }
+
+    if (IsSingleThreaded)
+    {
+        for (const auto& pArchetype : m_Archetypes)
+            TickRows(Wrld, *pArchetype, 0, pArchetype->GetCount(), m_JobOutputs[0]);
+    }
+    else
+    {
+        RunJobs([&](EntityArchetype& Archetype, Uint32 Begin, Uint32 End, Uint32 JobIdx) {
+            TickRows(Wrld, Archetype, Begin, End, m_JobOutputs[JobIdx]);
+        });
+    }
+
+    // Destroying changes shared lists, so it waits until all jobs are done
+    if (NumOutputs == 1)
+    {
+        m_LandedBlocks.swap(m_JobOutputs[0].Landed);
+    }
+    else
+    {
+        m_LandedBlocks.clear();
+        for (size_t i = 0; i < NumOutputs; ++i)
+            m_LandedBlocks.insert(m_LandedBlocks.end(), m_JobOutputs[i].Landed.begin(), m_JobOutputs[i].Landed.end());
+    }
+    for (size_t i = 0; i < NumOutputs; ++i)
+    {
+        for (const EntityHandle& Handle : m_JobOutputs[i].Expired)
+            Destroy(Handle);
+    }
+    // Everything moved, but the hash is only rebuilt once something queries it, so ticks
+    // without pushing or queries in between do not pay for it
+    m_IsHashStale = true;
+
+    m_LastTickTime = Tmr.GetElapsedTime();
+}
+
+void EntityStore::PushRows(EntityArchetype& Archetype, Uint32 Begin, Uint32 End) const
+{
+    for (Uint32 i = Begin; i < End; ++i)
+    {
+        const Uint32   Self = Archetype.Slots[i];
+        const float2   Pos{Archetype.PosX[i], Archetype.PosZ[i]};
+        const BoundBox Box{
+            float3{Archetype.PosX[i] - Archetype.HalfWidth[i], Archetype.PosY[i], Archetype.PosZ[i] - Archetype.HalfWidth[i]},
+            float3{Archetype.PosX[i] + Archetype.HalfWidth[i], Archetype.PosY[i] + Archetype.Height[i], Archetype.PosZ[i] + Archetype.HalfWidth[i]},
+        };
+
+        float2 Push;
+        Uint32 NumNeighbours = 0;
+        ForEachInBox(Box, [&](Uint32 SlotIdx, const EntityArchetype& Other, Uint32 Row) {
+            if (SlotIdx == Self || !Other.Has(ENTITY_COMPONENT_PUSHABLE))
+                return true;
+
+            float2      Away = Pos - float2{Other.PosX[Row], Other.PosZ[Row]};
+            const float Dist = length(Away);
+            if (Dist > 1e-4f)
+            {
+                Away /= Dist;
+            }
+            else
+            {
+                // Entities at the same spot push each other in opposite directions picked
+                // from the pair of slots, so a stack spreads out the same way every time
+                const Uint32 Hash  = (std::min(Self, SlotIdx) * 2654435761u) ^ (std::max(Self, SlotIdx) * 40503u);
+                const float  Angle = static_cast<float>(Hash) * (2.f * PI_F / 4294967296.f);
+                Away               = float2{std::cos(Angle), std::sin(Angle)} * (Self < SlotIdx ? 1.f : -1.f);
+            }
+            Push += Away;
+            return ++NumNeighbours < MaxPushNeighbours;
+        });
+
+        // Crowds push no harder than a single neighbour
+        const float PushLength = length(Push);
+        if (PushLength > 1.f)
+            Push /= PushLength;
+        Archetype.VelX[i] += Push.x * PushSpeed;
+        Archetype.VelZ[i] += Push.y * PushSpeed;
+    }
+}
+
+void EntityStore::TickRows(const World& Wrld, EntityArchetype& Archetype, Uint32 Begin, Uint32 End, JobOutput& Output) const
+{
+    constexpr float TickTime = static_cast<float>(SimulationClock::TickInterval);
+
+    // Entities that go through blocks move in one fused pass. Colliding ones take a pass
+    // per step, each streaming through only the arrays it needs, and those without
+    // branches on the entity are plain loops that the compiler vectorizes.
+    if (Archetype.Has(ENTITY_COMPONENT_COLLISION))
+    {
+        for (Uint32 i = Begin; i < End; ++i)
+        {
+            const float3   Delta{Archetype.VelX[i] * TickTime, Archetype.VelY[i] * TickTime, Archetype.VelZ[i] * TickTime};
+            const BoundBox Box{
+                float3{Archetype.PosX[i] - Archetype.HalfWidth[i], Archetype.PosY[i], Archetype.PosZ[i] - Archetype.HalfWidth[i]},
+                float3{Archetype.PosX[i] + Archetype.HalfWidth[i], Archetype.PosY[i] + Archetype.Height[i], Archetype.PosZ[i] + Archetype.HalfWidth[i]},
+            };
+            const float3 Moved = MoveBox(Wrld, Box, Delta);
+            Archetype.PosX[i] += Moved.x;
+            Archetype.PosY[i] += Moved.y;
+            Archetype.PosZ[i] += Moved.z;
+            Archetype.OnGround[i] = Delta.y < 0 && Moved.y != Delta.y ? 1 : 0;
+            // clang-format off
+            if (Moved.x != Delta.x) Archetype.VelX[i] = 0;
+            if (Moved.y != Delta.y) Archetype.VelY[i] = 0;
+            if (Moved.z != Delta.z) Archetype.VelZ[i] = 0;
+            // clang-format on
+        }
+    }
+    else if (Archetype.Has(ENTITY_COMPONENT_VELOCITY))
+    {
+        auto Rows = [Begin](std::vector<float>& Values) { return Values.data() + Begin; };
+        if (Archetype.Has(ENTITY_COMPONENT_GRAVITY))
+        {
+            IntegrateFreeRows<true>(End - Begin, TickTime, Rows(Archetype.PosX), Rows(Archetype.PosY), Rows(Archetype.PosZ),
+                                    Rows(Archetype.VelX), Rows(Archetype.VelY), Rows(Archetype.VelZ), Rows(Archetype.Gravity));
+        }
+        else
+        {
+            IntegrateFreeRows<false>(End - Begin, TickTime, Rows(Archetype.PosX), Rows(Archetype.PosY), Rows(Archetype.PosZ),
+                                     Rows(Archetype.VelX), Rows(Archetype.VelY), Rows(Archetype.VelZ), nullptr);
+        }
+    }
+
+    if (Archetype.Has(ENTITY_COMPONENT_COLLISION | ENTITY_COMPONENT_GRAVITY))
+    {
+        for (Uint32 i = Begin; i < End; ++i)
+            Archetype.VelY[i] -= Archetype.Gravity[i] * TickTime;
+    }
+
+    if (Archetype.Has(ENTITY_COMPONENT_COLLISION))
+    {
+        // Sliding on the ground slows down faster
+        for (Uint32 i = Begin; i < End; ++i)
+        {
+            const float Drag = Archetype.OnGround[i] != 0 ? GroundDrag : AirDrag;
+            Archetype.VelX[i] *= Drag;
+            Archetype.VelY[i] *= AirDrag;
+            Archetype.VelZ[i] *= Drag;
+        }
+    }
+
+    if (Archetype.Has(ENTITY_COMPONENT_BLOCK))
+    {
+        for (Uint32 i = Begin; i < End; ++i)
+        {
+            if (Archetype.OnGround[i] == 0)
+                continue;
+            // The bottom of the box rests on the top of a block
+            const int3 Pos{
+                static_cast<Int32>(std::floor(Archetype.PosX[i])),
+                static_cast<Int32>(std::floor(Archetype.PosY[i] + 0.5f)),
+                static_cast<Int32>(std::floor(Archetype.PosZ[i])),
+            };
+            Output.Landed.push_back(LandedBlock{Pos, Archetype.Block[i]});
+            Output.Expired.push_back(EntityHandle{Archetype.Slots[i], m_Slots[Archetype.Slots[i]].Generation});
+        }
+    }
+
+    if (Archetype.Has(ENTITY_COMPONENT_LIFETIME))
+    {
+        for (Uint32 i = Begin; i < End; ++i)
+        {
+            if (--Archetype.Lifetime[i] == 0)
+                Output.Expired.push_back(EntityHandle{Archetype.Slots[i], m_Slots[Archetype.Slots[i]].Generation});
+        }
+    }
+}
+
+} // namespace Diligent
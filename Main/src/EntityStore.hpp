@@ -0,0 +1,412 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include "Common/interface/AdvancedMath.hpp"
+#include "Common/interface/ThreadPool.hpp"
+#include "World.hpp"
+
+namespace Diligent
+{
+
+// Refers to an entity while it exists. Handles of destroyed entities never refer to
+// another entity, even when their slot is reused.
+struct EntityHandle
+{
+    Uint32 Slot       = ~0u;
+    Uint32 Generation = 0;
+};
+
+// Every entity has a position and a box, the rest depends on its components
+enum ENTITY_COMPONENT : Uint32
+{
+    ENTITY_COMPONENT_NONE      = 0,
+    // Moves by its velocity every tick, with drag
+    ENTITY_COMPONENT_VELOCITY  = 1u << 0,
+    // Accelerates down, needs a velocity
+    ENTITY_COMPONENT_GRAVITY   = 1u << 1,
+    // Stopped by solid blocks (see SweepBox()), needs a velocity
+    ENTITY_COMPONENT_COLLISION = 1u << 2,
+    // Destroyed when it has been alive for its lifetime
+    ENTITY_COMPONENT_LIFETIME  = 1u << 3,
+    // Falling sand and gravel: destroyed when it lands, reporting where its block goes
+    ENTITY_COMPONENT_BLOCK     = 1u << 4,
+    // Pushed apart from other pushable entities it overlaps, needs a velocity
+    ENTITY_COMPONENT_PUSHABLE  = 1u << 5,
+};
+using EntityComponentMask = Uint32;
+
+struct EntityDesc
+{
+    EntityComponentMask Components = ENTITY_COMPONENT_NONE;
+
+    // Centre of the bottom of the box
+    float3 Pos;
+    float3 Velocity;
+    float  Width  = 0.25f;
+    float  Height = 0.25f;
+
+    // Blocks per second squared
+    float   Gravity  = 16.f;
+    Uint32  Lifetime = 0; // Ticks
+    BlockId Block    = BLOCK_AIR;
+};
+
+// All entities with the same components, one array per value. Arrays of components
+// the archetype does not have stay empty.
+struct EntityArchetype
+{
+    EntityComponentMask Components = ENTITY_COMPONENT_NONE;
+
+    // clang-format off
+    std::vector<float>   PosX, PosY, PosZ;
+    std::vector<float>   HalfWidth, Height;
+    std::vector<float>   VelX, VelY, VelZ;
+    std::vector<float>   Gravity;
+    std::vector<Uint8>   OnGround;
+    std::vector<Uint32>  Lifetime;
+    std::vector<BlockId> Block;
+    // clang-format on
+
+    // Handle slot of each entity, to update it when the entity is moved
+    std::vector<Uint32> Slots;
+
+    Uint32 GetCount() const { return static_cast<Uint32>(Slots.size()); }
+    bool   Has(EntityComponentMask Mask) const { return (Components & Mask) == Mask; }
+};
+
+// Entity storage grouped by archetype, in structure-of-arrays form.
+//
+// Entities with the same set of components share an archetype and lie next to each
+// other in its arrays, so systems stream through exactly the values they touch.
+// Destroying an entity moves the last one of its archetype into its place. Handles go
+// through a slot table holding the archetype and row of every entity, so they stay
+// valid when entities move.
+//
+// Systems are split into jobs of JobSize entities of one archetype each, which run on
+// the worker threads. Jobs write their results to their own lists, which are merged in
+// job order, so the outcome does not depend on the number of threads.
+//
+// Entities near a point are found through a spatial hash of uniform cells. Each entity
+// is in the cell of the centre of its bottom. Every tick ends by counting-sorting the
+// slots of all entities by bucket, which takes a few linear passes rather than a random
+// unlink and link for every entity that moved to another cell, and lays each bucket's
+// entities out next to each other so that queries allocate nothing. Creating or
+// destroying entities leaves the hash stale until the next query or tick rebuilds it,
+// so the first query after that must not run alongside others. Queries stop when their
+// handler says so, which keeps pushing in crowds of hundreds of entities in one block
+// linear in the number of entities.
+class EntityStore
+{
+public:
+    static constexpr Uint32 JobSize = 4096;
+
+    // clang-format off
+    static constexpr float  HashCellSize   = 4.f;
+    static constexpr Uint32 NumHashBuckets = 1u << 14;
+    // Pushing considers this many overlapping neighbours at most, like entity cramming
+    static constexpr Uint32 MaxPushNeighbours = 24;
+    // Blocks per second added per tick in the direction away from the neighbours
+    static constexpr float  PushSpeed      = 1.f;
+    // clang-format on
+
+    // Fraction of the velocity kept per tick in the air and when sliding on the ground
+    static constexpr float AirDrag    = 0.98f;
+    static constexpr float GroundDrag = 0.6f * 0.98f;
+
+    // Runs jobs on a thread pool of its own
+    explicit EntityStore(Uint32 NumThreads);
+    // Runs jobs on a pool shared with other systems, which must have NumThreads workers
+    EntityStore(IThreadPool* pThreadPool, Uint32 NumThreads);
+    ~EntityStore();
+
+    // clang-format off
+    EntityStore           (const EntityStore&)  = delete;
+    EntityStore           (      EntityStore&&) = delete;
+    EntityStore& operator=(const EntityStore&)  = delete;
+    EntityStore& operator=(      EntityStore&&) = delete;
+    // clang-format on
+
+    EntityHandle Create(const EntityDesc& Desc);
+    void         Destroy(const EntityHandle& Handle);
+    bool         IsAlive(const EntityHandle& Handle) const;
+
+    // The entity must be alive
+    float3              GetPos(const EntityHandle& Handle) const;
+    float3              GetVelocity(const EntityHandle& Handle) const;
+    void                SetVelocity(const EntityHandle& Handle, const float3& Velocity);
+    EntityComponentMask GetComponents(const EntityHandle& Handle) const;
+
+    // Advances every entity by SimulationClock::TickInterval: gravity, motion, collision
+    // and lifetimes. The world must not be changed by other threads meanwhile.
+    void Tick(const World& Wrld);
+
+    struct LandedBlock
+    {
+        int3    Pos;
+        BlockId Block = BLOCK_AIR;
+    };
+    // Blocks of falling block entities that landed during the last Tick(), to be placed
+    // by the caller
+    const std::vector<LandedBlock>& GetLandedBlocks() const { return m_LandedBlocks; }
+
+    // Call Handler(const EntityHandle&) for every entity whose box overlaps the query,
+    // until the handler returns false. Boxes only touching the query do not overlap it.
+    template <typename HandlerType>
+    void QueryBox(const BoundBox& Box, HandlerType&& Handler) const;
+    template <typename HandlerType>
+    void QueryRadius(const float3& Center, float Radius, HandlerType&& Handler) const;
+
+    // Calls Handler(EntityArchetype&, Uint32 Begin, Uint32 End, Uint32 Job) for rows
+    // [Begin, End) of every archetype with all of the Required components, in jobs spread
+    // over the worker threads ahead of any other work queued on the pool. Jobs are
+    // numbered in archetype and row order. Handlers may
+    // query the store and change the values of their own rows, but must not create or
+    // destroy entities.
+    template <typename HandlerType>
+    void RunSystem(EntityComponentMask Required, HandlerType&& Handler);
+
+    // Calls Handler(const EntityArchetype&, Uint32 Row) for every entity with all of the
+    // Required components, on the calling thread
+    template <typename HandlerType>
+    void ForEach(EntityComponentMask Required, HandlerType&& Handler) const;
+
+    Uint32 GetCount() const { return m_NumEntities; }
+    Uint32 GetArchetypeCount() const { return static_cast<Uint32>(m_Archetypes.size()); }
+    Uint32 GetThreadCount() const { return m_NumThreads; }
+    double GetLastTickTime() const { return m_LastTickTime; }
+
+private:
+    struct Slot
+    {
+        Uint32 Archetype  = ~0u;
+        Uint32 Row        = 0;
+        Uint32 Generation = 0;
+    };
+
+    struct Job
+    {
+        EntityArchetype* pArchetype = nullptr;
+        Uint32           Begin      = 0;
+        Uint32           End        = 0;
+    };
+
+    // What a Tick() job wants done once all jobs have finished
+    struct JobOutput
+    {
+        std::vector<EntityHandle> Expired;
+        std::vector<LandedBlock>  Landed;
+    };
+
+    const Slot& GetSlot(const EntityHandle& Handle) const;
+
+    void BuildJobs(EntityComponentMask Required);
+
+    template <typename HandlerType>
+    void RunJobs(HandlerType&& Handler);
+
+    void PushRows(EntityArchetype& Archetype, Uint32 Begin, Uint32 End) const;
+    void TickRows(const World& Wrld, EntityArchetype& Archetype, Uint32 Begin, Uint32 End, JobOutput& Output) const;
+
+    static int3 GetHashCell(float x, float y, float z)
+    {
+        // Rounds down without calling floor(), which is not inlined without SSE4.1
+        constexpr float InvCellSize = 1.f / HashCellSize;
+        auto            Floor       = [](float v) {
+            const Int32 i = static_cast<Int32>(v);
+            return i - (v < static_cast<float>(i) ? 1 : 0);
+        };
+        return int3{Floor(x * InvCellSize), Floor(y * InvCellSize), Floor(z * InvCellSize)};
+    }
+    static Uint32 GetHashBucket(const int3& Cell)
+    {
+        const Uint32 Hash = (static_cast<Uint32>(Cell.x) * 73856093u) ^ (static_cast<Uint32>(Cell.y) * 19349663u) ^ (static_cast<Uint32>(Cell.z) * 83492791u);
+        return Hash & (NumHashBuckets - 1);
+    }
+    void RebuildHash() const;
+
+    // Calls Visitor(Uint32 SlotIdx, const EntityArchetype&, Uint32 Row) for entities whose
+    // boxes overlap Box, until it returns false
+    template <typename VisitorType>
+    void ForEachInBox(const BoundBox& Box, VisitorType&& Visitor) const;
+
+private:
+    // The calling thread waits for the jobs, so they go ahead of background jobs on a
+    // shared pool
+    static constexpr float JobPriority = std::numeric_limits<float>::max();
+
+    const Uint32               m_NumThreads;
+    RefCntAutoPtr<IThreadPool> m_pThreadPool;
+    bool                       m_OwnsThreadPool = false;
+
+    // Archetypes never go away, so pointers to them stay valid
+    std::vector<std::unique_ptr<EntityArchetype>> m_Archetypes;
+
+    std::vector<Slot>   m_Slots;
+    std::vector<Uint32> m_FreeSlots;
+    Uint32              m_NumEntities = 0;
+
+    // Slots of all entities sorted by spatial hash bucket, and where each bucket starts
+    // among them, with one more start for the end of the last. Queries look past their
+    // box by the largest entity size ever seen, as entities are hashed by a single point.
+    mutable std::vector<Uint32> m_BucketStarts;
+    mutable std::vector<Uint32> m_BucketSlots;
+    mutable std::vector<Uint32> m_RowBuckets;
+    mutable bool                m_IsHashStale  = false;
+    float                       m_MaxHalfWidth = 0;
+    float                       m_MaxHeight    = 0;
+
+    // Reused by every system run
+    std::vector<Job>                       m_Jobs;
+    std::vector<JobOutput>                 m_JobOutputs;
+    std::vector<LandedBlock>               m_LandedBlocks;
+    std::vector<RefCntAutoPtr<IAsyncTask>> m_Tasks;
+
+    double m_LastTickTime = 0;
+};
+
+template <typename HandlerType>
+void EntityStore::RunJobs(HandlerType&& Handler)
+{
+    if (m_Jobs.size() == 1)
+    {
+        Handler(*m_Jobs[0].pArchetype, m_Jobs[0].Begin, m_Jobs[0].End, Uint32{0});
+    }
+    else if (m_Jobs.size() > 1)
+    {
+        m_Tasks.clear();
+        for (Uint32 JobIdx = 0; JobIdx < m_Jobs.size(); ++JobIdx)
+        {
+            m_Tasks.emplace_back(EnqueueAsyncWork(
+                m_pThreadPool, [this, &Handler, JobIdx](Uint32 /*ThreadId*/) {
+                    const Job& J = m_Jobs[JobIdx];
+                    Handler(*J.pArchetype, J.Begin, J.End, JobIdx);
+                },
+                JobPriority));
+        }
+        for (const auto& pTask : m_Tasks)
+            pTask->WaitForCompletion();
+    }
+}
+
+template <typename VisitorType>
+void EntityStore::ForEachInBox(const BoundBox& Box, VisitorType&& Visitor) const
+{
+    if (m_IsHashStale)
+        RebuildHash();
+
+    const int3 Lo = GetHashCell(Box.Min.x - m_MaxHalfWidth, Box.Min.y - m_MaxHeight, Box.Min.z - m_MaxHalfWidth);
+    const int3 Hi = GetHashCell(Box.Max.x + m_MaxHalfWidth, Box.Max.y, Box.Max.z + m_MaxHalfWidth);
+    for (Int32 z = Lo.z; z <= Hi.z; ++z)
+    {
+        for (Int32 y = Lo.y; y <= Hi.y; ++y)
+        {
+            for (Int32 x = Lo.x; x <= Hi.x; ++x)
+            {
+                const int3   Cell{x, y, z};
+                const Uint32 Bucket = GetHashBucket(Cell);
+                for (Uint32 i = m_BucketStarts[Bucket]; i < m_BucketStarts[Bucket + 1]; ++i)
+                {
+                    // Buckets are shared by cells whose hashes collide
+                    const Uint32           SlotIdx   = m_BucketSlots[i];
+                    const Slot&            S         = m_Slots[SlotIdx];
+                    const EntityArchetype& Archetype = *m_Archetypes[S.Archetype];
+                    const Uint32           Row       = S.Row;
+                    if (GetHashCell(Archetype.PosX[Row], Archetype.PosY[Row], Archetype.PosZ[Row]) != Cell)
+                        continue;
+
+                    const float HalfWidth = Archetype.HalfWidth[Row];
+                    if (Archetype.PosX[Row] - HalfWidth < Box.Max.x && Archetype.PosX[Row] + HalfWidth > Box.Min.x &&
+                        Archetype.PosY[Row] < Box.Max.y && Archetype.PosY[Row] + Archetype.Height[Row] > Box.Min.y &&
+                        Archetype.PosZ[Row] - HalfWidth < Box.Max.z && Archetype.PosZ[Row] + HalfWidth > Box.Min.z)
+                    {
+                        if (!Visitor(SlotIdx, Archetype, Row))
+                            return;
+                    }
+                }
+            }
+        }
+    }
+}
+
+template <typename HandlerType>
+void EntityStore::QueryBox(const BoundBox& Box, HandlerType&& Handler) const
+{
+    ForEachInBox(Box, [&](Uint32 SlotIdx, const EntityArchetype&, Uint32) {
+        return Handler(EntityHandle{SlotIdx, m_Slots[SlotIdx].Generation});
+    });
+}
+
+template <typename HandlerType>
+void EntityStore::QueryRadius(const float3& Center, float Radius, HandlerType&& Handler) const
+{
+    const BoundBox Box{Center - float3{Radius, Radius, Radius}, Center + float3{Radius, Radius, Radius}};
+    ForEachInBox(Box, [&](Uint32 SlotIdx, const EntityArchetype& Archetype, Uint32 Row) {
+        // Distance from the centre to the nearest point of the entity's box
+        const float  HalfWidth = Archetype.HalfWidth[Row];
+        const float3 Nearest{
+            std::clamp(Center.x, Archetype.PosX[Row] - HalfWidth, Archetype.PosX[Row] + HalfWidth),
+            std::clamp(Center.y, Archetype.PosY[Row], Archetype.PosY[Row] + Archetype.Height[Row]),
+            std::clamp(Center.z, Archetype.PosZ[Row] - HalfWidth, Archetype.PosZ[Row] + HalfWidth),
+        };
+        const float3 Offset = Nearest - Center;
+        if (dot(Offset, Offset) >= Radius * Radius)
+            return true;
+        return Handler(EntityHandle{SlotIdx, m_Slots[SlotIdx].Generation});
+    });
+}
+
+template <typename HandlerType>
+void EntityStore::RunSystem(EntityComponentMask Required, HandlerType&& Handler)
+{
+    // Handlers may query the hash concurrently, so they must not find it stale
+    if (m_IsHashStale)
+        RebuildHash();
+    BuildJobs(Required);
+    RunJobs(Handler);
+}
+
+template <typename HandlerType>
+void EntityStore::ForEach(EntityComponentMask Required, HandlerType&& Handler) const
+{
+    for (const auto& pArchetype : m_Archetypes)
+    {
+        if (!pArchetype->Has(Required))
+            continue;
+        for (Uint32 Row = 0; Row < pArchetype->GetCount(); ++Row)
+            Handler(*pArchetype, Row);
+    }
+}
+
+} // namespace Diligent
@@ -31,85 +31,102 @@
 namespace Diligent
 {
 
-void FirstPersonCamera::Update(Key key, KeyState state, float ElapsedTime)
+namespace
 {
-    float3 MoveDirection = float3(0, 0, 0);
 
-    // Input repeated
-    if (state == KeyState::Press || state == KeyState::Repeat)
+enum MOVE_KEY : Uint32
+{
+    MOVE_KEY_FORWARD  = 1u << 0,
+    MOVE_KEY_BACKWARD = 1u << 1,
+    MOVE_KEY_RIGHT    = 1u << 2,
+    MOVE_KEY_LEFT     = 1u << 3,
+    MOVE_KEY_UP       = 1u << 4,
+    MOVE_KEY_DOWN     = 1u << 5,
+};
+
+} // namespace
+
+void FirstPersonCamera::Update(Key key, KeyState state)
+{
+    Uint32 MoveKey = 0;
+    switch (key)
     {
-        switch (key)
-        {
-            case Key::W:
-                MoveDirection.z += 1.0f;
-                //cam.location.Translation();
-                break;
-
-            case Key::S:
-                MoveDirection.z -= 1.0f;
-                ////m_Player.PendingPos.y -= 1.0f;
-                break;
-
-            case Key::D:
-                MoveDirection.x += 1.0f;
-                //m_Player.PendingPos.x += 1.0f;
-                break;
-
-            case Key::A:
-                MoveDirection.x -= 1.0f;
-                //m_Player.PendingPos.x -= 1.0f;
-                break;
-
-            case Key::Space:
-                MoveDirection.y += 1.0f;
-                break;
-
-            case Key::RightShift:
-            case Key::LeftShift:
-                MoveDirection.y -= 1.0f;
-
-            default:
-                break;
-        }
+        // clang-format off
+        case Key::W:          MoveKey = MOVE_KEY_FORWARD;  break;
+        case Key::S:          MoveKey = MOVE_KEY_BACKWARD; break;
+        case Key::D:          MoveKey = MOVE_KEY_RIGHT;    break;
+        case Key::A:          MoveKey = MOVE_KEY_LEFT;     break;
+        case Key::Space:      MoveKey = MOVE_KEY_UP;       break;
+        case Key::RightShift:
+        case Key::LeftShift:  MoveKey = MOVE_KEY_DOWN;     break;
+        // clang-format on
+        default:
+            return;
     }
 
+    if (state == KeyState::Press || state == KeyState::Repeat)
+        m_HeldMoveKeys |= MoveKey;
+    else
+        m_HeldMoveKeys &= ~MoveKey;
+}
+
+float3 FirstPersonCamera::GetMoveKeyDirection() const
+{
+    float3 MoveDirection = float3(0, 0, 0);
+    // clang-format off
+    if (m_HeldMoveKeys & MOVE_KEY_FORWARD)  MoveDirection.z += 1.0f;
+    if (m_HeldMoveKeys & MOVE_KEY_BACKWARD) MoveDirection.z -= 1.0f;
+    if (m_HeldMoveKeys & MOVE_KEY_RIGHT)    MoveDirection.x += 1.0f;
+    if (m_HeldMoveKeys & MOVE_KEY_LEFT)     MoveDirection.x -= 1.0f;
+    if (m_HeldMoveKeys & MOVE_KEY_UP)       MoveDirection.y += 1.0f;
+    if (m_HeldMoveKeys & MOVE_KEY_DOWN)     MoveDirection.y -= 1.0f;
+    // clang-format on
+
     // Normalize vector so if moving in 2 dirs (left & forward),
     // the camera doesn't move faster than if moving in 1 dir
     auto len = length(MoveDirection);
     if (len != 0.0)
         MoveDirection /= len;
 
-    MoveDirection *= m_fMoveSpeed;
+    return MoveDirection;
+}
 
-    m_fCurrentSpeed = length(MoveDirection);
+float2 FirstPersonCamera::GetWalkDirection() const
+{
+    float3 MoveDirection = GetMoveKeyDirection();
+    MoveDirection.y      = 0;
 
-    float3 PosDelta = MoveDirection * ElapsedTime;
+    const float4x4 YawRotation = (float4x4::RotationArbitrary(m_ReferenceUpAxis, m_fYawAngle) * GetReferenceRotiation()).Transpose();
 
-    m_PosDelta += PosDelta;
+    const float3 WorldDirection = MoveDirection * YawRotation;
+    const float2 WalkDirection{WorldDirection.x, WorldDirection.z};
+    const float  len = length(WalkDirection);
+    return len > 0 ? WalkDirection / len : WalkDirection;
+}
 
-    /*{
-        const auto& mouseState = Controller.GetMouseState();
+bool FirstPersonCamera::IsJumpHeld() const
+{
+    return (m_HeldMoveKeys & MOVE_KEY_UP) != 0;
+}
 
-        float MouseDeltaX = 0;
-        float MouseDeltaY = 0;
-        if (m_LastMouseState.PosX >= 0 && m_LastMouseState.PosY >= 0 &&
-            m_LastMouseState.ButtonFlags != MouseState::BUTTON_FLAG_NONE)
-        {
-            MouseDeltaX = mouseState.PosX - m_LastMouseState.PosX;
-            MouseDeltaY = mouseState.PosY - m_LastMouseState.PosY;
-        }
-        m_LastMouseState = mouseState;
+bool FirstPersonCamera::IsSneakHeld() const
+{
+    return (m_HeldMoveKeys & MOVE_KEY_DOWN) != 0;
+}
 
-        float fYawDelta   = MouseDeltaX * m_fRotationSpeed;
-        float fPitchDelta = MouseDeltaY * m_fRotationSpeed;
-        if (mouseState.ButtonFlags & MouseState::BUTTON_FLAG_LEFT)
-        {
-            m_fYawAngle += fYawDelta * -m_fHandness;
-            m_fPitchAngle += fPitchDelta * -m_fHandness;
-            m_fPitchAngle = std::max(m_fPitchAngle, -PI_F / 2.f);
-            m_fPitchAngle = std::min(m_fPitchAngle, +PI_F / 2.f);
-        }
-    }*/
+void FirstPersonCamera::Tick(float TickTime)
+{
+    const float3 MoveDirection = GetMoveKeyDirection() * m_fMoveSpeed;
+
+    m_fCurrentSpeed = length(MoveDirection);
+
+    // Movement follows the view direction at the time of the tick
+    const float4x4 WorldRotation = (float4x4::RotationArbitrary(m_ReferenceUpAxis, m_fYawAngle) *
+                                    float4x4::RotationArbitrary(m_ReferenceRightAxis, m_fPitchAngle) *
+                                    GetReferenceRotiation())
+                                       .Transpose();
+
+    m_Pos.Set(m_Pos.Curr + (MoveDirection * TickTime) * WorldRotation);
 }
 
 void FirstPersonCamera::UpdateMouse(float2 pos){
@@ -131,7 +148,7 @@ void FirstPersonCamera::UpdateMouse(float2 pos){
         m_fPitchAngle = std::min(m_fPitchAngle, +PI_F / 2.f);
 }
 
-void FirstPersonCamera::UpdateMat(){
+void FirstPersonCamera::UpdateMat(float TickAlpha){
 
     float4x4 ReferenceRotation = GetReferenceRotiation();
 
@@ -140,13 +157,11 @@ void FirstPersonCamera::UpdateMat(){
         ReferenceRotation;
     float4x4 WorldRotation = CameraRotation.Transpose();
 
-    float3 PosDeltaWorld = m_PosDelta * WorldRotation;
-    m_Pos += PosDeltaWorld;
-
-    m_ViewMatrix  = float4x4::Translation(-m_Pos) * CameraRotation;
-    m_WorldMatrix = WorldRotation * float4x4::Translation(m_Pos);
+    // Rotation is applied every frame for responsiveness, position is interpolated
+    m_RenderPos = m_Pos.Get(TickAlpha);
 
-    m_PosDelta = float3(.0f, .0f, .0f);
+    m_ViewMatrix  = float4x4::Translation(-m_RenderPos) * CameraRotation;
+    m_WorldMatrix = WorldRotation * float4x4::Translation(m_RenderPos);
 }
 
 float4x4 FirstPersonCamera::GetReferenceRotiation() const
@@ -188,7 +203,7 @@ void FirstPersonCamera::SetReferenceAxes(const float3& ReferenceRightAxis, const
 
 void FirstPersonCamera::SetLookAt(const float3& LookAt)
 {
-    float3 ViewDir = LookAt - m_Pos;
+    float3 ViewDir = LookAt - m_Pos.Curr;
 
     ViewDir = ViewDir * GetReferenceRotiation();
 
@@ -31,6 +31,7 @@
 //#include "InputController.hpp"
 #include "Graphics/GraphicsEngine/interface/GraphicsTypes.h"
 #include "BaseEngine.hpp"
+#include "SimulationClock.hpp"
 
 namespace Diligent
 {
@@ -38,12 +39,23 @@ namespace Diligent
 class FirstPersonCamera
 {
 public:
-    void Update(Key key, KeyState state, float ElapsedTime);
+    // Tracks held movement keys, movement itself happens in Tick()
+    void Update(Key key, KeyState state);
+    // Moves the camera by one simulation step
+    void Tick(float TickTime);
     void SetRotation(float Yaw, float Pitch);
     void SetLookAt(const float3& LookAt);
     void SetMoveSpeed(float MoveSpeed) { m_fMoveSpeed = MoveSpeed; }
     void SetRotationSpeed(float RotationSpeed) { m_fRotationSpeed = RotationSpeed; }
-    void SetPos(const float3& Pos) { m_Pos = Pos; }
+    void SetPos(const float3& Pos) { m_Pos.Reset(Pos); }
+    // Moves to a position found elsewhere, e.g. by player physics, instead of by Tick()
+    void MoveTo(const float3& Pos) { m_Pos.Set(Pos); }
+
+    // Held movement keys for walking: the horizontal direction in world space, which
+    // ignores the pitch and is unit length or zero, and the up and down keys
+    float2 GetWalkDirection() const;
+    bool   IsJumpHeld() const;
+    bool   IsSneakHeld() const;
 
     // AspectRatio = width / height accounting for surface pretransform
     // (i.e. logical width / logical height)
@@ -65,10 +77,14 @@ public:
     float3 GetWorldUp()    const { return float3(m_ViewMatrix._12, m_ViewMatrix._22, m_ViewMatrix._32); }
     float3 GetWorldAhead() const { return float3(m_ViewMatrix._13, m_ViewMatrix._23, m_ViewMatrix._33); }
     void UpdateMouse(float2 pos);
-    void UpdateMat();
+    // Builds the matrices at the position interpolated between the last two ticks
+    void UpdateMat(float TickAlpha);
     // clang-format on
 
-    float3 GetPos() const { return m_Pos; }
+    // Position after the last tick
+    float3 GetPos() const { return m_Pos.Curr; }
+    // Position the camera is rendered from
+    float3 GetRenderPos() const { return m_RenderPos; }
     float2 GetRot() const { return float2(m_fYawAngle, m_fPitchAngle);}
     float  GetCurrentSpeed() const { return m_fCurrentSpeed; }
 
@@ -92,6 +108,8 @@ public:
 
 protected:
     float4x4 GetReferenceRotiation() const;
+    // Camera-space direction of the held movement keys, unit length or zero
+    float3 GetMoveKeyDirection() const;
 
     ProjectionAttribs m_ProjAttribs;
 
@@ -101,7 +119,8 @@ protected:
     float3 m_ReferenceUpAxis    = float3{0, 1, 0};
     float3 m_ReferenceAheadAxis = float3{0, 0, 1};
 
-    float3 m_Pos;
+    Interpolated<float3> m_Pos;
+    float3               m_RenderPos;
 
     float4x4 m_ViewMatrix;
     float4x4 m_WorldMatrix;
@@ -116,7 +135,8 @@ protected:
     float m_fSuperSpeedUpScale = 1.f;
     float m_fHandness          = 1.f; // -1 - left handed
                                       // +1 - right handed
-    float3 m_PosDelta;
+    // MOVE_KEY bits of the movement keys currently held
+    Uint32 m_HeldMoveKeys = 0;
 };
 
 } // namespace Diligent
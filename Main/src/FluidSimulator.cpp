@@ -0,0 +1,216 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include <algorithm>
+
+#include "FluidSimulator.hpp"
+#include "ChunkMesher.hpp"
+
+namespace Diligent
+{
+
+namespace
+{
+
+// clang-format off
+const int3 HorizontalOffsets[4] = {{-1, 0, 0}, {1, 0, 0}, {0, 0, -1}, {0, 0, 1}};
+const int3 NeighbourOffsets[6]  = {{-1, 0, 0}, {1, 0, 0}, {0, -1, 0}, {0, 1, 0}, {0, 0, -1}, {0, 0, 1}};
+// clang-format on
+
+BlockId GetBlock(const World& Wrld, const int3& Pos)
+{
+    return Wrld.GetBlock(Pos.x, Pos.y, Pos.z);
+}
+
+// Fluid only flows into air of loaded chunks. Other fluids and every other block stop it.
+bool CanFlowInto(const World& Wrld, const int3& Pos)
+{
+    if (Pos.y < 0 || Pos.y >= Chunk::Height)
+        return false;
+    if (Wrld.GetChunk(World::BlockToChunk(Pos.x), World::BlockToChunk(Pos.z)) == nullptr)
+        return false;
+    return GetBlock(Wrld, Pos) == BLOCK_AIR;
+}
+
+} // namespace
+
+void FluidSimulator::OnBlockChanged(const World& Wrld, Int32 x, Int32 y, Int32 z)
+{
+    const int3 Pos{x, y, z};
+    Schedule(Wrld, Pos);
+    for (const int3& Offset : NeighbourOffsets)
+        Schedule(Wrld, Pos + Offset);
+}
+
+void FluidSimulator::Schedule(const World& Wrld, const int3& Pos)
+{
+    if (Pos.y < 0 || Pos.y >= Chunk::Height)
+        return;
+
+    const FLUID_TYPE Type = GetFluidType(GetBlock(Wrld, Pos));
+    if (Type == FLUID_NONE || !m_Queued.insert(PackBlockKey(Pos)).second)
+        return;
+
+    m_Wheel[(m_CurrentTick + GetTickDelay(Type)) % WheelSize].push_back(Pos);
+    m_PeakQueued = std::max(m_PeakQueued, m_Queued.size());
+}
+
+void FluidSimulator::CancelChunk(Int32 ChunkX, Int32 ChunkZ)
+{
+    for (auto& Slot : m_Wheel)
+    {
+        auto It = std::remove_if(Slot.begin(), Slot.end(), [&](const int3& Pos) {
+            return World::BlockToChunk(Pos.x) == ChunkX && World::BlockToChunk(Pos.z) == ChunkZ;
+        });
+        for (auto Removed = It; Removed != Slot.end(); ++Removed)
+            m_Queued.erase(PackBlockKey(*Removed));
+        Slot.erase(It, Slot.end());
+    }
+}
+
+void FluidSimulator::Tick(World& Wrld)
+{
+    m_ChangedBlocks.clear();
+    m_ChangedSectionKeys.clear();
+    m_ChangedSections.clear();
+
+    ++m_CurrentTick;
+
+    m_Due.clear();
+    std::swap(m_Due, m_Wheel[m_CurrentTick % WheelSize]);
+
+    const size_t NumUpdates = std::min(m_Due.size(), size_t{MaxUpdatesPerTick});
+    if (NumUpdates < m_Due.size())
+    {
+        auto& Next = m_Wheel[(m_CurrentTick + 1) % WheelSize];
+        Next.insert(Next.end(), m_Due.begin() + NumUpdates, m_Due.end());
+    }
+
+    for (size_t i = 0; i < NumUpdates; ++i)
+    {
+        // Unqueued first so that the update can queue the block again
+        m_Queued.erase(PackBlockKey(m_Due[i]));
+        Update(Wrld, m_Due[i]);
+    }
+    m_LastUpdateCount = static_cast<Uint32>(NumUpdates);
+}
+
+void FluidSimulator::Update(World& Wrld, const int3& Pos)
+{
+    const BlockId    Id   = GetBlock(Wrld, Pos);
+    const FLUID_TYPE Type = GetFluidType(Id);
+    if (Type == FLUID_NONE)
+        return;
+
+    const Uint32 LevelDrop = Type == FLUID_LAVA ? 2 : 1;
+
+    Uint32 Level = GetFluidLevel(Id);
+    if (Level != FluidSourceLevel)
+    {
+        // Flowing fluid takes its level from the strongest fluid feeding it, and dries
+        // up when nothing does
+        constexpr Uint32 DriedUp = FluidFallingLevel + 1;
+
+        Uint32 NewLevel = DriedUp;
+        if (Pos.y + 1 < Chunk::Height && GetFluidType(GetBlock(Wrld, Pos + int3{0, 1, 0})) == Type)
+        {
+            NewLevel = FluidFallingLevel;
+        }
+        else
+        {
+            Uint32 NumSources = 0;
+            for (const int3& Offset : HorizontalOffsets)
+            {
+                const BlockId Neighbour = GetBlock(Wrld, Pos + Offset);
+                if (GetFluidType(Neighbour) != Type)
+                    continue;
+
+                const Uint32 NeighbourLevel = GetFluidLevel(Neighbour);
+                NumSources += NeighbourLevel == FluidSourceLevel ? 1 : 0;
+                NewLevel = std::min(NewLevel, (NeighbourLevel == FluidFallingLevel ? 0 : NeighbourLevel) + LevelDrop);
+            }
+            if (NewLevel > FluidMaxLevel)
+                NewLevel = DriedUp;
+
+            if (Type == FLUID_WATER && NumSources >= 2 && Pos.y > 0)
+            {
+                const BlockId Below = GetBlock(Wrld, Pos - int3{0, 1, 0});
+                if (IsOpaqueBlock(Below) || Below == BLOCK_WATER)
+                    NewLevel = FluidSourceLevel;
+            }
+        }
+
+        if (NewLevel == DriedUp)
+        {
+            SetFluidBlock(Wrld, Pos, BLOCK_AIR);
+            return;
+        }
+        if (NewLevel != Level)
+        {
+            SetFluidBlock(Wrld, Pos, GetFluidBlock(Type, NewLevel));
+            Level = NewLevel;
+        }
+    }
+
+    const int3 BelowPos = Pos - int3{0, 1, 0};
+    if (CanFlowInto(Wrld, BelowPos))
+    {
+        SetFluidBlock(Wrld, BelowPos, GetFluidBlock(Type, FluidFallingLevel));
+        return;
+    }
+
+    // Flowing fluid only spreads sideways once it rests on something solid. Sources
+    // always spread.
+    if (Level != FluidSourceLevel && Pos.y > 0 && GetFluidType(GetBlock(Wrld, BelowPos)) != FLUID_NONE)
+        return;
+
+    const Uint32 SpreadLevel = Level == FluidFallingLevel ? 1 : Level + LevelDrop;
+    if (SpreadLevel > FluidMaxLevel)
+        return;
+
+    for (const int3& Offset : HorizontalOffsets)
+    {
+        if (CanFlowInto(Wrld, Pos + Offset))
+            SetFluidBlock(Wrld, Pos + Offset, GetFluidBlock(Type, SpreadLevel));
+    }
+}
+
+void FluidSimulator::SetFluidBlock(World& Wrld, const int3& Pos, BlockId Id)
+{
+    if (!Wrld.SetBlock(Pos.x, Pos.y, Pos.z, Id))
+        return;
+
+    m_ChangedBlocks.push_back(Pos);
+    OnBlockChanged(Wrld, Pos.x, Pos.y, Pos.z);
+
+    ChunkMesher::ForEachSectionSampling(Pos, [this](const int3& SectionPos) {
+        if (m_ChangedSectionKeys.insert(World::PackSectionKey(SectionPos)).second)
+            m_ChangedSections.push_back(SectionPos);
+    });
+}
+
+} // namespace Diligent
@@ -0,0 +1,115 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <array>
+#include <unordered_set>
+#include <vector>
+
+#include "World.hpp"
+
+namespace Diligent
+{
+
+// Water and lava flow.
+//
+// Only blocks that may change are simulated: a fluid block is queued for an update
+// when it or one of its six neighbours changes, and an update that changes nothing
+// queues nothing, so still water costs nothing however much of it is loaded. Updates
+// are scheduled a fluid-dependent number of ticks ahead on a timing wheel, and a block
+// is queued at most once at a time.
+//
+// Flow follows the console editions: sources spread flowing fluid that loses a level
+// per block (two for lava) and falls straight down wherever it can, and water between
+// two sources on solid ground becomes a source itself. Flowing fluid spreads to all
+// open sides instead of searching for the nearest drop.
+class FluidSimulator
+{
+public:
+    // Ticks between a change and the update of the fluid next to it
+    static constexpr Uint32 WaterTickDelay = 5;
+    static constexpr Uint32 LavaTickDelay  = 30;
+
+    // Updates due in one tick past this many are carried over to the next one
+    static constexpr Uint32 MaxUpdatesPerTick = 65536;
+
+    static Uint32 GetTickDelay(FLUID_TYPE Type) { return Type == FLUID_LAVA ? LavaTickDelay : WaterTickDelay; }
+
+    // Wakes the fluid at and around a block that has already been changed in the world
+    void OnBlockChanged(const World& Wrld, Int32 x, Int32 y, Int32 z);
+
+    // Drops the queued updates of a chunk that is being unloaded
+    void CancelChunk(Int32 ChunkX, Int32 ChunkZ);
+
+    // Advances one tick and runs the updates that are due, changing the world
+    void Tick(World& Wrld);
+
+    // Blocks changed by the last Tick()
+    const std::vector<int3>& GetChangedBlocks() const { return m_ChangedBlocks; }
+
+    // Sections whose meshes the last Tick() changed, each listed once. Blocks on the
+    // edge of a section also change the meshes of the sections they touch.
+    const std::vector<int3>& GetChangedSections() const { return m_ChangedSections; }
+
+    Uint64 GetTickCount() const { return m_CurrentTick; }
+    size_t GetQueuedCount() const { return m_Queued.size(); }
+    size_t GetPeakQueuedCount() const { return m_PeakQueued; }
+    Uint32 GetLastUpdateCount() const { return m_LastUpdateCount; }
+
+private:
+    // Longer than the longest delay, so that a slot is never reused before it is due
+    static constexpr Uint32 WheelSize = 32;
+    static_assert(LavaTickDelay < WheelSize && WaterTickDelay < WheelSize, "Tick delays must fit in the wheel");
+
+    // Unique key of a block: 28 bits for x and z and 8 bits for y
+    static Uint64 PackBlockKey(const int3& Pos)
+    {
+        return World::PackSectionKey(Pos);
+    }
+
+    void Schedule(const World& Wrld, const int3& Pos);
+    void Update(World& Wrld, const int3& Pos);
+    void SetFluidBlock(World& Wrld, const int3& Pos, BlockId Id);
+
+private:
+    std::array<std::vector<int3>, WheelSize> m_Wheel;
+    std::unordered_set<Uint64>               m_Queued;
+
+    // Reused by Tick()
+    std::vector<int3> m_Due;
+
+    std::vector<int3>          m_ChangedBlocks;
+    std::unordered_set<Uint64> m_ChangedSectionKeys;
+    std::vector<int3>          m_ChangedSections;
+
+    Uint64 m_CurrentTick     = 0;
+    size_t m_PeakQueued      = 0;
+    Uint32 m_LastUpdateCount = 0;
+};
+
+} // namespace Diligent
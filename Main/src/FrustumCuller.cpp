@@ -0,0 +1,187 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+#include "FrustumCuller.hpp"
+
+#include "CpuFeatures.hpp"
+#include "Platforms/interface/PlatformMisc.hpp"
+
+#if SIMD_X86
+#    include <immintrin.h>
+#endif
+
+namespace Diligent
+{
+
+Uint32 FrustumCuller::Add(const BoundBox& Box)
+{
+    const Uint32 Index = GetCount();
+    m_CenterX.push_back(0);
+    m_CenterY.push_back(0);
+    m_CenterZ.push_back(0);
+    m_SizeX.push_back(0);
+    m_SizeY.push_back(0);
+    m_SizeZ.push_back(0);
+    Update(Index, Box);
+    return Index;
+}
+
+void FrustumCuller::Update(Uint32 Index, const BoundBox& Box)
+{
+    VERIFY_EXPR(Index < GetCount());
+    const float3 Center = Box.Max + Box.Min;
+    const float3 Size   = Box.Max - Box.Min;
+    m_CenterX[Index]    = Center.x;
+    m_CenterY[Index]    = Center.y;
+    m_CenterZ[Index]    = Center.z;
+    m_SizeX[Index]      = Size.x;
+    m_SizeY[Index]      = Size.y;
+    m_SizeZ[Index]      = Size.z;
+}
+
+Uint32 FrustumCuller::Remove(Uint32 Index)
+{
+    VERIFY_EXPR(Index < GetCount());
+    const Uint32 Last = GetCount() - 1;
+    for (auto* pArray : {&m_CenterX, &m_CenterY, &m_CenterZ, &m_SizeX, &m_SizeY, &m_SizeZ})
+    {
+        (*pArray)[Index] = pArray->back();
+        pArray->pop_back();
+    }
+    return Last;
+}
+
+void FrustumCuller::Clear()
+{
+    for (auto* pArray : {&m_CenterX, &m_CenterY, &m_CenterZ, &m_SizeX, &m_SizeY, &m_SizeZ})
+        pArray->clear();
+}
+
+Uint32 FrustumCuller::Cull(const ViewFrustum& Frustum, Uint32* pVisibleIndices) const
+{
+    return GetCpuFeatures().AVX2 ?
+        CullAVX2(Frustum, pVisibleIndices) :
+        CullScalar(Frustum, pVisibleIndices);
+}
+
+Uint32 FrustumCuller::CullScalar(const ViewFrustum& Frustum, Uint32* pVisibleIndices) const
+{
+    return CullScalar(Frustum, 0, pVisibleIndices);
+}
+
+Uint32 FrustumCuller::CullScalar(const ViewFrustum& Frustum, Uint32 First, Uint32* pVisibleIndices) const
+{
+    const Uint32 Count      = GetCount();
+    Uint32       NumVisible = 0;
+    for (Uint32 i = First; i < Count; ++i)
+    {
+        bool IsVisible = true;
+        for (Uint32 p = 0; p < ViewFrustum::NUM_PLANES && IsVisible; ++p)
+        {
+            const Plane3D& Plane = Frustum.GetPlane(static_cast<ViewFrustum::PLANE_IDX>(p));
+
+            // Same as GetBoxVisibilityAgainstPlane()
+            const float DistanceToCenter = (m_CenterX[i] * Plane.Normal.x + m_CenterY[i] * Plane.Normal.y + m_CenterZ[i] * Plane.Normal.z) * 0.5f + Plane.Distance;
+            const float ProjHalfLen      = (m_SizeX[i] * std::abs(Plane.Normal.x) + m_SizeY[i] * std::abs(Plane.Normal.y) + m_SizeZ[i] * std::abs(Plane.Normal.z)) * 0.5f;
+
+            IsVisible = !(DistanceToCenter < -ProjHalfLen);
+        }
+        pVisibleIndices[NumVisible] = i;
+        NumVisible += IsVisible ? 1 : 0;
+    }
+    return NumVisible;
+}
+
+SIMD_TARGET_AVX2 Uint32 FrustumCuller::CullAVX2(const ViewFrustum& Frustum, Uint32* pVisibleIndices) const
+{
+#if SIMD_X86
+    VERIFY(GetCpuFeatures().AVX2, "AVX2 is not supported by this CPU");
+
+    const __m256 Half     = _mm256_set1_ps(0.5f);
+    const __m256 SignMask = _mm256_set1_ps(-0.f);
+
+    __m256 Normals[ViewFrustum::NUM_PLANES][3];
+    __m256 AbsNormals[ViewFrustum::NUM_PLANES][3];
+    __m256 Distances[ViewFrustum::NUM_PLANES];
+    for (Uint32 p = 0; p < ViewFrustum::NUM_PLANES; ++p)
+    {
+        const Plane3D& Plane = Frustum.GetPlane(static_cast<ViewFrustum::PLANE_IDX>(p));
+        for (Uint32 c = 0; c < 3; ++c)
+        {
+            Normals[p][c]    = _mm256_set1_ps(Plane.Normal[c]);
+            AbsNormals[p][c] = _mm256_set1_ps(std::abs(Plane.Normal[c]));
+        }
+        Distances[p] = _mm256_set1_ps(Plane.Distance);
+    }
+
+    const Uint32 Count      = GetCount();
+    const Uint32 SimdCount  = Count & ~7u;
+    Uint32       NumVisible = 0;
+    for (Uint32 i = 0; i < SimdCount; i += 8)
+    {
+        const __m256 CenterX = _mm256_loadu_ps(&m_CenterX[i]);
+        const __m256 CenterY = _mm256_loadu_ps(&m_CenterY[i]);
+        const __m256 CenterZ = _mm256_loadu_ps(&m_CenterZ[i]);
+        const __m256 SizeX   = _mm256_loadu_ps(&m_SizeX[i]);
+        const __m256 SizeY   = _mm256_loadu_ps(&m_SizeY[i]);
+        const __m256 SizeZ   = _mm256_loadu_ps(&m_SizeZ[i]);
+
+        __m256 Outside = _mm256_setzero_ps();
+        for (Uint32 p = 0; p < ViewFrustum::NUM_PLANES; ++p)
+        {
+            // Multiplies and adds are kept separate and in the scalar order so that
+            // the results are bit-exact with CullScalar()
+            __m256 DistanceToCenter = _mm256_mul_ps(CenterX, Normals[p][0]);
+            DistanceToCenter        = _mm256_add_ps(DistanceToCenter, _mm256_mul_ps(CenterY, Normals[p][1]));
+            DistanceToCenter        = _mm256_add_ps(DistanceToCenter, _mm256_mul_ps(CenterZ, Normals[p][2]));
+            DistanceToCenter        = _mm256_add_ps(_mm256_mul_ps(DistanceToCenter, Half), Distances[p]);
+
+            __m256 ProjHalfLen = _mm256_mul_ps(SizeX, AbsNormals[p][0]);
+            ProjHalfLen        = _mm256_add_ps(ProjHalfLen, _mm256_mul_ps(SizeY, AbsNormals[p][1]));
+            ProjHalfLen        = _mm256_add_ps(ProjHalfLen, _mm256_mul_ps(SizeZ, AbsNormals[p][2]));
+            ProjHalfLen        = _mm256_mul_ps(ProjHalfLen, Half);
+
+            Outside = _mm256_or_ps(Outside, _mm256_cmp_ps(DistanceToCenter, _mm256_xor_ps(ProjHalfLen, SignMask), _CMP_LT_OQ));
+            // Neighbouring sections tend to be rejected by the same side plane
+            if (_mm256_movemask_ps(Outside) == 0xFF)
+                break;
+        }
+
+        Uint32 VisibleMask = ~static_cast<Uint32>(_mm256_movemask_ps(Outside)) & 0xFFu;
+        while (VisibleMask != 0)
+        {
+            pVisibleIndices[NumVisible++] = i + PlatformMisc::GetLSB(VisibleMask);
+            VisibleMask &= VisibleMask - 1;
+        }
+    }
+
+    return NumVisible + CullScalar(Frustum, SimdCount, pVisibleIndices + NumVisible);
+#else
+    return CullScalar(Frustum, pVisibleIndices);
+#endif
+}
+
+} // namespace Diligent
@@ -0,0 +1,79 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+#pragma once
+
+#include <vector>
+
+#include "Common/interface/AdvancedMath.hpp"
+
+namespace Diligent
+{
+
+// Frustum culling of many axis-aligned boxes.
+//
+// Boxes are stored as structure of arrays (Max + Min and Max - Min per axis), so the
+// AVX2 kernel tests eight boxes against a plane with a handful of instructions. Both
+// kernels evaluate exactly the same expression as GetBoxVisibility() from AdvancedMath,
+// in the same order, so their results agree bit for bit.
+class FrustumCuller
+{
+public:
+    // Returns the index of the new box
+    Uint32 Add(const BoundBox& Box);
+
+    void Update(Uint32 Index, const BoundBox& Box);
+
+    // Removes the box by moving the last one into its slot.
+    // Returns the old index of the moved box, which equals Index when the last box was removed.
+    Uint32 Remove(Uint32 Index);
+
+    void Clear();
+
+    Uint32 GetCount() const { return static_cast<Uint32>(m_CenterX.size()); }
+
+    // Writes indices of the boxes that are not completely outside the frustum to
+    // pVisibleIndices, which must have room for GetCount() entries, and returns their
+    // number. Uses the AVX2 kernel when the CPU supports it.
+    Uint32 Cull(const ViewFrustum& Frustum, Uint32* pVisibleIndices) const;
+
+    Uint32 CullScalar(const ViewFrustum& Frustum, Uint32* pVisibleIndices) const;
+    // Must only be called when GetCpuFeatures().AVX2 is set
+    Uint32 CullAVX2(const ViewFrustum& Frustum, Uint32* pVisibleIndices) const;
+
+private:
+    Uint32 CullScalar(const ViewFrustum& Frustum, Uint32 First, Uint32* pVisibleIndices) const;
+
+    // Twice the center and the size of each box, the values GetBoxVisibility() works with
+    std::vector<float> m_CenterX;
+    std::vector<float> m_CenterY;
+    std::vector<float> m_CenterZ;
+    std::vector<float> m_SizeX;
+    std::vector<float> m_SizeY;
+    std::vector<float> m_SizeZ;
+};
+
+} // namespace Diligent
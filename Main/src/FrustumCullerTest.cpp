@@ -0,0 +1,162 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+// Headless frustum culling tests.
+//
+// The section culler must keep exactly the boxes GetBoxVisibility() keeps, or sections
+// pop in and out at the screen edges. Culls random boxes, boxes straddling the frustum
+// planes and degenerate boxes from random views with the scalar and the AVX2 kernel, at
+// counts that are and are not a multiple of eight, and after boxes were updated and
+// removed. Prints the cases that differed and exits with a non-zero code if any did.
+//
+//     FrustumCullerTest
+
+#include <cstdio>
+#include <vector>
+
+#include "CpuFeatures.hpp"
+#include "FrustumCuller.hpp"
+#include "Common/interface/FastRand.hpp"
+
+using namespace Diligent;
+
+namespace
+{
+
+ViewFrustum GetRandomFrustum(FastRandFloat& Rand)
+{
+    const float3   CameraPos{Rand() * 512.f - 256.f, Rand() * 256.f, Rand() * 512.f - 256.f};
+    const float    Yaw   = Rand() * 2.f * PI_F;
+    const float    Pitch = (Rand() - 0.5f) * PI_F;
+    const float4x4 View  = float4x4::Translation(-CameraPos) * float4x4::RotationY(-Yaw) * float4x4::RotationX(Pitch);
+    const float4x4 Proj  = float4x4::Projection(PI_F / 8.f + Rand() * PI_F / 2.f, 0.5f + Rand() * 2.f, 0.05f + Rand(), 64.f + Rand() * 1000.f, false);
+
+    ViewFrustum Frustum;
+    ExtractViewFrustumPlanesFromMatrix(View * Proj, Frustum, false);
+    return Frustum;
+}
+
+// Boxes anywhere around the camera, boxes centered on a frustum plane and boxes of zero
+// size, in random order
+std::vector<BoundBox> GetRandomBoxes(FastRandFloat& Rand, const ViewFrustum& Frustum, Uint32 Count)
+{
+    std::vector<BoundBox> Boxes;
+    for (Uint32 i = 0; i < Count; ++i)
+    {
+        float3 Center{Rand() * 2048.f - 1024.f, Rand() * 1024.f - 512.f, Rand() * 2048.f - 1024.f};
+        float3 HalfSize{Rand() * 32.f, Rand() * 32.f, Rand() * 32.f};
+        switch (static_cast<Uint32>(Rand() * 3.f) % 3)
+        {
+            case 0:
+                break;
+
+            case 1:
+            {
+                // Project the center onto a plane, the planes are not normalized
+                const Uint32   PlaneIdx = static_cast<Uint32>(Rand() * static_cast<float>(ViewFrustum::NUM_PLANES)) % ViewFrustum::NUM_PLANES;
+                const Plane3D& Plane    = Frustum.GetPlane(static_cast<ViewFrustum::PLANE_IDX>(PlaneIdx));
+                Center -= Plane.Normal * ((dot(Center, Plane.Normal) + Plane.Distance) / dot(Plane.Normal, Plane.Normal));
+                break;
+            }
+
+            case 2:
+                HalfSize = float3{0, 0, 0};
+                break;
+        }
+        Boxes.push_back(BoundBox{Center - HalfSize, Center + HalfSize});
+    }
+    return Boxes;
+}
+
+} // namespace
+
+int main()
+{
+    const bool HasAVX2 = GetCpuFeatures().AVX2;
+    if (!HasAVX2)
+        std::printf("AVX2 is not supported by this CPU, skipped\n");
+
+    Uint32 NumChecks = 0;
+    Uint32 NumFailed = 0;
+    auto   Check     = [&](const char* Kernel, Uint32 View, Uint32 Count, const std::vector<Uint32>& Visible, Uint32 NumVisible, const std::vector<Uint32>& Reference) {
+        ++NumChecks;
+        bool Passed = NumVisible == Reference.size();
+        for (Uint32 i = 0; i < NumVisible && Passed; ++i)
+            Passed = Visible[i] == Reference[i];
+        if (!Passed)
+        {
+            ++NumFailed;
+            std::printf("FAILED: %s, view %u, %u boxes: %u visible, %u expected\n", Kernel, View, Count, NumVisible, static_cast<Uint32>(Reference.size()));
+        }
+    };
+
+    FastRandFloat Rand{1234, 0.f, 1.f};
+    for (Uint32 View = 0; View < 64; ++View)
+    {
+        const ViewFrustum Frustum = GetRandomFrustum(Rand);
+        for (Uint32 Count : {0u, 1u, 7u, 8u, 9u, 15u, 16u, 17u, 63u, 1000u, 4099u})
+        {
+            std::vector<BoundBox> Boxes = GetRandomBoxes(Rand, Frustum, Count);
+
+            FrustumCuller Culler;
+            for (const BoundBox& Box : Boxes)
+                Culler.Add(Box);
+
+            // Move some boxes and remove others, the way sections are loaded and unloaded
+            for (Uint32 i = 0; i < Count / 4; ++i)
+            {
+                const Uint32 Index = static_cast<Uint32>(Rand() * Culler.GetCount()) % Culler.GetCount();
+                if (i % 2 == 0)
+                {
+                    Boxes[Index] = GetRandomBoxes(Rand, Frustum, 1)[0];
+                    Culler.Update(Index, Boxes[Index]);
+                }
+                else
+                {
+                    const Uint32 Moved = Culler.Remove(Index);
+                    Boxes[Index]       = Boxes[Moved];
+                    Boxes.pop_back();
+                }
+            }
+
+            std::vector<Uint32> Reference;
+            for (Uint32 i = 0; i < Boxes.size(); ++i)
+            {
+                if (GetBoxVisibility(Frustum, Boxes[i]) != BoxVisibility::Invisible)
+                    Reference.push_back(i);
+            }
+
+            std::vector<Uint32> Visible(Culler.GetCount());
+            Check("scalar", View, Culler.GetCount(), Visible, Culler.CullScalar(Frustum, Visible.data()), Reference);
+            if (HasAVX2)
+                Check("AVX2", View, Culler.GetCount(), Visible, Culler.CullAVX2(Frustum, Visible.data()), Reference);
+        }
+    }
+
+    std::printf("%u of %u frustum culling checks passed\n", NumChecks - NumFailed, NumChecks);
+    return NumFailed == 0 ? 0 : 1;
+}
@@ -0,0 +1,384 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+#include "GenerationScheduler.hpp"
+
+#include <algorithm>
+
+#include "LightEngine.hpp"
+#include "RegionFile.hpp"
+#include "Common/interface/Timer.hpp"
+
+namespace Diligent
+{
+
+GenerationScheduler::GenerationScheduler(const WorldGenerator& Generator, Uint32 NumThreads, RegionStorage* pStorage) :
+    GenerationScheduler{Generator, CreateThreadPool(ThreadPoolCreateInfo{std::max(NumThreads, 1u)}), NumThreads, pStorage}
+{
+    m_OwnsThreadPool = true;
+}
+
+GenerationScheduler::GenerationScheduler(const WorldGenerator& Generator, IThreadPool* pThreadPool, Uint32 NumThreads, RegionStorage* pStorage) :
+    m_Generator{Generator},
+    m_pStorage{pStorage},
+    m_NumThreads{std::max(NumThreads, 1u)},
+    m_pThreadPool{pThreadPool}
+{
+    VERIFY_EXPR(m_pThreadPool);
+}
+
+GenerationScheduler::~GenerationScheduler()
+{
+    // Jobs that have not started yet are dropped, running ones are waited for. The pool
+    // may be shared, so only the scheduler's own jobs are.
+    for (auto& It : m_Chunks)
+    {
+        if (It.second->pTask && !m_pThreadPool->RemoveTask(It.second->pTask))
+            It.second->pTask->WaitForCompletion();
+    }
+    if (m_OwnsThreadPool)
+        m_pThreadPool->StopThreads();
+}
+
+GenerationScheduler::ChunkEntry& GenerationScheduler::GetOrCreateEntry(Int32 ChunkX, Int32 ChunkZ)
+{
+    auto& pEntry = m_Chunks[World::PackChunkKey(ChunkX, ChunkZ)];
+    if (!pEntry)
+    {
+        pEntry    = std::make_unique<ChunkEntry>();
+        pEntry->X = ChunkX;
+        pEntry->Z = ChunkZ;
+    }
+    return *pEntry;
+}
+
+GenerationScheduler::ChunkEntry* GenerationScheduler::FindEntry(Int32 ChunkX, Int32 ChunkZ)
+{
+    auto It = m_Chunks.find(World::PackChunkKey(ChunkX, ChunkZ));
+    return It != m_Chunks.end() ? It->second.get() : nullptr;
+}
+
+const GenerationScheduler::ChunkEntry* GenerationScheduler::FindEntry(Int32 ChunkX, Int32 ChunkZ) const
+{
+    auto It = m_Chunks.find(World::PackChunkKey(ChunkX, ChunkZ));
+    return It != m_Chunks.end() ? It->second.get() : nullptr;
+}
+
+void GenerationScheduler::RequestChunk(Int32 ChunkX, Int32 ChunkZ)
+{
+    ChunkEntry& Entry = GetOrCreateEntry(ChunkX, ChunkZ);
+    Entry.IsRequested = true;
+    // Recounted in Update(), kept up to date here so that HasPendingWork() sees the request
+    m_NumPending += Entry.Target < CHUNK_STATUS_LIGHT ? 1 : 0;
+    RaiseTarget(Entry, CHUNK_STATUS_LIGHT);
+}
+
+bool GenerationScheduler::IsRequested(Int32 ChunkX, Int32 ChunkZ) const
+{
+    const ChunkEntry* pEntry = FindEntry(ChunkX, ChunkZ);
+    return pEntry != nullptr && pEntry->IsRequested;
+}
+
+CHUNK_STATUS GenerationScheduler::GetStatus(Int32 ChunkX, Int32 ChunkZ) const
+{
+    const ChunkEntry* pEntry = FindEntry(ChunkX, ChunkZ);
+    return pEntry != nullptr ? pEntry->Status : CHUNK_STATUS_EMPTY;
+}
+
+bool GenerationScheduler::CanUnload(Int32 ChunkX, Int32 ChunkZ) const
+{
+    const ChunkEntry* pEntry = FindEntry(ChunkX, ChunkZ);
+    return pEntry == nullptr || (!pEntry->IsRunning && pEntry->NumReaders == 0);
+}
+
+void GenerationScheduler::OnChunkUnloaded(Int32 ChunkX, Int32 ChunkZ)
+{
+    VERIFY(CanUnload(ChunkX, ChunkZ), "Chunk is still in use by generation jobs");
+    m_Chunks.erase(World::PackChunkKey(ChunkX, ChunkZ));
+}
+
+void GenerationScheduler::DropDistantChunks(Int32 CenterX, Int32 CenterZ, Int32 Radius)
+{
+    for (auto It = m_Chunks.begin(); It != m_Chunks.end();)
+    {
+        const ChunkEntry& Entry = *It->second;
+        // Chunks in the world are unloaded through OnChunkUnloaded()
+        const bool IsDropped = !Entry.IsInWorld && !Entry.IsRunning && Entry.NumReaders == 0 &&
+            (std::abs(Entry.X - CenterX) > Radius || std::abs(Entry.Z - CenterZ) > Radius);
+        if (IsDropped)
+            It = m_Chunks.erase(It);
+        else
+            ++It;
+    }
+}
+
+void GenerationScheduler::RaiseTarget(ChunkEntry& Entry, CHUNK_STATUS Target)
+{
+    Entry.Target = std::max(Entry.Target, Target);
+}
+
+bool GenerationScheduler::AreNeighboursReady(const ChunkEntry& Entry, CHUNK_STATUS Status)
+{
+    bool IsReady = true;
+    for (Int32 dz = -1; dz <= 1; ++dz)
+    {
+        for (Int32 dx = -1; dx <= 1; ++dx)
+        {
+            if (dx == 0 && dz == 0)
+                continue;
+
+            ChunkEntry& Neighbour = GetOrCreateEntry(Entry.X + dx, Entry.Z + dz);
+            RaiseTarget(Neighbour, Status);
+            IsReady = IsReady && Neighbour.Status >= Status;
+        }
+    }
+    return IsReady;
+}
+
+float GenerationScheduler::ComputePriority(const ChunkEntry& Entry) const
+{
+    const float dx = (static_cast<float>(Entry.X) + 0.5f) * 16.f - m_FocusPos.x;
+    const float dz = (static_cast<float>(Entry.Z) + 0.5f) * 16.f - m_FocusPos.z;
+    // The thread pool runs higher priorities first
+    return -std::sqrt(dx * dx + dz * dz);
+}
+
+void GenerationScheduler::AddStageTime(CHUNK_STATUS Stage, double Seconds)
+{
+    m_StageNanoseconds[Stage].fetch_add(static_cast<Uint64>(Seconds * 1e9), std::memory_order_relaxed);
+    m_StageCounts[Stage].fetch_add(1, std::memory_order_relaxed);
+}
+
+double GenerationScheduler::GetStageTime(CHUNK_STATUS Stage) const
+{
+    return static_cast<double>(m_StageNanoseconds[Stage].load(std::memory_order_relaxed)) * 1e-9;
+}
+
+Uint32 GenerationScheduler::GetStageCount(CHUNK_STATUS Stage) const
+{
+    return m_StageCounts[Stage].load(std::memory_order_relaxed);
+}
+
+void GenerationScheduler::StartJob(ChunkEntry& Entry, World& Wrld)
+{
+    VERIFY_EXPR(!Entry.IsRunning && Entry.Status < Entry.Target);
+
+    if (Entry.Status == CHUNK_STATUS_EMPTY && m_pStorage != nullptr)
+    {
+        // Saved chunks hold final blocks and only need light
+        auto pChunk = std::make_unique<Chunk>(Entry.X, Entry.Z);
+        if (m_pStorage->LoadChunk(*pChunk))
+        {
+            Entry.Heightmap.Compute(*pChunk);
+            Entry.IsInWorld = Wrld.AddChunk(std::move(pChunk)) != nullptr;
+            Entry.Status = CHUNK_STATUS_FEATURES;
+            return;
+        }
+    }
+
+    // Run as many stages as possible without waiting for the neighbours again
+    const CHUNK_STATUS FirstStage = static_cast<CHUNK_STATUS>(Entry.Status + 1);
+    CHUNK_STATUS       LastStage  = FirstStage;
+    while (LastStage + 1 <= Entry.Target && LastStage + 1 < CHUNK_STATUS_LIGHT && !StageNeedsNeighbours(static_cast<CHUNK_STATUS>(LastStage + 1)))
+        LastStage = static_cast<CHUNK_STATUS>(LastStage + 1);
+    // Blocks are kept dense in the job until the carver stage encodes them
+    VERIFY_EXPR(FirstStage > CHUNK_STATUS_CARVERS || LastStage >= CHUNK_STATUS_CARVERS);
+
+    WorldGenerator::HeightmapNeighbourhood Heightmaps{};
+    if (StageNeedsNeighbours(FirstStage))
+    {
+        for (Int32 dz = -1; dz <= 1; ++dz)
+        {
+            for (Int32 dx = -1; dx <= 1; ++dx)
+            {
+                ChunkEntry* pNeighbour = FindEntry(Entry.X + dx, Entry.Z + dz);
+                VERIFY_EXPR(pNeighbour != nullptr);
+                ++pNeighbour->NumReaders;
+                Heightmaps[(dz + 1) * 3 + (dx + 1)] = &pNeighbour->Heightmap;
+            }
+        }
+    }
+
+    Entry.IsRunning = true;
+    ++m_NumRunningJobs;
+
+    ChunkEntry* pEntry = &Entry;
+    Entry.pTask        = EnqueueAsyncWork(
+        m_pThreadPool,
+        [this, pEntry, LastStage, Heightmaps](Uint32 /*ThreadId*/) {
+            RunJob(*pEntry, LastStage, Heightmaps);
+        },
+        ComputePriority(Entry));
+}
+
+void GenerationScheduler::RunJob(ChunkEntry& Entry, CHUNK_STATUS LastStage, const WorldGenerator::HeightmapNeighbourhood& Heightmaps)
+{
+    thread_local std::vector<BlockId> Blocks(WorldGenerator::ChunkVolume);
+
+    Timer Tmr;
+    for (Uint32 Stage = Entry.Status + 1u; Stage <= LastStage; ++Stage)
+    {
+        Tmr.Restart();
+        switch (Stage)
+        {
+            case CHUNK_STATUS_NOISE:
+                m_Generator.GenerateNoise(Entry.X, Entry.Z, Blocks.data());
+                break;
+
+            case CHUNK_STATUS_SURFACE:
+                m_Generator.ApplySurface(Entry.X, Entry.Z, Blocks.data());
+                break;
+
+            case CHUNK_STATUS_CARVERS:
+                m_Generator.Carve(Entry.X, Entry.Z, Blocks.data());
+                Entry.Heightmap.Compute(Blocks.data());
+                Entry.pChunk = std::make_unique<Chunk>(Entry.X, Entry.Z);
+                for (Int32 s = 0; s < Chunk::NumSections; ++s)
+                    Entry.pChunk->GetSection(s).Encode(Blocks.data() + s * ChunkSection::Volume);
+                break;
+
+            case CHUNK_STATUS_FEATURES:
+                m_Generator.PlaceFeatures(*Entry.pChunk, Heightmaps);
+                break;
+
+            default:
+                UNEXPECTED("Stage ", Stage, " does not run on worker threads");
+        }
+        AddStageTime(static_cast<CHUNK_STATUS>(Stage), Tmr.GetElapsedTime());
+    }
+
+    std::lock_guard<std::mutex> Lock{m_CompletedMtx};
+    m_CompletedJobs.push_back({World::PackChunkKey(Entry.X, Entry.Z), LastStage, Heightmaps[0] != nullptr});
+}
+
+void GenerationScheduler::Update(World& Wrld, LightEngine& Light, const float3& FocusPos, Uint32 MaxLitChunks, Uint32 MaxLoads)
+{
+    m_FocusPos = FocusPos;
+    m_CompletedChunks.clear();
+
+    std::deque<CompletedJob> CompletedJobs;
+    {
+        std::lock_guard<std::mutex> Lock{m_CompletedMtx};
+        CompletedJobs.swap(m_CompletedJobs);
+    }
+    for (const CompletedJob& Job : CompletedJobs)
+    {
+        // Entries are never dropped while their job runs
+        ChunkEntry& Entry = *m_Chunks.at(Job.Key);
+        Entry.IsRunning   = false;
+        Entry.Status      = Job.Status;
+        Entry.pTask.Release();
+        --m_NumRunningJobs;
+
+        if (Job.ReadNeighbours)
+        {
+            for (Int32 dz = -1; dz <= 1; ++dz)
+            {
+                for (Int32 dx = -1; dx <= 1; ++dx)
+                    --FindEntry(Entry.X + dx, Entry.Z + dz)->NumReaders;
+            }
+        }
+
+        if (Entry.Status == CHUNK_STATUS_FEATURES)
+            Entry.IsInWorld = Wrld.AddChunk(std::move(Entry.pChunk)) != nullptr;
+    }
+
+    // Entries may be added while neighbours are checked, so candidates are collected first
+    std::vector<ChunkEntry*> Candidates;
+    for (auto& It : m_Chunks)
+    {
+        ChunkEntry& Entry = *It.second;
+        if (!Entry.IsRunning && Entry.Status < Entry.Target)
+            Candidates.push_back(&Entry);
+    }
+    std::sort(Candidates.begin(), Candidates.end(), [this](const ChunkEntry* pLHS, const ChunkEntry* pRHS) {
+        return ComputePriority(*pLHS) > ComputePriority(*pRHS);
+    });
+
+    // Lighting and loading run on this thread, so the nearest chunks go first and the
+    // rest wait for the next update
+    m_ReadyToLight.clear();
+    Uint32 NumLoads = 0;
+    for (ChunkEntry* pEntry : Candidates)
+    {
+        const CHUNK_STATUS NextStage = static_cast<CHUNK_STATUS>(pEntry->Status + 1);
+        if (StageNeedsNeighbours(NextStage) && !AreNeighboursReady(*pEntry, pEntry->Status))
+            continue;
+
+        if (NextStage == CHUNK_STATUS_LIGHT)
+        {
+            if (m_ReadyToLight.size() < MaxLitChunks)
+                m_ReadyToLight.push_back(pEntry);
+            continue;
+        }
+
+        if (pEntry->Status == CHUNK_STATUS_EMPTY && m_pStorage != nullptr)
+        {
+            if (NumLoads >= MaxLoads)
+                continue;
+            ++NumLoads;
+        }
+        StartJob(*pEntry, Wrld);
+    }
+
+    // Lighting writes into the neighbours, which all have final blocks by now and are
+    // no longer touched by any job
+    if (!m_ReadyToLight.empty())
+    {
+        for (const ChunkEntry* pEntry : m_ReadyToLight)
+            Light.QueueChunk(pEntry->X, pEntry->Z);
+
+        Timer Tmr;
+        Light.Update(Wrld);
+        const double LightTime = Tmr.GetElapsedTime();
+
+        for (ChunkEntry* pEntry : m_ReadyToLight)
+        {
+            pEntry->Status = CHUNK_STATUS_LIGHT;
+            m_CompletedChunks.emplace_back(pEntry->X, pEntry->Z);
+        }
+        m_StageNanoseconds[CHUNK_STATUS_LIGHT].fetch_add(static_cast<Uint64>(LightTime * 1e9), std::memory_order_relaxed);
+        m_StageCounts[CHUNK_STATUS_LIGHT].fetch_add(static_cast<Uint32>(m_ReadyToLight.size()), std::memory_order_relaxed);
+    }
+
+    m_NumPending = 0;
+    for (const auto& It : m_Chunks)
+        m_NumPending += It.second->Status < It.second->Target ? 1 : 0;
+
+    // Reordering the queue is not free, only do it when the focus has moved noticeably
+    if (length(m_FocusPos - m_PrioritizedFocusPos) > 8.f)
+    {
+        m_PrioritizedFocusPos = m_FocusPos;
+        for (const auto& It : m_Chunks)
+        {
+            if (It.second->pTask)
+                It.second->pTask->SetPriority(ComputePriority(*It.second));
+        }
+        m_pThreadPool->ReprioritizeAllTasks();
+    }
+}
+
+} // namespace Diligent
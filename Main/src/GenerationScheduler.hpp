@@ -0,0 +1,193 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <deque>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "Common/interface/ThreadPool.hpp"
+#include "Common/interface/BasicMath.hpp"
+#include "WorldGenerator.hpp"
+#include "World.hpp"
+
+namespace Diligent
+{
+
+class LightEngine;
+class RegionStorage;
+
+// Runs the world generation stages (see CHUNK_STATUS) on a worker thread pool.
+//
+// Every chunk the scheduler knows has a status and a target status. Requested chunks
+// target full generation, and a stage that reads its neighbours raises the targets of
+// the 3x3 chunks around it to the previous stage, so a ring of partially generated
+// chunks forms around the requested area. A chunk advances once its neighbours are far
+// enough; consecutive stages that only touch the chunk itself run in one job.
+//
+// Chunks are not locked. A chunk being generated lives outside the world until its blocks
+// are final, so only its own job touches it, and the only data jobs share is the
+// heightmap a chunk publishes after the carver stage, which never changes afterwards.
+// Finished chunks are added to the world on the main thread and lit there through the
+// light engine, and saved chunks are loaded there too, both capped per Update() so that
+// crossing into a new area spreads them over several frames. Jobs and chunks closer to
+// the focus position go first.
+class GenerationScheduler
+{
+public:
+    // Chunks found in pStorage are loaded instead of generated. Jobs run on a thread pool
+    // of its own.
+    GenerationScheduler(const WorldGenerator& Generator, Uint32 NumThreads, RegionStorage* pStorage = nullptr);
+    // Jobs run on a pool shared with other systems, which must have NumThreads workers
+    GenerationScheduler(const WorldGenerator& Generator, IThreadPool* pThreadPool, Uint32 NumThreads, RegionStorage* pStorage = nullptr);
+    ~GenerationScheduler();
+
+    // clang-format off
+    GenerationScheduler           (const GenerationScheduler&)  = delete;
+    GenerationScheduler           (      GenerationScheduler&&) = delete;
+    GenerationScheduler& operator=(const GenerationScheduler&)  = delete;
+    GenerationScheduler& operator=(      GenerationScheduler&&) = delete;
+    // clang-format on
+
+    // Asks for the chunk to be fully generated
+    void RequestChunk(Int32 ChunkX, Int32 ChunkZ);
+    bool IsRequested(Int32 ChunkX, Int32 ChunkZ) const;
+
+    CHUNK_STATUS GetStatus(Int32 ChunkX, Int32 ChunkZ) const;
+
+    // A chunk must stay in the world while jobs of its neighbours read its heightmap
+    bool CanUnload(Int32 ChunkX, Int32 ChunkZ) const;
+    // Forgets a chunk the world has unloaded
+    void OnChunkUnloaded(Int32 ChunkX, Int32 ChunkZ);
+
+    // Drops chunks that are not in the world (partially generated, or past the border of
+    // a finite world) outside the square of the given radius that no job is working on.
+    // They are regenerated if they are needed again.
+    void DropDistantChunks(Int32 CenterX, Int32 CenterZ, Int32 Radius);
+
+    // Collects finished jobs, adds chunks with final blocks to the world, lights up to
+    // MaxLitChunks chunks whose neighbours are ready and starts the jobs that have become
+    // possible, loading at most MaxLoads chunks from storage
+    void Update(World&        Wrld,
+                LightEngine&  Light,
+                const float3& FocusPos,
+                Uint32        MaxLitChunks = std::numeric_limits<Uint32>::max(),
+                Uint32        MaxLoads     = std::numeric_limits<Uint32>::max());
+
+    // Chunks that became fully generated during the last Update()
+    const std::vector<int2>& GetCompletedChunks() const { return m_CompletedChunks; }
+
+    bool HasPendingWork() const { return m_NumPending > 0; }
+
+    Uint32 GetThreadCount() const { return m_NumThreads; }
+    Uint32 GetRunningJobCount() const { return m_NumRunningJobs; }
+    size_t GetChunkCount() const { return m_Chunks.size(); }
+
+    // Total time spent in a stage and the number of chunks that went through it
+    double GetStageTime(CHUNK_STATUS Stage) const;
+    Uint32 GetStageCount(CHUNK_STATUS Stage) const;
+
+private:
+    struct ChunkEntry
+    {
+        Int32 X = 0;
+        Int32 Z = 0;
+
+        CHUNK_STATUS Status      = CHUNK_STATUS_EMPTY;
+        CHUNK_STATUS Target      = CHUNK_STATUS_EMPTY;
+        bool         IsRequested = false;
+        bool         IsRunning   = false;
+        // False for chunks past the border of a finite world, which only exist here
+        bool IsInWorld = false;
+        // Number of running neighbour jobs reading the heightmap
+        Uint32 NumReaders = 0;
+
+        // Owned by the running job until the chunk joins the world
+        std::unique_ptr<Chunk> pChunk;
+        ChunkHeightmap         Heightmap;
+
+        RefCntAutoPtr<IAsyncTask> pTask;
+    };
+
+    struct CompletedJob
+    {
+        Uint64       Key    = 0;
+        CHUNK_STATUS Status = CHUNK_STATUS_EMPTY;
+        // The job pinned the heightmaps of the 3x3 chunks around it
+        bool ReadNeighbours = false;
+    };
+
+    ChunkEntry&       GetOrCreateEntry(Int32 ChunkX, Int32 ChunkZ);
+    ChunkEntry*       FindEntry(Int32 ChunkX, Int32 ChunkZ);
+    const ChunkEntry* FindEntry(Int32 ChunkX, Int32 ChunkZ) const;
+
+    void RaiseTarget(ChunkEntry& Entry, CHUNK_STATUS Target);
+
+    // Checks that the 3x3 chunks around the entry have reached Status, raising their
+    // targets when they have not
+    bool AreNeighboursReady(const ChunkEntry& Entry, CHUNK_STATUS Status);
+
+    void StartJob(ChunkEntry& Entry, World& Wrld);
+    void RunJob(ChunkEntry& Entry, CHUNK_STATUS LastStage, const WorldGenerator::HeightmapNeighbourhood& Heightmaps);
+
+    float ComputePriority(const ChunkEntry& Entry) const;
+
+    void AddStageTime(CHUNK_STATUS Stage, double Seconds);
+
+private:
+    const WorldGenerator& m_Generator;
+    RegionStorage* const  m_pStorage;
+    const Uint32          m_NumThreads;
+
+    RefCntAutoPtr<IThreadPool> m_pThreadPool;
+    bool                       m_OwnsThreadPool = false;
+
+    // Main thread only, except for the parts of a running job's entry described above
+    std::unordered_map<Uint64, std::unique_ptr<ChunkEntry>> m_Chunks;
+
+    Uint32 m_NumPending     = 0;
+    Uint32 m_NumRunningJobs = 0;
+
+    std::mutex               m_CompletedMtx;
+    std::deque<CompletedJob> m_CompletedJobs;
+
+    std::vector<int2>        m_CompletedChunks;
+    std::vector<ChunkEntry*> m_ReadyToLight;
+
+    float3 m_FocusPos;
+    float3 m_PrioritizedFocusPos;
+
+    std::array<std::atomic<Uint64>, CHUNK_STATUS_COUNT> m_StageNanoseconds = {};
+    std::array<std::atomic<Uint32>, CHUNK_STATUS_COUNT> m_StageCounts      = {};
+};
+
+} // namespace Diligent
@@ -0,0 +1,576 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+#include "LightEngine.hpp"
+
+#include <algorithm>
+#include <array>
+#include <limits>
+
+#include "Common/interface/Timer.hpp"
+
+namespace Diligent
+{
+
+namespace
+{
+
+// The calling thread waits for the batch, so it goes ahead of background jobs on a
+// shared pool
+constexpr float BatchPriority = std::numeric_limits<float>::max();
+
+struct LightTables
+{
+    std::array<Uint8, BLOCK_ID_COUNT> Opacity;
+    std::array<Uint8, BLOCK_ID_COUNT> Emission;
+
+    LightTables()
+    {
+        for (Uint32 Id = 0; Id < BLOCK_ID_COUNT; ++Id)
+        {
+            const BlockInfo& Info = GetBlockInfo(static_cast<BlockId>(Id));
+            Opacity[Id]           = Info.LightOpacity;
+            Emission[Id]          = Info.LightEmission;
+        }
+    }
+};
+
+const LightTables& GetLightTables()
+{
+    static const LightTables Tables;
+    return Tables;
+}
+
+// Queue entries pack a position relative to the job's chunk origin and a light level:
+// [0..5] x + 16  [6..11] z + 16  [12..18] y  [19..22] level
+constexpr Int32 FootprintMin = -16;
+constexpr Int32 FootprintMax = 32;
+
+Uint32 PackEntry(Int32 x, Int32 y, Int32 z, Uint32 Level)
+{
+    return static_cast<Uint32>(x - FootprintMin) | (static_cast<Uint32>(z - FootprintMin) << 6u) | (static_cast<Uint32>(y) << 12u) | (Level << 19u);
+}
+
+// clang-format off
+constexpr Int32 NeighbourOffsets[6][3] =
+{
+    {-1, 0, 0}, {1, 0, 0}, {0, -1, 0}, {0, 1, 0}, {0, 0, -1}, {0, 0, 1}
+};
+// clang-format on
+constexpr Uint32 DownNeighbour = 2;
+
+// Level of light arriving in a block from a neighbour. Full sky light keeps going down
+// through transparent blocks, any other step loses at least one level.
+Int32 GetPropagatedLevel(LIGHT_TYPE Type, Int32 Level, Uint8 Opacity, bool IsDown)
+{
+    if (Type == LIGHT_TYPE_SKY && IsDown && Level == LightEngine::MaxLight && Opacity == 0)
+        return LightEngine::MaxLight;
+    return Level - std::max<Int32>(Opacity, 1);
+}
+
+// Light access to a chunk and the eight around it, in coordinates relative to the
+// origin of the middle chunk
+class LightNeighbourhood
+{
+public:
+    LightNeighbourhood(World& Wrld, Int32 ChunkX, Int32 ChunkZ, std::bitset<9 * Chunk::NumSections>& ChangedSections) :
+        m_ChangedSections{ChangedSections}
+    {
+        for (Int32 dz = -1; dz <= 1; ++dz)
+        {
+            for (Int32 dx = -1; dx <= 1; ++dx)
+                m_Chunks[(dz + 1) * 3 + dx + 1] = Wrld.GetChunk(ChunkX + dx, ChunkZ + dz);
+        }
+    }
+
+    static bool IsInside(Int32 x, Int32 y, Int32 z)
+    {
+        return x >= FootprintMin && x < FootprintMax && z >= FootprintMin && z < FootprintMax && y >= 0 && y < Chunk::Height;
+    }
+
+    Chunk* GetChunk(Int32 x, Int32 z) const
+    {
+        return m_Chunks[GetChunkSlot(x, z)];
+    }
+
+    Chunk* GetChunkAt(Int32 dx, Int32 dz) const
+    {
+        return m_Chunks[(dz + 1) * 3 + dx + 1];
+    }
+
+    // Blocks of unloaded chunks are reported as opaque so light never enters them
+    Uint8 GetOpacity(Int32 x, Int32 y, Int32 z) const
+    {
+        const Chunk* pChunk = GetChunk(x, z);
+        if (pChunk == nullptr)
+            return LightEngine::MaxLight;
+        return GetLightTables().Opacity[pChunk->GetBlock(x & 15, y, z & 15)];
+    }
+
+    Uint8 GetEmission(Int32 x, Int32 y, Int32 z) const
+    {
+        const Chunk* pChunk = GetChunk(x, z);
+        return pChunk != nullptr ? GetLightTables().Emission[pChunk->GetBlock(x & 15, y, z & 15)] : 0;
+    }
+
+    Uint8 GetLight(LIGHT_TYPE Type, Int32 x, Int32 y, Int32 z) const
+    {
+        const Chunk* pChunk = GetChunk(x, z);
+        if (pChunk == nullptr)
+            return 0;
+        const ChunkSection& Section = pChunk->GetSection(y >> 4);
+        return (Type == LIGHT_TYPE_SKY ? Section.GetSkyLight() : Section.GetBlockLight()).Get(ChunkSection::GetIndex(x & 15, y & 15, z & 15));
+    }
+
+    void SetLight(LIGHT_TYPE Type, Int32 x, Int32 y, Int32 z, Uint8 Level)
+    {
+        const Uint32 Slot   = GetChunkSlot(x, z);
+        Chunk*       pChunk = m_Chunks[Slot];
+        VERIFY_EXPR(pChunk != nullptr);
+        ChunkSection& Section = pChunk->GetSection(y >> 4);
+        (Type == LIGHT_TYPE_SKY ? Section.GetSkyLight() : Section.GetBlockLight()).Set(ChunkSection::GetIndex(x & 15, y & 15, z & 15), Level);
+        m_ChangedSections.set(Slot * Chunk::NumSections + (y >> 4));
+    }
+
+private:
+    static Uint32 GetChunkSlot(Int32 x, Int32 z)
+    {
+        VERIFY_EXPR(x >= FootprintMin && x < FootprintMax && z >= FootprintMin && z < FootprintMax);
+        return static_cast<Uint32>(((z + 16) >> 4) * 3 + ((x + 16) >> 4));
+    }
+
+private:
+    std::array<Chunk*, 9>                m_Chunks = {};
+    std::bitset<9 * Chunk::NumSections>& m_ChangedSections;
+};
+
+void PropagateAdd(LightNeighbourhood& Area, LIGHT_TYPE Type, std::vector<Uint32>& Queue)
+{
+    for (size_t Head = 0; Head < Queue.size(); ++Head)
+    {
+        const Uint32 Entry = Queue[Head];
+        const Int32  x     = static_cast<Int32>(Entry & 63u) + FootprintMin;
+        const Int32  z     = static_cast<Int32>((Entry >> 6u) & 63u) + FootprintMin;
+        const Int32  y     = static_cast<Int32>((Entry >> 12u) & 127u);
+
+        // The level may have risen since the entry was queued
+        const Uint8 Level = Area.GetLight(Type, x, y, z);
+        if (Level <= 1)
+            continue;
+
+        for (Uint32 n = 0; n < 6; ++n)
+        {
+            const Int32 nx = x + NeighbourOffsets[n][0];
+            const Int32 ny = y + NeighbourOffsets[n][1];
+            const Int32 nz = z + NeighbourOffsets[n][2];
+            if (!LightNeighbourhood::IsInside(nx, ny, nz))
+                continue;
+
+            const Uint8 Opacity = Area.GetOpacity(nx, ny, nz);
+            if (Opacity >= LightEngine::MaxLight)
+                continue;
+
+            const Int32 NewLevel = GetPropagatedLevel(Type, Level, Opacity, n == DownNeighbour);
+            if (NewLevel > Area.GetLight(Type, nx, ny, nz))
+            {
+                Area.SetLight(Type, nx, ny, nz, static_cast<Uint8>(NewLevel));
+                Queue.push_back(PackEntry(nx, ny, nz, 0));
+            }
+        }
+    }
+    Queue.clear();
+}
+
+// Clears the light that came through the queued blocks and queues the blocks around
+// the cleared area, whose light comes from elsewhere, for refilling
+void PropagateRemove(LightNeighbourhood& Area, LIGHT_TYPE Type, std::vector<Uint32>& Queue, std::vector<Uint32>& AddQueue)
+{
+    for (size_t Head = 0; Head < Queue.size(); ++Head)
+    {
+        const Uint32 Entry    = Queue[Head];
+        const Int32  x        = static_cast<Int32>(Entry & 63u) + FootprintMin;
+        const Int32  z        = static_cast<Int32>((Entry >> 6u) & 63u) + FootprintMin;
+        const Int32  y        = static_cast<Int32>((Entry >> 12u) & 127u);
+        const Uint32 OldLevel = Entry >> 19u;
+
+        for (Uint32 n = 0; n < 6; ++n)
+        {
+            const Int32 nx = x + NeighbourOffsets[n][0];
+            const Int32 ny = y + NeighbourOffsets[n][1];
+            const Int32 nz = z + NeighbourOffsets[n][2];
+            if (!LightNeighbourhood::IsInside(nx, ny, nz))
+                continue;
+
+            const Uint8 Level = Area.GetLight(Type, nx, ny, nz);
+            if (Level == 0)
+                continue;
+
+            const bool IsSkyColumn = Type == LIGHT_TYPE_SKY && n == DownNeighbour && OldLevel == LightEngine::MaxLight && Level == LightEngine::MaxLight;
+            if (Level < OldLevel || IsSkyColumn)
+            {
+                Area.SetLight(Type, nx, ny, nz, 0);
+                Queue.push_back(PackEntry(nx, ny, nz, Level));
+
+                // Light sources lose what they received but keep their own light
+                const Uint8 Emission = Type == LIGHT_TYPE_BLOCK ? Area.GetEmission(nx, ny, nz) : 0;
+                if (Emission > 0)
+                {
+                    Area.SetLight(Type, nx, ny, nz, Emission);
+                    AddQueue.push_back(PackEntry(nx, ny, nz, 0));
+                }
+            }
+            else
+            {
+                AddQueue.push_back(PackEntry(nx, ny, nz, 0));
+            }
+        }
+    }
+    Queue.clear();
+}
+
+// Sky light of every column of the middle chunk, plus the blocks that may spread it
+// sideways: those below the top of a neighbouring column and those already dimmed
+void LightSkyColumns(LightNeighbourhood& Area, std::vector<Uint32>& AddQueue)
+{
+    // Height of the first block that dims sky light, for the middle chunk and a
+    // one-block border around it; unloaded columns count as open sky
+    std::array<Int32, 18 * 18> Heights;
+    for (Int32 z = -1; z <= 16; ++z)
+    {
+        for (Int32 x = -1; x <= 16; ++x)
+        {
+            Int32 y = Chunk::Height - 1;
+            if (Area.GetChunk(x, z) != nullptr)
+            {
+                while (y >= 0 && Area.GetOpacity(x, y, z) == 0)
+                    --y;
+            }
+            else
+            {
+                y = -1;
+            }
+            Heights[(z + 1) * 18 + x + 1] = y + 1;
+        }
+    }
+
+    for (Int32 z = 0; z < 16; ++z)
+    {
+        for (Int32 x = 0; x < 16; ++x)
+        {
+            const Int32 Height = Heights[(z + 1) * 18 + x + 1];
+            const Int32 SpreadHeight = std::max({Height,
+                                                 Heights[(z + 1) * 18 + x], Heights[(z + 1) * 18 + x + 2],
+                                                 Heights[z * 18 + x + 1], Heights[(z + 2) * 18 + x + 1]});
+
+            // Open sky above the top of the world
+            Int32 Level = LightEngine::MaxLight;
+            for (Int32 y = Chunk::Height - 1; y >= 0; --y)
+            {
+                const Uint8 Opacity = Area.GetOpacity(x, y, z);
+                if (Opacity >= LightEngine::MaxLight)
+                    break;
+                Level = GetPropagatedLevel(LIGHT_TYPE_SKY, Level, Opacity, true);
+                if (Level <= 0)
+                    break;
+                if (Level > Area.GetLight(LIGHT_TYPE_SKY, x, y, z))
+                    Area.SetLight(LIGHT_TYPE_SKY, x, y, z, static_cast<Uint8>(Level));
+                if (y < SpreadHeight || Level < LightEngine::MaxLight)
+                    AddQueue.push_back(PackEntry(x, y, z, 0));
+            }
+        }
+    }
+}
+
+void LightSources(LightNeighbourhood& Area, std::vector<Uint32>& AddQueue)
+{
+    const LightTables& Tables = GetLightTables();
+
+    const Chunk*         pChunk = Area.GetChunkAt(0, 0);
+    std::vector<BlockId> Blocks(ChunkSection::Volume);
+    for (Int32 s = 0; s < Chunk::NumSections; ++s)
+    {
+        const ChunkSection& Section = pChunk->GetSection(s);
+        if (Section.IsUniform())
+        {
+            if (Tables.Emission[Section.GetUniformBlock()] == 0)
+                continue;
+        }
+        Section.Decode(Blocks.data());
+        for (Uint32 i = 0; i < ChunkSection::Volume; ++i)
+        {
+            const Uint8 Emission = Tables.Emission[Blocks[i]];
+            if (Emission == 0)
+                continue;
+
+            const Int32 x = i & 15, z = (i >> 4) & 15, y = s * 16 + (i >> 8);
+            if (Emission > Area.GetLight(LIGHT_TYPE_BLOCK, x, y, z))
+                Area.SetLight(LIGHT_TYPE_BLOCK, x, y, z, Emission);
+            AddQueue.push_back(PackEntry(x, y, z, 0));
+        }
+    }
+}
+
+// Queues the lit blocks of the loaded neighbours that touch the middle chunk
+void GatherBorderLight(LightNeighbourhood& Area, LIGHT_TYPE Type, std::vector<Uint32>& AddQueue)
+{
+    // clang-format off
+    struct Border { Int32 dx, dz, x0, z0, StepX, StepZ; };
+    constexpr Border Borders[] =
+    {
+        {-1,  0, -1,  0, 0, 1},
+        { 1,  0, 16,  0, 0, 1},
+        { 0, -1,  0, -1, 1, 0},
+        { 0,  1,  0, 16, 1, 0},
+    };
+    // clang-format on
+
+    for (const Border& B : Borders)
+    {
+        const Chunk* pNeighbour = Area.GetChunkAt(B.dx, B.dz);
+        if (pNeighbour == nullptr)
+            continue;
+
+        for (Int32 s = 0; s < Chunk::NumSections; ++s)
+        {
+            const ChunkSection& Section = pNeighbour->GetSection(s);
+            const NibbleArray&  Light   = Type == LIGHT_TYPE_SKY ? Section.GetSkyLight() : Section.GetBlockLight();
+            if (Light.IsUniform() && Light.GetUniformValue() <= 1)
+                continue;
+
+            for (Int32 i = 0; i < 16; ++i)
+            {
+                const Int32 x = B.x0 + B.StepX * i;
+                const Int32 z = B.z0 + B.StepZ * i;
+                for (Int32 y = s * 16; y < s * 16 + 16; ++y)
+                {
+                    if (Area.GetLight(Type, x, y, z) > 1)
+                        AddQueue.push_back(PackEntry(x, y, z, 0));
+                }
+            }
+        }
+    }
+}
+
+} // namespace
+
+LightEngine::LightEngine(Uint32 NumThreads) :
+    LightEngine{CreateThreadPool(ThreadPoolCreateInfo{std::max(NumThreads, 1u)}), NumThreads}
+{
+    m_OwnsThreadPool = true;
+}
+
+LightEngine::LightEngine(IThreadPool* pThreadPool, Uint32 NumThreads) :
+    m_NumThreads{std::max(NumThreads, 1u)},
+    m_pThreadPool{pThreadPool},
+    m_Scratch(m_NumThreads + 1)
+{
+    VERIFY_EXPR(m_pThreadPool);
+}
+
+LightEngine::~LightEngine()
+{
+    if (m_OwnsThreadPool)
+        m_pThreadPool->StopThreads();
+}
+
+LightEngine::ChunkJob& LightEngine::GetJob(Int32 ChunkX, Int32 ChunkZ)
+{
+    ChunkJob& Job = m_Jobs[World::PackChunkKey(ChunkX, ChunkZ)];
+    Job.ChunkX    = ChunkX;
+    Job.ChunkZ    = ChunkZ;
+    return Job;
+}
+
+void LightEngine::QueueChunk(Int32 ChunkX, Int32 ChunkZ)
+{
+    GetJob(ChunkX, ChunkZ).NeedsFullLight = true;
+}
+
+void LightEngine::QueueBlockChange(Int32 x, Int32 y, Int32 z)
+{
+    if (y < 0 || y >= Chunk::Height)
+        return;
+    GetJob(World::BlockToChunk(x), World::BlockToChunk(z)).ChangedBlocks.emplace_back(World::BlockToLocal(x), y, World::BlockToLocal(z));
+}
+
+void LightEngine::CancelChunk(Int32 ChunkX, Int32 ChunkZ)
+{
+    m_Jobs.erase(World::PackChunkKey(ChunkX, ChunkZ));
+}
+
+void LightEngine::RunJob(World& Wrld, ChunkJob& Job, Scratch& Scratch)
+{
+    LightNeighbourhood Area{Wrld, Job.ChunkX, Job.ChunkZ, Job.ChangedSections};
+    if (Area.GetChunkAt(0, 0) == nullptr)
+        return;
+
+    if (Job.NeedsFullLight)
+    {
+        // A freshly lit chunk only gains light, so there is nothing to remove and
+        // block changes made before it was lit are covered as well
+        LightSkyColumns(Area, Scratch.AddQueue);
+        GatherBorderLight(Area, LIGHT_TYPE_SKY, Scratch.AddQueue);
+        PropagateAdd(Area, LIGHT_TYPE_SKY, Scratch.AddQueue);
+
+        LightSources(Area, Scratch.AddQueue);
+        GatherBorderLight(Area, LIGHT_TYPE_BLOCK, Scratch.AddQueue);
+        PropagateAdd(Area, LIGHT_TYPE_BLOCK, Scratch.AddQueue);
+        return;
+    }
+
+    for (Uint32 t = 0; t < LIGHT_TYPE_COUNT; ++t)
+    {
+        const LIGHT_TYPE Type = static_cast<LIGHT_TYPE>(t);
+
+        // Remove all light that passed through the changed blocks first, so that
+        // refilling sees every hole at once
+        for (const int3& Pos : Job.ChangedBlocks)
+        {
+            const Uint8 Level = Area.GetLight(Type, Pos.x, Pos.y, Pos.z);
+            if (Level > 0)
+            {
+                Area.SetLight(Type, Pos.x, Pos.y, Pos.z, 0);
+                Scratch.RemoveQueue.push_back(PackEntry(Pos.x, Pos.y, Pos.z, Level));
+            }
+        }
+        PropagateRemove(Area, Type, Scratch.RemoveQueue, Scratch.AddQueue);
+
+        for (const int3& Pos : Job.ChangedBlocks)
+        {
+            const Uint8 Emission = Type == LIGHT_TYPE_BLOCK ? Area.GetEmission(Pos.x, Pos.y, Pos.z) : 0;
+            if (Emission > Area.GetLight(Type, Pos.x, Pos.y, Pos.z))
+            {
+                Area.SetLight(Type, Pos.x, Pos.y, Pos.z, Emission);
+                Scratch.AddQueue.push_back(PackEntry(Pos.x, Pos.y, Pos.z, 0));
+            }
+
+            // A block that became transparent lets its neighbours' light in. Above the
+            // top of the world there is open sky.
+            const Uint8 Opacity = Area.GetOpacity(Pos.x, Pos.y, Pos.z);
+            if (Type == LIGHT_TYPE_SKY && Pos.y == Chunk::Height - 1 && Opacity < MaxLight)
+            {
+                const Int32 Level = GetPropagatedLevel(LIGHT_TYPE_SKY, MaxLight, Opacity, true);
+                if (Level > Area.GetLight(Type, Pos.x, Pos.y, Pos.z))
+                {
+                    Area.SetLight(Type, Pos.x, Pos.y, Pos.z, static_cast<Uint8>(Level));
+                    Scratch.AddQueue.push_back(PackEntry(Pos.x, Pos.y, Pos.z, 0));
+                }
+            }
+            for (const auto& Offset : NeighbourOffsets)
+            {
+                const Int32 nx = Pos.x + Offset[0];
+                const Int32 ny = Pos.y + Offset[1];
+                const Int32 nz = Pos.z + Offset[2];
+                if (LightNeighbourhood::IsInside(nx, ny, nz) && Area.GetLight(Type, nx, ny, nz) > 1)
+                    Scratch.AddQueue.push_back(PackEntry(nx, ny, nz, 0));
+            }
+        }
+        PropagateAdd(Area, Type, Scratch.AddQueue);
+    }
+}
+
+void LightEngine::Update(World& Wrld)
+{
+    Timer Tmr;
+
+    m_ChangedSections.clear();
+    m_ChangedSectionKeys.clear();
+    m_LastJobCount   = static_cast<Uint32>(m_Jobs.size());
+    m_LastBatchCount = 0;
+
+    while (!m_Jobs.empty())
+    {
+        // Greedily pick jobs whose 3x3 neighbourhoods do not overlap
+        m_Batch.clear();
+        m_ReservedChunks.clear();
+        for (auto It = m_Jobs.begin(); It != m_Jobs.end();)
+        {
+            const Int32 ChunkX = It->second.ChunkX;
+            const Int32 ChunkZ = It->second.ChunkZ;
+
+            bool IsFree = true;
+            for (Int32 dz = -1; dz <= 1 && IsFree; ++dz)
+            {
+                for (Int32 dx = -1; dx <= 1 && IsFree; ++dx)
+                    IsFree = m_ReservedChunks.count(World::PackChunkKey(ChunkX + dx, ChunkZ + dz)) == 0;
+            }
+            if (!IsFree)
+            {
+                ++It;
+                continue;
+            }
+
+            for (Int32 dz = -1; dz <= 1; ++dz)
+            {
+                for (Int32 dx = -1; dx <= 1; ++dx)
+                    m_ReservedChunks.insert(World::PackChunkKey(ChunkX + dx, ChunkZ + dz));
+            }
+            m_Batch.emplace_back(std::move(It->second));
+            It = m_Jobs.erase(It);
+        }
+
+        if (m_Batch.size() == 1)
+        {
+            RunJob(Wrld, m_Batch[0], m_Scratch[m_NumThreads]);
+        }
+        else
+        {
+            m_Tasks.clear();
+            for (size_t i = 0; i < m_Batch.size(); ++i)
+            {
+                m_Tasks.emplace_back(EnqueueAsyncWork(
+                    m_pThreadPool, [this, &Wrld, i](Uint32 ThreadId) {
+                        RunJob(Wrld, m_Batch[i], m_Scratch[ThreadId]);
+                    },
+                    BatchPriority));
+            }
+            for (const auto& pTask : m_Tasks)
+                pTask->WaitForCompletion();
+        }
+        ++m_LastBatchCount;
+
+        for (const ChunkJob& Job : m_Batch)
+        {
+            if (Job.ChangedSections.none())
+                continue;
+            for (Uint32 Slot = 0; Slot < 9; ++Slot)
+            {
+                for (Int32 s = 0; s < Chunk::NumSections; ++s)
+                {
+                    if (!Job.ChangedSections.test(Slot * Chunk::NumSections + s))
+                        continue;
+                    const int3 SectionPos{Job.ChunkX + static_cast<Int32>(Slot % 3) - 1, s, Job.ChunkZ + static_cast<Int32>(Slot / 3) - 1};
+                    if (m_ChangedSectionKeys.insert(World::PackSectionKey(SectionPos)).second)
+                        m_ChangedSections.push_back(SectionPos);
+                }
+            }
+        }
+    }
+
+    m_LastUpdateTime = Tmr.GetElapsedTime();
+}
+
+} // namespace Diligent
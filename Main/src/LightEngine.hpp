@@ -0,0 +1,154 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+#pragma once
+
+#include <bitset>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "Common/interface/ThreadPool.hpp"
+#include "World.hpp"
+
+namespace Diligent
+{
+
+enum LIGHT_TYPE : Uint8
+{
+    LIGHT_TYPE_SKY = 0,
+    LIGHT_TYPE_BLOCK,
+    LIGHT_TYPE_COUNT
+};
+
+// Incremental sky and block light.
+//
+// Light is stored per section (see ChunkSection::GetSkyLight()) and updated with
+// breadth-first flood fills: a change first removes the light that depended on the
+// changed block, then refills the hole from the light left around it, so only the
+// affected blocks are touched. Sky light travels straight down without falling off.
+//
+// Work is grouped into one job per chunk. Light never travels further than 15 blocks,
+// so a job only reads and writes its chunk and the eight around it, and jobs whose
+// 3x3 neighbourhoods do not overlap run in parallel on the worker threads.
+class LightEngine
+{
+public:
+    static constexpr Uint8 MaxLight = 15;
+
+    // Runs jobs on a thread pool of its own
+    explicit LightEngine(Uint32 NumThreads);
+    // Runs jobs on a pool shared with other systems, which must have NumThreads workers
+    LightEngine(IThreadPool* pThreadPool, Uint32 NumThreads);
+    ~LightEngine();
+
+    // clang-format off
+    LightEngine           (const LightEngine&)  = delete;
+    LightEngine           (      LightEngine&&) = delete;
+    LightEngine& operator=(const LightEngine&)  = delete;
+    LightEngine& operator=(      LightEngine&&) = delete;
+    // clang-format on
+
+    // Lights a chunk that was just generated or loaded, spreading light into the loaded
+    // chunks around it and pulling theirs in. The chunk must start with no light.
+    void QueueChunk(Int32 ChunkX, Int32 ChunkZ);
+
+    // Relights around a block that has already been changed in the world
+    void QueueBlockChange(Int32 x, Int32 y, Int32 z);
+
+    // Drops pending work of a chunk that is being unloaded
+    void CancelChunk(Int32 ChunkX, Int32 ChunkZ);
+
+    // Runs all pending jobs and returns once they are done. A single job runs on the
+    // calling thread. Jobs go ahead of any other work queued on the pool, and only they
+    // are waited for. The world must not be changed by other threads meanwhile.
+    void Update(World& Wrld);
+
+    bool HasPendingWork() const { return !m_Jobs.empty(); }
+
+    // Sections whose light changed during the last Update()
+    const std::vector<int3>& GetChangedSections() const { return m_ChangedSections; }
+
+    Uint32 GetThreadCount() const { return m_NumThreads; }
+
+    // Statistics of the last Update()
+    Uint32 GetLastJobCount() const { return m_LastJobCount; }
+    Uint32 GetLastBatchCount() const { return m_LastBatchCount; }
+    double GetLastUpdateTime() const { return m_LastUpdateTime; }
+
+private:
+    // Light-propagation state of one worker. Kept between updates so the queues do
+    // not reallocate.
+    struct Scratch
+    {
+        std::vector<Uint32> AddQueue;
+        std::vector<Uint32> RemoveQueue;
+    };
+
+    struct ChunkJob
+    {
+        Int32 ChunkX = 0;
+        Int32 ChunkZ = 0;
+
+        bool NeedsFullLight = false;
+
+        // Chunk-local positions of changed blocks
+        std::vector<int3> ChangedBlocks;
+
+        // Sections of the 3x3 chunk neighbourhood whose light changed, indexed by
+        // ((dz + 1) * 3 + dx + 1) * Chunk::NumSections + y
+        std::bitset<9 * Chunk::NumSections> ChangedSections;
+    };
+
+    static void RunJob(World& Wrld, ChunkJob& Job, Scratch& Scratch);
+
+    ChunkJob& GetJob(Int32 ChunkX, Int32 ChunkZ);
+
+private:
+    const Uint32               m_NumThreads;
+    RefCntAutoPtr<IThreadPool> m_pThreadPool;
+    bool                       m_OwnsThreadPool = false;
+
+    // One scratch per worker thread plus one for the calling thread
+    std::vector<Scratch> m_Scratch;
+
+    // Tasks of the running batch
+    std::vector<RefCntAutoPtr<IAsyncTask>> m_Tasks;
+
+    std::unordered_map<Uint64, ChunkJob> m_Jobs;
+
+    // Reused by Update()
+    std::vector<ChunkJob>      m_Batch;
+    std::unordered_set<Uint64> m_ReservedChunks;
+    std::unordered_set<Uint64> m_ChangedSectionKeys;
+    std::vector<int3>          m_ChangedSections;
+
+    Uint32 m_LastJobCount   = 0;
+    Uint32 m_LastBatchCount = 0;
+    double m_LastUpdateTime = 0;
+};
+
+} // namespace Diligent
@@ -0,0 +1,252 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+#include "MeshScheduler.hpp"
+#include "Common/interface/ObjectBase.hpp"
+
+namespace Diligent
+{
+
+namespace
+{
+
+// Above the priority of any distance (see ComputePriority())
+constexpr float UrgentPriority = std::numeric_limits<float>::max();
+
+class MeshTask final : public AsyncTaskBase
+{
+public:
+    MeshTask(IReferenceCounters*               pRefCounters,
+             float                             fPriority,
+             MeshScheduler&                    Scheduler,
+             const int3&                       SectionPos,
+             Uint32                            Generation,
+             const ChunkMesher::Neighbourhood& Sections) :
+        AsyncTaskBase{pRefCounters, fPriority},
+        m_Scheduler{Scheduler},
+        m_SectionPos{SectionPos},
+        m_Generation{Generation}
+    {
+        // Only the section itself and the one block border its mesh samples are copied, not
+        // the whole neighbours
+        if (const ChunkSection* pSection = Sections[13])
+        {
+            m_Section    = *pSection;
+            m_HasSection = true;
+        }
+        ChunkMesher::GatherBorder(Sections, m_Border);
+    }
+
+    virtual void Run(Uint32 /*ThreadId*/) override final
+    {
+        if (m_bSafelyCancel.load())
+        {
+            SetStatus(ASYNC_TASK_STATUS_CANCELLED);
+            return;
+        }
+
+        thread_local std::vector<BlockId> Padded(ChunkMesher::PaddedVolume);
+        thread_local std::vector<Uint8>   PaddedLight(ChunkMesher::PaddedVolume);
+        thread_local ChunkMesher          Mesher;
+
+        MeshScheduler::CompletedMesh Completed;
+        Completed.SectionPos = m_SectionPos;
+        Completed.Generation = m_Generation;
+        ChunkMesher::GatherWithBorder(m_HasSection ? &m_Section : nullptr, m_Border, Padded.data(), PaddedLight.data());
+        Mesher.Mesh(Padded.data(), PaddedLight.data(), Completed.Mesh);
+        Completed.Mesh.Connectivity = Mesher.ComputeConnectivity(Padded.data());
+
+        if (m_bSafelyCancel.load())
+        {
+            SetStatus(ASYNC_TASK_STATUS_CANCELLED);
+            return;
+        }
+
+        m_Scheduler.OnMeshCompleted(std::move(Completed));
+        SetStatus(ASYNC_TASK_STATUS_COMPLETE);
+    }
+
+private:
+    MeshScheduler& m_Scheduler;
+    const int3     m_SectionPos;
+    const Uint32   m_Generation;
+
+    // A missing section is air and lit as open sky, like missing neighbours in the border
+    ChunkSection               m_Section;
+    bool                       m_HasSection = false;
+    ChunkMesher::SectionBorder m_Border;
+};
+
+} // namespace
+
+MeshScheduler::MeshScheduler(Uint32 NumThreads) :
+    MeshScheduler{CreateThreadPool(ThreadPoolCreateInfo{NumThreads})}
+{
+    VERIFY(NumThreads > 0, "Meshing must not run on the main thread");
+    m_OwnsThreadPool = true;
+}
+
+MeshScheduler::MeshScheduler(IThreadPool* pThreadPool) :
+    m_pThreadPool{pThreadPool}
+{
+    VERIFY_EXPR(m_pThreadPool);
+}
+
+MeshScheduler::~MeshScheduler()
+{
+    // The pool may be shared, so only the scheduler's own tasks are waited for
+    for (auto& It : m_Pending)
+        DropTask(It.second.pTask);
+    for (const auto& pTask : m_CancelledTasks)
+        pTask->WaitForCompletion();
+
+    if (m_OwnsThreadPool)
+        m_pThreadPool->StopThreads();
+}
+
+void MeshScheduler::DropTask(IAsyncTask* pTask)
+{
+    pTask->Cancel();
+    if (m_pThreadPool->RemoveTask(pTask))
+        return;
+
+    m_CancelledTasks.erase(std::remove_if(m_CancelledTasks.begin(), m_CancelledTasks.end(),
+                                          [](const RefCntAutoPtr<IAsyncTask>& pCancelled) { return pCancelled->IsFinished(); }),
+                           m_CancelledTasks.end());
+    m_CancelledTasks.emplace_back(pTask);
+}
+
+float MeshScheduler::ComputePriority(const int3& SectionPos) const
+{
+    const float3 Center{
+        (static_cast<float>(SectionPos.x) + 0.5f) * 16.f,
+        (static_cast<float>(SectionPos.y) + 0.5f) * 16.f,
+        (static_cast<float>(SectionPos.z) + 0.5f) * 16.f,
+    };
+    float Distance = length(Center - m_CameraPos);
+
+    if (m_HasFrustum)
+    {
+        BoundBox Box{Center - float3{8, 8, 8}, Center + float3{8, 8, 8}};
+        // Sections behind the camera wait for visible ones up to four times farther away
+        if (GetBoxVisibility(m_Frustum, Box) == BoxVisibility::Invisible)
+            Distance *= 4.f;
+    }
+
+    // The thread pool runs higher priorities first
+    return -Distance;
+}
+
+void MeshScheduler::RequestMesh(const World& Wrld, const int3& SectionPos, bool IsUrgent)
+{
+    const Uint64 Key = World::PackSectionKey(SectionPos);
+
+    auto& Job = m_Pending[Key];
+    if (Job.pTask)
+    {
+        // The section changed again before its previous mesh was done
+        DropTask(Job.pTask);
+    }
+
+    if (IsUrgent && !Job.IsUrgent)
+        ++m_NumUrgent;
+
+    Job.SectionPos = SectionPos;
+    Job.Generation = m_NextGeneration++;
+    Job.IsUrgent   = Job.IsUrgent || IsUrgent;
+    Job.pTask      = RefCntAutoPtr<IAsyncTask>{MakeNewRCObj<MeshTask>()(Job.IsUrgent ? UrgentPriority : ComputePriority(SectionPos), *this, SectionPos,
+                                                                   Job.Generation, ChunkMesher::GetNeighbourhood(Wrld, SectionPos))};
+    m_pThreadPool->EnqueueTask(Job.pTask);
+}
+
+void MeshScheduler::CancelMesh(const int3& SectionPos)
+{
+    auto It = m_Pending.find(World::PackSectionKey(SectionPos));
+    if (It == m_Pending.end())
+        return;
+
+    DropTask(It->second.pTask);
+    if (It->second.IsUrgent)
+        --m_NumUrgent;
+    m_Pending.erase(It);
+}
+
+void MeshScheduler::WaitForUrgent()
+{
+    if (m_NumUrgent == 0)
+        return;
+
+    for (const auto& It : m_Pending)
+    {
+        if (It.second.IsUrgent)
+            It.second.pTask->WaitForCompletion();
+    }
+}
+
+void MeshScheduler::UpdatePriorities(const float3& CameraPos, const float3& CameraDir, const ViewFrustum& Frustum)
+{
+    // Reordering the whole queue is not free, only do it when it would change noticeably
+    const bool Moved  = length(CameraPos - m_CameraPos) > 4.f;
+    const bool Turned = dot(CameraDir, m_CameraDir) < 0.95f;
+    if (m_HasFrustum && !Moved && !Turned)
+        return;
+
+    m_CameraPos  = CameraPos;
+    m_CameraDir  = CameraDir;
+    m_Frustum    = Frustum;
+    m_HasFrustum = true;
+
+    for (auto& It : m_Pending)
+    {
+        if (!It.second.IsUrgent)
+            It.second.pTask->SetPriority(ComputePriority(It.second.SectionPos));
+    }
+    m_pThreadPool->ReprioritizeAllTasks();
+}
+
+void MeshScheduler::OnMeshCompleted(CompletedMesh&& Completed)
+{
+    std::lock_guard<std::mutex> Lock{m_CompletedMtx};
+    m_Completed.emplace_back(std::move(Completed));
+}
+
+bool MeshScheduler::PopCompleted(CompletedMesh& Completed)
+{
+    std::lock_guard<std::mutex> Lock{m_CompletedMtx};
+    if (m_Completed.empty())
+        return false;
+
+    Completed = std::move(m_Completed.front());
+    m_Completed.pop_front();
+    return true;
+}
+
+} // namespace Diligent
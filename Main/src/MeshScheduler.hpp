@@ -0,0 +1,161 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "Common/interface/ThreadPool.hpp"
+#include "Common/interface/AdvancedMath.hpp"
+#include "ChunkMesher.hpp"
+
+namespace Diligent
+{
+
+// Builds section meshes on a worker thread pool.
+//
+// RequestMesh() snapshots the section and the one block border of its neighbours on the
+// calling (main) thread, so workers never touch the live world. Pending jobs are ordered by distance to the
+// camera, with sections outside the view frustum pushed back. Urgent jobs, for blocks
+// the player edited, go before all of them. Requesting a section again, or cancelling
+// it, invalidates any job still in flight for it. Finished meshes are handed back on the
+// main thread through ApplyCompleted() under a time and byte budget.
+class MeshScheduler
+{
+public:
+    // Runs jobs on a thread pool of its own
+    explicit MeshScheduler(Uint32 NumThreads);
+    // Runs jobs on a pool shared with other systems
+    explicit MeshScheduler(IThreadPool* pThreadPool);
+    ~MeshScheduler();
+
+    // clang-format off
+    MeshScheduler           (const MeshScheduler&)  = delete;
+    MeshScheduler           (      MeshScheduler&&) = delete;
+    MeshScheduler& operator=(const MeshScheduler&)  = delete;
+    MeshScheduler& operator=(      MeshScheduler&&) = delete;
+    // clang-format on
+
+    // A section requested as urgent stays urgent until its mesh is applied
+    void RequestMesh(const World& Wrld, const int3& SectionPos, bool IsUrgent = false);
+    void CancelMesh(const int3& SectionPos);
+
+    // Waits for the urgent jobs to finish, so that the next ApplyCompleted() applies them
+    void WaitForUrgent();
+
+    // Recomputes job priorities when the camera has moved or turned noticeably
+    void UpdatePriorities(const float3& CameraPos, const float3& CameraDir, const ViewFrustum& Frustum);
+
+    // Calls Handler(SectionPos, ChunkMesh&&) for finished jobs, oldest first, until either
+    // budget is exhausted. At least one mesh is applied per call so the queue always drains,
+    // and the budgets are ignored while urgent jobs are waiting to be applied.
+    // Returns the number of applied meshes.
+    template <typename HandlerType>
+    Uint32 ApplyCompleted(HandlerType&& Handler, double TimeBudget, size_t ByteBudget);
+
+    Uint32 GetPendingCount() const { return static_cast<Uint32>(m_Pending.size()); }
+    Uint32 GetUrgentCount() const { return m_NumUrgent; }
+
+    struct CompletedMesh
+    {
+        int3      SectionPos;
+        Uint32    Generation = 0;
+        ChunkMesh Mesh;
+    };
+
+    // Called by worker threads
+    void OnMeshCompleted(CompletedMesh&& Completed);
+
+private:
+    float ComputePriority(const int3& SectionPos) const;
+
+    bool PopCompleted(CompletedMesh& Completed);
+
+    // Cancels the task and keeps it until it is finished if it has already started
+    void DropTask(IAsyncTask* pTask);
+
+private:
+    RefCntAutoPtr<IThreadPool> m_pThreadPool;
+    bool                       m_OwnsThreadPool = false;
+
+    struct PendingJob
+    {
+        int3                      SectionPos;
+        Uint32                    Generation = 0;
+        bool                      IsUrgent   = false;
+        RefCntAutoPtr<IAsyncTask> pTask;
+    };
+    // Main thread only
+    std::unordered_map<Uint64, PendingJob> m_Pending;
+    Uint32                                 m_NextGeneration = 1;
+    Uint32                                 m_NumUrgent      = 0;
+    // Cancelled tasks that were already running, which still refer to the scheduler
+    std::vector<RefCntAutoPtr<IAsyncTask>> m_CancelledTasks;
+
+    std::mutex                m_CompletedMtx;
+    std::deque<CompletedMesh> m_Completed;
+
+    float3      m_CameraPos;
+    float3      m_CameraDir;
+    ViewFrustum m_Frustum{};
+    bool        m_HasFrustum = false;
+};
+
+template <typename HandlerType>
+Uint32 MeshScheduler::ApplyCompleted(HandlerType&& Handler, double TimeBudget, size_t ByteBudget)
+{
+    const auto StartTime = std::chrono::high_resolution_clock::now();
+
+    Uint32        NumApplied = 0;
+    size_t        NumBytes   = 0;
+    CompletedMesh Completed;
+    while (PopCompleted(Completed))
+    {
+        auto It = m_Pending.find(World::PackSectionKey(Completed.SectionPos));
+        // Drop results of jobs that were re-requested or cancelled after they started
+        if (It == m_Pending.end() || It->second.Generation != Completed.Generation)
+            continue;
+        if (It->second.IsUrgent)
+            --m_NumUrgent;
+        m_Pending.erase(It);
+
+        NumBytes += Completed.Mesh.Vertices.size() * sizeof(ChunkVertex);
+        Handler(Completed.SectionPos, std::move(Completed.Mesh));
+        ++NumApplied;
+
+        const std::chrono::duration<double> Elapsed = std::chrono::high_resolution_clock::now() - StartTime;
+        if ((Elapsed.count() >= TimeBudget || NumBytes >= ByteBudget) && m_NumUrgent == 0)
+            break;
+    }
+    return NumApplied;
+}
+
+} // namespace Diligent
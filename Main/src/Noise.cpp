@@ -0,0 +1,772 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+#include "Noise.hpp"
+
+#include "Platforms/Basic/interface/DebugUtilities.hpp"
+
+#if SIMD_X86
+#    include <immintrin.h>
+#endif
+
+namespace Diligent
+{
+
+namespace
+{
+
+// Lattice coordinates are hashed by multiplying each with a large odd constant, xoring
+// the products with the seed and mixing the result. Integer arithmetic wraps the same
+// way in every kernel, so only the float math needs care to stay bit-exact.
+// clang-format off
+constexpr Uint32 PrimeX   = 501125321u;
+constexpr Uint32 PrimeY   = 1136930381u;
+constexpr Uint32 PrimeZ   = 1720413743u;
+constexpr Uint32 HashMult = 0x27D4EB2Du;
+// clang-format on
+
+// Displacement fields of the domain warp use their own seeds
+constexpr Uint32 WarpSeedOffset = 0x5BD1E995u;
+
+// ---------------------------------------------------------------------------------
+// Scalar kernel. The reference the vector kernels must match operation for operation.
+// ---------------------------------------------------------------------------------
+
+// Same as the vector floor: truncate, then step down when truncation rounded up.
+// Unlike std::floor it never returns -0, which would change the sign of zero results.
+inline float FloorScalar(float x)
+{
+    const float t = static_cast<float>(static_cast<Int32>(x));
+    return t > x ? t - 1.f : t;
+}
+
+inline Uint32 HashScalar(Uint32 Seed, Uint32 hx, Uint32 hy, Uint32 hz)
+{
+    Uint32 h = (Seed ^ hx ^ hy ^ hz) * HashMult;
+    return h ^ (h >> 15u);
+}
+
+inline float FadeScalar(float t)
+{
+    return t * t * t * (t * (t * 6.f - 15.f) + 10.f);
+}
+
+inline float LerpScalar(float a, float b, float t)
+{
+    return a + t * (b - a);
+}
+
+// Ken Perlin's twelve cube edge gradients, with four of them repeated to fill 16 slots
+inline float Grad3Scalar(Uint32 h, float x, float y, float z)
+{
+    const Uint32 g = h & 15u;
+    const float  u = g < 8u ? x : y;
+    const float  v = g < 4u ? y : (g == 12u || g == 14u ? x : z);
+    return ((g & 1u) ? -u : u) + ((g & 2u) ? -v : v);
+}
+
+// Eight gradients, (+-1, +-0.5) and (+-0.5, +-1)
+inline float Grad2Scalar(Uint32 h, float x, float y)
+{
+    const Uint32 g = h & 7u;
+    const float  u = (g & 4u) ? y : x;
+    const float  v = (g & 4u) ? x : y;
+    return ((g & 1u) ? -u : u) + ((g & 2u) ? -v : v) * 0.5f;
+}
+
+float Noise2DScalar(Uint32 Seed, float x, float y)
+{
+    const float fx = FloorScalar(x);
+    const float fy = FloorScalar(y);
+    const float tx = x - fx;
+    const float ty = y - fy;
+
+    const Uint32 hx0 = static_cast<Uint32>(static_cast<Int32>(fx)) * PrimeX;
+    const Uint32 hy0 = static_cast<Uint32>(static_cast<Int32>(fy)) * PrimeY;
+    const Uint32 hx1 = hx0 + PrimeX;
+    const Uint32 hy1 = hy0 + PrimeY;
+
+    const float g00 = Grad2Scalar(HashScalar(Seed, hx0, hy0, 0), tx, ty);
+    const float g10 = Grad2Scalar(HashScalar(Seed, hx1, hy0, 0), tx - 1.f, ty);
+    const float g01 = Grad2Scalar(HashScalar(Seed, hx0, hy1, 0), tx, ty - 1.f);
+    const float g11 = Grad2Scalar(HashScalar(Seed, hx1, hy1, 0), tx - 1.f, ty - 1.f);
+
+    const float u = FadeScalar(tx);
+    const float v = FadeScalar(ty);
+    return LerpScalar(LerpScalar(g00, g10, u), LerpScalar(g01, g11, u), v);
+}
+
+float Noise3DScalar(Uint32 Seed, float x, float y, float z)
+{
+    const float fx = FloorScalar(x);
+    const float fy = FloorScalar(y);
+    const float fz = FloorScalar(z);
+    const float tx = x - fx;
+    const float ty = y - fy;
+    const float tz = z - fz;
+
+    const Uint32 hx0 = static_cast<Uint32>(static_cast<Int32>(fx)) * PrimeX;
+    const Uint32 hy0 = static_cast<Uint32>(static_cast<Int32>(fy)) * PrimeY;
+    const Uint32 hz0 = static_cast<Uint32>(static_cast<Int32>(fz)) * PrimeZ;
+    const Uint32 hx1 = hx0 + PrimeX;
+    const Uint32 hy1 = hy0 + PrimeY;
+    const Uint32 hz1 = hz0 + PrimeZ;
+
+    const float tx1 = tx - 1.f;
+    const float ty1 = ty - 1.f;
+    const float tz1 = tz - 1.f;
+
+    const float g000 = Grad3Scalar(HashScalar(Seed, hx0, hy0, hz0), tx, ty, tz);
+    const float g100 = Grad3Scalar(HashScalar(Seed, hx1, hy0, hz0), tx1, ty, tz);
+    const float g010 = Grad3Scalar(HashScalar(Seed, hx0, hy1, hz0), tx, ty1, tz);
+    const float g110 = Grad3Scalar(HashScalar(Seed, hx1, hy1, hz0), tx1, ty1, tz);
+    const float g001 = Grad3Scalar(HashScalar(Seed, hx0, hy0, hz1), tx, ty, tz1);
+    const float g101 = Grad3Scalar(HashScalar(Seed, hx1, hy0, hz1), tx1, ty, tz1);
+    const float g011 = Grad3Scalar(HashScalar(Seed, hx0, hy1, hz1), tx, ty1, tz1);
+    const float g111 = Grad3Scalar(HashScalar(Seed, hx1, hy1, hz1), tx1, ty1, tz1);
+
+    const float u = FadeScalar(tx);
+    const float v = FadeScalar(ty);
+    const float w = FadeScalar(tz);
+
+    const float x00 = LerpScalar(g000, g100, u);
+    const float x10 = LerpScalar(g010, g110, u);
+    const float x01 = LerpScalar(g001, g101, u);
+    const float x11 = LerpScalar(g011, g111, u);
+    return LerpScalar(LerpScalar(x00, x10, v), LerpScalar(x01, x11, v), w);
+}
+
+float Fractal2DScalar(const NoiseGenerator::Fractal& Fractal, float x, float y)
+{
+    float Sum = 0;
+    for (Uint32 o = 0; o < Fractal.NumOctaves; ++o)
+    {
+        const NoiseGenerator::Octave& Oct = Fractal.pOctaves[o];
+        Sum                               = Sum + Oct.Amplitude * Noise2DScalar(Oct.Seed, x * Oct.Frequency, y * Oct.Frequency);
+    }
+    return Sum;
+}
+
+float Fractal3DScalar(const NoiseGenerator::Fractal& Fractal, float x, float y, float z)
+{
+    float Sum = 0;
+    for (Uint32 o = 0; o < Fractal.NumOctaves; ++o)
+    {
+        const NoiseGenerator::Octave& Oct = Fractal.pOctaves[o];
+        Sum                               = Sum + Oct.Amplitude * Noise3DScalar(Oct.Seed, x * Oct.Frequency, y * Oct.Frequency, z * Oct.Frequency);
+    }
+    return Sum;
+}
+
+#if SIMD_X86
+
+// ---------------------------------------------------------------------------------
+// SSE2 kernel, four samples at a time
+// ---------------------------------------------------------------------------------
+
+SIMD_TARGET_SSE2 inline __m128 Select4(__m128 Mask, __m128 a, __m128 b)
+{
+    return _mm_or_ps(_mm_and_ps(Mask, a), _mm_andnot_ps(Mask, b));
+}
+
+// SSE2 has no 32-bit multiply that keeps the low halves, so it is assembled from two
+// 32x32->64 multiplies of the even and odd lanes
+SIMD_TARGET_SSE2 inline __m128i MulLo4(__m128i a, __m128i b)
+{
+    const __m128i Even = _mm_mul_epu32(a, b);
+    const __m128i Odd  = _mm_mul_epu32(_mm_srli_si128(a, 4), _mm_srli_si128(b, 4));
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(Even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(Odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+SIMD_TARGET_SSE2 inline __m128 Floor4(__m128 x)
+{
+    const __m128 t = _mm_cvtepi32_ps(_mm_cvttps_epi32(x));
+    return _mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, x), _mm_set1_ps(1.f)));
+}
+
+SIMD_TARGET_SSE2 inline __m128i Hash4(__m128i Seed, __m128i hx, __m128i hy, __m128i hz)
+{
+    const __m128i h = MulLo4(_mm_xor_si128(_mm_xor_si128(Seed, hx), _mm_xor_si128(hy, hz)), _mm_set1_epi32(static_cast<int>(HashMult)));
+    return _mm_xor_si128(h, _mm_srli_epi32(h, 15));
+}
+
+SIMD_TARGET_SSE2 inline __m128 Fade4(__m128 t)
+{
+    const __m128 ttt   = _mm_mul_ps(_mm_mul_ps(t, t), t);
+    const __m128 Inner = _mm_add_ps(_mm_mul_ps(t, _mm_sub_ps(_mm_mul_ps(t, _mm_set1_ps(6.f)), _mm_set1_ps(15.f))), _mm_set1_ps(10.f));
+    return _mm_mul_ps(ttt, Inner);
+}
+
+SIMD_TARGET_SSE2 inline __m128 Lerp4(__m128 a, __m128 b, __m128 t)
+{
+    return _mm_add_ps(a, _mm_mul_ps(t, _mm_sub_ps(b, a)));
+}
+
+// Moves bit Bit of every lane of g to the float sign bit
+SIMD_TARGET_SSE2 inline __m128 SignFromBit4(__m128i g, int Bit)
+{
+    return _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(g, _mm_set1_epi32(1 << Bit)), 31 - Bit));
+}
+
+SIMD_TARGET_SSE2 inline __m128 Grad3_4(__m128i h, __m128 x, __m128 y, __m128 z)
+{
+    const __m128i g      = _mm_and_si128(h, _mm_set1_epi32(15));
+    const __m128  IsLt8  = _mm_castsi128_ps(_mm_cmplt_epi32(g, _mm_set1_epi32(8)));
+    const __m128  IsLt4  = _mm_castsi128_ps(_mm_cmplt_epi32(g, _mm_set1_epi32(4)));
+    const __m128  Is1214 = _mm_castsi128_ps(_mm_or_si128(_mm_cmpeq_epi32(g, _mm_set1_epi32(12)), _mm_cmpeq_epi32(g, _mm_set1_epi32(14))));
+
+    const __m128 u = Select4(IsLt8, x, y);
+    const __m128 v = Select4(IsLt4, y, Select4(Is1214, x, z));
+    return _mm_add_ps(_mm_xor_ps(u, SignFromBit4(g, 0)), _mm_xor_ps(v, SignFromBit4(g, 1)));
+}
+
+SIMD_TARGET_SSE2 inline __m128 Grad2_4(__m128i h, __m128 x, __m128 y)
+{
+    const __m128i g     = _mm_and_si128(h, _mm_set1_epi32(7));
+    const __m128  IsBit = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(g, _mm_set1_epi32(4)), _mm_setzero_si128()));
+
+    const __m128 u = Select4(IsBit, x, y);
+    const __m128 v = Select4(IsBit, y, x);
+    return _mm_add_ps(_mm_xor_ps(u, SignFromBit4(g, 0)), _mm_mul_ps(_mm_xor_ps(v, SignFromBit4(g, 1)), _mm_set1_ps(0.5f)));
+}
+
+SIMD_TARGET_SSE2 __m128 Noise2D_4(Uint32 SeedValue, __m128 x, __m128 y)
+{
+    const __m128i Seed = _mm_set1_epi32(static_cast<int>(SeedValue));
+    const __m128  One  = _mm_set1_ps(1.f);
+    const __m128i Zero = _mm_setzero_si128();
+
+    const __m128 fx = Floor4(x);
+    const __m128 fy = Floor4(y);
+    const __m128 tx = _mm_sub_ps(x, fx);
+    const __m128 ty = _mm_sub_ps(y, fy);
+
+    const __m128i hx0 = MulLo4(_mm_cvttps_epi32(fx), _mm_set1_epi32(static_cast<int>(PrimeX)));
+    const __m128i hy0 = MulLo4(_mm_cvttps_epi32(fy), _mm_set1_epi32(static_cast<int>(PrimeY)));
+    const __m128i hx1 = _mm_add_epi32(hx0, _mm_set1_epi32(static_cast<int>(PrimeX)));
+    const __m128i hy1 = _mm_add_epi32(hy0, _mm_set1_epi32(static_cast<int>(PrimeY)));
+
+    const __m128 tx1 = _mm_sub_ps(tx, One);
+    const __m128 ty1 = _mm_sub_ps(ty, One);
+
+    const __m128 g00 = Grad2_4(Hash4(Seed, hx0, hy0, Zero), tx, ty);
+    const __m128 g10 = Grad2_4(Hash4(Seed, hx1, hy0, Zero), tx1, ty);
+    const __m128 g01 = Grad2_4(Hash4(Seed, hx0, hy1, Zero), tx, ty1);
+    const __m128 g11 = Grad2_4(Hash4(Seed, hx1, hy1, Zero), tx1, ty1);
+
+    const __m128 u = Fade4(tx);
+    const __m128 v = Fade4(ty);
+    return Lerp4(Lerp4(g00, g10, u), Lerp4(g01, g11, u), v);
+}
+
+SIMD_TARGET_SSE2 __m128 Noise3D_4(Uint32 SeedValue, __m128 x, __m128 y, __m128 z)
+{
+    const __m128i Seed = _mm_set1_epi32(static_cast<int>(SeedValue));
+    const __m128  One  = _mm_set1_ps(1.f);
+
+    const __m128 fx = Floor4(x);
+    const __m128 fy = Floor4(y);
+    const __m128 fz = Floor4(z);
+    const __m128 tx = _mm_sub_ps(x, fx);
+    const __m128 ty = _mm_sub_ps(y, fy);
+    const __m128 tz = _mm_sub_ps(z, fz);
+
+    const __m128i hx0 = MulLo4(_mm_cvttps_epi32(fx), _mm_set1_epi32(static_cast<int>(PrimeX)));
+    const __m128i hy0 = MulLo4(_mm_cvttps_epi32(fy), _mm_set1_epi32(static_cast<int>(PrimeY)));
+    const __m128i hz0 = MulLo4(_mm_cvttps_epi32(fz), _mm_set1_epi32(static_cast<int>(PrimeZ)));
+    const __m128i hx1 = _mm_add_epi32(hx0, _mm_set1_epi32(static_cast<int>(PrimeX)));
+    const __m128i hy1 = _mm_add_epi32(hy0, _mm_set1_epi32(static_cast<int>(PrimeY)));
+    const __m128i hz1 = _mm_add_epi32(hz0, _mm_set1_epi32(static_cast<int>(PrimeZ)));
+
+    const __m128 tx1 = _mm_sub_ps(tx, One);
+    const __m128 ty1 = _mm_sub_ps(ty, One);
+    const __m128 tz1 = _mm_sub_ps(tz, One);
+
+    const __m128 g000 = Grad3_4(Hash4(Seed, hx0, hy0, hz0), tx, ty, tz);
+    const __m128 g100 = Grad3_4(Hash4(Seed, hx1, hy0, hz0), tx1, ty, tz);
+    const __m128 g010 = Grad3_4(Hash4(Seed, hx0, hy1, hz0), tx, ty1, tz);
+    const __m128 g110 = Grad3_4(Hash4(Seed, hx1, hy1, hz0), tx1, ty1, tz);
+    const __m128 g001 = Grad3_4(Hash4(Seed, hx0, hy0, hz1), tx, ty, tz1);
+    const __m128 g101 = Grad3_4(Hash4(Seed, hx1, hy0, hz1), tx1, ty, tz1);
+    const __m128 g011 = Grad3_4(Hash4(Seed, hx0, hy1, hz1), tx, ty1, tz1);
+    const __m128 g111 = Grad3_4(Hash4(Seed, hx1, hy1, hz1), tx1, ty1, tz1);
+
+    const __m128 u = Fade4(tx);
+    const __m128 v = Fade4(ty);
+    const __m128 w = Fade4(tz);
+
+    const __m128 x00 = Lerp4(g000, g100, u);
+    const __m128 x10 = Lerp4(g010, g110, u);
+    const __m128 x01 = Lerp4(g001, g101, u);
+    const __m128 x11 = Lerp4(g011, g111, u);
+    return Lerp4(Lerp4(x00, x10, v), Lerp4(x01, x11, v), w);
+}
+
+SIMD_TARGET_SSE2 __m128 Fractal2D_4(const NoiseGenerator::Fractal& Fractal, __m128 x, __m128 y)
+{
+    __m128 Sum = _mm_setzero_ps();
+    for (Uint32 o = 0; o < Fractal.NumOctaves; ++o)
+    {
+        const NoiseGenerator::Octave& Oct  = Fractal.pOctaves[o];
+        const __m128                  Freq = _mm_set1_ps(Oct.Frequency);
+        Sum = _mm_add_ps(Sum, _mm_mul_ps(_mm_set1_ps(Oct.Amplitude), Noise2D_4(Oct.Seed, _mm_mul_ps(x, Freq), _mm_mul_ps(y, Freq))));
+    }
+    return Sum;
+}
+
+SIMD_TARGET_SSE2 __m128 Fractal3D_4(const NoiseGenerator::Fractal& Fractal, __m128 x, __m128 y, __m128 z)
+{
+    __m128 Sum = _mm_setzero_ps();
+    for (Uint32 o = 0; o < Fractal.NumOctaves; ++o)
+    {
+        const NoiseGenerator::Octave& Oct  = Fractal.pOctaves[o];
+        const __m128                  Freq = _mm_set1_ps(Oct.Frequency);
+        Sum = _mm_add_ps(Sum, _mm_mul_ps(_mm_set1_ps(Oct.Amplitude), Noise3D_4(Oct.Seed, _mm_mul_ps(x, Freq), _mm_mul_ps(y, Freq), _mm_mul_ps(z, Freq))));
+    }
+    return Sum;
+}
+
+// ---------------------------------------------------------------------------------
+// AVX2 kernel, eight samples at a time. Same structure as the SSE2 kernel.
+// ---------------------------------------------------------------------------------
+
+SIMD_TARGET_AVX2 inline __m256 Select8(__m256 Mask, __m256 a, __m256 b)
+{
+    return _mm256_blendv_ps(b, a, Mask);
+}
+
+SIMD_TARGET_AVX2 inline __m256 Floor8(__m256 x)
+{
+    // Not _mm256_floor_ps: the truncation sequence is what the other kernels do
+    const __m256 t = _mm256_cvtepi32_ps(_mm256_cvttps_epi32(x));
+    return _mm256_sub_ps(t, _mm256_and_ps(_mm256_cmp_ps(t, x, _CMP_GT_OQ), _mm256_set1_ps(1.f)));
+}
+
+SIMD_TARGET_AVX2 inline __m256i Hash8(__m256i Seed, __m256i hx, __m256i hy, __m256i hz)
+{
+    const __m256i h = _mm256_mullo_epi32(_mm256_xor_si256(_mm256_xor_si256(Seed, hx), _mm256_xor_si256(hy, hz)), _mm256_set1_epi32(static_cast<int>(HashMult)));
+    return _mm256_xor_si256(h, _mm256_srli_epi32(h, 15));
+}
+
+SIMD_TARGET_AVX2 inline __m256 Fade8(__m256 t)
+{
+    const __m256 ttt   = _mm256_mul_ps(_mm256_mul_ps(t, t), t);
+    const __m256 Inner = _mm256_add_ps(_mm256_mul_ps(t, _mm256_sub_ps(_mm256_mul_ps(t, _mm256_set1_ps(6.f)), _mm256_set1_ps(15.f))), _mm256_set1_ps(10.f));
+    return _mm256_mul_ps(ttt, Inner);
+}
+
+SIMD_TARGET_AVX2 inline __m256 Lerp8(__m256 a, __m256 b, __m256 t)
+{
+    return _mm256_add_ps(a, _mm256_mul_ps(t, _mm256_sub_ps(b, a)));
+}
+
+SIMD_TARGET_AVX2 inline __m256 SignFromBit8(__m256i g, int Bit)
+{
+    return _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(g, _mm256_set1_epi32(1 << Bit)), 31 - Bit));
+}
+
+SIMD_TARGET_AVX2 inline __m256 Grad3_8(__m256i h, __m256 x, __m256 y, __m256 z)
+{
+    const __m256i g      = _mm256_and_si256(h, _mm256_set1_epi32(15));
+    const __m256  IsLt8  = _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(8), g));
+    const __m256  IsLt4  = _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(4), g));
+    const __m256  Is1214 = _mm256_castsi256_ps(_mm256_or_si256(_mm256_cmpeq_epi32(g, _mm256_set1_epi32(12)), _mm256_cmpeq_epi32(g, _mm256_set1_epi32(14))));
+
+    const __m256 u = Select8(IsLt8, x, y);
+    const __m256 v = Select8(IsLt4, y, Select8(Is1214, x, z));
+    return _mm256_add_ps(_mm256_xor_ps(u, SignFromBit8(g, 0)), _mm256_xor_ps(v, SignFromBit8(g, 1)));
+}
+
+SIMD_TARGET_AVX2 inline __m256 Grad2_8(__m256i h, __m256 x, __m256 y)
+{
+    const __m256i g     = _mm256_and_si256(h, _mm256_set1_epi32(7));
+    const __m256  IsBit = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(g, _mm256_set1_epi32(4)), _mm256_setzero_si256()));
+
+    const __m256 u = Select8(IsBit, x, y);
+    const __m256 v = Select8(IsBit, y, x);
+    return _mm256_add_ps(_mm256_xor_ps(u, SignFromBit8(g, 0)), _mm256_mul_ps(_mm256_xor_ps(v, SignFromBit8(g, 1)), _mm256_set1_ps(0.5f)));
+}
+
+SIMD_TARGET_AVX2 __m256 Noise2D_8(Uint32 SeedValue, __m256 x, __m256 y)
+{
+    const __m256i Seed = _mm256_set1_epi32(static_cast<int>(SeedValue));
+    const __m256  One  = _mm256_set1_ps(1.f);
+    const __m256i Zero = _mm256_setzero_si256();
+
+    const __m256 fx = Floor8(x);
+    const __m256 fy = Floor8(y);
+    const __m256 tx = _mm256_sub_ps(x, fx);
+    const __m256 ty = _mm256_sub_ps(y, fy);
+
+    const __m256i hx0 = _mm256_mullo_epi32(_mm256_cvttps_epi32(fx), _mm256_set1_epi32(static_cast<int>(PrimeX)));
+    const __m256i hy0 = _mm256_mullo_epi32(_mm256_cvttps_epi32(fy), _mm256_set1_epi32(static_cast<int>(PrimeY)));
+    const __m256i hx1 = _mm256_add_epi32(hx0, _mm256_set1_epi32(static_cast<int>(PrimeX)));
+    const __m256i hy1 = _mm256_add_epi32(hy0, _mm256_set1_epi32(static_cast<int>(PrimeY)));
+
+    const __m256 tx1 = _mm256_sub_ps(tx, One);
+    const __m256 ty1 = _mm256_sub_ps(ty, One);
+
+    const __m256 g00 = Grad2_8(Hash8(Seed, hx0, hy0, Zero), tx, ty);
+    const __m256 g10 = Grad2_8(Hash8(Seed, hx1, hy0, Zero), tx1, ty);
+    const __m256 g01 = Grad2_8(Hash8(Seed, hx0, hy1, Zero), tx, ty1);
+    const __m256 g11 = Grad2_8(Hash8(Seed, hx1, hy1, Zero), tx1, ty1);
+
+    const __m256 u = Fade8(tx);
+    const __m256 v = Fade8(ty);
+    return Lerp8(Lerp8(g00, g10, u), Lerp8(g01, g11, u), v);
+}
+
+SIMD_TARGET_AVX2 __m256 Noise3D_8(Uint32 SeedValue, __m256 x, __m256 y, __m256 z)
+{
+    const __m256i Seed = _mm256_set1_epi32(static_cast<int>(SeedValue));
+    const __m256  One  = _mm256_set1_ps(1.f);
+
+    const __m256 fx = Floor8(x);
+    const __m256 fy = Floor8(y);
+    const __m256 fz = Floor8(z);
+    const __m256 tx = _mm256_sub_ps(x, fx);
+    const __m256 ty = _mm256_sub_ps(y, fy);
+    const __m256 tz = _mm256_sub_ps(z, fz);
+
+    const __m256i hx0 = _mm256_mullo_epi32(_mm256_cvttps_epi32(fx), _mm256_set1_epi32(static_cast<int>(PrimeX)));
+    const __m256i hy0 = _mm256_mullo_epi32(_mm256_cvttps_epi32(fy), _mm256_set1_epi32(static_cast<int>(PrimeY)));
+    const __m256i hz0 = _mm256_mullo_epi32(_mm256_cvttps_epi32(fz), _mm256_set1_epi32(static_cast<int>(PrimeZ)));
+    const __m256i hx1 = _mm256_add_epi32(hx0, _mm256_set1_epi32(static_cast<int>(PrimeX)));
+    const __m256i hy1 = _mm256_add_epi32(hy0, _mm256_set1_epi32(static_cast<int>(PrimeY)));
+    const __m256i hz1 = _mm256_add_epi32(hz0, _mm256_set1_epi32(static_cast<int>(PrimeZ)));
+
+    const __m256 tx1 = _mm256_sub_ps(tx, One);
+    const __m256 ty1 = _mm256_sub_ps(ty, One);
+    const __m256 tz1 = _mm256_sub_ps(tz, One);
+
+    const __m256 g000 = Grad3_8(Hash8(Seed, hx0, hy0, hz0), tx, ty, tz);
+    const __m256 g100 = Grad3_8(Hash8(Seed, hx1, hy0, hz0), tx1, ty, tz);
+    const __m256 g010 = Grad3_8(Hash8(Seed, hx0, hy1, hz0), tx, ty1, tz);
+    const __m256 g110 = Grad3_8(Hash8(Seed, hx1, hy1, hz0), tx1, ty1, tz);
+    const __m256 g001 = Grad3_8(Hash8(Seed, hx0, hy0, hz1), tx, ty, tz1);
+    const __m256 g101 = Grad3_8(Hash8(Seed, hx1, hy0, hz1), tx1, ty, tz1);
+    const __m256 g011 = Grad3_8(Hash8(Seed, hx0, hy1, hz1), tx, ty1, tz1);
+    const __m256 g111 = Grad3_8(Hash8(Seed, hx1, hy1, hz1), tx1, ty1, tz1);
+
+    const __m256 u = Fade8(tx);
+    const __m256 v = Fade8(ty);
+    const __m256 w = Fade8(tz);
+
+    const __m256 x00 = Lerp8(g000, g100, u);
+    const __m256 x10 = Lerp8(g010, g110, u);
+    const __m256 x01 = Lerp8(g001, g101, u);
+    const __m256 x11 = Lerp8(g011, g111, u);
+    return Lerp8(Lerp8(x00, x10, v), Lerp8(x01, x11, v), w);
+}
+
+SIMD_TARGET_AVX2 __m256 Fractal2D_8(const NoiseGenerator::Fractal& Fractal, __m256 x, __m256 y)
+{
+    __m256 Sum = _mm256_setzero_ps();
+    for (Uint32 o = 0; o < Fractal.NumOctaves; ++o)
+    {
+        const NoiseGenerator::Octave& Oct  = Fractal.pOctaves[o];
+        const __m256                  Freq = _mm256_set1_ps(Oct.Frequency);
+        Sum = _mm256_add_ps(Sum, _mm256_mul_ps(_mm256_set1_ps(Oct.Amplitude), Noise2D_8(Oct.Seed, _mm256_mul_ps(x, Freq), _mm256_mul_ps(y, Freq))));
+    }
+    return Sum;
+}
+
+SIMD_TARGET_AVX2 __m256 Fractal3D_8(const NoiseGenerator::Fractal& Fractal, __m256 x, __m256 y, __m256 z)
+{
+    __m256 Sum = _mm256_setzero_ps();
+    for (Uint32 o = 0; o < Fractal.NumOctaves; ++o)
+    {
+        const NoiseGenerator::Octave& Oct  = Fractal.pOctaves[o];
+        const __m256                  Freq = _mm256_set1_ps(Oct.Frequency);
+        Sum = _mm256_add_ps(Sum, _mm256_mul_ps(_mm256_set1_ps(Oct.Amplitude), Noise3D_8(Oct.Seed, _mm256_mul_ps(x, Freq), _mm256_mul_ps(y, Freq), _mm256_mul_ps(z, Freq))));
+    }
+    return Sum;
+}
+
+#endif // SIMD_X86
+
+} // namespace
+
+NoiseGenerator::NoiseGenerator(const NoiseDesc& Desc, SIMD_LEVEL Level) :
+    m_Level{IsSimdLevelSupported(Level) ? Level : GetMaxSimdLevel()},
+    m_WarpAmplitude{Desc.WarpAmplitude}
+{
+    VERIFY(IsSimdLevelSupported(Level), GetSimdLevelName(Level), " noise kernel is not supported by this CPU");
+    VERIFY(Desc.Octaves > 0, "Noise needs at least one octave");
+
+    m_Octaves = MakeOctaves(Desc.Seed, Desc.Frequency, Desc.Octaves, Desc.Lacunarity, Desc.Gain);
+    if (Desc.WarpAmplitude != 0 && Desc.WarpOctaves > 0)
+    {
+        m_NumWarpOctaves = Desc.WarpOctaves;
+        for (Uint32 Axis = 0; Axis < 3; ++Axis)
+        {
+            const auto Octaves = MakeOctaves(Desc.Seed + WarpSeedOffset * (Axis + 1), Desc.WarpFrequency, Desc.WarpOctaves, Desc.Lacunarity, Desc.Gain);
+            m_WarpOctaves.insert(m_WarpOctaves.end(), Octaves.begin(), Octaves.end());
+        }
+    }
+}
+
+std::vector<NoiseGenerator::Octave> NoiseGenerator::MakeOctaves(Uint32 Seed, float Frequency, Uint32 NumOctaves, float Lacunarity, float Gain)
+{
+    std::vector<Octave> Octaves(NumOctaves);
+
+    // Amplitudes are normalized up front so that kernels only multiply and add
+    double TotalAmplitude = 0;
+    double Amplitude      = 1;
+    for (Uint32 o = 0; o < NumOctaves; ++o)
+    {
+        TotalAmplitude += Amplitude;
+        Amplitude *= Gain;
+    }
+
+    double Freq = Frequency;
+    Amplitude   = 1;
+    for (Uint32 o = 0; o < NumOctaves; ++o)
+    {
+        Octaves[o].Seed      = Seed + o;
+        Octaves[o].Frequency = static_cast<float>(Freq);
+        Octaves[o].Amplitude = static_cast<float>(Amplitude / TotalAmplitude);
+        Freq *= Lacunarity;
+        Amplitude *= Gain;
+    }
+    return Octaves;
+}
+
+NoiseGenerator::Fractal NoiseGenerator::GetWarpFractal(Uint32 Axis) const
+{
+    VERIFY_EXPR(Axis < 3 && m_NumWarpOctaves > 0);
+    return {m_WarpOctaves.data() + Axis * m_NumWarpOctaves, m_NumWarpOctaves};
+}
+
+float NoiseGenerator::Sample2D(Int32 x, Int32 z) const
+{
+    float px = static_cast<float>(x);
+    float pz = static_cast<float>(z);
+    if (m_NumWarpOctaves > 0)
+    {
+        // Both displacements are taken at the unwarped position
+        const float wx = px + m_WarpAmplitude * Fractal2DScalar(GetWarpFractal(0), px, pz);
+        const float wz = pz + m_WarpAmplitude * Fractal2DScalar(GetWarpFractal(2), px, pz);
+        px             = wx;
+        pz             = wz;
+    }
+    return Fractal2DScalar(GetFractal(), px, pz);
+}
+
+float NoiseGenerator::Sample3D(Int32 x, Int32 y, Int32 z) const
+{
+    float px = static_cast<float>(x);
+    float py = static_cast<float>(y);
+    float pz = static_cast<float>(z);
+    if (m_NumWarpOctaves > 0)
+    {
+        const float wx = px + m_WarpAmplitude * Fractal3DScalar(GetWarpFractal(0), px, py, pz);
+        const float wy = py + m_WarpAmplitude * Fractal3DScalar(GetWarpFractal(1), px, py, pz);
+        const float wz = pz + m_WarpAmplitude * Fractal3DScalar(GetWarpFractal(2), px, py, pz);
+        px             = wx;
+        py             = wy;
+        pz             = wz;
+    }
+    return Fractal3DScalar(GetFractal(), px, py, pz);
+}
+
+#if SIMD_X86
+
+namespace
+{
+
+SIMD_TARGET_SSE2 void FillColumnGridSSE2(const NoiseGenerator::Fractal& Main, const NoiseGenerator::Fractal* pWarp, float WarpAmplitude, Int32 OriginX, Int32 OriginZ, float* pValues)
+{
+    const __m128i LaneX = _mm_setr_epi32(0, 1, 2, 3);
+    const __m128  Amp   = _mm_set1_ps(WarpAmplitude);
+    for (Int32 z = 0; z < 16; ++z)
+    {
+        const __m128 pz = _mm_cvtepi32_ps(_mm_set1_epi32(OriginZ + z));
+        for (Int32 x = 0; x < 16; x += 4)
+        {
+            __m128 px = _mm_cvtepi32_ps(_mm_add_epi32(_mm_set1_epi32(OriginX + x), LaneX));
+            __m128 qz = pz;
+            if (pWarp != nullptr)
+            {
+                const __m128 wx = _mm_add_ps(px, _mm_mul_ps(Amp, Fractal2D_4(pWarp[0], px, qz)));
+                const __m128 wz = _mm_add_ps(qz, _mm_mul_ps(Amp, Fractal2D_4(pWarp[2], px, qz)));
+                px              = wx;
+                qz              = wz;
+            }
+            _mm_storeu_ps(pValues + z * 16 + x, Fractal2D_4(Main, px, qz));
+        }
+    }
+}
+
+SIMD_TARGET_SSE2 void FillBlockSSE2(const NoiseGenerator::Fractal& Main, const NoiseGenerator::Fractal* pWarp, float WarpAmplitude, Int32 OriginX, Int32 OriginY, Int32 OriginZ, float* pValues)
+{
+    const __m128i LaneX = _mm_setr_epi32(0, 1, 2, 3);
+    const __m128  Amp   = _mm_set1_ps(WarpAmplitude);
+    for (Int32 y = 0; y < 16; ++y)
+    {
+        const __m128 py = _mm_cvtepi32_ps(_mm_set1_epi32(OriginY + y));
+        for (Int32 z = 0; z < 16; ++z)
+        {
+            const __m128 pz = _mm_cvtepi32_ps(_mm_set1_epi32(OriginZ + z));
+            for (Int32 x = 0; x < 16; x += 4)
+            {
+                __m128 px = _mm_cvtepi32_ps(_mm_add_epi32(_mm_set1_epi32(OriginX + x), LaneX));
+                __m128 qy = py;
+                __m128 qz = pz;
+                if (pWarp != nullptr)
+                {
+                    const __m128 wx = _mm_add_ps(px, _mm_mul_ps(Amp, Fractal3D_4(pWarp[0], px, qy, qz)));
+                    const __m128 wy = _mm_add_ps(qy, _mm_mul_ps(Amp, Fractal3D_4(pWarp[1], px, qy, qz)));
+                    const __m128 wz = _mm_add_ps(qz, _mm_mul_ps(Amp, Fractal3D_4(pWarp[2], px, qy, qz)));
+                    px              = wx;
+                    qy              = wy;
+                    qz              = wz;
+                }
+                _mm_storeu_ps(pValues + (y * 16 + z) * 16 + x, Fractal3D_4(Main, px, qy, qz));
+            }
+        }
+    }
+}
+
+SIMD_TARGET_AVX2 void FillColumnGridAVX2(const NoiseGenerator::Fractal& Main, const NoiseGenerator::Fractal* pWarp, float WarpAmplitude, Int32 OriginX, Int32 OriginZ, float* pValues)
+{
+    const __m256i LaneX = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256  Amp   = _mm256_set1_ps(WarpAmplitude);
+    for (Int32 z = 0; z < 16; ++z)
+    {
+        const __m256 pz = _mm256_cvtepi32_ps(_mm256_set1_epi32(OriginZ + z));
+        for (Int32 x = 0; x < 16; x += 8)
+        {
+            __m256 px = _mm256_cvtepi32_ps(_mm256_add_epi32(_mm256_set1_epi32(OriginX + x), LaneX));
+            __m256 qz = pz;
+            if (pWarp != nullptr)
+            {
+                const __m256 wx = _mm256_add_ps(px, _mm256_mul_ps(Amp, Fractal2D_8(pWarp[0], px, qz)));
+                const __m256 wz = _mm256_add_ps(qz, _mm256_mul_ps(Amp, Fractal2D_8(pWarp[2], px, qz)));
+                px              = wx;
+                qz              = wz;
+            }
+            _mm256_storeu_ps(pValues + z * 16 + x, Fractal2D_8(Main, px, qz));
+        }
+    }
+}
+
+SIMD_TARGET_AVX2 void FillBlockAVX2(const NoiseGenerator::Fractal& Main, const NoiseGenerator::Fractal* pWarp, float WarpAmplitude, Int32 OriginX, Int32 OriginY, Int32 OriginZ, float* pValues)
+{
+    const __m256i LaneX = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256  Amp   = _mm256_set1_ps(WarpAmplitude);
+    for (Int32 y = 0; y < 16; ++y)
+    {
+        const __m256 py = _mm256_cvtepi32_ps(_mm256_set1_epi32(OriginY + y));
+        for (Int32 z = 0; z < 16; ++z)
+        {
+            const __m256 pz = _mm256_cvtepi32_ps(_mm256_set1_epi32(OriginZ + z));
+            for (Int32 x = 0; x < 16; x += 8)
+            {
+                __m256 px = _mm256_cvtepi32_ps(_mm256_add_epi32(_mm256_set1_epi32(OriginX + x), LaneX));
+                __m256 qy = py;
+                __m256 qz = pz;
+                if (pWarp != nullptr)
+                {
+                    const __m256 wx = _mm256_add_ps(px, _mm256_mul_ps(Amp, Fractal3D_8(pWarp[0], px, qy, qz)));
+                    const __m256 wy = _mm256_add_ps(qy, _mm256_mul_ps(Amp, Fractal3D_8(pWarp[1], px, qy, qz)));
+                    const __m256 wz = _mm256_add_ps(qz, _mm256_mul_ps(Amp, Fractal3D_8(pWarp[2], px, qy, qz)));
+                    px              = wx;
+                    qy              = wy;
+                    qz              = wz;
+                }
+                _mm256_storeu_ps(pValues + (y * 16 + z) * 16 + x, Fractal3D_8(Main, px, qy, qz));
+            }
+        }
+    }
+}
+
+} // namespace
+
+#endif // SIMD_X86
+
+void NoiseGenerator::FillColumnGrid(Int32 OriginX, Int32 OriginZ, float* pValues) const
+{
+#if SIMD_X86
+    if (m_Level != SIMD_LEVEL_SCALAR)
+    {
+        Fractal        Warp[3];
+        const Fractal* pWarp = nullptr;
+        if (m_NumWarpOctaves > 0)
+        {
+            for (Uint32 Axis = 0; Axis < 3; ++Axis)
+                Warp[Axis] = GetWarpFractal(Axis);
+            pWarp = Warp;
+        }
+
+        if (m_Level == SIMD_LEVEL_AVX2)
+            FillColumnGridAVX2(GetFractal(), pWarp, m_WarpAmplitude, OriginX, OriginZ, pValues);
+        else
+            FillColumnGridSSE2(GetFractal(), pWarp, m_WarpAmplitude, OriginX, OriginZ, pValues);
+        return;
+    }
+#endif
+
+    for (Int32 z = 0; z < 16; ++z)
+    {
+        for (Int32 x = 0; x < 16; ++x)
+            pValues[z * 16 + x] = Sample2D(OriginX + x, OriginZ + z);
+    }
+}
+
+void NoiseGenerator::FillBlock(Int32 OriginX, Int32 OriginY, Int32 OriginZ, float* pValues) const
+{
+#if SIMD_X86
+    if (m_Level != SIMD_LEVEL_SCALAR)
+    {
+        Fractal        Warp[3];
+        const Fractal* pWarp = nullptr;
+        if (m_NumWarpOctaves > 0)
+        {
+            for (Uint32 Axis = 0; Axis < 3; ++Axis)
+                Warp[Axis] = GetWarpFractal(Axis);
+            pWarp = Warp;
+        }
+
+        if (m_Level == SIMD_LEVEL_AVX2)
+            FillBlockAVX2(GetFractal(), pWarp, m_WarpAmplitude, OriginX, OriginY, OriginZ, pValues);
+        else
+            FillBlockSSE2(GetFractal(), pWarp, m_WarpAmplitude, OriginX, OriginY, OriginZ, pValues);
+        return;
+    }
+#endif
+
+    for (Int32 y = 0; y < 16; ++y)
+    {
+        for (Int32 z = 0; z < 16; ++z)
+        {
+            for (Int32 x = 0; x < 16; ++x)
+                pValues[(y * 16 + z) * 16 + x] = Sample3D(OriginX + x, OriginY + y, OriginZ + z);
+        }
+    }
+}
+
+} // namespace Diligent
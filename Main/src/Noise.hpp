@@ -0,0 +1,111 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+#pragma once
+
+#include <vector>
+
+#include "CpuFeatures.hpp"
+
+namespace Diligent
+{
+
+// Fractal gradient noise with optional domain warp
+struct NoiseDesc
+{
+    Uint32 Seed = 0;
+
+    // Frequency of the first octave, in cycles per block
+    float  Frequency  = 1.f / 64.f;
+    Uint32 Octaves    = 4;
+    float  Lacunarity = 2.f;
+    float  Gain       = 0.5f;
+
+    // Sample positions are displaced by up to WarpAmplitude blocks by a second fractal
+    // noise per axis before the main noise is evaluated. Zero disables the warp.
+    float  WarpAmplitude = 0.f;
+    float  WarpFrequency = 1.f / 128.f;
+    Uint32 WarpOctaves   = 2;
+};
+
+// Gradient (Perlin) noise evaluated at integer block positions.
+//
+// Fills use the widest kernel the CPU supports: AVX2 evaluates eight samples at once,
+// SSE2 four, and the scalar kernel one. All kernels perform the same float operations in
+// the same order, with no fused multiply-adds, so they produce bit-identical results and
+// a seed generates the same terrain on every machine. Octave sums are normalized to about
+// [-1, 1].
+class NoiseGenerator
+{
+public:
+    explicit NoiseGenerator(const NoiseDesc& Desc, SIMD_LEVEL Level = GetMaxSimdLevel());
+
+    static constexpr Uint32 ColumnGridSize = 16 * 16;
+    static constexpr Uint32 BlockSize      = 16 * 16 * 16;
+
+    // 2D noise over the XZ plane at (OriginX + x, OriginZ + z), written to pValues[z * 16 + x]
+    void FillColumnGrid(Int32 OriginX, Int32 OriginZ, float* pValues) const;
+
+    // 3D noise at (OriginX + x, OriginY + y, OriginZ + z), written to pValues in
+    // ChunkSection order, i.e. pValues[(y * 16 + z) * 16 + x]
+    void FillBlock(Int32 OriginX, Int32 OriginY, Int32 OriginZ, float* pValues) const;
+
+    // Single samples, always scalar. Equal to the corresponding fill values.
+    float Sample2D(Int32 x, Int32 z) const;
+    float Sample3D(Int32 x, Int32 y, Int32 z) const;
+
+    SIMD_LEVEL GetSimdLevel() const { return m_Level; }
+
+    // Per-octave seed, frequency and normalized amplitude
+    struct Octave
+    {
+        Uint32 Seed      = 0;
+        float  Frequency = 0;
+        float  Amplitude = 0;
+    };
+    struct Fractal
+    {
+        const Octave* pOctaves   = nullptr;
+        Uint32        NumOctaves = 0;
+    };
+
+private:
+    static std::vector<Octave> MakeOctaves(Uint32 Seed, float Frequency, Uint32 NumOctaves, float Lacunarity, float Gain);
+
+    Fractal GetFractal() const { return {m_Octaves.data(), static_cast<Uint32>(m_Octaves.size())}; }
+    Fractal GetWarpFractal(Uint32 Axis) const;
+
+private:
+    SIMD_LEVEL m_Level;
+    float      m_WarpAmplitude = 0;
+
+    std::vector<Octave> m_Octaves;
+    // Warp octaves of the x, y and z displacements, one after the other
+    std::vector<Octave> m_WarpOctaves;
+    Uint32              m_NumWarpOctaves = 0;
+};
+
+} // namespace Diligent
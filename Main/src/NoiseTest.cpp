@@ -0,0 +1,180 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+// Headless noise kernel tests.
+//
+// World generation must produce the same terrain for a seed on every machine, so the
+// SSE2 and AVX2 noise kernels must match the scalar one bit for bit. Fills 2D column
+// grids and 3D blocks with every kernel the CPU supports, over several seeds, octave and
+// domain warp settings and origins on both sides of zero, and compares every value
+// bitwise with the scalar fill and with single samples. Prints the settings that
+// differed and exits with a non-zero code if any did.
+//
+//     NoiseTest
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "Noise.hpp"
+#include "Common/interface/BasicMath.hpp"
+
+using namespace Diligent;
+
+namespace
+{
+
+struct NoiseCase
+{
+    const char* Name;
+    NoiseDesc   Desc;
+};
+
+std::vector<NoiseCase> GetNoiseCases()
+{
+    std::vector<NoiseCase> Cases;
+    for (Uint32 Seed : {0u, 1u, 1234u, 0xDEADBEEFu})
+    {
+        NoiseDesc Desc;
+        Desc.Seed = Seed;
+
+        Desc.Octaves = 1;
+        Cases.push_back({"one_octave", Desc});
+
+        Desc.Octaves = 6;
+        Cases.push_back({"six_octaves", Desc});
+
+        Desc.Frequency  = 1.f / 13.f;
+        Desc.Octaves    = 3;
+        Desc.Lacunarity = 2.7f;
+        Desc.Gain       = 0.35f;
+        Cases.push_back({"odd_lacunarity_and_gain", Desc});
+
+        // Terrain-like settings of the world generator
+        Desc               = NoiseDesc{};
+        Desc.Seed          = Seed;
+        Desc.Frequency     = 1.f / 128.f;
+        Desc.Octaves       = 6;
+        Desc.WarpAmplitude = 24.f;
+        Desc.WarpFrequency = 1.f / 256.f;
+        Desc.WarpOctaves   = 2;
+        Cases.push_back({"warp", Desc});
+
+        Desc.Frequency     = 1.f / 48.f;
+        Desc.Octaves       = 3;
+        Desc.WarpAmplitude = 200.f;
+        Desc.WarpFrequency = 1.f / 37.f;
+        Desc.WarpOctaves   = 3;
+        Cases.push_back({"strong_warp", Desc});
+    }
+    return Cases;
+}
+
+// Origins of the fills, on both sides of zero, off the chunk grid and far out
+// clang-format off
+const int3 Origins[] = {
+    {        0,    0,        0},
+    {      -16,  -16,      -16},
+    {       -7,  -33,       13},
+    {      -41,   48,      -90},
+    {   123457,   64,  -654321},
+    {-29999984, -512, 29999984},
+};
+// clang-format on
+
+Uint32 CountBitDifferences(const std::vector<float>& Values, const std::vector<float>& Reference)
+{
+    Uint32 NumDifferent = 0;
+    for (size_t i = 0; i < Values.size(); ++i)
+        NumDifferent += std::memcmp(&Values[i], &Reference[i], sizeof(float)) != 0 ? 1 : 0;
+    return NumDifferent;
+}
+
+} // namespace
+
+int main()
+{
+    std::vector<SIMD_LEVEL> Levels;
+    for (Uint32 Level = SIMD_LEVEL_SCALAR + 1; Level < SIMD_LEVEL_COUNT; ++Level)
+    {
+        if (IsSimdLevelSupported(static_cast<SIMD_LEVEL>(Level)))
+            Levels.push_back(static_cast<SIMD_LEVEL>(Level));
+        else
+            std::printf("%s is not supported by this CPU, skipped\n", GetSimdLevelName(static_cast<SIMD_LEVEL>(Level)));
+    }
+
+    Uint32 NumChecks = 0;
+    Uint32 NumFailed = 0;
+    auto   Check     = [&](const NoiseCase& Case, const int3& Origin, const char* What, Uint32 NumDifferent) {
+        ++NumChecks;
+        if (NumDifferent != 0)
+        {
+            ++NumFailed;
+            std::printf("FAILED: %s, seed %u, origin (%d, %d, %d): %u %s values differ from the scalar fill\n", Case.Name, Case.Desc.Seed,
+                        Origin.x, Origin.y, Origin.z, NumDifferent, What);
+        }
+    };
+
+    std::vector<float> Reference2D(NoiseGenerator::ColumnGridSize), Reference3D(NoiseGenerator::BlockSize);
+    std::vector<float> Values2D(NoiseGenerator::ColumnGridSize), Values3D(NoiseGenerator::BlockSize);
+    for (const NoiseCase& Case : GetNoiseCases())
+    {
+        const NoiseGenerator Scalar{Case.Desc, SIMD_LEVEL_SCALAR};
+        for (const int3& Origin : Origins)
+        {
+            Scalar.FillColumnGrid(Origin.x, Origin.z, Reference2D.data());
+            Scalar.FillBlock(Origin.x, Origin.y, Origin.z, Reference3D.data());
+
+            // Single samples at corners and in the middle
+            Uint32 NumDifferent = 0;
+            for (const int3& Local : {int3{0, 0, 0}, int3{15, 0, 0}, int3{8, 7, 9}, int3{0, 15, 15}, int3{15, 15, 15}})
+            {
+                const float Value2D = Scalar.Sample2D(Origin.x + Local.x, Origin.z + Local.z);
+                const float Value3D = Scalar.Sample3D(Origin.x + Local.x, Origin.y + Local.y, Origin.z + Local.z);
+                NumDifferent += std::memcmp(&Value2D, &Reference2D[Local.z * 16 + Local.x], sizeof(float)) != 0 ? 1 : 0;
+                NumDifferent += std::memcmp(&Value3D, &Reference3D[(Local.y * 16 + Local.z) * 16 + Local.x], sizeof(float)) != 0 ? 1 : 0;
+            }
+            Check(Case, Origin, "single sample", NumDifferent);
+
+            for (SIMD_LEVEL Level : Levels)
+            {
+                const NoiseGenerator Gen{Case.Desc, Level};
+                Gen.FillColumnGrid(Origin.x, Origin.z, Values2D.data());
+                Gen.FillBlock(Origin.x, Origin.y, Origin.z, Values3D.data());
+
+                char What[64];
+                std::snprintf(What, sizeof(What), "%s 2D", GetSimdLevelName(Level));
+                Check(Case, Origin, What, CountBitDifferences(Values2D, Reference2D));
+                std::snprintf(What, sizeof(What), "%s 3D", GetSimdLevelName(Level));
+                Check(Case, Origin, What, CountBitDifferences(Values3D, Reference3D));
+            }
+        }
+    }
+
+    std::printf("%u of %u noise checks passed\n", NumChecks - NumFailed, NumChecks);
+    return NumFailed == 0 ? 0 : 1;
+}
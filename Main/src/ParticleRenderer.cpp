@@ -0,0 +1,266 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include "ParticleRenderer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "Graphics/GraphicsTools/interface/GraphicsUtilities.h"
+#include "Graphics/GraphicsTools/interface/MapHelper.hpp"
+#include "Common/interface/Timer.hpp"
+
+namespace Diligent
+{
+
+namespace
+{
+
+// Grows on demand, enough for about 40k particles
+constexpr Uint32 InitialInstanceBufferSize = 1u << 20;
+constexpr Uint32 SpriteSize                = 16;
+
+} // namespace
+
+ParticleRenderer::ParticleRenderer(IRenderDevice* pDevice, IDeviceContext* pContext, TEXTURE_FORMAT RTVFormat, TEXTURE_FORMAT DSVFormat) :
+    m_pDevice{pDevice},
+    m_pContext{pContext}
+{
+    StreamingBufferCreateInfo BufferCI;
+    BufferCI.pDevice                 = pDevice;
+    BufferCI.BuffDesc.Name           = "Particle instance buffer";
+    BufferCI.BuffDesc.Usage          = USAGE_DYNAMIC;
+    BufferCI.BuffDesc.BindFlags      = BIND_VERTEX_BUFFER;
+    BufferCI.BuffDesc.CPUAccessFlags = CPU_ACCESS_WRITE;
+    BufferCI.BuffDesc.Size           = InitialInstanceBufferSize;
+    m_Instances                      = StreamingBuffer{BufferCI};
+
+    CreateUniformBuffer(pDevice, sizeof(VSConstants), "Particle VS constants CB", &m_pConstants);
+    CreateSpriteTexture();
+    CreatePipelineState(RTVFormat, DSVFormat);
+}
+
+void ParticleRenderer::CreateSpriteTexture()
+{
+    // White, so that the particle colour tints them, with the shape in alpha
+    std::vector<Uint32> Texels(SpriteSize * SpriteSize * PARTICLE_SPRITE_COUNT);
+    for (Uint32 y = 0; y < SpriteSize; ++y)
+    {
+        for (Uint32 x = 0; x < SpriteSize; ++x)
+        {
+            const float Center = (SpriteSize - 1) * 0.5f;
+            const float Radius = std::sqrt((x - Center) * (x - Center) + (y - Center) * (y - Center)) / (SpriteSize * 0.5f);
+
+            const float PuffAlpha = std::clamp(1.f - Radius, 0.f, 1.f);
+            const float DropAlpha = Radius < 0.5f ? 1.f : 0.f;
+
+            Texels[(PARTICLE_SPRITE_PUFF * SpriteSize + y) * SpriteSize + x] = 0x00FFFFFFu | (static_cast<Uint32>(PuffAlpha * 255.f + 0.5f) << 24u);
+            Texels[(PARTICLE_SPRITE_DROP * SpriteSize + y) * SpriteSize + x] = 0x00FFFFFFu | (static_cast<Uint32>(DropAlpha * 255.f + 0.5f) << 24u);
+        }
+    }
+
+    TextureDesc TexDesc;
+    TexDesc.Name      = "Particle sprites";
+    TexDesc.Type      = RESOURCE_DIM_TEX_2D_ARRAY;
+    TexDesc.Width     = SpriteSize;
+    TexDesc.Height    = SpriteSize;
+    TexDesc.ArraySize = PARTICLE_SPRITE_COUNT;
+    TexDesc.MipLevels = 1;
+    TexDesc.Format    = TEX_FORMAT_RGBA8_UNORM;
+    TexDesc.Usage     = USAGE_IMMUTABLE;
+    TexDesc.BindFlags = BIND_SHADER_RESOURCE;
+
+    TextureSubResData Layers[PARTICLE_SPRITE_COUNT];
+    for (Uint32 Layer = 0; Layer < PARTICLE_SPRITE_COUNT; ++Layer)
+    {
+        Layers[Layer].pData  = &Texels[Layer * SpriteSize * SpriteSize];
+        Layers[Layer].Stride = SpriteSize * sizeof(Uint32);
+    }
+    TextureData InitData{Layers, PARTICLE_SPRITE_COUNT};
+    m_pDevice->CreateTexture(TexDesc, &InitData, &m_pSpriteTexture);
+    VERIFY_EXPR(m_pSpriteTexture);
+}
+
+void ParticleRenderer::CreatePipelineState(TEXTURE_FORMAT RTVFormat, TEXTURE_FORMAT DSVFormat)
+{
+    GraphicsPipelineStateCreateInfo PSOCreateInfo;
+    PSOCreateInfo.PSODesc.Name         = "Particle PSO";
+    PSOCreateInfo.PSODesc.PipelineType = PIPELINE_TYPE_GRAPHICS;
+
+    // clang-format off
+    PSOCreateInfo.GraphicsPipeline.NumRenderTargets                  = 1;
+    PSOCreateInfo.GraphicsPipeline.RTVFormats[0]                     = RTVFormat;
+    PSOCreateInfo.GraphicsPipeline.DSVFormat                         = DSVFormat;
+    PSOCreateInfo.GraphicsPipeline.PrimitiveTopology                 = PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP;
+    // Quads face the camera, whichever way round their corners end up
+    PSOCreateInfo.GraphicsPipeline.RasterizerDesc.CullMode           = CULL_MODE_NONE;
+    // Hidden by the terrain, but not by each other
+    PSOCreateInfo.GraphicsPipeline.DepthStencilDesc.DepthEnable      = True;
+    PSOCreateInfo.GraphicsPipeline.DepthStencilDesc.DepthWriteEnable = False;
+    // clang-format on
+
+    RenderTargetBlendDesc& Blend = PSOCreateInfo.GraphicsPipeline.BlendDesc.RenderTargets[0];
+    Blend.BlendEnable            = True;
+    Blend.SrcBlend               = BLEND_FACTOR_SRC_ALPHA;
+    Blend.DestBlend              = BLEND_FACTOR_INV_SRC_ALPHA;
+    Blend.SrcBlendAlpha          = BLEND_FACTOR_ONE;
+    Blend.DestBlendAlpha         = BLEND_FACTOR_INV_SRC_ALPHA;
+
+    ShaderCreateInfo ShaderCI;
+    ShaderCI.SourceLanguage                  = SHADER_SOURCE_LANGUAGE_HLSL;
+    ShaderCI.Desc.UseCombinedTextureSamplers = true;
+
+    RefCntAutoPtr<IShaderSourceInputStreamFactory> pShaderSourceFactory;
+    m_pDevice->GetEngineFactory()->CreateDefaultShaderSourceStreamFactory(nullptr, &pShaderSourceFactory);
+    ShaderCI.pShaderSourceStreamFactory = pShaderSourceFactory;
+
+    RefCntAutoPtr<IShader> pVS;
+    {
+        ShaderCI.Desc.ShaderType = SHADER_TYPE_VERTEX;
+        ShaderCI.EntryPoint      = "main";
+        ShaderCI.Desc.Name       = "Particle VS";
+        ShaderCI.FilePath        = "assets/particle.vsh";
+        m_pDevice->CreateShader(ShaderCI, &pVS);
+    }
+
+    RefCntAutoPtr<IShader> pPS;
+    {
+        ShaderCI.Desc.ShaderType = SHADER_TYPE_PIXEL;
+        ShaderCI.EntryPoint      = "main";
+        ShaderCI.Desc.Name       = "Particle PS";
+        ShaderCI.FilePath        = "assets/particle.psh";
+        m_pDevice->CreateShader(ShaderCI, &pPS);
+    }
+
+    // clang-format off
+    // Both attributes come from the instance buffer, see ParticleInstance
+    LayoutElement LayoutElems[] =
+    {
+        // Attribute 0 - position and size
+        LayoutElement{0, 0, 4, VT_FLOAT32, False, INPUT_ELEMENT_FREQUENCY_PER_INSTANCE},
+        // Attribute 1 - packed texture coordinates and colour
+        LayoutElement{1, 0, 2, VT_UINT32, False, INPUT_ELEMENT_FREQUENCY_PER_INSTANCE}
+    };
+    // clang-format on
+
+    PSOCreateInfo.pVS = pVS;
+    PSOCreateInfo.pPS = pPS;
+
+    PSOCreateInfo.GraphicsPipeline.InputLayout.LayoutElements = LayoutElems;
+    PSOCreateInfo.GraphicsPipeline.InputLayout.NumElements    = _countof(LayoutElems);
+
+    PSOCreateInfo.PSODesc.ResourceLayout.DefaultVariableType = SHADER_RESOURCE_VARIABLE_TYPE_STATIC;
+
+    // clang-format off
+    // The texture changes with the shader resource binding of each draw
+    ShaderResourceVariableDesc Vars[] =
+    {
+        {SHADER_TYPE_PIXEL, "g_Texture", SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE}
+    };
+    // clang-format on
+    PSOCreateInfo.PSODesc.ResourceLayout.Variables    = Vars;
+    PSOCreateInfo.PSODesc.ResourceLayout.NumVariables = _countof(Vars);
+
+    // clang-format off
+    // Debris shows a quarter of a block face, which must not bleed into its neighbours
+    SamplerDesc SamPointClampDesc
+    {
+        FILTER_TYPE_POINT, FILTER_TYPE_POINT, FILTER_TYPE_LINEAR,
+        TEXTURE_ADDRESS_CLAMP, TEXTURE_ADDRESS_CLAMP, TEXTURE_ADDRESS_CLAMP
+    };
+    ImmutableSamplerDesc ImtblSamplers[] =
+    {
+        {SHADER_TYPE_PIXEL, "g_Texture", SamPointClampDesc}
+    };
+    // clang-format on
+    PSOCreateInfo.PSODesc.ResourceLayout.ImmutableSamplers    = ImtblSamplers;
+    PSOCreateInfo.PSODesc.ResourceLayout.NumImmutableSamplers = _countof(ImtblSamplers);
+
+    m_pDevice->CreateGraphicsPipelineState(PSOCreateInfo, &m_pPSO);
+    VERIFY_EXPR(m_pPSO);
+
+    m_pPSO->GetStaticVariableByName(SHADER_TYPE_VERTEX, "Constants")->Set(m_pConstants);
+    for (auto& pSRB : m_SRBs)
+        m_pPSO->CreateShaderResourceBinding(&pSRB, true);
+    m_SRBs[PARTICLE_TEXTURE_SPRITES]->GetVariableByName(SHADER_TYPE_PIXEL, "g_Texture")->Set(m_pSpriteTexture->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE));
+}
+
+void ParticleRenderer::SetBlockTextures(ITextureView* pSRV)
+{
+    m_SRBs[PARTICLE_TEXTURE_BLOCKS]->GetVariableByName(SHADER_TYPE_PIXEL, "g_Texture")->Set(pSRV);
+}
+
+void ParticleRenderer::Draw(const ParticleSystem& Particles, const float4x4& ViewProj, const float3& CameraRight, const float3& CameraUp)
+{
+    Timer Tmr;
+
+    m_Stats              = {};
+    m_Stats.NumParticles = Particles.GetCount();
+    if (m_Stats.NumParticles == 0)
+        return;
+
+    {
+        MapHelper<VSConstants> Constants(m_pContext, m_pConstants, MAP_WRITE, MAP_FLAG_DISCARD);
+        Constants->ViewProj    = ViewProj.Transpose();
+        Constants->CameraRight = float4{CameraRight, 0};
+        Constants->CameraUp    = float4{CameraUp, 0};
+    }
+
+    // All particles go into the buffer in one write, straight from the particle arrays
+    const Uint32 Offset = m_Instances.Map(m_pContext, m_pDevice, m_Stats.NumParticles * sizeof(ParticleInstance));
+    Particles.WriteInstances(reinterpret_cast<ParticleInstance*>(static_cast<Uint8*>(m_Instances.GetMappedCPUAddress()) + Offset));
+    m_Instances.Unmap();
+
+    m_pContext->SetPipelineState(m_pPSO);
+    IBuffer* pBuffs[] = {m_Instances.GetBuffer()};
+    for (Uint32 t = 0; t < PARTICLE_TEXTURE_COUNT; ++t)
+    {
+        const PARTICLE_TEXTURE Texture = static_cast<PARTICLE_TEXTURE>(t);
+        if (Particles.GetCount(Texture) == 0)
+            continue;
+
+        // The instances of the texture are picked by offsetting the binding, which works
+        // on devices without FirstInstanceLocation too
+        const Uint64 Offsets[] = {Offset + Uint64{Particles.GetFirstInstance(Texture)} * sizeof(ParticleInstance)};
+        m_pContext->SetVertexBuffers(0, _countof(pBuffs), pBuffs, Offsets, RESOURCE_STATE_TRANSITION_MODE_TRANSITION, SET_VERTEX_BUFFERS_FLAG_RESET);
+        m_pContext->CommitShaderResources(m_SRBs[t], RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+
+        DrawAttribs DrawAttrs{4, DRAW_FLAG_VERIFY_ALL};
+        DrawAttrs.NumInstances = Particles.GetCount(Texture);
+        m_pContext->Draw(DrawAttrs);
+        ++m_Stats.NumDrawCalls;
+    }
+
+    // Dynamic buffers do not keep their contents past the frame on every backend, so the
+    // next frame maps the buffer with discard again
+    m_Instances.Reset();
+
+    m_Stats.SubmitTime = Tmr.GetElapsedTime();
+}
+
+} // namespace Diligent
@@ -0,0 +1,100 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include "Graphics/GraphicsEngine/interface/RenderDevice.h"
+#include "Graphics/GraphicsEngine/interface/DeviceContext.h"
+#include "Graphics/GraphicsTools/interface/StreamingBuffer.hpp"
+#include "Common/interface/RefCntAutoPtr.hpp"
+#include "ParticleSystem.hpp"
+
+namespace Diligent
+{
+
+// Draws a ParticleSystem as camera-facing quads.
+//
+// The live particles are written once per frame straight into a mapped StreamingBuffer
+// of per-instance data, grouped by texture, and each texture is drawn with a single
+// instanced draw of a four-vertex strip. There is no vertex buffer: particle.vsh builds
+// the corners from the vertex index and turns them towards the camera with its right
+// and up vectors. Particles are blended over the terrain without writing depth or being
+// sorted, so they are drawn after it.
+class ParticleRenderer
+{
+public:
+    struct DrawStats
+    {
+        Uint32 NumParticles = 0;
+        Uint32 NumDrawCalls = 0;
+        // CPU time spent writing the instances and submitting the draws, in seconds
+        double SubmitTime = 0;
+    };
+
+    ParticleRenderer(IRenderDevice* pDevice, IDeviceContext* pContext, TEXTURE_FORMAT RTVFormat, TEXTURE_FORMAT DSVFormat);
+
+    // clang-format off
+    ParticleRenderer           (const ParticleRenderer&)  = delete;
+    ParticleRenderer           (      ParticleRenderer&&) = delete;
+    ParticleRenderer& operator=(const ParticleRenderer&)  = delete;
+    ParticleRenderer& operator=(      ParticleRenderer&&) = delete;
+    // clang-format on
+
+    // Texture array of PARTICLE_TEXTURE_BLOCKS, see BlockTextureArray
+    void SetBlockTextures(ITextureView* pSRV);
+
+    // Sets its own pipeline state, the render targets must already be set
+    void Draw(const ParticleSystem& Particles, const float4x4& ViewProj, const float3& CameraRight, const float3& CameraUp);
+
+    const DrawStats& GetStats() const { return m_Stats; }
+
+private:
+    void CreatePipelineState(TEXTURE_FORMAT RTVFormat, TEXTURE_FORMAT DSVFormat);
+    void CreateSpriteTexture();
+
+    // Layout must match the Constants cbuffer in particle.vsh
+    struct VSConstants
+    {
+        float4x4 ViewProj;
+        float4   CameraRight;
+        float4   CameraUp;
+    };
+
+    RefCntAutoPtr<IRenderDevice>  m_pDevice;
+    RefCntAutoPtr<IDeviceContext> m_pContext;
+
+    RefCntAutoPtr<IPipelineState> m_pPSO;
+    RefCntAutoPtr<IBuffer>        m_pConstants;
+    RefCntAutoPtr<ITexture>       m_pSpriteTexture;
+    // One per PARTICLE_TEXTURE
+    RefCntAutoPtr<IShaderResourceBinding> m_SRBs[PARTICLE_TEXTURE_COUNT];
+
+    StreamingBuffer m_Instances;
+    DrawStats       m_Stats;
+};
+
+} // namespace Diligent
@@ -0,0 +1,402 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include <algorithm>
+#include <cmath>
+
+#include "ParticleSystem.hpp"
+#include "Common/interface/Timer.hpp"
+
+namespace Diligent
+{
+
+namespace
+{
+
+Uint32 PackChannel(float Value)
+{
+    return static_cast<Uint32>(std::clamp(Value, 0.f, 1.f) * 255.f + 0.5f);
+}
+
+// Brightest light of the block and its neighbours, as the terrain shades it (see
+// cube.psh). Bursts often start inside solid blocks, which are dark, and broken blocks
+// are not relit until the next frame.
+float GetBrightness(const World& Wrld, const int3& Pos)
+{
+    // clang-format off
+    static constexpr int3 Offsets[] =
+    {
+        { 0, 0, 0},
+        {-1, 0, 0}, {1, 0, 0},
+        { 0,-1, 0}, {0, 1, 0},
+        { 0, 0,-1}, {0, 0, 1},
+    };
+    // clang-format on
+
+    Uint32 Light = 0;
+    for (const int3& Offset : Offsets)
+    {
+        const int3 BlockPos = Pos + Offset;
+        // Above the world and in chunks not loaded yet there is only sky
+        const ChunkSection* pSection = Wrld.GetSection(int3{World::BlockToChunk(BlockPos.x), BlockPos.y >> 4, World::BlockToChunk(BlockPos.z)});
+        if (pSection == nullptr)
+            return 1.f;
+
+        const Uint32 Index = ChunkSection::GetIndex(World::BlockToLocal(BlockPos.x), BlockPos.y & 15, World::BlockToLocal(BlockPos.z));
+        Light              = std::max({Light, Uint32{pSection->GetSkyLight().Get(Index)}, Uint32{pSection->GetBlockLight().Get(Index)}});
+    }
+    return std::pow(0.8f, 15.f - static_cast<float>(Light));
+}
+
+// Particles that would go below their floor stop on it. Every product is taken before
+// the selects, as compilers will not turn a branch holding floating-point math into a
+// select unless they may ignore floating-point exceptions, and the arrays are marked as
+// not overlapping, which is more than the compiler will check at run time. Both keep
+// the loop vectorized.
+void IntegrateParticles(Uint32 Count, float dt,
+                        float* __restrict PosX, float* __restrict PosY, float* __restrict PosZ,
+                        float* __restrict VelX, float* __restrict VelY, float* __restrict VelZ,
+                        float* __restrict Life,
+                        const float* __restrict Gravity, const float* __restrict Drag, const float* __restrict FloorY, const float* __restrict LifeRate)
+{
+    for (Uint32 i = 0; i < Count; ++i)
+    {
+        const float Damping = std::max(1.f - Drag[i] * dt, 0.f);
+        const float NewVelX = VelX[i] * Damping;
+        const float NewVelY = (VelY[i] - Gravity[i] * dt) * Damping;
+        const float NewVelZ = VelZ[i] * Damping;
+        const float NewPosY = PosY[i] + NewVelY * dt;
+        const bool  Landed  = NewPosY < FloorY[i];
+
+        PosX[i] += NewVelX * dt;
+        PosY[i] = Landed ? FloorY[i] : NewPosY;
+        PosZ[i] += NewVelZ * dt;
+        VelX[i] = Landed ? 0.f : NewVelX;
+        VelY[i] = Landed ? 0.f : NewVelY;
+        VelZ[i] = Landed ? 0.f : NewVelZ;
+        Life[i] -= LifeRate[i] * dt;
+    }
+}
+
+int3 ToBlockPos(const float3& Pos)
+{
+    return int3{
+        static_cast<Int32>(std::floor(Pos.x)),
+        static_cast<Int32>(std::floor(Pos.y)),
+        static_cast<Int32>(std::floor(Pos.z)),
+    };
+}
+
+} // namespace
+
+Uint32 ParticleDesc::PackColor(float r, float g, float b)
+{
+    return PackChannel(r) | (PackChannel(g) << 8u) | (PackChannel(b) << 16u) | 0xFF000000u;
+}
+
+ParticleSystem::ParticleSystem(Uint32 Capacity, FastRand::StateType Seed) :
+    m_Capacity{Capacity},
+    m_Rand{Seed, 0.f, 1.f}
+{
+    for (std::vector<float>* pArray : {&m_PosX, &m_PosY, &m_PosZ, &m_VelX, &m_VelY, &m_VelZ, &m_Gravity, &m_Drag, &m_FloorY, &m_Life, &m_LifeRate, &m_Size})
+        pArray->resize(Capacity);
+    m_TexCoord.resize(Capacity);
+    m_Color.resize(Capacity);
+}
+
+bool ParticleSystem::Emit(const ParticleDesc& Desc)
+{
+    if (m_Count == m_Capacity)
+    {
+        ++m_NumDropped;
+        return false;
+    }
+
+    // Makes room at the end of the range of the texture by moving the first particle of
+    // every later range to its end
+    Uint32 i = m_Count;
+    for (Uint32 t = PARTICLE_TEXTURE_COUNT - 1; t > Desc.Texture; --t)
+    {
+        const Uint32 First = i - m_TextureCounts[t];
+        Move(First, i);
+        i = First;
+    }
+    ++m_Count;
+    ++m_TextureCounts[Desc.Texture];
+
+    m_PosX[i]     = Desc.Pos.x;
+    m_PosY[i]     = Desc.Pos.y;
+    m_PosZ[i]     = Desc.Pos.z;
+    m_VelX[i]     = Desc.Velocity.x;
+    m_VelY[i]     = Desc.Velocity.y;
+    m_VelZ[i]     = Desc.Velocity.z;
+    m_Gravity[i]  = Desc.Gravity;
+    m_Drag[i]     = Desc.Drag;
+    m_FloorY[i]   = Desc.FloorY;
+    m_Life[i]     = 1.f;
+    m_LifeRate[i] = 1.f / std::max(Desc.Lifetime, 1e-3f);
+    m_Size[i]     = Desc.Size;
+    m_TexCoord[i] = Desc.TexCoord;
+    m_Color[i]    = Desc.Color;
+    return true;
+}
+
+float ParticleSystem::Random(float Min, float Max)
+{
+    return Min + (Max - Min) * m_Rand();
+}
+
+float ParticleSystem::FindFloor(const World& Wrld, const float3& Pos) const
+{
+    const int3 Start = ToBlockPos(Pos);
+    for (Int32 y = Start.y; y > Start.y - MaxFloorDepth; --y)
+    {
+        if (IsSolidBlock(Wrld.GetBlock(Start.x, y, Start.z)))
+            return static_cast<float>(y + 1);
+    }
+    // Falls until it expires
+    return static_cast<float>(Start.y - MaxFloorDepth);
+}
+
+Uint32 ParticleSystem::GetLitColor(const World& Wrld, const float3& Pos, float r, float g, float b) const
+{
+    const float Brightness = GetBrightness(Wrld, ToBlockPos(Pos));
+    return ParticleDesc::PackColor(r * Brightness, g * Brightness, b * Brightness);
+}
+
+void ParticleSystem::EmitBlockBreak(const World& Wrld, const int3& Pos, BlockId Block)
+{
+    // A 4x4x4 grid of debris thrown out from the centre, each showing a random quarter of
+    // one of the block faces
+    const float3 Center = float3{static_cast<float>(Pos.x), static_cast<float>(Pos.y), static_cast<float>(Pos.z)} + float3{0.5f, 0.5f, 0.5f};
+
+    ParticleDesc Desc;
+    Desc.Texture = PARTICLE_TEXTURE_BLOCKS;
+    Desc.FloorY  = FindFloor(Wrld, Center);
+    Desc.Color   = GetLitColor(Wrld, Center, 1.f, 1.f, 1.f);
+    for (Uint32 i = 0; i < 64; ++i)
+    {
+        const float3 Offset{
+            (static_cast<float>(i & 3u) + 0.5f) / 4.f - 0.5f,
+            (static_cast<float>((i >> 2u) & 3u) + 0.5f) / 4.f - 0.5f,
+            (static_cast<float>(i >> 4u) + 0.5f) / 4.f - 0.5f,
+        };
+        const Uint32 Face = std::min(static_cast<Uint32>(Random(0.f, static_cast<float>(BLOCK_FACE_COUNT))), Uint32{BLOCK_FACE_COUNT - 1});
+
+        Desc.Pos      = Center + Offset;
+        Desc.Velocity = Offset * 4.f + float3{Random(-1.f, 1.f), Random(0.f, 2.f), Random(-1.f, 1.f)};
+        Desc.Size     = Random(0.05f, 0.1f);
+        Desc.Lifetime = Random(0.2f, 1.f);
+        Desc.TexCoord = ParticleDesc::PackTexCoord(GetBlockTextureLayer(Block, Face), static_cast<Uint32>(Random(0.f, 12.f)),
+                                                   static_cast<Uint32>(Random(0.f, 12.f)), 4);
+        Emit(Desc);
+    }
+}
+
+void ParticleSystem::EmitSmoke(const World& Wrld, const float3& Pos)
+{
+    const float Grey = Random(0.f, 0.3f);
+
+    ParticleDesc Desc;
+    Desc.Pos      = Pos + float3{Random(-0.05f, 0.05f), 0.f, Random(-0.05f, 0.05f)};
+    Desc.Velocity = float3{Random(-0.1f, 0.1f), Random(0.2f, 0.6f), Random(-0.1f, 0.1f)};
+    Desc.Gravity  = -1.6f;
+    Desc.Drag     = 1.f;
+    Desc.Size     = Random(0.06f, 0.12f);
+    Desc.Lifetime = Random(0.8f, 2.f);
+    // Smoke only rises
+    Desc.FloorY   = Pos.y;
+    Desc.Color    = GetLitColor(Wrld, Pos, Grey, Grey, Grey);
+    Emit(Desc);
+}
+
+void ParticleSystem::EmitSplash(const World& Wrld, const float3& Pos)
+{
+    ParticleDesc Desc;
+    Desc.TexCoord = ParticleDesc::PackTexCoord(PARTICLE_SPRITE_DROP);
+    // Drops land back on the surface
+    Desc.FloorY   = Pos.y;
+    Desc.Color    = GetLitColor(Wrld, Pos, 0.6f, 0.7f, 1.f);
+    for (Uint32 i = 0; i < 8; ++i)
+    {
+        Desc.Pos      = Pos + float3{Random(-0.3f, 0.3f), 0.f, Random(-0.3f, 0.3f)};
+        Desc.Velocity = float3{Random(-1.f, 1.f), Random(2.f, 4.f), Random(-1.f, 1.f)};
+        Desc.Size     = Random(0.04f, 0.06f);
+        Desc.Lifetime = Random(0.3f, 0.7f);
+        Emit(Desc);
+    }
+}
+
+void ParticleSystem::EmitExplosion(const World& Wrld, const float3& Center, float Radius)
+{
+    const float  FloorY   = FindFloor(Wrld, Center);
+    const Uint32 NumPuffs = static_cast<Uint32>(std::clamp(Radius * Radius * 8.f, 16.f, 256.f));
+    for (Uint32 i = 0; i < NumPuffs + NumPuffs / 2; ++i)
+    {
+        float3 Dir{Random(-1.f, 1.f), Random(-1.f, 1.f), Random(-1.f, 1.f)};
+        Dir = length(Dir) > 1e-3f ? normalize(Dir) : float3{0, 1, 0};
+
+        ParticleDesc Desc;
+        Desc.FloorY = FloorY;
+        if (i < NumPuffs)
+        {
+            // Bright puffs bursting out and stopping quickly
+            const float Shade = Random(0.7f, 1.f);
+            Desc.Pos          = Center + Dir * Random(0.f, Radius * 0.5f);
+            Desc.Velocity     = Dir * Random(2.f, 6.f) * (Radius / 4.f);
+            Desc.Gravity      = 0.f;
+            Desc.Drag         = 3.f;
+            Desc.Size         = Random(0.3f, 0.8f);
+            Desc.Lifetime     = Random(0.3f, 0.8f);
+            Desc.Color        = GetLitColor(Wrld, Desc.Pos, Shade, Shade, Shade);
+        }
+        else
+        {
+            // Dark smoke left hanging over the crater
+            const float Shade = Random(0.1f, 0.3f);
+            Desc.Pos          = Center + Dir * Random(0.f, Radius);
+            Desc.Velocity     = float3{0.f, Random(0.2f, 1.f), 0.f};
+            Desc.Gravity      = -1.f;
+            Desc.Drag         = 1.f;
+            Desc.Size         = Random(0.2f, 0.4f);
+            Desc.Lifetime     = Random(1.5f, 3.f);
+            Desc.Color        = ParticleDesc::PackColor(Shade, Shade, Shade);
+        }
+        Emit(Desc);
+    }
+}
+
+void ParticleSystem::Update(float dt)
+{
+    Timer Tmr;
+    dt = std::min(dt, MaxTimeStep);
+
+    IntegrateParticles(m_Count, dt, m_PosX.data(), m_PosY.data(), m_PosZ.data(), m_VelX.data(), m_VelY.data(), m_VelZ.data(), m_Life.data(),
+                       m_Gravity.data(), m_Drag.data(), m_FloorY.data(), m_LifeRate.data());
+
+    Uint32 First = 0;
+    for (Uint32 t = 0; t < PARTICLE_TEXTURE_COUNT; ++t)
+    {
+        const PARTICLE_TEXTURE Texture = static_cast<PARTICLE_TEXTURE>(t);
+        for (Uint32 i = First; i < First + m_TextureCounts[t];)
+        {
+            if (m_Life[i] > 0.f)
+                ++i;
+            else
+                Remove(i, Texture);
+        }
+        First += m_TextureCounts[t];
+    }
+
+    m_LastUpdateTime = Tmr.GetElapsedTime();
+}
+
+void ParticleSystem::Remove(Uint32 Index, PARTICLE_TEXTURE Texture)
+{
+    VERIFY_EXPR(Index >= GetFirstInstance(Texture) && Index < GetFirstInstance(Texture) + m_TextureCounts[Texture]);
+
+    // The last particle of the range takes the place of the removed one, and the last
+    // particle of every later range moves to the start of its range
+    Uint32 Hole = GetFirstInstance(Texture) + m_TextureCounts[Texture] - 1;
+    Move(Hole, Index);
+    --m_TextureCounts[Texture];
+    for (Uint32 t = Texture + 1; t < PARTICLE_TEXTURE_COUNT; ++t)
+    {
+        const Uint32 Last = Hole + m_TextureCounts[t];
+        Move(Last, Hole);
+        Hole = Last;
+    }
+    --m_Count;
+}
+
+void ParticleSystem::Move(Uint32 From, Uint32 To)
+{
+    m_PosX[To]     = m_PosX[From];
+    m_PosY[To]     = m_PosY[From];
+    m_PosZ[To]     = m_PosZ[From];
+    m_VelX[To]     = m_VelX[From];
+    m_VelY[To]     = m_VelY[From];
+    m_VelZ[To]     = m_VelZ[From];
+    m_Gravity[To]  = m_Gravity[From];
+    m_Drag[To]     = m_Drag[From];
+    m_FloorY[To]   = m_FloorY[From];
+    m_Life[To]     = m_Life[From];
+    m_LifeRate[To] = m_LifeRate[From];
+    m_Size[To]     = m_Size[From];
+    m_TexCoord[To] = m_TexCoord[From];
+    m_Color[To]    = m_Color[From];
+}
+
+void ParticleSystem::Clear()
+{
+    m_Count = 0;
+    for (Uint32& Count : m_TextureCounts)
+        Count = 0;
+}
+
+Uint32 ParticleSystem::GetFirstInstance(PARTICLE_TEXTURE Texture) const
+{
+    Uint32 First = 0;
+    for (Uint32 t = 0; t < Texture; ++t)
+        First += m_TextureCounts[t];
+    return First;
+}
+
+void ParticleSystem::WriteInstances(ParticleInstance* pInstances) const
+{
+    // Instances could alias the members as far as the compiler knows, so the arrays are
+    // read through locals to keep it from reloading them on every write
+    const float* const  PosX     = m_PosX.data();
+    const float* const  PosY     = m_PosY.data();
+    const float* const  PosZ     = m_PosZ.data();
+    const float* const  Size     = m_Size.data();
+    const float* const  Life     = m_Life.data();
+    const Uint32* const TexCoord = m_TexCoord.data();
+    const Uint32* const Color    = m_Color.data();
+
+    Uint32 First = 0;
+    for (Uint32 t = 0; t < PARTICLE_TEXTURE_COUNT; ++t)
+    {
+        // Sprites fade out over the second half of their lives, debris stays opaque
+        const bool   Fades = t == PARTICLE_TEXTURE_SPRITES;
+        const Uint32 End   = First + m_TextureCounts[t];
+        for (Uint32 i = First; i < End; ++i)
+        {
+            const float  Fade  = std::clamp(2.f * Life[i], 0.f, 1.f);
+            const Uint32 Faded = (Color[i] & 0x00FFFFFFu) | (static_cast<Uint32>(Fade * static_cast<float>(Color[i] >> 24u)) << 24u);
+
+            ParticleInstance& Instance = pInstances[i];
+            Instance.Pos               = float3{PosX[i], PosY[i], PosZ[i]};
+            Instance.Size              = Size[i];
+            Instance.TexCoord          = TexCoord[i];
+            Instance.Color             = Fades ? Faded : Color[i];
+        }
+        First = End;
+    }
+}
+
+} // namespace Diligent
@@ -0,0 +1,197 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "Common/interface/FastRand.hpp"
+#include "World.hpp"
+
+namespace Diligent
+{
+
+// Textures particles are drawn with, one instanced draw each
+enum PARTICLE_TEXTURE : Uint8
+{
+    // Block texture array, for debris showing a corner of a block face
+    PARTICLE_TEXTURE_BLOCKS = 0,
+    // White sprites tinted by the particle colour, in PARTICLE_SPRITE layers
+    PARTICLE_TEXTURE_SPRITES,
+    PARTICLE_TEXTURE_COUNT
+};
+
+// Layers of the sprite texture (see ParticleRenderer)
+enum PARTICLE_SPRITE : Uint32
+{
+    // Soft round puff for smoke and explosions
+    PARTICLE_SPRITE_PUFF = 0,
+    // Small hard dot for splashes
+    PARTICLE_SPRITE_DROP,
+    PARTICLE_SPRITE_COUNT
+};
+
+// Per-instance data, must match ATTRIB0 and ATTRIB1 in particle.vsh
+struct ParticleInstance
+{
+    float3 Pos;
+    // Half the width of the billboard, in blocks
+    float  Size;
+    // [0..9] texture layer  [10..13] u  [14..17] v  [18..22] extent, in 16ths of the texture
+    Uint32 TexCoord;
+    // RGBA8, alpha fades sprites out as they age
+    Uint32 Color;
+};
+static_assert(sizeof(ParticleInstance) == 24, "Particle instances must be tightly packed");
+
+struct ParticleDesc
+{
+    float3 Pos;
+    // Blocks per second
+    float3 Velocity;
+    // Blocks per second squared, negative to rise
+    float  Gravity = 16.f;
+    // Share of the velocity lost per second
+    float  Drag = 0.4f;
+    float  Size = 0.1f;
+    // Seconds
+    float  Lifetime = 1.f;
+    // Particles stop where they reach this height
+    float  FloorY = 0.f;
+
+    PARTICLE_TEXTURE Texture  = PARTICLE_TEXTURE_SPRITES;
+    Uint32           TexCoord = PackTexCoord(PARTICLE_SPRITE_PUFF);
+    Uint32           Color    = 0xFFFFFFFFu;
+
+    static Uint32 PackTexCoord(Uint32 Layer, Uint32 u = 0, Uint32 v = 0, Uint32 Extent = 16)
+    {
+        VERIFY_EXPR(Layer < 1024 && u < 16 && v < 16 && Extent > 0 && Extent <= 16);
+        return Layer | (u << 10u) | (v << 14u) | (Extent << 18u);
+    }
+
+    // Channels from 0 to 1, opaque
+    static Uint32 PackColor(float r, float g, float b);
+};
+
+// Short-lived visual particles: block debris, torch smoke, splashes and explosions.
+//
+// Particles live in a pool of fixed capacity kept as structure of arrays, so emitting
+// never allocates and Update() runs a plain loop over the attributes that the compiler
+// can vectorize. The pool is kept in one range per texture: an expired particle is
+// replaced with the last one of its range, and the ranges after it shift by moving one
+// particle each. When the pool is full new particles are dropped rather than old ones
+// cut short.
+//
+// Particles do not collide with blocks. Each one gets a floor height when it is emitted,
+// found once for its burst, and stops where it reaches it; lifetimes are short enough
+// that the terrain rarely changes under them. Colours are darkened by the
+// light at the burst when it is emitted.
+//
+// WriteInstances() copies the live particles in pool order, so that the renderer can fill
+// a mapped buffer in one pass and draw each texture range with one instanced draw.
+class ParticleSystem
+{
+public:
+    // clang-format off
+    static constexpr Uint32 DefaultCapacity = 1u << 17;
+    // Longest step Update() takes, so that a hitch does not fling particles through the floor
+    static constexpr float  MaxTimeStep     = 0.1f;
+    // How far below a burst its floor is looked for
+    static constexpr Int32  MaxFloorDepth   = 16;
+    // clang-format on
+
+    explicit ParticleSystem(Uint32 Capacity = DefaultCapacity, FastRand::StateType Seed = 0x50415254u);
+
+    // clang-format off
+    ParticleSystem           (const ParticleSystem&)  = delete;
+    ParticleSystem           (      ParticleSystem&&) = delete;
+    ParticleSystem& operator=(const ParticleSystem&)  = delete;
+    ParticleSystem& operator=(      ParticleSystem&&) = delete;
+    // clang-format on
+
+    // Returns false if the pool is full
+    bool Emit(const ParticleDesc& Desc);
+
+    // Debris of a block that was just broken at Pos, showing its faces
+    void EmitBlockBreak(const World& Wrld, const int3& Pos, BlockId Block);
+    // A wisp of smoke rising from Pos, such as the top of a torch
+    void EmitSmoke(const World& Wrld, const float3& Pos);
+    // Drops thrown up from a fluid surface at Pos
+    void EmitSplash(const World& Wrld, const float3& Pos);
+    // A ball of puffs flying out from Center, followed by smoke
+    void EmitExplosion(const World& Wrld, const float3& Center, float Radius);
+
+    void Update(float dt);
+    void Clear();
+
+    // Writes GetCount() instances to pInstances, those of each texture together starting
+    // at GetFirstInstance()
+    void WriteInstances(ParticleInstance* pInstances) const;
+
+    Uint32 GetCount() const { return m_Count; }
+    Uint32 GetCount(PARTICLE_TEXTURE Texture) const { return m_TextureCounts[Texture]; }
+    Uint32 GetFirstInstance(PARTICLE_TEXTURE Texture) const;
+    Uint32 GetCapacity() const { return m_Capacity; }
+    // Particles dropped because the pool was full
+    Uint64 GetDroppedCount() const { return m_NumDropped; }
+    // CPU time of the last Update(), in seconds
+    double GetLastUpdateTime() const { return m_LastUpdateTime; }
+
+private:
+    float  Random(float Min, float Max);
+    float  FindFloor(const World& Wrld, const float3& Pos) const;
+    Uint32 GetLitColor(const World& Wrld, const float3& Pos, float r, float g, float b) const;
+    void   Remove(Uint32 Index, PARTICLE_TEXTURE Texture);
+    void   Move(Uint32 From, Uint32 To);
+
+    const Uint32 m_Capacity;
+    Uint32       m_Count = 0;
+
+    std::vector<float>  m_PosX;
+    std::vector<float>  m_PosY;
+    std::vector<float>  m_PosZ;
+    std::vector<float>  m_VelX;
+    std::vector<float>  m_VelY;
+    std::vector<float>  m_VelZ;
+    std::vector<float>  m_Gravity;
+    std::vector<float>  m_Drag;
+    std::vector<float>  m_FloorY;
+    // Share of the lifetime left, from 1 down to 0, and how much of it goes per second
+    std::vector<float>  m_Life;
+    std::vector<float>  m_LifeRate;
+    std::vector<float>  m_Size;
+    std::vector<Uint32> m_TexCoord;
+    std::vector<Uint32> m_Color;
+
+    Uint32 m_TextureCounts[PARTICLE_TEXTURE_COUNT] = {};
+
+    FastRandFloat m_Rand;
+    Uint64        m_NumDropped     = 0;
+    double        m_LastUpdateTime = 0;
+};
+
+} // namespace Diligent
@@ -0,0 +1,663 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include "Pathfinder.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
+
+#include "Common/interface/Timer.hpp"
+
+namespace Diligent
+{
+
+namespace
+{
+
+// clang-format off
+const int3 HorizontalOffsets[4] = {{-1, 0, 0}, {1, 0, 0}, {0, 0, -1}, {0, 0, 1}};
+const int3 SectionOffsets[6]    = {{-1, 0, 0}, {1, 0, 0}, {0, -1, 0}, {0, 1, 0}, {0, 0, -1}, {0, 0, 1}};
+const int3 Up{0, 1, 0};
+// clang-format on
+
+int3 GetSectionPos(const int3& Pos)
+{
+    return int3{Pos.x >> 4, Pos.y >> 4, Pos.z >> 4};
+}
+
+Uint64 GetSectionKey(const int3& Pos)
+{
+    return World::PackSectionKey(GetSectionPos(Pos));
+}
+
+// Cheapest a path from Pos to Goal can be: every block across costs at least one, a
+// block up at least one more and a block down at least half
+float EstimateCost(const int3& Pos, const int3& Goal)
+{
+    const Int32 dy = Goal.y - Pos.y;
+    return static_cast<float>(std::abs(Goal.x - Pos.x) + std::abs(Goal.z - Pos.z)) + (dy > 0 ? static_cast<float>(dy) : static_cast<float>(-dy) * 0.5f);
+}
+
+// Sections between two sections along the axes
+Uint32 EstimateRouteCost(const int3& SectionPos, const int3& GoalSection)
+{
+    return static_cast<Uint32>(std::abs(GoalSection.x - SectionPos.x) + std::abs(GoalSection.y - SectionPos.y) + std::abs(GoalSection.z - SectionPos.z));
+}
+
+// Min-heap order, breaking ties towards the deepest node
+bool IsWorseEntry(float F0, float G0, float F1, float G1)
+{
+    return F0 > F1 || (F0 == F1 && G0 < G1);
+}
+
+int3 UnpackSectionKey(Uint64 Key)
+{
+    // Sign-extends the 28-bit x and z and the 8-bit y, see World::PackSectionKey()
+    return int3{
+        static_cast<Int32>(static_cast<Uint32>(Key >> 36u) << 4u) >> 4,
+        static_cast<Int32>(static_cast<Uint32>(Key) << 24u) >> 24,
+        static_cast<Int32>(static_cast<Uint32>(Key >> 8u) << 4u) >> 4,
+    };
+}
+
+bool IsInSections(const std::vector<Uint64>& Sections, Uint64 Key)
+{
+    return std::binary_search(Sections.begin(), Sections.end(), Key);
+}
+
+void SortUnique(std::vector<Uint64>& Keys)
+{
+    std::sort(Keys.begin(), Keys.end());
+    Keys.erase(std::unique(Keys.begin(), Keys.end()), Keys.end());
+}
+
+} // namespace
+
+// Reads blocks, looking the chunk up only when the column moves to another one
+class Pathfinder::BlockReader
+{
+public:
+    explicit BlockReader(const World& Wrld) :
+        m_World{Wrld}
+    {}
+
+    BlockId GetBlock(const int3& Pos)
+    {
+        if (Pos.y < 0 || Pos.y >= Chunk::Height)
+            return BLOCK_AIR;
+
+        const Int32 ChunkX = World::BlockToChunk(Pos.x);
+        const Int32 ChunkZ = World::BlockToChunk(Pos.z);
+        if (ChunkX != m_ChunkX || ChunkZ != m_ChunkZ)
+        {
+            m_pChunk = m_World.GetChunk(ChunkX, ChunkZ);
+            m_ChunkX = ChunkX;
+            m_ChunkZ = ChunkZ;
+        }
+        return m_pChunk != nullptr ? m_pChunk->GetBlock(World::BlockToLocal(Pos.x), Pos.y, World::BlockToLocal(Pos.z)) : BlockId{BLOCK_AIR};
+    }
+
+    bool IsPassable(const int3& Pos) { return IsPassableBlock(GetBlock(Pos)); }
+
+    // Unloaded chunks read as air, so there is nothing to stand on in them
+    bool CanStandIn(const int3& Pos)
+    {
+        return IsPassable(Pos) && IsPassable(Pos + Up) && IsSolidBlock(GetBlock(Pos - Up));
+    }
+
+    // Calls Handler(const int3& To, float Cost) for every block a mob standing in Pos can
+    // move to in one step
+    template <typename HandlerType>
+    void ForEachMove(const int3& Pos, HandlerType&& Handler)
+    {
+        const bool HasHeadRoom = IsPassable(Pos + Up * 2);
+        for (const int3& Offset : HorizontalOffsets)
+        {
+            const int3 To = Pos + Offset;
+            if (CanStandIn(To))
+            {
+                Handler(To, 1.f);
+            }
+            else if (HasHeadRoom && CanStandIn(To + Up))
+            {
+                Handler(To + Up, 2.f);
+            }
+            else if (IsPassable(To) && IsPassable(To + Up))
+            {
+                // Nothing solid is below To, or the mob could stand in it
+                for (Int32 Drop = 1; Drop <= MaxDrop; ++Drop)
+                {
+                    const int3 Below = To - Up * Drop;
+                    if (!IsPassable(Below))
+                        break;
+                    if (IsSolidBlock(GetBlock(Below - Up)))
+                    {
+                        Handler(Below, 1.f + static_cast<float>(Drop) * 0.5f);
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+private:
+    const World& m_World;
+    const Chunk* m_pChunk = nullptr;
+    Int32        m_ChunkX = std::numeric_limits<Int32>::min();
+    Int32        m_ChunkZ = std::numeric_limits<Int32>::min();
+};
+
+Pathfinder::Pathfinder(Int32 HierarchicalDistance) :
+    m_HierarchicalDistance{HierarchicalDistance},
+    m_NodeTable(MaxNodes * 2)
+{
+    // The pool never grows past its capacity, so references to nodes stay valid
+    m_Nodes.reserve(MaxNodes);
+}
+
+bool Pathfinder::CanStandIn(const World& Wrld, const int3& Pos)
+{
+    BlockReader Reader{Wrld};
+    return Reader.CanStandIn(Pos);
+}
+
+PathRequestId Pathfinder::RequestPath(const int3& Start, const int3& Goal)
+{
+    // Cached paths through changed blocks must not be handed out
+    DropDirtySections();
+
+    const PathRequestId Id  = m_NextId++;
+    Request&            Req = m_Requests[Id];
+    Req.Start               = Start;
+    Req.Goal                = Goal;
+
+    if (CachedPath* pCached = FindCachedPath(Start, Goal))
+    {
+        const auto StartIt = std::find(pCached->Path.begin(), pCached->Path.end(), Start);
+        if (pCached->Goal == Goal && StartIt != pCached->Path.end())
+        {
+            Req.Path.assign(StartIt, pCached->Path.end());
+            Req.Status       = PATH_STATUS_FOUND;
+            pCached->LastUse = ++m_UseCounter;
+            ++m_NumPathReuses;
+            return Id;
+        }
+    }
+
+    m_Queue.push_back(Id);
+    return Id;
+}
+
+PATH_STATUS Pathfinder::TakePath(PathRequestId Id, std::vector<int3>& Path)
+{
+    auto It = m_Requests.find(Id);
+    if (It == m_Requests.end())
+        return PATH_STATUS_INVALID;
+
+    const PATH_STATUS Status = It->second.Status;
+    if (Status != PATH_STATUS_PENDING)
+    {
+        Path = std::move(It->second.Path);
+        m_Requests.erase(It);
+    }
+    return Status;
+}
+
+void Pathfinder::Cancel(PathRequestId Id)
+{
+    // Cancelled requests are skipped when they come up in the queue
+    if (m_Requests.erase(Id) != 0 && !m_Queue.empty() && m_Queue.front() == Id)
+        m_IsSearching = false;
+}
+
+void Pathfinder::OnBlockChanged(const int3& Pos)
+{
+    // Whether a mob can stand in a block depends on the blocks above and below it
+    m_DirtySections.insert(GetSectionKey(Pos));
+    m_DirtySections.insert(GetSectionKey(Pos + Up));
+    m_DirtySections.insert(GetSectionKey(Pos - Up * 2));
+}
+
+void Pathfinder::OnChunkChanged(Int32 ChunkX, Int32 ChunkZ)
+{
+    for (Int32 y = 0; y < Chunk::NumSections; ++y)
+        m_DirtySections.insert(World::PackSectionKey(int3{ChunkX, y, ChunkZ}));
+}
+
+void Pathfinder::DropDirtySections()
+{
+    if (m_DirtySections.empty())
+        return;
+
+    // Summaries of the neighbours say whether they lead into the changed sections
+    for (Uint64 Key : m_DirtySections)
+    {
+        m_Summaries.erase(Key);
+        const int3 SectionPos = UnpackSectionKey(Key);
+        for (const int3& Offset : SectionOffsets)
+            m_Summaries.erase(World::PackSectionKey(SectionPos + Offset));
+    }
+
+    m_Cache.erase(std::remove_if(m_Cache.begin(), m_Cache.end(),
+                                 [this](const CachedPath& Cached) {
+                                     return std::any_of(Cached.Sections.begin(), Cached.Sections.end(), [this](Uint64 Key) {
+                                         return m_DirtySections.count(Key) != 0;
+                                     });
+                                 }),
+                  m_Cache.end());
+    m_DirtySections.clear();
+}
+
+void Pathfinder::Tick(const World& Wrld, Uint32 IterationBudget)
+{
+    Timer Tmr;
+
+    DropDirtySections();
+
+    BlockReader Reader{Wrld};
+    m_TickBudget         = static_cast<Int32>(std::min(IterationBudget, static_cast<Uint32>(std::numeric_limits<Int32>::max())));
+    Int32 Budget         = m_TickBudget;
+    m_LastIterationCount = 0;
+    while (Budget > 0 && !m_Queue.empty())
+    {
+        auto It = m_Requests.find(m_Queue.front());
+        if (It == m_Requests.end())
+        {
+            m_Queue.pop_front();
+            continue;
+        }
+
+        Request& Req = It->second;
+        if (!m_IsSearching && !BeginSearch(Reader, Req))
+        {
+            m_Queue.pop_front();
+            continue;
+        }
+        // The route search may stop with some budget left, which is not enough to go on
+        if (m_IsFindingRoute && !StepRoute(Reader, Req, Budget))
+            break;
+        if (StepSearch(Reader, Req, Budget))
+            m_Queue.pop_front();
+    }
+
+    m_LastBudgetSpent = static_cast<Uint32>(m_TickBudget - Budget);
+    m_LastTickTime    = Tmr.GetElapsedTime();
+}
+
+bool Pathfinder::BeginSearch(BlockReader& Reader, Request& Req)
+{
+    if (!Reader.CanStandIn(Req.Start) || !Reader.CanStandIn(Req.Goal))
+    {
+        FinishSearch(Req, PATH_STATUS_NOT_FOUND);
+        return false;
+    }
+
+    // Long paths are searched along a route through the sections, cached or found now
+    m_Route.clear();
+    if (const CachedPath* pCached = FindCachedPath(Req.Start, Req.Goal))
+    {
+        if (!pCached->Route.empty())
+        {
+            m_Route = pCached->Route;
+            ++m_NumRouteReuses;
+        }
+    }
+    m_IsSearching       = true;
+    const int3 Distance = Req.Goal - Req.Start;
+    if (m_Route.empty() && std::abs(Distance.x) + std::abs(Distance.z) > m_HierarchicalDistance)
+        BeginRoute(Req.Start, Req.Goal);
+    else
+        BeginBlockSearch(Req);
+    return true;
+}
+
+void Pathfinder::BeginBlockSearch(const Request& Req)
+{
+    m_IsFindingRoute = false;
+    m_IsUsingRoute   = !m_Route.empty();
+    ResetNodes(Req.Start, Req.Goal);
+}
+
+void Pathfinder::ResetNodes(const int3& Start, const int3& Goal)
+{
+    // Entries of earlier searches have older stamps. When the stamp wraps around, they
+    // could match again and are cleared.
+    if (++m_Stamp == 0)
+    {
+        std::fill(m_NodeTable.begin(), m_NodeTable.end(), NodeTableEntry{});
+        m_Stamp = 1;
+    }
+    m_Nodes.clear();
+    m_Open.clear();
+
+    bool         IsNew = false;
+    const Uint32 Idx   = FindOrAddNode(Start, IsNew);
+    m_Open.push_back(OpenEntry{EstimateCost(Start, Goal), 0, Idx});
+}
+
+Uint32 Pathfinder::FindOrAddNode(const int3& Pos, bool& IsNew)
+{
+    const Uint64 Key  = World::PackSectionKey(Pos);
+    const Uint32 Mask = static_cast<Uint32>(m_NodeTable.size() - 1);
+    for (Uint32 i = static_cast<Uint32>((Key * 0x9E3779B97F4A7C15ull) >> 32u) & Mask;; i = (i + 1) & Mask)
+    {
+        NodeTableEntry& Entry = m_NodeTable[i];
+        if (Entry.Stamp != m_Stamp)
+        {
+            // The table has twice as many entries as the pool has nodes, so a free entry
+            // is always found
+            IsNew = true;
+            if (m_Nodes.size() == MaxNodes)
+                return ~0u;
+            Entry.Key   = Key;
+            Entry.Node  = static_cast<Uint32>(m_Nodes.size());
+            Entry.Stamp = m_Stamp;
+            m_Nodes.emplace_back();
+            m_Nodes.back().Pos = Pos;
+            return Entry.Node;
+        }
+        if (Entry.Key == Key)
+        {
+            IsNew = false;
+            return Entry.Node;
+        }
+    }
+}
+
+bool Pathfinder::StepSearch(BlockReader& Reader, Request& Req, Int32& Budget)
+{
+    auto IsWorse = [](const OpenEntry& a, const OpenEntry& b) {
+        return IsWorseEntry(a.F, a.G, b.F, b.G);
+    };
+
+    while (Budget > 0)
+    {
+        if (m_Open.empty())
+        {
+            // The route may have missed a way around, so the whole world is searched
+            if (m_IsUsingRoute)
+            {
+                m_IsUsingRoute = false;
+                m_Route.clear();
+                ResetNodes(Req.Start, Req.Goal);
+                continue;
+            }
+            FinishSearch(Req, PATH_STATUS_NOT_FOUND);
+            return true;
+        }
+
+        std::pop_heap(m_Open.begin(), m_Open.end(), IsWorse);
+        const OpenEntry Entry = m_Open.back();
+        m_Open.pop_back();
+
+        // Nodes are pushed again when a cheaper way to them is found, instead of being
+        // moved up the heap, and the stale entries are skipped
+        Node& Current = m_Nodes[Entry.Node];
+        if (Current.IsClosed || Entry.G != Current.G)
+            continue;
+
+        --Budget;
+        ++m_LastIterationCount;
+        Current.IsClosed = true;
+
+        if (Current.Pos == Req.Goal)
+        {
+            Req.Path.clear();
+            for (Uint32 Idx = Entry.Node; Idx != ~0u; Idx = m_Nodes[Idx].Parent)
+                Req.Path.push_back(m_Nodes[Idx].Pos);
+            std::reverse(Req.Path.begin(), Req.Path.end());
+            FinishSearch(Req, PATH_STATUS_FOUND);
+            return true;
+        }
+
+        const Uint32 CurrentIdx = Entry.Node;
+        const float  CurrentG   = Current.G;
+        Reader.ForEachMove(Current.Pos, [&](const int3& To, float Cost) {
+            if (m_IsUsingRoute && !IsInSections(m_Route, GetSectionKey(To)))
+                return;
+
+            // Nodes past the pool capacity are not searched
+            bool         IsNew = false;
+            const Uint32 Idx   = FindOrAddNode(To, IsNew);
+            if (Idx == ~0u)
+                return;
+
+            Node&       Next = m_Nodes[Idx];
+            const float G    = CurrentG + Cost;
+            if (!IsNew && (Next.IsClosed || Next.G <= G))
+                return;
+
+            Next.G      = G;
+            Next.Parent = CurrentIdx;
+            m_Open.push_back(OpenEntry{G + EstimateCost(To, Req.Goal), G, Idx});
+            std::push_heap(m_Open.begin(), m_Open.end(), IsWorse);
+        });
+    }
+    return false;
+}
+
+void Pathfinder::FinishSearch(Request& Req, PATH_STATUS Status)
+{
+    Req.Status    = Status;
+    m_IsSearching = false;
+    if (Status == PATH_STATUS_FOUND)
+        CachePath(Req);
+}
+
+Pathfinder::CachedPath* Pathfinder::FindCachedPath(const int3& Start, const int3& Goal)
+{
+    const int3 StartSection = GetSectionPos(Start);
+    const int3 GoalSection  = GetSectionPos(Goal);
+
+    // Prefers the path to the same goal, which can be taken whole
+    CachedPath* pFound = nullptr;
+    for (CachedPath& Cached : m_Cache)
+    {
+        if (Cached.StartSection != StartSection || Cached.GoalSection != GoalSection)
+            continue;
+        if (Cached.Goal == Goal)
+            return &Cached;
+        pFound = &Cached;
+    }
+    return pFound;
+}
+
+void Pathfinder::CachePath(const Request& Req)
+{
+    CachedPath* pCached = nullptr;
+    for (CachedPath& Cached : m_Cache)
+    {
+        if (Cached.StartSection == GetSectionPos(Req.Start) && Cached.GoalSection == GetSectionPos(Req.Goal) && Cached.Goal == Req.Goal)
+            pCached = &Cached;
+    }
+    if (pCached == nullptr)
+    {
+        if (m_Cache.size() < MaxCachedPaths)
+        {
+            pCached = &m_Cache.emplace_back();
+        }
+        else
+        {
+            pCached = &*std::min_element(m_Cache.begin(), m_Cache.end(), [](const CachedPath& a, const CachedPath& b) {
+                return a.LastUse < b.LastUse;
+            });
+        }
+    }
+
+    pCached->StartSection = GetSectionPos(Req.Start);
+    pCached->GoalSection  = GetSectionPos(Req.Goal);
+    pCached->Goal         = Req.Goal;
+    pCached->Path         = Req.Path;
+    pCached->Route        = m_IsUsingRoute ? m_Route : std::vector<Uint64>{};
+    pCached->Sections     = pCached->Route;
+    for (const int3& Pos : Req.Path)
+        pCached->Sections.push_back(GetSectionKey(Pos));
+    SortUnique(pCached->Sections);
+    pCached->LastUse = ++m_UseCounter;
+}
+
+bool Pathfinder::HasSectionSummary(const int3& SectionPos) const
+{
+    // Sections outside the world are never summarized and cost nothing
+    return SectionPos.y < 0 || SectionPos.y >= Chunk::NumSections || m_Summaries.count(World::PackSectionKey(SectionPos)) != 0;
+}
+
+const Pathfinder::SectionSummary& Pathfinder::GetSectionSummary(BlockReader& Reader, const int3& SectionPos, Int32& Budget)
+{
+    auto Inserted = m_Summaries.emplace(World::PackSectionKey(SectionPos), SectionSummary{});
+    if (!Inserted.second)
+        return Inserted.first->second;
+
+    SectionSummary& Summary = Inserted.first->second;
+    if (SectionPos.y < 0 || SectionPos.y >= Chunk::NumSections)
+        return Summary;
+
+    Budget -= static_cast<Int32>(SectionSummaryCost);
+
+    // Moves out of the section by one step, of blocks next to its faces
+    auto AddExits = [&](const int3& Pos) {
+        Reader.ForEachMove(Pos, [&](const int3& To, float) {
+            const int3 ToSection = GetSectionPos(To);
+            for (Uint32 Face = 0; Face < 6; ++Face)
+            {
+                const int3 Offset = ToSection - SectionPos;
+                if (Offset == SectionOffsets[Face])
+                    Summary.OpenFaces |= static_cast<Uint8>(1u << Face);
+            }
+        });
+    };
+
+    const int3 Origin = SectionPos * 16;
+    for (Int32 y = 0; y < 16; ++y)
+    {
+        for (Int32 z = 0; z < 16; ++z)
+        {
+            for (Int32 x = 0; x < 16; ++x)
+            {
+                const int3 Pos = Origin + int3{x, y, z};
+                if (!Reader.CanStandIn(Pos))
+                    continue;
+                Summary.CanStandIn = true;
+                // Only moves from the border, or dropping from near the bottom, leave the section
+                if (x == 0 || x == 15 || z == 0 || z == 15 || y == 15 || y < MaxDrop)
+                    AddExits(Pos);
+            }
+        }
+    }
+    return Summary;
+}
+
+void Pathfinder::BeginRoute(const int3& Start, const int3& Goal)
+{
+    const int3 StartSection = GetSectionPos(Start);
+
+    m_IsFindingRoute = true;
+    m_RouteNodes.clear();
+    m_RouteNodeIndices.clear();
+    m_RouteOpen.clear();
+    m_RouteNodes.push_back(RouteNode{StartSection});
+    m_RouteNodeIndices.emplace(World::PackSectionKey(StartSection), 0u);
+    m_RouteOpen.push_back(OpenEntry{static_cast<float>(EstimateRouteCost(StartSection, GetSectionPos(Goal))), 0, 0});
+}
+
+bool Pathfinder::StepRoute(BlockReader& Reader, const Request& Req, Int32& Budget)
+{
+    const int3 GoalSection = GetSectionPos(Req.Goal);
+
+    auto IsWorse = [](const OpenEntry& a, const OpenEntry& b) {
+        return IsWorseEntry(a.F, a.G, b.F, b.G);
+    };
+
+    while (Budget > 0)
+    {
+        // Without a route the block search goes through the whole world
+        if (m_RouteOpen.empty() || m_RouteNodes.size() >= MaxRouteNodes)
+        {
+            BeginBlockSearch(Req);
+            return true;
+        }
+
+        const Uint32 CurrentIdx = m_RouteOpen.front().Node;
+        const int3   SectionPos = m_RouteNodes[CurrentIdx].SectionPos;
+        if (m_RouteNodes[CurrentIdx].IsClosed)
+        {
+            std::pop_heap(m_RouteOpen.begin(), m_RouteOpen.end(), IsWorse);
+            m_RouteOpen.pop_back();
+            continue;
+        }
+
+        // A section is summarized in one go, so it waits for the next tick unless the
+        // budget left covers it. A tick whose whole budget is smaller summarizes it anyway.
+        const bool NeedsSummary = SectionPos != GoalSection && !HasSectionSummary(SectionPos);
+        if (NeedsSummary && Budget <= static_cast<Int32>(SectionSummaryCost) && Budget < m_TickBudget)
+            return false;
+
+        std::pop_heap(m_RouteOpen.begin(), m_RouteOpen.end(), IsWorse);
+        m_RouteOpen.pop_back();
+        m_RouteNodes[CurrentIdx].IsClosed = true;
+        --Budget;
+
+        if (SectionPos == GoalSection)
+        {
+            // Sections above and below the route are added, as paths along a slope or
+            // over a bump cross into them
+            for (Uint32 Idx = CurrentIdx; Idx != ~0u; Idx = m_RouteNodes[Idx].Parent)
+            {
+                for (Int32 dy = -1; dy <= 1; ++dy)
+                    m_Route.push_back(World::PackSectionKey(m_RouteNodes[Idx].SectionPos + int3{0, dy, 0}));
+            }
+            SortUnique(m_Route);
+            BeginBlockSearch(Req);
+            return true;
+        }
+
+        const Uint8  OpenFaces = GetSectionSummary(Reader, SectionPos, Budget).OpenFaces;
+        const Uint32 G         = m_RouteNodes[CurrentIdx].G + 1;
+        for (Uint32 Face = 0; Face < 6; ++Face)
+        {
+            if ((OpenFaces & (1u << Face)) == 0)
+                continue;
+
+            const int3 NextSection = SectionPos + SectionOffsets[Face];
+            auto       Inserted    = m_RouteNodeIndices.emplace(World::PackSectionKey(NextSection), static_cast<Uint32>(m_RouteNodes.size()));
+            if (Inserted.second)
+                m_RouteNodes.push_back(RouteNode{NextSection});
+
+            RouteNode& Next = m_RouteNodes[Inserted.first->second];
+            if (Next.IsClosed || (!Inserted.second && Next.G <= G))
+                continue;
+            Next.G      = G;
+            Next.Parent = CurrentIdx;
+            m_RouteOpen.push_back(OpenEntry{static_cast<float>(G + EstimateRouteCost(NextSection, GoalSection)), static_cast<float>(G), Inserted.first->second});
+            std::push_heap(m_RouteOpen.begin(), m_RouteOpen.end(), IsWorse);
+        }
+    }
+    return false;
+}
+
+} // namespace Diligent
@@ -0,0 +1,259 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <deque>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "World.hpp"
+
+namespace Diligent
+{
+
+enum PATH_STATUS : Uint8
+{
+    // Queued or being searched
+    PATH_STATUS_PENDING = 0,
+    PATH_STATUS_FOUND,
+    // The start or the goal cannot be stood in, or the goal is out of reach within the
+    // node limit
+    PATH_STATUS_NOT_FOUND,
+    // The request is unknown, cancelled or already taken
+    PATH_STATUS_INVALID
+};
+
+using PathRequestId = Uint32;
+
+// A* path finding for mobs two blocks tall, over the blocks they can stand in.
+//
+// A mob can stand in a block when the block and the one above it are passable (neither
+// solid nor fluid) and the block below is solid. From there it walks to the four
+// neighbours at the same height, jumps one block up when it has head room, or drops
+// down up to MaxDrop blocks.
+//
+// Searches are time-sliced. Tick() expands the nodes of queued requests, oldest first,
+// until a budget shared by all of them runs out, and a search that is cut off carries
+// on from where it was on the next tick. Nodes come from a pool reused by every search,
+// and are found by packed block coordinates in an open-addressing table that is
+// cleared by bumping a stamp, so searches do not allocate once the pool has grown.
+//
+// Requests further apart than the hierarchical distance first find a route through a
+// coarse graph of chunk sections, where a section leads to a neighbour when some block
+// in it that can be stood in leads to one in the neighbour. Sections are summarized
+// when a route first crosses them. The route search shares the budget and is cut off
+// and carried on the same way, with a section node costing one and a summary
+// SectionSummaryCost. The block search is then kept to the sections of the route and
+// the ones above and below them, and searches everything if that fails.
+//
+// Found paths are cached with the sections they pass through. A request from the same
+// section to the same goal section takes the cached path if it starts on it and has the
+// same goal, and otherwise reuses its route. Changed blocks drop the summaries of the
+// sections around them and the cached paths through those.
+class Pathfinder
+{
+public:
+    // clang-format off
+    static constexpr Uint32 MaxNodes                    = 16384;
+    static constexpr Int32  MaxDrop                     = 3;
+    static constexpr Int32  DefaultHierarchicalDistance = 32;
+    static constexpr Uint32 MaxRouteNodes               = 2048;
+    static constexpr Uint32 MaxCachedPaths              = 64;
+    // Charged to the budget for summarizing a section, about what that costs in nodes
+    static constexpr Uint32 SectionSummaryCost          = 128;
+    // clang-format on
+
+    // Blocks along x plus blocks along z. Searches without routes use a distance past
+    // the size of the world.
+    explicit Pathfinder(Int32 HierarchicalDistance = DefaultHierarchicalDistance);
+
+    // clang-format off
+    Pathfinder           (const Pathfinder&)  = delete;
+    Pathfinder           (      Pathfinder&&) = delete;
+    Pathfinder& operator=(const Pathfinder&)  = delete;
+    Pathfinder& operator=(      Pathfinder&&) = delete;
+    // clang-format on
+
+    // Start and goal are the blocks the feet of the mob are in. Requests that a cached
+    // path answers are found right away.
+    PathRequestId RequestPath(const int3& Start, const int3& Goal);
+
+    // Once the request is finished, moves its path, from the start to the goal, to Path
+    // and forgets the request
+    PATH_STATUS TakePath(PathRequestId Id, std::vector<int3>& Path);
+    void        Cancel(PathRequestId Id);
+
+    // Spends at most IterationBudget on block nodes, section nodes and section summaries,
+    // over as many requests as it takes. Only a budget smaller than SectionSummaryCost
+    // is overrun, by summarizing one section.
+    void Tick(const World& Wrld, Uint32 IterationBudget);
+
+    // Drops what is known about the sections around a changed block
+    void OnBlockChanged(const int3& Pos);
+    // Same for all sections of a chunk that was loaded or is being unloaded
+    void OnChunkChanged(Int32 ChunkX, Int32 ChunkZ);
+
+    static bool IsPassableBlock(BlockId Id) { return !IsSolidBlock(Id) && GetFluidType(Id) == FLUID_NONE; }
+    static bool CanStandIn(const World& Wrld, const int3& Pos);
+
+    size_t GetPendingCount() const { return m_Queue.size(); }
+    size_t GetCachedPathCount() const { return m_Cache.size(); }
+    // Requests answered with a cached path, and searches that reused a cached route
+    Uint64 GetPathReuseCount() const { return m_NumPathReuses; }
+    Uint64 GetRouteReuseCount() const { return m_NumRouteReuses; }
+
+    // Statistics of the last Tick(). The iteration count is of block nodes only.
+    Uint32 GetLastIterationCount() const { return m_LastIterationCount; }
+    Uint32 GetLastBudgetSpent() const { return m_LastBudgetSpent; }
+    double GetLastTickTime() const { return m_LastTickTime; }
+
+private:
+    class BlockReader;
+
+    struct Request
+    {
+        int3              Start;
+        int3              Goal;
+        PATH_STATUS       Status = PATH_STATUS_PENDING;
+        std::vector<int3> Path;
+    };
+
+    struct Node
+    {
+        int3   Pos;
+        Uint32 Parent   = ~0u;
+        float  G        = 0;
+        bool   IsClosed = false;
+    };
+
+    struct OpenEntry
+    {
+        float  F    = 0;
+        float  G    = 0;
+        Uint32 Node = 0;
+    };
+
+    struct NodeTableEntry
+    {
+        Uint64 Key   = 0;
+        Uint32 Node  = 0;
+        Uint32 Stamp = 0;
+    };
+
+    // Which faces of a section lead into the neighbouring section, by BLOCK_FACE-like
+    // order: -x, +x, -y, +y, -z, +z
+    struct SectionSummary
+    {
+        Uint8 OpenFaces  = 0;
+        bool  CanStandIn = false;
+    };
+
+    struct RouteNode
+    {
+        int3   SectionPos;
+        Uint32 Parent   = ~0u;
+        Uint32 G        = 0;
+        bool   IsClosed = false;
+    };
+
+    struct CachedPath
+    {
+        int3              StartSection;
+        int3              GoalSection;
+        int3              Goal;
+        std::vector<int3> Path;
+        // Sorted keys of the sections of the route, empty for short paths
+        std::vector<Uint64> Route;
+        // Sorted keys of the sections the path and route pass through
+        std::vector<Uint64> Sections;
+        Uint64              LastUse = 0;
+    };
+
+    bool BeginSearch(BlockReader& Reader, Request& Req);
+    void BeginBlockSearch(const Request& Req);
+    // Returns true when the search has finished
+    bool StepSearch(BlockReader& Reader, Request& Req, Int32& Budget);
+    void ResetNodes(const int3& Start, const int3& Goal);
+    void FinishSearch(Request& Req, PATH_STATUS Status);
+
+    Uint32 FindOrAddNode(const int3& Pos, bool& IsNew);
+
+    void BeginRoute(const int3& Start, const int3& Goal);
+    // Returns true when the route search has finished and the block search has begun,
+    // along the route if one was found
+    bool StepRoute(BlockReader& Reader, const Request& Req, Int32& Budget);
+
+    bool                  HasSectionSummary(const int3& SectionPos) const;
+    const SectionSummary& GetSectionSummary(BlockReader& Reader, const int3& SectionPos, Int32& Budget);
+
+    CachedPath* FindCachedPath(const int3& Start, const int3& Goal);
+    void        CachePath(const Request& Req);
+    void        DropDirtySections();
+
+private:
+    const Int32 m_HierarchicalDistance;
+
+    std::unordered_map<PathRequestId, Request> m_Requests;
+    // Requests to search, oldest first. The front one is being searched.
+    std::deque<PathRequestId> m_Queue;
+    PathRequestId             m_NextId         = 1;
+    bool                      m_IsSearching    = false;
+    bool                      m_IsFindingRoute = false;
+    bool                      m_IsUsingRoute   = false;
+
+    // Node pool and table of the current search
+    std::vector<Node>           m_Nodes;
+    std::vector<OpenEntry>      m_Open;
+    std::vector<NodeTableEntry> m_NodeTable;
+    Uint32                      m_Stamp = 0;
+
+    // Sorted keys of the sections the current search is kept to
+    std::vector<Uint64> m_Route;
+
+    std::unordered_map<Uint64, SectionSummary> m_Summaries;
+    std::vector<RouteNode>                     m_RouteNodes;
+    std::unordered_map<Uint64, Uint32>         m_RouteNodeIndices;
+    std::vector<OpenEntry>                     m_RouteOpen;
+
+    std::vector<CachedPath>    m_Cache;
+    Uint64                     m_UseCounter = 0;
+    std::unordered_set<Uint64> m_DirtySections;
+
+    Uint64 m_NumPathReuses  = 0;
+    Uint64 m_NumRouteReuses = 0;
+
+    // Budget of the current Tick()
+    Int32 m_TickBudget = 0;
+
+    Uint32 m_LastIterationCount = 0;
+    Uint32 m_LastBudgetSpent    = 0;
+    double m_LastTickTime       = 0;
+};
+
+} // namespace Diligent
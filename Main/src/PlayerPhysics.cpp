@@ -0,0 +1,256 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include "PlayerPhysics.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "SimulationClock.hpp"
+
+namespace Diligent
+{
+
+namespace
+{
+
+// Keeps boxes touching a cell face, as they do after being stopped by it, from counting
+// as overlapping the cell
+constexpr float Epsilon = 1e-4f;
+
+bool IsColumnSolid(const World& Wrld, Int32 x, Int32 MinY, Int32 MaxY, Int32 z)
+{
+    const Chunk* pChunk = Wrld.GetChunk(World::BlockToChunk(x), World::BlockToChunk(z));
+    if (pChunk == nullptr)
+        return true;
+
+    const Uint32 LocalX = static_cast<Uint32>(World::BlockToLocal(x));
+    const Uint32 LocalZ = static_cast<Uint32>(World::BlockToLocal(z));
+    for (Int32 y = std::max(MinY, 0); y <= std::min(MaxY, Chunk::Height - 1); ++y)
+    {
+        if (IsSolidBlock(pChunk->GetBlock(LocalX, y, LocalZ)))
+            return true;
+    }
+    return false;
+}
+
+// Cells in [Lo, Hi], inclusive
+bool IsRangeSolid(const World& Wrld, const int3& Lo, const int3& Hi)
+{
+    for (Int32 z = Lo.z; z <= Hi.z; ++z)
+    {
+        for (Int32 x = Lo.x; x <= Hi.x; ++x)
+        {
+            if (IsColumnSolid(Wrld, x, Lo.y, Hi.y, z))
+                return true;
+        }
+    }
+    return false;
+}
+
+// Cells the box overlaps
+void GetCellRange(const BoundBox& Box, int3& Lo, int3& Hi)
+{
+    for (Uint32 Axis = 0; Axis < 3; ++Axis)
+    {
+        Lo[Axis] = static_cast<Int32>(std::floor(Box.Min[Axis] + Epsilon));
+        Hi[Axis] = static_cast<Int32>(std::ceil(Box.Max[Axis] - Epsilon)) - 1;
+    }
+}
+
+BoundBox OffsetBox(const BoundBox& Box, const float3& Offset)
+{
+    return BoundBox{Box.Min + Offset, Box.Max + Offset};
+}
+
+} // namespace
+
+bool BoxCollides(const World& Wrld, const BoundBox& Box)
+{
+    int3 Lo, Hi;
+    GetCellRange(Box, Lo, Hi);
+    return IsRangeSolid(Wrld, Lo, Hi);
+}
+
+float SweepBox(const World& Wrld, const BoundBox& Box, Uint32 Axis, float Delta)
+{
+    VERIFY_EXPR(Axis < 3);
+    if (Delta == 0)
+        return 0;
+
+    int3 Lo, Hi;
+    GetCellRange(Box, Lo, Hi);
+
+    // Layers of cells the leading face passes, nearest first
+    Int32 First, Last;
+    if (Delta > 0)
+    {
+        First = static_cast<Int32>(std::ceil(Box.Max[Axis] - Epsilon));
+        Last  = static_cast<Int32>(std::ceil(Box.Max[Axis] + Delta)) - 1;
+        if (Axis == 1)
+        {
+            // There is nothing solid above the world
+            Last = std::min(Last, Chunk::Height - 1);
+        }
+    }
+    else
+    {
+        First = static_cast<Int32>(std::floor(Box.Min[Axis] + Epsilon)) - 1;
+        Last  = static_cast<Int32>(std::floor(Box.Min[Axis] + Delta));
+        if (Axis == 1)
+        {
+            // Nor below it, so a long fall out of the world does not walk every layer
+            Last = std::max(Last, 0);
+        }
+    }
+
+    const Int32 Step = Delta > 0 ? 1 : -1;
+    for (Int32 i = First; (i - Last) * Step <= 0; i += Step)
+    {
+        Lo[Axis] = i;
+        Hi[Axis] = i;
+        if (IsRangeSolid(Wrld, Lo, Hi))
+        {
+            // Stop at the face of the layer. Rounding may leave the box a hair inside
+            // it, in which case it does not move at all.
+            if (Delta > 0)
+                return std::clamp(static_cast<float>(i) - Box.Max[Axis], 0.f, Delta);
+            else
+                return std::clamp(static_cast<float>(i + 1) - Box.Min[Axis], Delta, 0.f);
+        }
+    }
+    return Delta;
+}
+
+float3 MoveBox(const World& Wrld, const BoundBox& Box, const float3& Delta, float StepHeight)
+{
+    constexpr Uint32 AxisOrder[] = {1, 0, 2};
+
+    float3   Moved;
+    BoundBox Moving = Box;
+    for (Uint32 Axis : AxisOrder)
+    {
+        Moved[Axis] = SweepBox(Wrld, Moving, Axis, Delta[Axis]);
+        Moving.Min[Axis] += Moved[Axis];
+        Moving.Max[Axis] += Moved[Axis];
+    }
+
+    if (StepHeight <= 0 || (Moved.x == Delta.x && Moved.z == Delta.z))
+        return Moved;
+
+    // Blocked horizontally: go up, across, and back down as far as possible
+    float3 Stepped;
+    Stepped.y = SweepBox(Wrld, Box, 1, StepHeight);
+    Moving    = OffsetBox(Box, float3{0, Stepped.y, 0});
+    Stepped.x = SweepBox(Wrld, Moving, 0, Delta.x);
+    Moving    = OffsetBox(Moving, float3{Stepped.x, 0, 0});
+    Stepped.z = SweepBox(Wrld, Moving, 2, Delta.z);
+    Moving    = OffsetBox(Moving, float3{0, 0, Stepped.z});
+    Stepped.y += SweepBox(Wrld, Moving, 1, std::min(Delta.y, 0.f) - Stepped.y);
+
+    const float MovedDist   = Moved.x * Moved.x + Moved.z * Moved.z;
+    const float SteppedDist = Stepped.x * Stepped.x + Stepped.z * Stepped.z;
+    return SteppedDist > MovedDist ? Stepped : Moved;
+}
+
+void PlayerPhysics::SetPos(const float3& Pos)
+{
+    m_Pos      = Pos;
+    m_Velocity = float3{};
+    m_OnGround = false;
+}
+
+BoundBox PlayerPhysics::GetBox() const
+{
+    return BoundBox{
+        m_Pos - float3{Width * 0.5f, 0, Width * 0.5f},
+        m_Pos + float3{Width * 0.5f, Height, Width * 0.5f},
+    };
+}
+
+void PlayerPhysics::ClipToEdges(const World& Wrld, const BoundBox& Box, float3& Delta)
+{
+    // The move is shortened in small steps, as in the console editions, until a block
+    // within StepHeight below the feet is still under the box
+    constexpr float Step = 0.05f;
+
+    auto HasGround = [&](float dx, float dz) {
+        const BoundBox Feet{
+            float3{Box.Min.x + dx, Box.Min.y - StepHeight, Box.Min.z + dz},
+            float3{Box.Max.x + dx, Box.Min.y, Box.Max.z + dz},
+        };
+        return BoxCollides(Wrld, Feet);
+    };
+    auto Shorten = [](float& d) {
+        d = d > Step ? d - Step : (d < -Step ? d + Step : 0);
+    };
+
+    if (!HasGround(0, 0))
+        return;
+    while (Delta.x != 0 && !HasGround(Delta.x, 0))
+        Shorten(Delta.x);
+    while (Delta.z != 0 && !HasGround(0, Delta.z))
+        Shorten(Delta.z);
+    while (Delta.x != 0 && Delta.z != 0 && !HasGround(Delta.x, Delta.z))
+    {
+        Shorten(Delta.x);
+        Shorten(Delta.z);
+    }
+}
+
+void PlayerPhysics::Tick(const World& Wrld, const PlayerInput& Input)
+{
+    constexpr float TickTime = static_cast<float>(SimulationClock::TickInterval);
+
+    const float Speed   = Input.Sneak ? SneakSpeed : WalkSpeed;
+    const float Control = m_OnGround ? GroundControl : AirControl;
+    m_Velocity.x += (Input.Move.x * Speed - m_Velocity.x) * Control;
+    m_Velocity.z += (Input.Move.y * Speed - m_Velocity.z) * Control;
+    if (Input.Jump && m_OnGround)
+        m_Velocity.y = JumpSpeed;
+
+    const BoundBox Box   = GetBox();
+    float3         Delta = m_Velocity * TickTime;
+    if (Input.Sneak && m_OnGround)
+        ClipToEdges(Wrld, Box, Delta);
+
+    // Ledges are only stepped up while walking, not while jumping or falling
+    const float  Step  = m_OnGround && Delta.y <= 0 ? StepHeight : 0.f;
+    const float3 Moved = MoveBox(Wrld, Box, Delta, Step);
+    m_Pos += Moved;
+
+    m_OnGround = Delta.y < 0 && Moved.y != Delta.y;
+    // clang-format off
+    if (Moved.x != Delta.x) m_Velocity.x = 0;
+    if (Moved.y != Delta.y) m_Velocity.y = 0;
+    if (Moved.z != Delta.z) m_Velocity.z = 0;
+    // clang-format on
+
+    m_Velocity.y = (m_Velocity.y - Gravity * TickTime) * AirDrag;
+}
+
+} // namespace Diligent
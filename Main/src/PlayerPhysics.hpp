@@ -0,0 +1,112 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include "Common/interface/AdvancedMath.hpp"
+#include "World.hpp"
+
+namespace Diligent
+{
+
+// Collision of a box with the block grid.
+//
+// The box is swept along one axis at a time, Y first, then X and Z, as the console
+// editions do. Each sweep walks the layers of cells in front of the box from the nearest
+// one and stops at the first layer with a solid block in the box's cross section, so
+// only the cells along the sweep are read, nothing is allocated, and fast boxes cannot
+// tunnel through thin walls. Solid blocks are whole cells (see BlockInfo::IsSolid).
+// Cells of unloaded chunks count as solid, which also walls in finite worlds.
+
+// True if the box overlaps a solid cell. Boxes only touching a cell do not overlap it.
+bool BoxCollides(const World& Wrld, const BoundBox& Box);
+
+// Returns how far the box can move along one axis (0 - x, 1 - y, 2 - z), which is
+// Delta or less and has the same sign. Cells the box already overlaps are ignored so
+// that a stuck box can move out.
+float SweepBox(const World& Wrld, const BoundBox& Box, Uint32 Axis, float Delta);
+
+// Moves the box by Delta one axis at a time and returns the distance moved. When
+// StepHeight is not 0 and the box is blocked horizontally, moving StepHeight up first
+// is tried too, and taken if it gets further.
+float3 MoveBox(const World& Wrld, const BoundBox& Box, const float3& Delta, float StepHeight = 0);
+
+struct PlayerInput
+{
+    // Wanted horizontal direction in world space (x and z), at most unit length
+    float2 Move;
+    bool   Jump  = false;
+    bool   Sneak = false;
+};
+
+// Walking player: gravity, jumping, stepping up ledges and not falling off edges while
+// sneaking. Advances by one fixed simulation tick at a time.
+class PlayerPhysics
+{
+public:
+    // clang-format off
+    // Sizes in blocks, as in the console editions
+    static constexpr float Width         = 0.6f;
+    static constexpr float Height        = 1.8f;
+    static constexpr float EyeHeight     = 1.62f;
+    static constexpr float StepHeight    = 0.6f;
+
+    // Speeds in blocks per second, accelerations in blocks per second squared
+    static constexpr float WalkSpeed     = 4.317f;
+    static constexpr float SneakSpeed    = 1.295f;
+    static constexpr float JumpSpeed     = 8.4f;
+    static constexpr float Gravity       = 32.f;
+    // Fraction of the vertical speed kept per tick
+    static constexpr float AirDrag       = 0.98f;
+    // Fraction of the difference to the wanted horizontal speed made up per tick
+    static constexpr float GroundControl = 0.6f;
+    static constexpr float AirControl    = 0.1f;
+    // clang-format on
+
+    // Position is the centre of the bottom of the box. Stops the player.
+    void SetPos(const float3& Pos);
+
+    // Advances by SimulationClock::TickInterval
+    void Tick(const World& Wrld, const PlayerInput& Input);
+
+    const float3& GetPos() const { return m_Pos; }
+    float3        GetEyePos() const { return m_Pos + float3{0, EyeHeight, 0}; }
+    const float3& GetVelocity() const { return m_Velocity; }
+    bool          IsOnGround() const { return m_OnGround; }
+    BoundBox      GetBox() const;
+
+private:
+    // Shortens the horizontal move so that the box keeps standing on a block
+    static void ClipToEdges(const World& Wrld, const BoundBox& Box, float3& Delta);
+
+private:
+    float3 m_Pos;
+    float3 m_Velocity;
+    bool   m_OnGround = false;
+};
+
+} // namespace Diligent
@@ -0,0 +1,264 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+// Headless player physics tests.
+//
+// Checks corner cases of player collision on a flat stone floor (landing, fast falls,
+// thin walls, corners, stepping, ceilings, sneaking at edges, unloaded chunks), and that
+// random box moves through terrain with caves never end inside a block. Prints every
+// failed check and exits with a non-zero code if any failed.
+//
+//     PlayerPhysicsTest
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "PlayerPhysics.hpp"
+#include "TestWorld.hpp"
+#include "World.hpp"
+#include "Common/interface/FastRand.hpp"
+
+using namespace Diligent;
+
+namespace
+{
+
+Uint32 NumChecks = 0;
+Uint32 NumFailed = 0;
+
+void Check(const char* Name, bool Passed)
+{
+    ++NumChecks;
+    if (!Passed)
+    {
+        ++NumFailed;
+        std::printf("FAILED: %s\n", Name);
+    }
+}
+
+bool IsNear(float a, float b)
+{
+    return std::abs(a - b) < 1e-3f;
+}
+
+BoundBox GetPlayerBox(const float3& Feet)
+{
+    return BoundBox{Feet - float3{PlayerPhysics::Width * 0.5f, 0, PlayerPhysics::Width * 0.5f},
+                    Feet + float3{PlayerPhysics::Width * 0.5f, PlayerPhysics::Height, PlayerPhysics::Width * 0.5f}};
+}
+
+void TestCornerCases()
+{
+    // A flat stone floor whose top is at Ground. Chunks end at +-32.
+    constexpr Int32 Radius = 2;
+    constexpr Int32 FloorY = 4;
+    constexpr float Ground = FloorY + 1;
+
+    World Wrld;
+    for (Int32 cz = -Radius; cz < Radius; ++cz)
+    {
+        for (Int32 cx = -Radius; cx < Radius; ++cx)
+        {
+            Chunk& Chnk = Wrld.GetOrCreateChunk(cx, cz);
+            for (Uint32 z = 0; z < 16; ++z)
+            {
+                for (Uint32 x = 0; x < 16; ++x)
+                {
+                    for (Int32 y = 0; y <= FloorY; ++y)
+                        Chnk.SetBlock(x, y, z, BLOCK_STONE);
+                }
+            }
+        }
+    }
+
+    auto Run = [&](PlayerPhysics& Player, const PlayerInput& Input, Uint32 NumTicks) {
+        for (Uint32 t = 0; t < NumTicks; ++t)
+            Player.Tick(Wrld, Input);
+    };
+
+    PlayerPhysics Player;
+    PlayerInput   Idle;
+    {
+        // Falls and comes to rest exactly on the floor
+        Player.SetPos(float3{0.5f, 20, 0.5f});
+        Run(Player, Idle, 60);
+        Check("landing", Player.IsOnGround() && IsNear(Player.GetPos().y, Ground) && Player.GetVelocity().y <= 0);
+    }
+    {
+        // Water and wires do not hold the player up, a glass block does, even at 500 blocks
+        // per tick
+        Wrld.SetBlock(-20, FloorY + 1, 0, BLOCK_WATER);
+        Wrld.SetBlock(-20, FloorY + 2, 0, BLOCK_REDSTONE_WIRE);
+        const float3 Fall = MoveBox(Wrld, GetPlayerBox(float3{-19.5f, 100, 0.5f}), float3{0, -500, 0});
+        Check("fall_through_fluid", IsNear(100 + Fall.y, Ground));
+
+        Wrld.SetBlock(-22, 60, 0, BLOCK_GLASS);
+        const float3 FastFall = MoveBox(Wrld, GetPlayerBox(float3{-21.5f, 120, 0.5f}), float3{0, -500, 0});
+        Check("fast_fall", IsNear(120 + FastFall.y, 61));
+    }
+    {
+        // A one block thick wall stops a box moving 200 blocks in one query
+        for (Int32 z = 0; z < 10; ++z)
+        {
+            Wrld.SetBlock(10, FloorY + 1, z, BLOCK_STONE);
+            Wrld.SetBlock(10, FloorY + 2, z, BLOCK_STONE);
+        }
+        const BoundBox Box   = GetPlayerBox(float3{-20, Ground, 5.5f});
+        const float3   Moved = MoveBox(Wrld, Box, float3{200, 0, 0});
+        Check("thin_wall", IsNear(Box.Max.x + Moved.x, 10));
+
+        // Sliding along the face the box is touching does not snag on it
+        const BoundBox Touching = GetPlayerBox(float3{10 - PlayerPhysics::Width * 0.5f, Ground, 3.5f});
+        const float3   Slide    = MoveBox(Wrld, Touching, float3{0.2f, 0, 3});
+        Check("slide_along_wall", Slide.x == 0 && Slide.z == 3);
+    }
+    {
+        // Diagonal move into an inside corner stops on both axes
+        for (Int32 i = -16; i <= -10; ++i)
+        {
+            Wrld.SetBlock(-10, FloorY + 1, i, BLOCK_STONE);
+            Wrld.SetBlock(i, FloorY + 1, -10, BLOCK_STONE);
+        }
+        const BoundBox Box   = GetPlayerBox(float3{-12.5f, Ground, -12.5f});
+        const float3   Moved = MoveBox(Wrld, Box, float3{5, 0, 5});
+        Check("inside_corner", IsNear(Box.Max.x + Moved.x, -10) && IsNear(Box.Max.z + Moved.z, -10));
+    }
+    {
+        // Half a block is stepped up, a whole one is not
+        Wrld.SetBlock(15, FloorY + 1, -5, BLOCK_STONE);
+        const BoundBox Box     = GetPlayerBox(float3{14.1f, Ground + 0.5f, -4.5f});
+        const float3   Stepped = MoveBox(Wrld, Box, float3{1, -0.1f, 0}, PlayerPhysics::StepHeight);
+        Check("step_up", Stepped.x == 1 && IsNear(Box.Min.y + Stepped.y, Ground + 1));
+
+        PlayerInput Walk;
+        Walk.Move = float2{1, 0};
+        Player.SetPos(float3{12.5f, Ground, -4.5f});
+        Run(Player, Walk, 40);
+        Check("no_step_up_block", IsNear(Player.GetPos().y, Ground) && IsNear(Player.GetPos().x + PlayerPhysics::Width * 0.5f, 15));
+
+        // Jump until landing on it
+        Walk.Jump = true;
+        for (Uint32 t = 0; t < 20 && !(Player.IsOnGround() && Player.GetPos().y > Ground); ++t)
+            Player.Tick(Wrld, Walk);
+        Run(Player, Idle, 20);
+        Check("jump_up_block", Player.IsOnGround() && IsNear(Player.GetPos().y, Ground + 1));
+    }
+    {
+        // Jumping with two blocks of headroom hits the ceiling and falls back
+        Wrld.SetBlock(0, FloorY + 3, 10, BLOCK_STONE);
+        PlayerInput Jump;
+        Jump.Jump = true;
+        Player.SetPos(float3{0.5f, Ground, 10.5f});
+        Run(Player, Idle, 2);
+        float MaxY = 0;
+        for (Uint32 t = 0; t < 40; ++t)
+        {
+            Player.Tick(Wrld, Jump);
+            MaxY = std::max(MaxY, Player.GetPos().y);
+        }
+        Run(Player, Idle, 10);
+        Check("ceiling", IsNear(MaxY, Ground + 2 - PlayerPhysics::Height) && IsNear(Player.GetPos().y, Ground));
+    }
+    {
+        // Sneaking off a pillar stops at its edges, walking does not
+        for (Int32 y = FloorY + 1; y < FloorY + 5; ++y)
+            Wrld.SetBlock(20, y, 20, BLOCK_STONE);
+        const float Top = Ground + 4;
+
+        PlayerInput Sneak;
+        Sneak.Sneak = true;
+        const float2 Directions[] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}, {0.7071f, 0.7071f}, {-0.7071f, 0.7071f}};
+        bool         StayedOn     = true;
+        for (const float2& Dir : Directions)
+        {
+            Player.SetPos(float3{20.5f, Top, 20.5f});
+            Run(Player, Idle, 2);
+            Sneak.Move = Dir;
+            Run(Player, Sneak, 60);
+            const BoundBox Box = Player.GetBox();
+            StayedOn           = StayedOn && IsNear(Player.GetPos().y, Top) && Box.Min.x < 21 && Box.Max.x > 20 && Box.Min.z < 21 && Box.Max.z > 20;
+        }
+        Check("sneak_edge", StayedOn);
+
+        PlayerInput Walk;
+        Walk.Move = float2{1, 0};
+        Player.SetPos(float3{20.5f, Top, 20.5f});
+        Run(Player, Walk, 60);
+        Check("walk_off_edge", IsNear(Player.GetPos().y, Ground));
+    }
+    {
+        // Unloaded chunks past the edge of the loaded area are walls
+        PlayerInput Walk;
+        Walk.Move = float2{0, 1};
+        Player.SetPos(float3{-25.5f, Ground, 25.5f});
+        Run(Player, Walk, 100);
+        Check("unloaded_wall", IsNear(Player.GetPos().z + PlayerPhysics::Width * 0.5f, Radius * 16));
+    }
+}
+
+void TestRandomMoves()
+{
+    // Random moves of a player-sized box through terrain with caves, from a tenth of a
+    // block to fast falls of 50 blocks. Boxes that started clear must end clear.
+    World Terrain;
+    CreateTestWorld(Terrain, 4);
+
+    FastRandFloat RandXZ{1357, -56.f, 56.f};
+    FastRandFloat RandY{2468, 20.f, 100.f};
+    FastRandFloat RandDir{3579, -1.f, 1.f};
+    FastRandFloat RandLog{4680, -1.f, 1.7f};
+
+    Uint32 NumEmbedded = 0;
+    for (Uint32 i = 0; i < 10000; ++i)
+    {
+        const BoundBox Box = GetPlayerBox(float3{RandXZ(), RandY(), RandXZ()});
+
+        float3 Dir = float3{RandDir(), RandDir(), RandDir()};
+        Dir        = length(Dir) > 1e-3f ? normalize(Dir) : float3{0, -1, 0};
+
+        const float3 Delta = Dir * std::pow(10.f, RandLog());
+        if (BoxCollides(Terrain, Box))
+            continue;
+
+        const float3 Moved = MoveBox(Terrain, Box, Delta, PlayerPhysics::StepHeight);
+        NumEmbedded += BoxCollides(Terrain, BoundBox{Box.Min + Moved, Box.Max + Moved}) ? 1 : 0;
+    }
+    Check("no_embedding_after_move", NumEmbedded == 0);
+}
+
+} // namespace
+
+int main()
+{
+    TestCornerCases();
+    TestRandomMoves();
+
+    std::printf("%u of %u player physics checks passed\n", NumChecks - NumFailed, NumChecks);
+    return NumFailed == 0 ? 0 : 1;
+}
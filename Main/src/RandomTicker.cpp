@@ -0,0 +1,275 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include <algorithm>
+#include <bitset>
+#include <limits>
+
+#include "RandomTicker.hpp"
+#include "Common/interface/Timer.hpp"
+
+namespace Diligent
+{
+
+namespace
+{
+
+// Chunks per worker job. Small enough to balance the threads, large enough that a job is
+// worth enqueuing.
+constexpr size_t ChunksPerJob = 16;
+
+// The calling thread waits for the jobs, so they go ahead of background jobs on a shared pool
+constexpr float JobPriority = std::numeric_limits<float>::max();
+
+// Leaves decay unless a log is this many steps away through other leaves
+constexpr Int32 LeafSupportDistance = 4;
+
+// clang-format off
+const int3 NeighbourOffsets[6] = {{-1, 0, 0}, {1, 0, 0}, {0, -1, 0}, {0, 1, 0}, {0, 0, -1}, {0, 0, 1}};
+// clang-format on
+
+BlockId GetBlock(const World& Wrld, const int3& Pos)
+{
+    return Wrld.GetBlock(Pos.x, Pos.y, Pos.z);
+}
+
+// Brighter of sky and block light. Above the world is full sky light, unloaded chunks are dark.
+Uint32 GetLight(const World& Wrld, const int3& Pos)
+{
+    if (Pos.y >= Chunk::Height)
+        return 15;
+    if (Pos.y < 0)
+        return 0;
+
+    const ChunkSection* pSection = Wrld.GetSection(int3{World::BlockToChunk(Pos.x), Pos.y >> 4, World::BlockToChunk(Pos.z)});
+    if (pSection == nullptr)
+        return 0;
+
+    const Uint32 Index = ChunkSection::GetIndex(World::BlockToLocal(Pos.x), Pos.y & 15, World::BlockToLocal(Pos.z));
+    return std::max(pSection->GetSkyLight().Get(Index), pSection->GetBlockLight().Get(Index));
+}
+
+} // namespace
+
+RandomTicker::RandomTicker(Uint32 NumThreads, FastRand::StateType Seed) :
+    RandomTicker{CreateThreadPool(ThreadPoolCreateInfo{std::max(NumThreads, 1u)}), NumThreads, Seed}
+{
+    m_OwnsThreadPool = true;
+}
+
+RandomTicker::RandomTicker(IThreadPool* pThreadPool, Uint32 NumThreads, FastRand::StateType Seed) :
+    m_NumThreads{std::max(NumThreads, 1u)},
+    m_pThreadPool{pThreadPool}
+{
+    VERIFY_EXPR(m_pThreadPool);
+    m_Workers.reserve(m_NumThreads + 1);
+    for (Uint32 i = 0; i <= m_NumThreads; ++i)
+        m_Workers.emplace_back(Seed + i * 0x9E3779B9u);
+}
+
+RandomTicker::~RandomTicker()
+{
+    if (m_OwnsThreadPool)
+        m_pThreadPool->StopThreads();
+}
+
+void RandomTicker::Tick(World& Wrld)
+{
+    Timer Tmr;
+
+    m_ChangedBlocks.clear();
+    m_Chunks.clear();
+    Wrld.ForEachChunk([this](const Chunk& Chnk) { m_Chunks.push_back(&Chnk); });
+
+    for (Worker& Wrkr : m_Workers)
+    {
+        Wrkr.Changes.clear();
+        Wrkr.NumTickedSections  = 0;
+        Wrkr.NumSkippedSections = 0;
+    }
+
+    const size_t NumJobs = (m_Chunks.size() + ChunksPerJob - 1) / ChunksPerJob;
+    if (NumJobs == 1)
+    {
+        TickChunks(Wrld, m_Chunks.data(), m_Chunks.size(), m_Workers[m_NumThreads]);
+    }
+    else if (NumJobs > 1)
+    {
+        m_Tasks.clear();
+        for (size_t Job = 0; Job < NumJobs; ++Job)
+        {
+            m_Tasks.emplace_back(EnqueueAsyncWork(
+                m_pThreadPool, [this, &Wrld, Job](Uint32 ThreadId) {
+                    const size_t First = Job * ChunksPerJob;
+                    TickChunks(Wrld, m_Chunks.data() + First, std::min(ChunksPerJob, m_Chunks.size() - First), m_Workers[ThreadId]);
+                },
+                JobPriority));
+        }
+        for (const auto& pTask : m_Tasks)
+            pTask->WaitForCompletion();
+    }
+
+    m_LastTickedSections  = 0;
+    m_LastSkippedSections = 0;
+    for (Worker& Wrkr : m_Workers)
+    {
+        m_LastTickedSections += Wrkr.NumTickedSections;
+        m_LastSkippedSections += Wrkr.NumSkippedSections;
+
+        // An earlier change may already have changed the block, e.g. grass spreading
+        // from two sides into the same dirt
+        for (const BlockChange& Change : Wrkr.Changes)
+        {
+            if (GetBlock(Wrld, Change.Pos) == Change.Expected && Wrld.SetBlock(Change.Pos.x, Change.Pos.y, Change.Pos.z, Change.Id))
+                m_ChangedBlocks.push_back(Change.Pos);
+        }
+    }
+
+    m_LastTickTime = Tmr.GetElapsedTime();
+}
+
+void RandomTicker::TickChunks(const World& Wrld, const Chunk* const* ppChunks, size_t NumChunks, Worker& Wrkr)
+{
+    for (size_t c = 0; c < NumChunks; ++c)
+    {
+        const Chunk& Chnk = *ppChunks[c];
+        for (Int32 s = 0; s < Chunk::NumSections; ++s)
+        {
+            const ChunkSection& Section = Chnk.GetSection(s);
+            if (Section.GetRandomlyTickedCount() == 0)
+            {
+                ++Wrkr.NumSkippedSections;
+                continue;
+            }
+            ++Wrkr.NumTickedSections;
+
+            for (Uint32 t = 0; t < TicksPerSection; ++t)
+            {
+                // FastRand returns 15 bits, enough for a block index
+                const Uint32  Index = Wrkr.Rand() & (ChunkSection::Volume - 1);
+                const BlockId Id    = Section.GetBlock(Index);
+                if (!IsRandomlyTickedBlock(Id))
+                    continue;
+
+                const int3 Pos{
+                    Chnk.GetX() * 16 + static_cast<Int32>(Index & 15u),
+                    s * 16 + static_cast<Int32>(Index >> 8u),
+                    Chnk.GetZ() * 16 + static_cast<Int32>((Index >> 4u) & 15u),
+                };
+                switch (Id)
+                {
+                    case BLOCK_GRASS: TickGrass(Wrld, Pos, Wrkr); break;
+                    case BLOCK_LEAVES: TickLeaves(Wrld, Pos, Wrkr); break;
+                    default: UNEXPECTED("Randomly ticked block without a tick handler");
+                }
+            }
+        }
+    }
+}
+
+void RandomTicker::TickGrass(const World& Wrld, const int3& Pos, Worker& Wrkr)
+{
+    // Grass under a block that keeps the light out turns back into dirt
+    const int3   AbovePos   = Pos + int3{0, 1, 0};
+    const Uint32 LightAbove = GetLight(Wrld, AbovePos);
+    if (LightAbove < 4 && GetBlockInfo(GetBlock(Wrld, AbovePos)).LightOpacity > 2)
+    {
+        Wrkr.Changes.push_back({Pos, BLOCK_GRASS, BLOCK_DIRT});
+        return;
+    }
+    if (LightAbove < 9)
+        return;
+
+    // Well-lit grass spreads to lit dirt one block away, up to one block higher and
+    // three lower
+    for (Uint32 i = 0; i < 4; ++i)
+    {
+        const Int32 dx     = static_cast<Int32>(Wrkr.Rand() % 3u) - 1;
+        const Int32 dy     = static_cast<Int32>(Wrkr.Rand() % 5u) - 3;
+        const Int32 dz     = static_cast<Int32>(Wrkr.Rand() % 3u) - 1;
+        const int3  Target = Pos + int3{dx, dy, dz};
+        if (GetBlock(Wrld, Target) != BLOCK_DIRT)
+            continue;
+
+        const int3 TargetAbove = Target + int3{0, 1, 0};
+        if (GetLight(Wrld, TargetAbove) >= 4 && GetBlockInfo(GetBlock(Wrld, TargetAbove)).LightOpacity <= 2)
+            Wrkr.Changes.push_back({Target, BLOCK_DIRT, BLOCK_GRASS});
+    }
+}
+
+void RandomTicker::TickLeaves(const World& Wrld, const int3& Pos, Worker& Wrkr)
+{
+    // The search stays within one chunk of the leaves. A missing chunk could hold the log.
+    for (Int32 dz = -LeafSupportDistance; dz <= LeafSupportDistance; dz += 2 * LeafSupportDistance)
+    {
+        for (Int32 dx = -LeafSupportDistance; dx <= LeafSupportDistance; dx += 2 * LeafSupportDistance)
+        {
+            if (Wrld.GetChunk(World::BlockToChunk(Pos.x + dx), World::BlockToChunk(Pos.z + dz)) == nullptr)
+                return;
+        }
+    }
+
+    // Breadth-first search through leaves for a log. Offsets never leave the cube of
+    // LeafSupportDistance around the leaves.
+    constexpr Int32 Span = 2 * LeafSupportDistance + 1;
+
+    std::bitset<Span * Span * Span> Visited;
+    auto                            Visit = [&](const int3& Offset) {
+        const size_t Bit = ((Offset.y + LeafSupportDistance) * Span + Offset.z + LeafSupportDistance) * Span + Offset.x + LeafSupportDistance;
+        if (Visited.test(Bit))
+            return false;
+        Visited.set(Bit);
+        return true;
+    };
+
+    Wrkr.Front.assign(1, int3{});
+    Visit(int3{});
+    for (Int32 Distance = 1; Distance <= LeafSupportDistance && !Wrkr.Front.empty(); ++Distance)
+    {
+        Wrkr.NextFront.clear();
+        for (const int3& Offset : Wrkr.Front)
+        {
+            for (const int3& Step : NeighbourOffsets)
+            {
+                const int3 Next = Offset + Step;
+                if (!Visit(Next))
+                    continue;
+
+                const BlockId Id = GetBlock(Wrld, Pos + Next);
+                if (Id == BLOCK_LOG)
+                    return;
+                if (Id == BLOCK_LEAVES)
+                    Wrkr.NextFront.push_back(Next);
+            }
+        }
+        std::swap(Wrkr.Front, Wrkr.NextFront);
+    }
+
+    Wrkr.Changes.push_back({Pos, BLOCK_LEAVES, BLOCK_AIR});
+}
+
+} // namespace Diligent
@@ -0,0 +1,131 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "Common/interface/FastRand.hpp"
+#include "Common/interface/ThreadPool.hpp"
+#include "World.hpp"
+
+namespace Diligent
+{
+
+// Random block ticks: grass spreading and dying, and leaves decaying away from logs.
+//
+// Every tick a few random blocks of each section are picked, and the randomly ticked
+// ones among them (see BlockInfo::IsRandomlyTicked) are updated. Sections count their
+// randomly ticked blocks as blocks are set, so sections with none, which is most of
+// them, are skipped without reading their blocks.
+//
+// Chunks are split between the worker threads, each with its own random generator.
+// Workers only read the world and record the changes they want, which are applied on
+// the calling thread once all of them are done.
+class RandomTicker
+{
+public:
+    // Blocks picked per section and tick, as in the console editions
+    static constexpr Uint32 TicksPerSection = 3;
+
+    // Runs jobs on a thread pool of its own
+    RandomTicker(Uint32 NumThreads, FastRand::StateType Seed);
+    // Runs jobs on a pool shared with other systems, which must have NumThreads workers
+    RandomTicker(IThreadPool* pThreadPool, Uint32 NumThreads, FastRand::StateType Seed);
+    ~RandomTicker();
+
+    // clang-format off
+    RandomTicker           (const RandomTicker&)  = delete;
+    RandomTicker           (      RandomTicker&&) = delete;
+    RandomTicker& operator=(const RandomTicker&)  = delete;
+    RandomTicker& operator=(      RandomTicker&&) = delete;
+    // clang-format on
+
+    // Ticks every loaded chunk once. The world must not be changed by other threads meanwhile.
+    void Tick(World& Wrld);
+
+    // Blocks changed by the last Tick()
+    const std::vector<int3>& GetChangedBlocks() const { return m_ChangedBlocks; }
+
+    Uint32 GetThreadCount() const { return m_NumThreads; }
+
+    // Statistics of the last Tick()
+    Uint32 GetLastChunkCount() const { return static_cast<Uint32>(m_Chunks.size()); }
+    Uint32 GetLastTickedSectionCount() const { return m_LastTickedSections; }
+    Uint32 GetLastSkippedSectionCount() const { return m_LastSkippedSections; }
+    double GetLastTickTime() const { return m_LastTickTime; }
+
+private:
+    // A block a worker wants to change, applied only if it still holds the expected block
+    struct BlockChange
+    {
+        int3    Pos;
+        BlockId Expected = BLOCK_AIR;
+        BlockId Id       = BLOCK_AIR;
+    };
+
+    struct Worker
+    {
+        explicit Worker(FastRand::StateType Seed) :
+            Rand{Seed}
+        {}
+
+        FastRand                 Rand;
+        std::vector<BlockChange> Changes;
+        // Leaf decay search, kept between ticks so it does not reallocate
+        std::vector<int3> Front;
+        std::vector<int3> NextFront;
+
+        Uint32 NumTickedSections  = 0;
+        Uint32 NumSkippedSections = 0;
+    };
+
+    static void TickChunks(const World& Wrld, const Chunk* const* ppChunks, size_t NumChunks, Worker& Wrkr);
+    static void TickGrass(const World& Wrld, const int3& Pos, Worker& Wrkr);
+    static void TickLeaves(const World& Wrld, const int3& Pos, Worker& Wrkr);
+
+private:
+    const Uint32               m_NumThreads;
+    RefCntAutoPtr<IThreadPool> m_pThreadPool;
+    bool                       m_OwnsThreadPool = false;
+
+    // One worker per thread plus one for the calling thread
+    std::vector<Worker> m_Workers;
+
+    // Tasks of the running tick
+    std::vector<RefCntAutoPtr<IAsyncTask>> m_Tasks;
+
+    // Reused by Tick()
+    std::vector<const Chunk*> m_Chunks;
+    std::vector<int3>         m_ChangedBlocks;
+
+    Uint32 m_LastTickedSections  = 0;
+    Uint32 m_LastSkippedSections = 0;
+    double m_LastTickTime        = 0;
+};
+
+} // namespace Diligent
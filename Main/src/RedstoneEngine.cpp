@@ -0,0 +1,627 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include <algorithm>
+
+#include "RedstoneEngine.hpp"
+
+namespace Diligent
+{
+
+namespace
+{
+
+// clang-format off
+const int3 HorizontalDirections[4] = {{-1, 0, 0}, {1, 0, 0}, {0, 0, -1}, {0, 0, 1}};
+const int3 NeighbourOffsets[6]     = {{-1, 0, 0}, {1, 0, 0}, {0, -1, 0}, {0, 1, 0}, {0, 0, -1}, {0, 0, 1}};
+const int3 Up{0, 1, 0};
+// clang-format on
+
+// Section keys have room for block coordinates
+Uint64 PackBlockKey(const int3& Pos)
+{
+    return World::PackSectionKey(Pos);
+}
+
+int3 UnpackBlockKey(Uint64 Key)
+{
+    // Sign-extends the 28-bit coordinates
+    return int3{
+        static_cast<Int32>(static_cast<Uint32>(Key >> 36u) << 4u) >> 4,
+        static_cast<Int32>(Key & 0xFFu),
+        static_cast<Int32>(static_cast<Uint32>(Key >> 8u) << 4u) >> 4,
+    };
+}
+
+BlockId GetBlock(const World& Wrld, const int3& Pos)
+{
+    return Wrld.GetBlock(Pos.x, Pos.y, Pos.z);
+}
+
+bool IsWire(const World& Wrld, const int3& Pos)
+{
+    return GetBlock(Wrld, Pos) == BLOCK_REDSTONE_WIRE;
+}
+
+bool IsTorch(BlockId Id)
+{
+    return Id == BLOCK_REDSTONE_TORCH || Id == BLOCK_REDSTONE_TORCH_OFF;
+}
+
+// Wires connected to the wire at Pos, at most one per horizontal direction. Bit d of
+// DirectionMask is set when there is a connection in HorizontalDirections[d].
+Uint32 GetWireConnections(const World& Wrld, const int3& Pos, int3 Connections[4], Uint32& DirectionMask)
+{
+    const bool IsCovered = IsOpaqueBlock(GetBlock(Wrld, Pos + Up));
+
+    Uint32 NumConnections = 0;
+    DirectionMask         = 0;
+    for (Uint32 d = 0; d < 4; ++d)
+    {
+        const int3 Side = Pos + HorizontalDirections[d];
+
+        int3 Connection;
+        if (IsWire(Wrld, Side))
+            Connection = Side;
+        else if (!IsCovered && IsWire(Wrld, Side + Up))
+            Connection = Side + Up;
+        else if (!IsOpaqueBlock(GetBlock(Wrld, Side)) && IsWire(Wrld, Side - Up))
+            Connection = Side - Up;
+        else
+            continue;
+
+        Connections[NumConnections++] = Connection;
+        DirectionMask |= 1u << d;
+    }
+    return NumConnections;
+}
+
+// A wire points into the blocks along an axis unless it connects to either side of it
+bool PointsAlong(Uint32 DirectionMask, Uint32 Direction)
+{
+    const Uint32 Perpendicular = Direction < 2 ? 0b1100u : 0b0011u;
+    return (DirectionMask & Perpendicular) == 0;
+}
+
+// Gives power 15 to the wires next to it
+bool IsActiveSource(const World& Wrld, const int3& Pos)
+{
+    const BlockId Id = GetBlock(Wrld, Pos);
+    if (Id == BLOCK_REDSTONE_BLOCK || Id == BLOCK_REDSTONE_TORCH)
+        return true;
+    return IsOpaqueBlock(Id) && GetBlock(Wrld, Pos - Up) == BLOCK_REDSTONE_TORCH;
+}
+
+// May become a source without a block next to the wires changing, as torches switch
+bool IsPotentialSource(const World& Wrld, const int3& Pos)
+{
+    const BlockId Id = GetBlock(Wrld, Pos);
+    if (Id == BLOCK_REDSTONE_BLOCK || IsTorch(Id))
+        return true;
+    return IsOpaqueBlock(Id) && IsTorch(GetBlock(Wrld, Pos - Up));
+}
+
+template <typename T>
+void EraseFromMultimap(std::unordered_map<Uint64, std::vector<T>>& Map, Uint64 Key, const T& Value)
+{
+    auto It = Map.find(Key);
+    if (It == Map.end())
+        return;
+
+    auto& Values = It->second;
+    auto  Found  = std::find(Values.begin(), Values.end(), Value);
+    if (Found != Values.end())
+    {
+        *Found = Values.back();
+        Values.pop_back();
+    }
+    if (Values.empty())
+        Map.erase(It);
+}
+
+} // namespace
+
+RedstoneEngine::RedstoneEngine(REDSTONE_MODE Mode) :
+    m_Mode{Mode}
+{
+}
+
+void RedstoneEngine::OnBlockChanged(Int32 x, Int32 y, Int32 z)
+{
+    m_PendingChanges.emplace_back(x, y, z);
+}
+
+void RedstoneEngine::CancelChunk(Int32 ChunkX, Int32 ChunkZ)
+{
+    auto IsInChunk = [&](const int3& Pos) {
+        return World::BlockToChunk(Pos.x) == ChunkX && World::BlockToChunk(Pos.z) == ChunkZ;
+    };
+
+    if (m_Mode == REDSTONE_MODE_COMPILED)
+    {
+        // The rest of the network is recompiled without the unloaded wires
+        for (Uint32 n = 0; n < m_Networks.size(); ++n)
+        {
+            const Network& Net = m_Networks[n];
+            if (Net.IsValid && std::any_of(Net.Wires.begin(), Net.Wires.end(), IsInChunk))
+                InvalidateNetwork(n);
+        }
+    }
+    else
+    {
+        for (auto It = m_Power.begin(); It != m_Power.end();)
+        {
+            It = IsInChunk(UnpackBlockKey(It->first)) ? m_Power.erase(It) : std::next(It);
+        }
+    }
+}
+
+Uint8 RedstoneEngine::GetWirePower(const int3& Pos) const
+{
+    if (m_Mode == REDSTONE_MODE_COMPILED)
+    {
+        auto It = m_Wires.find(PackBlockKey(Pos));
+        return It != m_Wires.end() ? m_Networks[It->second.Network].Power[It->second.Index] : 0;
+    }
+
+    auto It = m_Power.find(PackBlockKey(Pos));
+    return It != m_Power.end() ? It->second : 0;
+}
+
+void RedstoneEngine::Tick(World& Wrld)
+{
+    ++m_CurrentTick;
+    m_ChangedBlocks.clear();
+    m_LastUpdateCount  = 0;
+    m_LastCompileCount = 0;
+
+    for (const int3& Pos : m_PendingChanges)
+        HandleChange(Wrld, Pos, true);
+    m_PendingChanges.clear();
+    if (m_Mode == REDSTONE_MODE_COMPILED)
+        UpdateNetworks(Wrld);
+
+    // Due torches all decide from the state at the start of the tick, then switch
+    // together, so the order they switch in does not matter
+    m_SwitchingTorches.clear();
+    while (!m_ScheduledTorches.empty() && m_ScheduledTorches.front().DueTick <= m_CurrentTick)
+    {
+        const int3 Pos = m_ScheduledTorches.front().Pos;
+        m_ScheduledTorches.pop_front();
+        m_ScheduledTorchKeys.erase(PackBlockKey(Pos));
+
+        const BlockId Id = GetBlock(Wrld, Pos);
+        if (IsTorch(Id) && (Id == BLOCK_REDSTONE_TORCH) == IsBlockPowered(Wrld, Pos - Up))
+            m_SwitchingTorches.push_back(Pos);
+    }
+    for (const int3& Pos : m_SwitchingTorches)
+    {
+        const bool IsLit = GetBlock(Wrld, Pos) == BLOCK_REDSTONE_TORCH;
+        Wrld.SetBlock(Pos.x, Pos.y, Pos.z, IsLit ? BLOCK_REDSTONE_TORCH_OFF : BLOCK_REDSTONE_TORCH);
+        m_ChangedBlocks.push_back(Pos);
+        HandleChange(Wrld, Pos, false);
+    }
+    if (m_Mode == REDSTONE_MODE_COMPILED)
+        UpdateNetworks(Wrld);
+
+    // Torches whose input no longer matches their state switch after the delay
+    for (const int3& Pos : m_TouchedTorches)
+    {
+        const BlockId Id = GetBlock(Wrld, Pos);
+        if (!IsTorch(Id) || (Id == BLOCK_REDSTONE_TORCH) != IsBlockPowered(Wrld, Pos - Up))
+            continue;
+        if (m_ScheduledTorchKeys.insert(PackBlockKey(Pos)).second)
+            m_ScheduledTorches.push_back({m_CurrentTick + TorchDelay, Pos});
+    }
+    m_TouchedTorches.clear();
+    m_TouchedTorchKeys.clear();
+}
+
+void RedstoneEngine::TouchTorch(const int3& Pos)
+{
+    if (m_TouchedTorchKeys.insert(PackBlockKey(Pos)).second)
+        m_TouchedTorches.push_back(Pos);
+}
+
+bool RedstoneEngine::IsBlockPowered(const World& Wrld, const int3& Pos) const
+{
+    const BlockId Id = GetBlock(Wrld, Pos);
+    if (Id == BLOCK_REDSTONE_BLOCK)
+        return true;
+    if (!IsOpaqueBlock(Id))
+        return false;
+
+    // Strongly powered by a torch below
+    if (GetBlock(Wrld, Pos - Up) == BLOCK_REDSTONE_TORCH)
+        return true;
+
+    // Weakly powered by wire on top or pointing into the block
+    if (IsWire(Wrld, Pos + Up) && GetWirePower(Pos + Up) > 0)
+        return true;
+    for (Uint32 d = 0; d < 4; ++d)
+    {
+        const int3 Side = Pos + HorizontalDirections[d];
+        if (!IsWire(Wrld, Side) || GetWirePower(Side) == 0)
+            continue;
+
+        int3   Connections[4];
+        Uint32 DirectionMask = 0;
+        GetWireConnections(Wrld, Side, Connections, DirectionMask);
+        if (PointsAlong(DirectionMask, d))
+            return true;
+    }
+    return false;
+}
+
+void RedstoneEngine::HandleChange(const World& Wrld, const int3& Pos, bool IsStructural)
+{
+    if (IsStructural)
+    {
+        // The inputs of torches up to two blocks away depend on the connections of the
+        // wires next to the block
+        for (Int32 dy = -2; dy <= 2; ++dy)
+        {
+            for (Int32 dz = -2; dz <= 2; ++dz)
+            {
+                for (Int32 dx = -2; dx <= 2; ++dx)
+                {
+                    const int3 TorchPos = Pos + int3{dx, dy, dz};
+                    if (IsTorch(GetBlock(Wrld, TorchPos)))
+                        TouchTorch(TorchPos);
+                }
+            }
+        }
+    }
+
+    if (m_Mode == REDSTONE_MODE_COMPILED)
+    {
+        if (IsStructural)
+        {
+            auto It = m_Dependents.find(PackBlockKey(Pos));
+            if (It != m_Dependents.end())
+            {
+                // Invalidation edits the list
+                const std::vector<Uint32> Networks = It->second;
+                for (Uint32 n : Networks)
+                    InvalidateNetwork(n);
+            }
+            m_CompileSeeds.push_back(Pos);
+            for (const int3& Offset : NeighbourOffsets)
+                m_CompileSeeds.push_back(Pos + Offset);
+        }
+        else
+        {
+            // A torch feeds the wires next to it and strongly powers the block above,
+            // which feeds the wires next to it and the torch on top of it
+            MarkInputDirty(Pos);
+            MarkInputDirty(Pos + Up);
+            TouchTorch(Pos + Up + Up);
+        }
+    }
+    else
+    {
+        if (IsStructural)
+        {
+            if (!IsWire(Wrld, Pos))
+                m_Power.erase(PackBlockKey(Pos));
+            m_UpdateQueue.push_back(Pos);
+        }
+        PushNeighbourUpdates(Pos);
+        RunNeighbourUpdates(Wrld);
+    }
+}
+
+void RedstoneEngine::UpdateNetworks(const World& Wrld)
+{
+    for (const int3& Seed : m_CompileSeeds)
+    {
+        if (IsWire(Wrld, Seed) && m_Wires.count(PackBlockKey(Seed)) == 0)
+            CompileNetwork(Wrld, Seed);
+    }
+    m_CompileSeeds.clear();
+
+    for (Uint32 n : m_DirtyNetworks)
+    {
+        if (m_Networks[n].IsValid && m_Networks[n].IsDirty)
+            EvaluateNetwork(Wrld, n);
+    }
+    m_DirtyNetworks.clear();
+}
+
+void RedstoneEngine::CompileNetwork(const World& Wrld, const int3& Seed)
+{
+    Uint32 Index = 0;
+    if (!m_FreeNetworks.empty())
+    {
+        Index = m_FreeNetworks.back();
+        m_FreeNetworks.pop_back();
+    }
+    else
+    {
+        Index = static_cast<Uint32>(m_Networks.size());
+        m_Networks.emplace_back();
+    }
+
+    Network& Net = m_Networks[Index];
+    Net          = {};
+    Net.IsValid  = true;
+
+    // Flood fill through the wire connections
+    std::vector<std::vector<Uint32>> Links;
+    auto                             AddWire = [&](const int3& Pos) {
+        auto Inserted = m_Wires.emplace(PackBlockKey(Pos), WireRef{Index, static_cast<Uint32>(Net.Wires.size())});
+        if (Inserted.second)
+        {
+            Net.Wires.push_back(Pos);
+            Links.emplace_back();
+        }
+        VERIFY(Inserted.first->second.Network == Index, "Connected wires must belong to the same network");
+        return Inserted.first->second.Index;
+    };
+    AddWire(Seed);
+
+    std::vector<Uint32> DirectionMasks;
+    for (Uint32 i = 0; i < Net.Wires.size(); ++i)
+    {
+        int3         Connections[4];
+        Uint32       DirectionMask  = 0;
+        const Uint32 NumConnections = GetWireConnections(Wrld, Net.Wires[i], Connections, DirectionMask);
+        DirectionMasks.push_back(DirectionMask);
+        for (Uint32 c = 0; c < NumConnections; ++c)
+        {
+            const Uint32 Linked = AddWire(Connections[c]);
+            Links[i].push_back(Linked);
+        }
+    }
+    const Uint32 NumWires = static_cast<Uint32>(Net.Wires.size());
+
+    // Sources next to the wires, with the wires they feed directly
+    std::unordered_map<Uint64, Uint32> InputIndices;
+    std::vector<std::vector<Uint32>>   InputWires;
+    std::unordered_map<Uint64, Uint32> OutputIndices;
+    std::unordered_set<Uint64>         Dependencies;
+    for (Uint32 i = 0; i < NumWires; ++i)
+    {
+        const int3& Pos = Net.Wires[i];
+        for (const int3& Offset : NeighbourOffsets)
+        {
+            const int3 Neighbour = Pos + Offset;
+            if (!IsPotentialSource(Wrld, Neighbour))
+                continue;
+
+            auto Inserted = InputIndices.emplace(PackBlockKey(Neighbour), static_cast<Uint32>(Net.Inputs.size()));
+            if (Inserted.second)
+            {
+                Net.Inputs.push_back({Neighbour, {}});
+                InputWires.emplace_back();
+            }
+            InputWires[Inserted.first->second].push_back(i);
+        }
+
+        for (Uint32 d = 0; d < 4; ++d)
+        {
+            const int3 Target = Pos + HorizontalDirections[d];
+            if (!PointsAlong(DirectionMasks[i], d) || !IsOpaqueBlock(GetBlock(Wrld, Target)) || !IsTorch(GetBlock(Wrld, Target + Up)))
+                continue;
+
+            auto Inserted = OutputIndices.emplace(PackBlockKey(Target), static_cast<Uint32>(Net.Outputs.size()));
+            if (Inserted.second)
+                Net.Outputs.push_back({Target, {}, false});
+            Net.Outputs[Inserted.first->second].Wires.push_back(i);
+        }
+
+        for (Int32 dy = -1; dy <= 1; ++dy)
+        {
+            for (Int32 dz = -1; dz <= 1; ++dz)
+            {
+                for (Int32 dx = -1; dx <= 1; ++dx)
+                    Dependencies.insert(PackBlockKey(Pos + int3{dx, dy, dz}));
+            }
+        }
+    }
+
+    // Power each input gives the wires in its reach: full power on the wires next to it,
+    // one less per wire after that. Breadth-first order reaches every wire at its
+    // highest power first.
+    std::vector<Uint8>  Visited(NumWires, 0);
+    std::vector<Uint32> Queue;
+    for (size_t InputIndex = 0; InputIndex < Net.Inputs.size(); ++InputIndex)
+    {
+        auto& Reach = Net.Inputs[InputIndex].Reach;
+        Queue.clear();
+        for (Uint32 Wire : InputWires[InputIndex])
+        {
+            if (!Visited[Wire])
+            {
+                Visited[Wire] = 1;
+                Queue.push_back(Wire);
+                Reach.emplace_back(Wire, MaxPower);
+            }
+        }
+        for (size_t q = 0; q < Queue.size(); ++q)
+        {
+            const Uint8 Power = Reach[q].second;
+            if (Power <= 1)
+                continue;
+            for (Uint32 Linked : Links[Queue[q]])
+            {
+                if (Visited[Linked])
+                    continue;
+                Visited[Linked] = 1;
+                Queue.push_back(Linked);
+                Reach.emplace_back(Linked, static_cast<Uint8>(Power - 1));
+            }
+        }
+        for (Uint32 Wire : Queue)
+            Visited[Wire] = 0;
+
+        m_InputNetworks[PackBlockKey(Net.Inputs[InputIndex].Pos)].push_back(Index);
+    }
+
+    Net.Dependencies.assign(Dependencies.begin(), Dependencies.end());
+    for (Uint64 Key : Net.Dependencies)
+        m_Dependents[Key].push_back(Index);
+
+    // The torches the network powers are checked once it is evaluated
+    for (const NetworkOutput& Output : Net.Outputs)
+        TouchTorch(Output.Pos + Up);
+
+    Net.Power.assign(NumWires, 0);
+    Net.IsDirty = true;
+    m_DirtyNetworks.push_back(Index);
+    ++m_LastCompileCount;
+}
+
+void RedstoneEngine::EvaluateNetwork(const World& Wrld, Uint32 NetworkIndex)
+{
+    Network& Net = m_Networks[NetworkIndex];
+    Net.IsDirty  = false;
+
+    Uint32 NumUpdates = 0;
+
+    m_EvaluatedPower.assign(Net.Wires.size(), 0);
+    for (const NetworkInput& Input : Net.Inputs)
+    {
+        if (!IsActiveSource(Wrld, Input.Pos))
+            continue;
+        for (const auto& Entry : Input.Reach)
+            m_EvaluatedPower[Entry.first] = std::max(m_EvaluatedPower[Entry.first], Entry.second);
+        NumUpdates += static_cast<Uint32>(Input.Reach.size());
+    }
+    Net.Power.swap(m_EvaluatedPower);
+    NumUpdates += static_cast<Uint32>(Net.Wires.size());
+
+    for (NetworkOutput& Output : Net.Outputs)
+    {
+        const bool IsPowered = std::any_of(Output.Wires.begin(), Output.Wires.end(), [&](Uint32 Wire) { return Net.Power[Wire] > 0; });
+        NumUpdates += static_cast<Uint32>(Output.Wires.size());
+        if (IsPowered != Output.IsPowered)
+        {
+            Output.IsPowered = IsPowered;
+            TouchTorch(Output.Pos + Up);
+        }
+    }
+
+    m_LastUpdateCount += NumUpdates;
+}
+
+void RedstoneEngine::InvalidateNetwork(Uint32 NetworkIndex)
+{
+    Network& Net = m_Networks[NetworkIndex];
+    VERIFY_EXPR(Net.IsValid);
+
+    // The wires are compiled again, possibly into different networks
+    for (const int3& Wire : Net.Wires)
+    {
+        m_Wires.erase(PackBlockKey(Wire));
+        m_CompileSeeds.push_back(Wire);
+    }
+    for (Uint64 Key : Net.Dependencies)
+        EraseFromMultimap(m_Dependents, Key, NetworkIndex);
+    for (const NetworkInput& Input : Net.Inputs)
+        EraseFromMultimap(m_InputNetworks, PackBlockKey(Input.Pos), NetworkIndex);
+    for (const NetworkOutput& Output : Net.Outputs)
+        TouchTorch(Output.Pos + Up);
+
+    Net = {};
+    m_FreeNetworks.push_back(NetworkIndex);
+}
+
+void RedstoneEngine::MarkInputDirty(const int3& Pos)
+{
+    auto It = m_InputNetworks.find(PackBlockKey(Pos));
+    if (It == m_InputNetworks.end())
+        return;
+
+    for (Uint32 n : It->second)
+    {
+        if (!m_Networks[n].IsDirty)
+        {
+            m_Networks[n].IsDirty = true;
+            m_DirtyNetworks.push_back(n);
+        }
+    }
+}
+
+void RedstoneEngine::PushNeighbourUpdates(const int3& Pos)
+{
+    // Like the console editions, a change notifies its neighbours and theirs
+    for (const int3& Offset : NeighbourOffsets)
+    {
+        const int3 Neighbour = Pos + Offset;
+        m_UpdateQueue.push_back(Neighbour);
+        for (const int3& Offset2 : NeighbourOffsets)
+            m_UpdateQueue.push_back(Neighbour + Offset2);
+    }
+}
+
+void RedstoneEngine::RunNeighbourUpdates(const World& Wrld)
+{
+    // The queue grows while it is processed
+    for (size_t i = 0; i < m_UpdateQueue.size(); ++i)
+    {
+        const int3    Pos = m_UpdateQueue[i];
+        const BlockId Id  = GetBlock(Wrld, Pos);
+        ++m_LastUpdateCount;
+
+        if (IsTorch(Id))
+        {
+            TouchTorch(Pos);
+            continue;
+        }
+        if (Id != BLOCK_REDSTONE_WIRE)
+            continue;
+
+        Uint8 Power = 0;
+        for (const int3& Offset : NeighbourOffsets)
+        {
+            if (IsActiveSource(Wrld, Pos + Offset))
+                Power = MaxPower;
+        }
+
+        int3         Connections[4];
+        Uint32       DirectionMask  = 0;
+        const Uint32 NumConnections = GetWireConnections(Wrld, Pos, Connections, DirectionMask);
+        for (Uint32 c = 0; c < NumConnections && Power < MaxPower; ++c)
+        {
+            const Uint8 Neighbour = GetWirePower(Connections[c]);
+            if (Neighbour > 0)
+                Power = std::max(Power, static_cast<Uint8>(Neighbour - 1));
+        }
+
+        if (Power == GetWirePower(Pos))
+            continue;
+        if (Power > 0)
+            m_Power[PackBlockKey(Pos)] = Power;
+        else
+            m_Power.erase(PackBlockKey(Pos));
+        PushNeighbourUpdates(Pos);
+    }
+    m_UpdateQueue.clear();
+}
+
+} // namespace Diligent
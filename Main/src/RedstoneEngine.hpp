@@ -0,0 +1,203 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <deque>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "World.hpp"
+
+namespace Diligent
+{
+
+enum REDSTONE_MODE : Uint8
+{
+    // Wire networks are compiled into graphs with precomputed power propagation
+    REDSTONE_MODE_COMPILED = 0,
+
+    // Every change notifies the neighbours of its neighbours, and wires recompute their
+    // power from the wires around them, like the console editions do. Kept as the
+    // reference the compiled mode is checked against.
+    REDSTONE_MODE_NEIGHBOUR_UPDATES
+};
+
+// Redstone wire, redstone torches and blocks of redstone.
+//
+// Wire takes power 15 next to a power source (a block of redstone, a lit torch or a block
+// a lit torch below strongly powers) and loses one level per wire it travels through.
+// Wire connects to wire next to it, and one block up or down where nothing opaque is
+// in the way. Wire powers the block under it and the block it points into, which a
+// lone or straight piece of wire does. A torch stands on the block below it and turns
+// off two ticks after that block becomes powered, and back on two ticks after it stops.
+//
+// In compiled mode, a connected set of wires is compiled into a network when first
+// needed: its wires, the sources that can feed it, each with the power it gives every
+// wire in reach, and the blocks it powers that have torches on them. A source changing
+// then re-evaluates the network from those lists in one pass, without touching the world
+// and without the cascades of neighbour updates. A network is dropped and recompiled
+// when any block next to one of its wires changes; torches switching do not count.
+//
+// Both modes run every tick in the same order: changes from outside, torches that are
+// due, then torches whose input changed are scheduled, so they give the same results.
+// Torches do not burn out.
+class RedstoneEngine
+{
+public:
+    static constexpr Uint8  MaxPower   = 15;
+    static constexpr Uint32 TorchDelay = 2;
+
+    explicit RedstoneEngine(REDSTONE_MODE Mode = REDSTONE_MODE_COMPILED);
+
+    // clang-format off
+    RedstoneEngine           (const RedstoneEngine&)  = delete;
+    RedstoneEngine           (      RedstoneEngine&&) = delete;
+    RedstoneEngine& operator=(const RedstoneEngine&)  = delete;
+    RedstoneEngine& operator=(      RedstoneEngine&&) = delete;
+    // clang-format on
+
+    // Queues a block that was changed in the world from outside the engine. It is
+    // handled by the next Tick().
+    void OnBlockChanged(Int32 x, Int32 y, Int32 z);
+
+    // Forgets the wires of a chunk that is being unloaded
+    void CancelChunk(Int32 ChunkX, Int32 ChunkZ);
+
+    void Tick(World& Wrld);
+
+    Uint8 GetWirePower(const int3& Pos) const;
+
+    // Torches switched by the last Tick()
+    const std::vector<int3>& GetChangedBlocks() const { return m_ChangedBlocks; }
+
+    REDSTONE_MODE GetMode() const { return m_Mode; }
+    Uint64        GetTickCount() const { return m_CurrentTick; }
+    size_t        GetNetworkCount() const { return m_Networks.size() - m_FreeNetworks.size(); }
+
+    // Statistics of the last Tick(). Updates are block updates in neighbour-update mode,
+    // and wire and output entries evaluated in compiled mode.
+    Uint32 GetLastUpdateCount() const { return m_LastUpdateCount; }
+    Uint32 GetLastCompileCount() const { return m_LastCompileCount; }
+
+private:
+    struct NetworkInput
+    {
+        int3 Pos;
+        // Power this input gives each wire in its reach, as (wire index, power)
+        std::vector<std::pair<Uint32, Uint8>> Reach;
+    };
+
+    // Block with a torch on it that wires of the network power
+    struct NetworkOutput
+    {
+        int3                Pos;
+        std::vector<Uint32> Wires;
+        bool                IsPowered = false;
+    };
+
+    struct Network
+    {
+        std::vector<int3>          Wires;
+        std::vector<Uint8>         Power;
+        std::vector<NetworkInput>  Inputs;
+        std::vector<NetworkOutput> Outputs;
+        // Blocks whose change invalidates the network
+        std::vector<Uint64> Dependencies;
+
+        bool IsValid = false;
+        bool IsDirty = false;
+    };
+
+    struct WireRef
+    {
+        Uint32 Network = 0;
+        Uint32 Index   = 0;
+    };
+
+    struct ScheduledTorch
+    {
+        Uint64 DueTick = 0;
+        int3   Pos;
+    };
+
+    // Handles a block that has already changed. Torches switching are not structural.
+    void HandleChange(const World& Wrld, const int3& Pos, bool IsStructural);
+    // Queues a possible torch to be checked at the end of the tick
+    void TouchTorch(const int3& Pos);
+    bool IsBlockPowered(const World& Wrld, const int3& Pos) const;
+
+    // Compiled mode
+    void UpdateNetworks(const World& Wrld);
+    void CompileNetwork(const World& Wrld, const int3& Seed);
+    void EvaluateNetwork(const World& Wrld, Uint32 NetworkIndex);
+    void InvalidateNetwork(Uint32 NetworkIndex);
+    void MarkInputDirty(const int3& Pos);
+
+    // Neighbour-update mode
+    void PushNeighbourUpdates(const int3& Pos);
+    void RunNeighbourUpdates(const World& Wrld);
+
+private:
+    const REDSTONE_MODE m_Mode;
+
+    Uint64 m_CurrentTick = 0;
+
+    std::vector<int3> m_PendingChanges;
+    std::vector<int3> m_ChangedBlocks;
+    // Reused by Tick()
+    std::vector<int3> m_SwitchingTorches;
+
+    // Torches waiting to switch, in due order, and the keys of their positions
+    std::deque<ScheduledTorch> m_ScheduledTorches;
+    std::unordered_set<Uint64> m_ScheduledTorchKeys;
+
+    // Torches whose input may have changed this tick
+    std::vector<int3>          m_TouchedTorches;
+    std::unordered_set<Uint64> m_TouchedTorchKeys;
+
+    // Compiled mode
+    std::vector<Network>                            m_Networks;
+    std::vector<Uint32>                             m_FreeNetworks;
+    std::unordered_map<Uint64, WireRef>             m_Wires;
+    std::unordered_map<Uint64, std::vector<Uint32>> m_Dependents;
+    std::unordered_map<Uint64, std::vector<Uint32>> m_InputNetworks;
+    std::vector<int3>                               m_CompileSeeds;
+    std::vector<Uint32>                             m_DirtyNetworks;
+    std::vector<Uint8>                              m_EvaluatedPower;
+
+    // Neighbour-update mode
+    std::unordered_map<Uint64, Uint8> m_Power;
+    std::vector<int3>                 m_UpdateQueue;
+
+    Uint32 m_LastUpdateCount  = 0;
+    Uint32 m_LastCompileCount = 0;
+};
+
+} // namespace Diligent
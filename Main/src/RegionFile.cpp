@@ -0,0 +1,634 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+#include "RegionFile.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+
+#if PLATFORM_WIN32
+#    ifndef NOMINMAX
+#        define NOMINMAX
+#    endif
+#    ifndef WIN32_LEAN_AND_MEAN
+#        define WIN32_LEAN_AND_MEAN
+#    endif
+#    include <Windows.h>
+#else
+#    include <cerrno>
+#    include <fcntl.h>
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#    include <unistd.h>
+#endif
+
+#include "World.hpp"
+#include "Common/interface/Timer.hpp"
+
+namespace Diligent
+{
+
+// Stored words and table entries are little-endian and read back without swapping
+static_assert(std::endian::native == std::endian::little, "Region files assume a little-endian host");
+
+namespace
+{
+
+constexpr Uint16 ChunkFormatVersion = 1;
+
+// Section records in the uncompressed payload
+enum SECTION_RECORD : Uint16
+{
+    SECTION_RECORD_UNIFORM = 0, // followed by one block id
+    SECTION_RECORD_DENSE   = 1, // followed by Volume block ids in ChunkSection::GetIndex() order
+};
+
+struct StoredChunkHeader
+{
+    Uint32 PayloadSize;
+    Uint8  Compression;
+    Uint8  Reserved[3];
+};
+static_assert(sizeof(StoredChunkHeader) == 8, "Payload must stay 8-byte aligned");
+
+// RLE tokens: a run of (Token & 0x7FFF) + 1 copies of the next word if the top bit is
+// set, otherwise (Token + 1) literal words
+constexpr Uint16 RleRunBit    = 0x8000;
+constexpr Uint32 RleMaxLength = 0x8000;
+constexpr Uint32 RleMinRun    = 3;
+
+void AppendWords(std::vector<Uint8>& Dst, const Uint16* pWords, size_t NumWords)
+{
+    const size_t Offset = Dst.size();
+    Dst.resize(Offset + NumWords * sizeof(Uint16));
+    std::memcpy(Dst.data() + Offset, pWords, NumWords * sizeof(Uint16));
+}
+
+void CompressRle(const std::vector<Uint16>& Src, std::vector<Uint8>& Dst)
+{
+    const size_t NumWords = Src.size();
+
+    auto GetRunLength = [&](size_t Start) {
+        size_t End = Start + 1;
+        while (End < NumWords && End - Start < RleMaxLength && Src[End] == Src[Start])
+            ++End;
+        return End - Start;
+    };
+
+    size_t i = 0;
+    while (i < NumWords)
+    {
+        const size_t Run = GetRunLength(i);
+        if (Run >= RleMinRun)
+        {
+            const Uint16 Token[] = {static_cast<Uint16>(RleRunBit | (Run - 1)), Src[i]};
+            AppendWords(Dst, Token, 2);
+            i += Run;
+            continue;
+        }
+
+        // Extend the literal until the next run worth encoding
+        const size_t Start = i;
+        i += Run;
+        while (i < NumWords && i - Start < RleMaxLength)
+        {
+            const size_t NextRun = GetRunLength(i);
+            if (NextRun >= RleMinRun)
+                break;
+            i = std::min(i + NextRun, Start + RleMaxLength);
+        }
+
+        const Uint16 Token = static_cast<Uint16>(i - Start - 1);
+        AppendWords(Dst, &Token, 1);
+        AppendWords(Dst, &Src[Start], i - Start);
+    }
+}
+
+// Streams decompressed words straight out of the mapped file
+class PayloadReader
+{
+public:
+    PayloadReader(const Uint8* pData, size_t Size, CHUNK_COMPRESSION Compression) :
+        m_pCurr{pData},
+        m_pEnd{pData + Size},
+        m_Compression{Compression}
+    {}
+
+    bool Read(Uint16* pDst, size_t Count)
+    {
+        while (Count > 0)
+        {
+            if (m_Compression == CHUNK_COMPRESSION_NONE)
+                return ReadLiteral(pDst, Count);
+
+            if (m_RunLeft > 0)
+            {
+                const size_t Num = std::min<size_t>(m_RunLeft, Count);
+                std::fill_n(pDst, Num, m_RunValue);
+                m_RunLeft -= static_cast<Uint32>(Num);
+                pDst += Num;
+                Count -= Num;
+            }
+            else if (m_LiteralLeft > 0)
+            {
+                const size_t Num = std::min<size_t>(m_LiteralLeft, Count);
+                if (!ReadLiteral(pDst, Num))
+                    return false;
+                m_LiteralLeft -= static_cast<Uint32>(Num);
+                pDst += Num;
+                Count -= Num;
+            }
+            else
+            {
+                Uint16 Token = 0;
+                if (!ReadLiteral(&Token, 1))
+                    return false;
+                if (Token & RleRunBit)
+                {
+                    if (!ReadLiteral(&m_RunValue, 1))
+                        return false;
+                    m_RunLeft = (Token & ~RleRunBit) + 1u;
+                }
+                else
+                {
+                    m_LiteralLeft = Token + 1u;
+                }
+            }
+        }
+        return true;
+    }
+
+    bool IsAtEnd() const { return m_pCurr == m_pEnd && m_RunLeft == 0 && m_LiteralLeft == 0; }
+
+private:
+    bool ReadLiteral(Uint16* pDst, size_t Count)
+    {
+        const size_t Bytes = Count * sizeof(Uint16);
+        if (static_cast<size_t>(m_pEnd - m_pCurr) < Bytes)
+            return false;
+        std::memcpy(pDst, m_pCurr, Bytes);
+        m_pCurr += Bytes;
+        return true;
+    }
+
+private:
+    const Uint8*            m_pCurr;
+    const Uint8* const      m_pEnd;
+    const CHUNK_COMPRESSION m_Compression;
+
+    Uint32 m_RunLeft     = 0;
+    Uint32 m_LiteralLeft = 0;
+    Uint16 m_RunValue    = 0;
+};
+
+} // namespace
+
+RegionFile::~RegionFile()
+{
+    Close();
+}
+
+bool RegionFile::Open(const std::string& Path)
+{
+    Close();
+
+    constexpr Uint64 HeaderSize = Uint64{NumHeaderSectors} * SectorSize;
+
+    Uint64 FileSize = 0;
+#if PLATFORM_WIN32
+    HANDLE hFile = CreateFileA(Path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (hFile == INVALID_HANDLE_VALUE)
+    {
+        LOG_ERROR_MESSAGE("Failed to open region file '", Path, "'");
+        return false;
+    }
+    m_hFile = hFile;
+
+    LARGE_INTEGER Size{};
+    GetFileSizeEx(hFile, &Size);
+    FileSize = static_cast<Uint64>(Size.QuadPart);
+#else
+    m_File = open(Path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (m_File < 0)
+    {
+        LOG_ERROR_MESSAGE("Failed to open region file '", Path, "': ", std::strerror(errno));
+        return false;
+    }
+
+    struct stat Stat = {};
+    fstat(m_File, &Stat);
+    FileSize = static_cast<Uint64>(Stat.st_size);
+#endif
+
+    if (FileSize != 0 && FileSize < HeaderSize)
+    {
+        LOG_ERROR_MESSAGE("Region file '", Path, "' is truncated");
+        Close();
+        return false;
+    }
+
+    // New files get an empty header; a torn trailing sector is padded back to a whole one
+    const Uint64 MappedSize = std::max(HeaderSize, (FileSize + SectorSize - 1) / SectorSize * SectorSize);
+    if (!Reserve(MappedSize))
+    {
+        LOG_ERROR_MESSAGE("Failed to map region file '", Path, "'");
+        Close();
+        return false;
+    }
+
+    std::memcpy(m_Locations.data(), m_pMapped, sizeof(m_Locations));
+    std::memcpy(m_Timestamps.data(), m_pMapped + SectorSize, sizeof(m_Timestamps));
+
+    std::fill_n(m_UsedSectors.begin(), NumHeaderSectors, true);
+    for (Uint32& Location : m_Locations)
+    {
+        if (Location == 0)
+            continue;
+
+        const Uint32 First = Location >> 8;
+        const Uint32 Count = Location & 0xFF;
+        if (First < NumHeaderSectors || Count == 0 || First + Count > m_UsedSectors.size())
+        {
+            LOG_WARNING_MESSAGE("Region file '", Path, "' has an invalid chunk location, the chunk is dropped");
+            Location = 0;
+            continue;
+        }
+        std::fill_n(m_UsedSectors.begin() + First, Count, true);
+    }
+
+    return true;
+}
+
+void RegionFile::Close()
+{
+    Unmap();
+#if PLATFORM_WIN32
+    if (m_hFile != nullptr)
+    {
+        CloseHandle(m_hFile);
+        m_hFile = nullptr;
+    }
+#else
+    if (m_File >= 0)
+    {
+        close(m_File);
+        m_File = -1;
+    }
+#endif
+    m_Locations  = {};
+    m_Timestamps = {};
+    m_UsedSectors.clear();
+}
+
+bool RegionFile::Map(Uint64 FileSize)
+{
+    VERIFY_EXPR(m_pMapped == nullptr && FileSize > 0);
+#if PLATFORM_WIN32
+    const DWORD SizeHigh = static_cast<DWORD>(FileSize >> 32u);
+    const DWORD SizeLow  = static_cast<DWORD>(FileSize & 0xFFFFFFFFu);
+
+    m_hMapping = CreateFileMappingA(m_hFile, nullptr, PAGE_READONLY, SizeHigh, SizeLow, nullptr);
+    if (m_hMapping == nullptr)
+        return false;
+    m_pMapped = static_cast<const Uint8*>(MapViewOfFile(m_hMapping, FILE_MAP_READ, 0, 0, 0));
+    if (m_pMapped == nullptr)
+    {
+        CloseHandle(m_hMapping);
+        m_hMapping = nullptr;
+        return false;
+    }
+#else
+    void* pMapped = mmap(nullptr, FileSize, PROT_READ, MAP_SHARED, m_File, 0);
+    if (pMapped == MAP_FAILED)
+        return false;
+    m_pMapped = static_cast<const Uint8*>(pMapped);
+#endif
+    m_MappedSize = FileSize;
+    return true;
+}
+
+void RegionFile::Unmap()
+{
+    if (m_pMapped == nullptr)
+        return;
+#if PLATFORM_WIN32
+    UnmapViewOfFile(m_pMapped);
+    CloseHandle(m_hMapping);
+    m_hMapping = nullptr;
+#else
+    munmap(const_cast<Uint8*>(m_pMapped), m_MappedSize);
+#endif
+    m_pMapped    = nullptr;
+    m_MappedSize = 0;
+}
+
+bool RegionFile::Reserve(Uint64 FileSize)
+{
+    if (m_pMapped != nullptr && FileSize <= m_MappedSize)
+        return true;
+
+    // Grow by half the file at a time so appending chunks does not remap on every write
+    Uint64 NewSize = std::max(FileSize, m_MappedSize + m_MappedSize / 2);
+    NewSize        = (NewSize + SectorSize - 1) / SectorSize * SectorSize;
+
+    Unmap();
+#if PLATFORM_WIN32
+    LARGE_INTEGER Size{};
+    GetFileSizeEx(m_hFile, &Size);
+    if (static_cast<Uint64>(Size.QuadPart) < NewSize)
+    {
+        LARGE_INTEGER End{};
+        End.QuadPart = static_cast<LONGLONG>(NewSize);
+        if (!SetFilePointerEx(m_hFile, End, nullptr, FILE_BEGIN) || !SetEndOfFile(m_hFile))
+            return false;
+    }
+#else
+    struct stat Stat = {};
+    fstat(m_File, &Stat);
+    if (static_cast<Uint64>(Stat.st_size) < NewSize && ftruncate(m_File, static_cast<off_t>(NewSize)) != 0)
+        return false;
+#endif
+    if (!Map(NewSize))
+        return false;
+
+    m_UsedSectors.resize(static_cast<size_t>(NewSize / SectorSize), false);
+    return true;
+}
+
+bool RegionFile::WriteAt(Uint64 Offset, const void* pData, size_t DataSize)
+{
+    const Uint8* pBytes = static_cast<const Uint8*>(pData);
+    while (DataSize > 0)
+    {
+#if PLATFORM_WIN32
+        OVERLAPPED Overlapped = {};
+        Overlapped.Offset     = static_cast<DWORD>(Offset & 0xFFFFFFFFu);
+        Overlapped.OffsetHigh = static_cast<DWORD>(Offset >> 32u);
+
+        DWORD Written = 0;
+        if (!WriteFile(m_hFile, pBytes, static_cast<DWORD>(std::min<size_t>(DataSize, 1u << 30)), &Written, &Overlapped) || Written == 0)
+            return false;
+#else
+        const ssize_t Written = pwrite(m_File, pBytes, DataSize, static_cast<off_t>(Offset));
+        if (Written < 0 && errno == EINTR)
+            continue;
+        if (Written <= 0)
+            return false;
+#endif
+        pBytes += Written;
+        Offset += static_cast<Uint64>(Written);
+        DataSize -= static_cast<size_t>(Written);
+    }
+    return true;
+}
+
+Uint32 RegionFile::FindFreeSectors(Uint32 Count) const
+{
+    const Uint32 NumSectors = static_cast<Uint32>(m_UsedSectors.size());
+
+    Uint32 RunStart = NumHeaderSectors;
+    for (Uint32 s = NumHeaderSectors; s < NumSectors; ++s)
+    {
+        if (m_UsedSectors[s])
+            RunStart = s + 1;
+        else if (s + 1 - RunStart == Count)
+            return RunStart;
+    }
+    // A free run at the end of the file is extended rather than skipped
+    return RunStart;
+}
+
+Uint32 RegionFile::GetFreeSectorCount() const
+{
+    return static_cast<Uint32>(std::count(m_UsedSectors.begin(), m_UsedSectors.end(), false));
+}
+
+Uint32 RegionFile::GetChunkSize(Uint32 LocalX, Uint32 LocalZ) const
+{
+    const Uint32 Location = m_Locations[GetSlot(LocalX, LocalZ)];
+    if (Location == 0)
+        return 0;
+
+    StoredChunkHeader Header;
+    std::memcpy(&Header, m_pMapped + Uint64{Location >> 8} * SectorSize, sizeof(Header));
+    return static_cast<Uint32>(sizeof(Header)) + Header.PayloadSize;
+}
+
+bool RegionFile::ReadChunk(Uint32 LocalX, Uint32 LocalZ, Chunk& Dst) const
+{
+    const Uint32 Location = m_Locations[GetSlot(LocalX, LocalZ)];
+    if (Location == 0)
+        return false;
+
+    const Uint8* pSectors = m_pMapped + Uint64{Location >> 8} * SectorSize;
+    const Uint64 Capacity = Uint64{Location & 0xFF} * SectorSize;
+
+    StoredChunkHeader Header;
+    std::memcpy(&Header, pSectors, sizeof(Header));
+    if (Header.PayloadSize > Capacity - sizeof(Header) || Header.Compression >= CHUNK_COMPRESSION_COUNT)
+        return false;
+
+    PayloadReader Reader{pSectors + sizeof(Header), Header.PayloadSize, static_cast<CHUNK_COMPRESSION>(Header.Compression)};
+
+    Uint16 Version = 0;
+    if (!Reader.Read(&Version, 1) || Version != ChunkFormatVersion)
+        return false;
+
+    // Everything is decoded before Dst is touched, so a corrupt chunk leaves it as is
+    thread_local std::vector<BlockId> Blocks(size_t{Chunk::NumSections} * ChunkSection::Volume);
+
+    std::array<bool, Chunk::NumSections> IsUniform = {};
+    for (Int32 s = 0; s < Chunk::NumSections; ++s)
+    {
+        BlockId* pBlocks = &Blocks[size_t{ChunkSection::Volume} * s];
+
+        Uint16 Record = 0;
+        if (!Reader.Read(&Record, 1))
+            return false;
+
+        Uint32 NumBlocks = 0;
+        if (Record == SECTION_RECORD_UNIFORM)
+            NumBlocks = 1;
+        else if (Record == SECTION_RECORD_DENSE)
+            NumBlocks = ChunkSection::Volume;
+        else
+            return false;
+
+        if (!Reader.Read(pBlocks, NumBlocks))
+            return false;
+        if (std::any_of(pBlocks, pBlocks + NumBlocks, [](BlockId Id) { return Id >= BLOCK_ID_COUNT; }))
+            return false;
+        IsUniform[s] = Record == SECTION_RECORD_UNIFORM;
+    }
+    if (!Reader.IsAtEnd())
+        return false;
+
+    for (Int32 s = 0; s < Chunk::NumSections; ++s)
+    {
+        const BlockId* pBlocks = &Blocks[size_t{ChunkSection::Volume} * s];
+        if (IsUniform[s])
+            Dst.GetSection(s).Fill(pBlocks[0]);
+        else
+            Dst.GetSection(s).Encode(pBlocks);
+    }
+    return true;
+}
+
+bool RegionFile::WriteChunk(Uint32 LocalX, Uint32 LocalZ, const Chunk& Src, Uint32 Timestamp, CHUNK_COMPRESSION Compression)
+{
+    VERIFY_EXPR(IsOpen() && Compression < CHUNK_COMPRESSION_COUNT);
+    const Uint32 Slot = GetSlot(LocalX, LocalZ);
+
+    m_RawWords.clear();
+    m_RawWords.push_back(ChunkFormatVersion);
+    for (Int32 s = 0; s < Chunk::NumSections; ++s)
+    {
+        const ChunkSection& Section = Src.GetSection(s);
+        if (Section.IsUniform())
+        {
+            m_RawWords.push_back(SECTION_RECORD_UNIFORM);
+            m_RawWords.push_back(Section.GetUniformBlock());
+        }
+        else
+        {
+            m_RawWords.push_back(SECTION_RECORD_DENSE);
+            const size_t Offset = m_RawWords.size();
+            m_RawWords.resize(Offset + ChunkSection::Volume);
+            Section.Decode(&m_RawWords[Offset]);
+        }
+    }
+
+    m_Encoded.assign(sizeof(StoredChunkHeader), 0);
+    if (Compression == CHUNK_COMPRESSION_RLE)
+        CompressRle(m_RawWords, m_Encoded);
+    else
+        AppendWords(m_Encoded, m_RawWords.data(), m_RawWords.size());
+
+    StoredChunkHeader Header = {};
+    Header.PayloadSize       = static_cast<Uint32>(m_Encoded.size() - sizeof(Header));
+    Header.Compression       = Compression;
+    std::memcpy(m_Encoded.data(), &Header, sizeof(Header));
+
+    const Uint32 NumSectors = static_cast<Uint32>((m_Encoded.size() + SectorSize - 1) / SectorSize);
+    if (NumSectors > MaxChunkSectors)
+    {
+        LOG_ERROR_MESSAGE("Chunk ", Src.GetX(), ", ", Src.GetZ(), " does not fit in ", MaxChunkSectors, " sectors");
+        return false;
+    }
+    // Whole sectors keep the file a multiple of the sector size
+    m_Encoded.resize(size_t{NumSectors} * SectorSize, 0);
+
+    // The old copy stays allocated until the new one is in place
+    const Uint32 First = FindFreeSectors(NumSectors);
+    if (!Reserve(Uint64{First + NumSectors} * SectorSize))
+        return false;
+    if (!WriteAt(Uint64{First} * SectorSize, m_Encoded.data(), m_Encoded.size()))
+        return false;
+
+    const Uint32 OldLocation = m_Locations[Slot];
+    const Uint32 NewLocation = (First << 8) | NumSectors;
+    if (!WriteAt(Uint64{Slot} * sizeof(Uint32), &NewLocation, sizeof(NewLocation)) ||
+        !WriteAt(SectorSize + Uint64{Slot} * sizeof(Uint32), &Timestamp, sizeof(Timestamp)))
+        return false;
+
+    std::fill_n(m_UsedSectors.begin() + First, NumSectors, true);
+    if (OldLocation != 0)
+        std::fill_n(m_UsedSectors.begin() + (OldLocation >> 8), OldLocation & 0xFF, false);
+
+    m_Locations[Slot]  = NewLocation;
+    m_Timestamps[Slot] = Timestamp;
+    return true;
+}
+
+RegionStorage::RegionStorage(std::string Directory) :
+    m_Directory{std::move(Directory)}
+{}
+
+RegionFile* RegionStorage::GetRegion(Int32 ChunkX, Int32 ChunkZ, bool Create)
+{
+    const Int32  RegionX = RegionFile::ChunkToRegion(ChunkX);
+    const Int32  RegionZ = RegionFile::ChunkToRegion(ChunkZ);
+    const Uint64 Key     = World::PackChunkKey(RegionX, RegionZ);
+
+    auto It = m_Regions.find(Key);
+    if (It != m_Regions.end() && (It->second || !Create))
+        return It->second.get();
+
+    const std::string Path = m_Directory + "/r." + std::to_string(RegionX) + "." + std::to_string(RegionZ) + ".region";
+
+    std::unique_ptr<RegionFile> pRegion;
+    std::error_code             Error;
+    if (Create)
+        std::filesystem::create_directories(m_Directory, Error);
+    if (Create || std::filesystem::exists(Path, Error))
+    {
+        pRegion = std::make_unique<RegionFile>();
+        if (!pRegion->Open(Path))
+            pRegion.reset();
+    }
+
+    RegionFile* pResult = pRegion.get();
+    m_Regions[Key]      = std::move(pRegion);
+    return pResult;
+}
+
+bool RegionStorage::LoadChunk(Chunk& Dst)
+{
+    Timer Tmr;
+
+    RegionFile* pRegion = GetRegion(Dst.GetX(), Dst.GetZ(), false);
+    if (pRegion == nullptr || !pRegion->ReadChunk(RegionFile::ChunkToLocal(Dst.GetX()), RegionFile::ChunkToLocal(Dst.GetZ()), Dst))
+        return false;
+
+    ++m_NumLoaded;
+    m_LoadTime += Tmr.GetElapsedTime();
+    return true;
+}
+
+bool RegionStorage::SaveChunk(const Chunk& Src)
+{
+    Timer Tmr;
+
+    RegionFile* pRegion = GetRegion(Src.GetX(), Src.GetZ(), true);
+    if (pRegion == nullptr)
+        return false;
+
+    const Uint32 Timestamp = static_cast<Uint32>(std::time(nullptr));
+    if (!pRegion->WriteChunk(RegionFile::ChunkToLocal(Src.GetX()), RegionFile::ChunkToLocal(Src.GetZ()), Src, Timestamp))
+    {
+        LOG_ERROR_MESSAGE("Failed to save chunk ", Src.GetX(), ", ", Src.GetZ(), " to '", m_Directory, "'");
+        return false;
+    }
+
+    ++m_NumSaved;
+    m_SaveTime += Tmr.GetElapsedTime();
+    return true;
+}
+
+} // namespace Diligent
@@ -0,0 +1,182 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+#pragma once
+
+#include <array>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Chunk.hpp"
+
+namespace Diligent
+{
+
+// Codec of a single stored chunk. It is recorded per chunk, so a region can mix codecs
+// and changing the default never requires rewriting old files.
+enum CHUNK_COMPRESSION : Uint8
+{
+    CHUNK_COMPRESSION_NONE = 0,
+    // Run-length encoding of 16-bit block ids. Terrain is stored in YZX order, so
+    // stone, air and water layers collapse into a handful of runs.
+    CHUNK_COMPRESSION_RLE,
+    CHUNK_COMPRESSION_COUNT
+};
+
+// 32x32 chunks stored in one file of 4 KB sectors.
+//
+// Sector 0 holds the location table (first sector << 8 | sector count, per chunk) and
+// sector 1 the last write time of every chunk. Chunk data follows in whole sectors:
+// an 8-byte header with the payload size and codec, then the compressed payload.
+//
+// The file is mapped read-only, so reading a chunk decompresses it straight out of the
+// page cache. Writes go through the file: a chunk is written to the first free run of
+// sectors that fits (or appended at the end) before its table entry is updated, and its
+// old sectors are only released afterwards, so a torn write never loses the old copy.
+//
+// Reads may run concurrently with each other, but not with writes, which can remap the
+// file.
+class RegionFile
+{
+public:
+    static constexpr Uint32 Size             = 32;
+    static constexpr Uint32 NumChunks        = Size * Size;
+    static constexpr Uint32 SectorSize       = 4096;
+    static constexpr Uint32 NumHeaderSectors = 2;
+    static constexpr Uint32 MaxChunkSectors  = 255;
+
+    static Int32  ChunkToRegion(Int32 ChunkCoord) { return ChunkCoord >> 5; }
+    static Uint32 ChunkToLocal(Int32 ChunkCoord) { return static_cast<Uint32>(ChunkCoord) & (Size - 1); }
+
+    RegionFile() = default;
+    ~RegionFile();
+
+    // clang-format off
+    RegionFile           (const RegionFile&)  = delete;
+    RegionFile           (      RegionFile&&) = delete;
+    RegionFile& operator=(const RegionFile&)  = delete;
+    RegionFile& operator=(      RegionFile&&) = delete;
+    // clang-format on
+
+    // Opens the file, creating it if it does not exist. Returns false if the file cannot
+    // be opened or mapped, or if its header is corrupt.
+    bool Open(const std::string& Path);
+    void Close();
+    bool IsOpen() const { return m_pMapped != nullptr; }
+
+    bool HasChunk(Uint32 LocalX, Uint32 LocalZ) const { return m_Locations[GetSlot(LocalX, LocalZ)] != 0; }
+
+    // Seconds since the epoch of the last write, or 0 if the chunk was never written
+    Uint32 GetTimestamp(Uint32 LocalX, Uint32 LocalZ) const { return m_Timestamps[GetSlot(LocalX, LocalZ)]; }
+
+    // Replaces the contents of Dst with the stored chunk. Returns false if the chunk is
+    // not stored or its data is corrupt, in which case Dst is left unchanged.
+    bool ReadChunk(Uint32 LocalX, Uint32 LocalZ, Chunk& Dst) const;
+
+    // Returns false if the file could not be written; the previously stored copy, if
+    // any, stays intact.
+    bool WriteChunk(Uint32 LocalX, Uint32 LocalZ, const Chunk& Src, Uint32 Timestamp, CHUNK_COMPRESSION Compression = CHUNK_COMPRESSION_RLE);
+
+    // Data sectors in the file and how many of them are unused
+    Uint32 GetSectorCount() const { return static_cast<Uint32>(m_UsedSectors.size()); }
+    Uint32 GetFreeSectorCount() const;
+
+    // Bytes the stored chunk occupies in the file including its header, or 0 if the
+    // chunk is not stored
+    Uint32 GetChunkSize(Uint32 LocalX, Uint32 LocalZ) const;
+
+private:
+    static Uint32 GetSlot(Uint32 LocalX, Uint32 LocalZ)
+    {
+        VERIFY_EXPR(LocalX < Size && LocalZ < Size);
+        return LocalZ * Size + LocalX;
+    }
+
+    bool   Map(Uint64 FileSize);
+    void   Unmap();
+    bool   WriteAt(Uint64 Offset, const void* pData, size_t DataSize);
+    bool   Reserve(Uint64 FileSize);
+    Uint32 FindFreeSectors(Uint32 Count) const;
+
+private:
+    std::array<Uint32, NumChunks> m_Locations  = {};
+    std::array<Uint32, NumChunks> m_Timestamps = {};
+
+    // One entry per sector, header included
+    std::vector<bool> m_UsedSectors;
+
+    // Scratch buffers reused by WriteChunk()
+    std::vector<BlockId> m_RawWords;
+    std::vector<Uint8>   m_Encoded;
+
+#if PLATFORM_WIN32
+    void* m_hFile    = nullptr;
+    void* m_hMapping = nullptr;
+#else
+    int m_File = -1;
+#endif
+    const Uint8* m_pMapped    = nullptr;
+    Uint64       m_MappedSize = 0;
+};
+
+// Region files of one world, opened on first use and kept open until destruction.
+// Files are named r.<x>.<z>.region after their region coordinates.
+class RegionStorage
+{
+public:
+    explicit RegionStorage(std::string Directory);
+
+    // Replaces the contents of Dst with its stored copy. Returns false if the chunk has
+    // never been saved.
+    bool LoadChunk(Chunk& Dst);
+    bool SaveChunk(const Chunk& Src);
+
+    const std::string& GetDirectory() const { return m_Directory; }
+
+    // Statistics since construction, for the debug panel
+    Uint32 GetLoadedChunkCount() const { return m_NumLoaded; }
+    Uint32 GetSavedChunkCount() const { return m_NumSaved; }
+    double GetLoadTime() const { return m_LoadTime; }
+    double GetSaveTime() const { return m_SaveTime; }
+
+private:
+    RegionFile* GetRegion(Int32 ChunkX, Int32 ChunkZ, bool Create);
+
+private:
+    std::string m_Directory;
+
+    // Regions that failed to open are kept as null so they are not retried every chunk
+    std::unordered_map<Uint64, std::unique_ptr<RegionFile>> m_Regions;
+
+    Uint32 m_NumLoaded = 0;
+    Uint32 m_NumSaved  = 0;
+    double m_LoadTime  = 0;
+    double m_SaveTime  = 0;
+};
+
+} // namespace Diligent
@@ -0,0 +1,88 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+#pragma once
+
+#include "Common/interface/BasicMath.hpp"
+
+namespace Diligent
+{
+
+// Fixed-step simulation clock.
+//
+// Frame time is accumulated and spent in whole ticks of TickInterval, so the
+// simulation advances the same way at any frame rate. After a long frame at most
+// MaxTicksPerFrame ticks are run and the rest of the backlog is dropped: the game
+// slows down instead of spiralling into ever longer frames. The remaining fraction
+// of a tick is exposed as the interpolation factor for rendering.
+class SimulationClock
+{
+public:
+    // LCE runs its simulation at 20 ticks per second
+    static constexpr Uint32 TicksPerSecond   = 20;
+    static constexpr double TickInterval     = 1.0 / TicksPerSecond;
+    static constexpr Uint32 MaxTicksPerFrame = 10;
+
+    // Adds the frame time and returns how many ticks to run this frame
+    Uint32 Advance(double FrameTime);
+
+    // How far the frame is between the last tick and the next one, in [0, 1)
+    float GetAlpha() const { return static_cast<float>(m_Accumulator / TickInterval); }
+
+    Uint64 GetTickCount() const { return m_TickCount; }
+    Uint64 GetDroppedTickCount() const { return m_DroppedTickCount; }
+
+private:
+    double m_Accumulator      = 0;
+    Uint64 m_TickCount        = 0;
+    Uint64 m_DroppedTickCount = 0;
+};
+
+// Value updated once per tick and drawn blended between its last two states
+template <typename T>
+struct Interpolated
+{
+    T Prev{};
+    T Curr{};
+
+    // Moves to a new state, keeping the old one to interpolate from
+    void Set(const T& Value)
+    {
+        Prev = Curr;
+        Curr = Value;
+    }
+
+    // Jumps to a state without interpolation, e.g. when teleporting
+    void Reset(const T& Value)
+    {
+        Prev = Value;
+        Curr = Value;
+    }
+
+    T Get(float Alpha) const { return lerp(Prev, Curr, Alpha); }
+};
+
+} // namespace Diligent
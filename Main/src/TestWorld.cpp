@@ -0,0 +1,133 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "TestWorld.hpp"
+
+namespace Diligent
+{
+
+namespace
+{
+
+Uint32 HashBlockPos(Int32 x, Int32 y, Int32 z)
+{
+    Uint32 h = static_cast<Uint32>(x) * 0x8da6b343u ^ static_cast<Uint32>(y) * 0xd8163841u ^ static_cast<Uint32>(z) * 0xcb1ab31fu;
+    h ^= h >> 13u;
+    h *= 0x5bd1e995u;
+    return h ^ (h >> 15u);
+}
+
+Int32 GetTestHeight(Int32 x, Int32 z)
+{
+    const float fx = static_cast<float>(x);
+    const float fz = static_cast<float>(z);
+    const float h  = 52.f + 10.f * std::sin(fx * 0.045f) * std::cos(fz * 0.06f) + 4.f * std::sin((fx + fz) * 0.13f);
+    return static_cast<Int32>(h);
+}
+
+} // namespace
+
+void FillTestChunk(Chunk& Chnk)
+{
+    const Int32 BaseX = Chnk.GetX() * 16;
+    const Int32 BaseZ = Chnk.GetZ() * 16;
+
+    Int32 Heights[16][16];
+    Int32 MaxHeight = 0;
+    for (Int32 z = 0; z < 16; ++z)
+    {
+        for (Int32 x = 0; x < 16; ++x)
+        {
+            Heights[z][x] = GetTestHeight(BaseX + x, BaseZ + z);
+            MaxHeight     = std::max(MaxHeight, Heights[z][x]);
+        }
+    }
+
+    std::vector<BlockId> Blocks(ChunkSection::Volume);
+    for (Int32 s = 0; s < Chunk::NumSections; ++s)
+    {
+        const Int32 BaseY = s * 16;
+        if (BaseY > MaxHeight)
+        {
+            Chnk.GetSection(s).Fill(BLOCK_AIR);
+            continue;
+        }
+
+        for (Int32 y = 0; y < 16; ++y)
+        {
+            const Int32 wy = BaseY + y;
+            for (Int32 z = 0; z < 16; ++z)
+            {
+                for (Int32 x = 0; x < 16; ++x)
+                {
+                    const Int32 Height = Heights[z][x];
+
+                    BlockId Id = BLOCK_AIR;
+                    if (wy == 0)
+                        Id = BLOCK_BEDROCK;
+                    else if (wy < Height - 3)
+                        Id = BLOCK_STONE;
+                    else if (wy < Height)
+                        Id = BLOCK_DIRT;
+                    else if (wy == Height)
+                        Id = BLOCK_GRASS;
+
+                    if (Id == BLOCK_STONE)
+                    {
+                        const Uint32 h = HashBlockPos(BaseX + x, wy, BaseZ + z);
+                        // Tunnels carved along two sine curves plus some stone variety
+                        const float Tunnel = std::sin((BaseX + x) * 0.11f) * 6.f + 24.f - static_cast<float>(wy);
+                        if (std::abs(Tunnel) < 2.5f && std::abs(std::sin((BaseZ + z) * 0.07f)) < 0.35f)
+                            Id = BLOCK_AIR;
+                        else if ((h & 63u) == 0)
+                            Id = BLOCK_GRAVEL;
+                        else if ((h & 63u) == 1)
+                            Id = BLOCK_COBBLESTONE;
+                    }
+
+                    Blocks[ChunkSection::GetIndex(x, y, z)] = Id;
+                }
+            }
+        }
+        Chnk.GetSection(s).Encode(Blocks.data());
+    }
+}
+
+void CreateTestWorld(World& Wrld, Int32 Radius)
+{
+    for (Int32 cz = -Radius; cz <= Radius; ++cz)
+    {
+        for (Int32 cx = -Radius; cx <= Radius; ++cx)
+            FillTestChunk(Wrld.GetOrCreateChunk(cx, cz));
+    }
+}
+
+} // namespace Diligent
@@ -0,0 +1,228 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+#include "VisibilityGraph.hpp"
+
+#include <cmath>
+
+#include "Common/interface/Timer.hpp"
+
+namespace Diligent
+{
+
+namespace
+{
+
+// clang-format off
+// Step to the neighbour behind each face, indexed by BLOCK_FACE
+constexpr Int32 FaceOffsets[BLOCK_FACE_COUNT][3] =
+{
+    {-1,  0,  0},
+    {+1,  0,  0},
+    { 0, -1,  0},
+    { 0, +1,  0},
+    { 0,  0, -1},
+    { 0,  0, +1},
+};
+// clang-format on
+
+constexpr Uint32 OppositeFace(Uint32 Face)
+{
+    return Face ^ 1u;
+}
+
+constexpr Uint8  NotEntered = 0xFF;
+constexpr Uint32 NoFace     = 7;
+
+} // namespace
+
+void VisibilityGraph::SetConnectivity(const int3& SectionPos, const SectionConnectivity& Connectivity)
+{
+    if (SectionPos.y < 0 || SectionPos.y >= Chunk::NumSections)
+        return;
+
+    auto It = m_Columns.find(World::PackChunkKey(SectionPos.x, SectionPos.z));
+    if (It == m_Columns.end())
+    {
+        Column NewColumn;
+        for (auto& Section : NewColumn.Sections)
+            Section = SectionConnectivity::AllConnected();
+        It = m_Columns.emplace(World::PackChunkKey(SectionPos.x, SectionPos.z), NewColumn).first;
+    }
+    It->second.Sections[SectionPos.y] = Connectivity;
+}
+
+void VisibilityGraph::RemoveChunk(Int32 ChunkX, Int32 ChunkZ)
+{
+    m_Columns.erase(World::PackChunkKey(ChunkX, ChunkZ));
+}
+
+const VisibilityGraph::Column* VisibilityGraph::GetColumn(Uint32 ColumnIndex)
+{
+    if (m_ColumnStamps[ColumnIndex] != m_Stamp)
+    {
+        const Int32 ChunkX = m_GridMinX + static_cast<Int32>(ColumnIndex % m_GridSize);
+        const Int32 ChunkZ = m_GridMinZ + static_cast<Int32>(ColumnIndex / m_GridSize);
+
+        auto It = m_Columns.find(World::PackChunkKey(ChunkX, ChunkZ));
+
+        m_GridColumns[ColumnIndex]  = It != m_Columns.end() ? &It->second : nullptr;
+        m_ColumnStamps[ColumnIndex] = m_Stamp;
+    }
+    return m_GridColumns[ColumnIndex];
+}
+
+Int32 VisibilityGraph::GetGridIndex(const int3& SectionPos) const
+{
+    const Int32 x = SectionPos.x - m_GridMinX;
+    const Int32 z = SectionPos.z - m_GridMinZ;
+    if (x < 0 || x >= m_GridSize || z < 0 || z >= m_GridSize || SectionPos.y < 0 || SectionPos.y >= Chunk::NumSections)
+        return -1;
+    return (z * m_GridSize + x) * Chunk::NumSections + SectionPos.y;
+}
+
+bool VisibilityGraph::IsVisible(const int3& SectionPos) const
+{
+    if (m_AllVisible)
+        return true;
+
+    const Int32 Index = GetGridIndex(SectionPos);
+    return Index >= 0 && m_SectionStamps[Index] == m_Stamp;
+}
+
+void VisibilityGraph::Update(const float3& CameraPos, const ViewFrustum& Frustum, Int32 Radius)
+{
+    Timer Tmr;
+
+    ++m_Stamp;
+    m_VisibleCount = 0;
+
+    const int3 CameraSection{
+        World::BlockToChunk(static_cast<Int32>(std::floor(CameraPos.x))),
+        static_cast<Int32>(std::floor(CameraPos.y / ChunkSection::Size)),
+        World::BlockToChunk(static_cast<Int32>(std::floor(CameraPos.z))),
+    };
+
+    // Any line of sight between two points inside the world stays inside it, but from
+    // above or below it the world has to be entered through a side we do not track
+    m_AllVisible = CameraSection.y < 0 || CameraSection.y >= Chunk::NumSections;
+    if (m_AllVisible)
+    {
+        m_UpdateTime = Tmr.GetElapsedTime();
+        return;
+    }
+
+    const Int32 GridSize = Radius * 2 + 1;
+    if (GridSize != m_GridSize)
+    {
+        m_GridSize = GridSize;
+
+        const size_t NumColumns  = static_cast<size_t>(GridSize) * GridSize;
+        const size_t NumSections = NumColumns * Chunk::NumSections;
+        m_GridColumns.assign(NumColumns, nullptr);
+        m_ColumnStamps.assign(NumColumns, 0);
+        m_SectionStamps.assign(NumSections, 0);
+        m_EntryDirections.resize(NumSections);
+        // Stamps were reset to zero
+        m_Stamp = 1;
+    }
+    m_GridMinX = CameraSection.x - Radius;
+    m_GridMinZ = CameraSection.z - Radius;
+
+    static const SectionConnectivity AllConnected = SectionConnectivity::AllConnected();
+
+    m_Queue.clear();
+
+    // Marks the section as reached and records a new way of entering it.
+    // Returns false if that way does not allow anything new.
+    auto Enter = [&](Uint32 SectionIndex, Uint32 EntryFace, Uint8 Directions) {
+        if (m_SectionStamps[SectionIndex] != m_Stamp)
+        {
+            m_SectionStamps[SectionIndex] = m_Stamp;
+            m_EntryDirections[SectionIndex].fill(NotEntered);
+            ++m_VisibleCount;
+        }
+        if (EntryFace == NoFace)
+            return true;
+
+        // Fewer taken directions mean fewer forbidden ones
+        Uint8& Entered = m_EntryDirections[SectionIndex][EntryFace];
+        if (Entered != NotEntered && (Entered & Directions) == Entered)
+            return false;
+        Entered = Entered == NotEntered ? Directions : static_cast<Uint8>(Entered & Directions);
+        return true;
+    };
+
+    const Uint32 CameraIndex = static_cast<Uint32>(GetGridIndex(CameraSection));
+    Enter(CameraIndex, NoFace, 0);
+    m_Queue.push_back((CameraIndex << 3u) | NoFace);
+
+    for (size_t Head = 0; Head < m_Queue.size(); ++Head)
+    {
+        const Uint32 SectionIndex = m_Queue[Head] >> 3u;
+        const Uint32 EntryFace    = m_Queue[Head] & 7u;
+        const Uint32 ColumnIndex  = SectionIndex / Chunk::NumSections;
+
+        const int3 SectionPos{
+            m_GridMinX + static_cast<Int32>(ColumnIndex % m_GridSize),
+            static_cast<Int32>(SectionIndex % Chunk::NumSections),
+            m_GridMinZ + static_cast<Int32>(ColumnIndex / m_GridSize),
+        };
+
+        const Column*              pColumn      = GetColumn(ColumnIndex);
+        const SectionConnectivity& Connectivity = pColumn != nullptr ? pColumn->Sections[SectionPos.y] : AllConnected;
+        const Uint8                Directions   = EntryFace != NoFace ? m_EntryDirections[SectionIndex][EntryFace] : Uint8{0};
+
+        for (Uint32 Face = 0; Face < BLOCK_FACE_COUNT; ++Face)
+        {
+            if (Directions & (1u << OppositeFace(Face)))
+                continue;
+            if (EntryFace != NoFace && !Connectivity.IsConnected(EntryFace, Face))
+                continue;
+
+            const int3 NeighbourPos{
+                SectionPos.x + FaceOffsets[Face][0],
+                SectionPos.y + FaceOffsets[Face][1],
+                SectionPos.z + FaceOffsets[Face][2],
+            };
+            const Int32 NeighbourIndex = GetGridIndex(NeighbourPos);
+            if (NeighbourIndex < 0)
+                continue;
+
+            const float3 Min{static_cast<float>(NeighbourPos.x * 16), static_cast<float>(NeighbourPos.y * 16), static_cast<float>(NeighbourPos.z * 16)};
+            if (GetBoxVisibility(Frustum, BoundBox{Min, Min + float3{16, 16, 16}}) == BoxVisibility::Invisible)
+                continue;
+
+            const Uint32 NeighbourEntry = OppositeFace(Face);
+            if (Enter(static_cast<Uint32>(NeighbourIndex), NeighbourEntry, static_cast<Uint8>(Directions | (1u << Face))))
+                m_Queue.push_back((static_cast<Uint32>(NeighbourIndex) << 3u) | NeighbourEntry);
+        }
+    }
+
+    m_UpdateTime = Tmr.GetElapsedTime();
+}
+
+} // namespace Diligent
@@ -0,0 +1,97 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+
+#include "Common/interface/AdvancedMath.hpp"
+#include "ChunkMesher.hpp"
+
+namespace Diligent
+{
+
+// Occlusion culling of whole sections through cave connectivity.
+//
+// Every meshed section records which of its faces see each other through non-opaque
+// blocks (see SectionConnectivity). Update() walks the sections breadth-first from the
+// one containing the camera, leaving a section only through a face connected to the one
+// it was entered by, never stepping back against a direction already taken (a line of
+// sight moves one way along each axis) and skipping sections outside the frustum.
+// Sections that are not reached cannot be seen.
+//
+// A section may be entered through several faces with different sets of taken
+// directions; it is revisited whenever that widens what can be reached from it, so the
+// result does not depend on the visiting order. Sections that were never meshed (empty
+// or not loaded yet) count as fully connected.
+class VisibilityGraph
+{
+public:
+    void SetConnectivity(const int3& SectionPos, const SectionConnectivity& Connectivity);
+    void RemoveChunk(Int32 ChunkX, Int32 ChunkZ);
+
+    // Radius is in chunks around the camera chunk; sections further away are not visible.
+    // When the camera is above or below the world, every section is treated as visible.
+    void Update(const float3& CameraPos, const ViewFrustum& Frustum, Int32 Radius);
+
+    bool IsVisible(const int3& SectionPos) const;
+
+    // Sections reached by the last Update()
+    Uint32 GetVisibleCount() const { return m_VisibleCount; }
+    double GetUpdateTime() const { return m_UpdateTime; }
+
+private:
+    struct Column
+    {
+        SectionConnectivity Sections[Chunk::NumSections];
+    };
+
+    const Column* GetColumn(Uint32 ColumnIndex);
+
+    Int32 GetGridIndex(const int3& SectionPos) const;
+
+    std::unordered_map<Uint64, Column> m_Columns;
+
+    // Search state, on a grid of columns centered on the camera chunk. Stamps avoid
+    // clearing the grid every frame; column pointers are only cached for one search.
+    Int32                      m_GridMinX   = 0;
+    Int32                      m_GridMinZ   = 0;
+    Int32                      m_GridSize   = 0;
+    Uint32                     m_Stamp      = 0;
+    bool                       m_AllVisible = true;
+    std::vector<const Column*> m_GridColumns;
+    std::vector<Uint32>        m_ColumnStamps;
+    std::vector<Uint32>        m_SectionStamps;
+    // Per section and entry face, the directions that must not be reversed; 0xFF when not entered
+    std::vector<std::array<Uint8, BLOCK_FACE_COUNT>> m_EntryDirections;
+    std::vector<Uint32>                              m_Queue;
+
+    Uint32 m_VisibleCount = 0;
+    double m_UpdateTime   = 0;
+};
+
+} // namespace Diligent
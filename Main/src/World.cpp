@@ -0,0 +1,194 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include "World.hpp"
+
+#include <algorithm>
+
+namespace Diligent
+{
+
+World::World(const WorldCreateInfo& CI) :
+    m_Type{CI.Type}
+{
+    if (m_Type != WORLD_TYPE_FINITE)
+        return;
+
+    VERIFY(CI.SizeInChunks > 0, "Finite world must be at least one chunk wide");
+    m_SizeInChunks = std::max(CI.SizeInChunks, 1);
+    m_MinChunk     = -(m_SizeInChunks / 2);
+    m_MinBlock     = m_MinChunk * static_cast<Int32>(ChunkSection::Size);
+    m_MaxBlock     = (m_MinChunk + m_SizeInChunks) * static_cast<Int32>(ChunkSection::Size) - 1;
+
+    m_Slots.reserve(static_cast<size_t>(m_SizeInChunks) * m_SizeInChunks);
+    for (Int32 z = 0; z < m_SizeInChunks; ++z)
+    {
+        for (Int32 x = 0; x < m_SizeInChunks; ++x)
+            m_Slots.emplace_back(m_MinChunk + x, m_MinChunk + z);
+    }
+}
+
+Chunk* World::GetChunk(Int32 ChunkX, Int32 ChunkZ)
+{
+    return const_cast<Chunk*>(static_cast<const World&>(*this).GetChunk(ChunkX, ChunkZ));
+}
+
+const Chunk* World::GetChunk(Int32 ChunkX, Int32 ChunkZ) const
+{
+    if (m_Type == WORLD_TYPE_FINITE)
+    {
+        if (!IsChunkInside(ChunkX, ChunkZ))
+            return nullptr;
+        const ChunkSlot& Slot = m_Slots[GetSlotIndex(ChunkX, ChunkZ)];
+        return Slot.IsLoaded ? &Slot.Chnk : nullptr;
+    }
+
+    auto It = m_Chunks.find(PackChunkKey(ChunkX, ChunkZ));
+    return It != m_Chunks.end() ? It->second.get() : nullptr;
+}
+
+Chunk& World::GetOrCreateChunk(Int32 ChunkX, Int32 ChunkZ)
+{
+    if (m_Type == WORLD_TYPE_FINITE)
+    {
+        VERIFY(IsChunkInside(ChunkX, ChunkZ), "Chunk (", ChunkX, ", ", ChunkZ, ") is outside of the world border");
+        ChunkSlot& Slot = m_Slots[GetSlotIndex(ChunkX, ChunkZ)];
+        if (!Slot.IsLoaded)
+        {
+            Slot.IsLoaded = true;
+            ++m_NumLoadedSlots;
+        }
+        return Slot.Chnk;
+    }
+
+    auto& pChunk = m_Chunks[PackChunkKey(ChunkX, ChunkZ)];
+    if (!pChunk)
+        pChunk = std::make_unique<Chunk>(ChunkX, ChunkZ);
+    return *pChunk;
+}
+
+Chunk* World::AddChunk(std::unique_ptr<Chunk> pChunk)
+{
+    VERIFY_EXPR(pChunk);
+    if (m_Type == WORLD_TYPE_FINITE)
+    {
+        if (!IsChunkInside(pChunk->GetX(), pChunk->GetZ()))
+            return nullptr;
+
+        // Slot chunks cannot be replaced, so the contents are moved over instead
+        Chunk& Chnk = GetOrCreateChunk(pChunk->GetX(), pChunk->GetZ());
+        for (Int32 s = 0; s < Chunk::NumSections; ++s)
+            Chnk.GetSection(s) = std::move(pChunk->GetSection(s));
+        Chnk.SetModified(pChunk->IsModified());
+        return &Chnk;
+    }
+
+    auto& pSlot = m_Chunks[PackChunkKey(pChunk->GetX(), pChunk->GetZ())];
+    pSlot       = std::move(pChunk);
+    return pSlot.get();
+}
+
+void World::ResetSlot(ChunkSlot& Slot)
+{
+    for (Int32 s = 0; s < Chunk::NumSections; ++s)
+        Slot.Chnk.GetSection(s) = ChunkSection{};
+    Slot.Chnk.SetModified(false);
+    Slot.IsLoaded = false;
+}
+
+void World::UnloadChunk(Int32 ChunkX, Int32 ChunkZ)
+{
+    if (m_Type == WORLD_TYPE_FINITE)
+    {
+        if (!IsChunkInside(ChunkX, ChunkZ))
+            return;
+
+        ChunkSlot& Slot = m_Slots[GetSlotIndex(ChunkX, ChunkZ)];
+        if (Slot.IsLoaded)
+        {
+            ResetSlot(Slot);
+            --m_NumLoadedSlots;
+        }
+        return;
+    }
+
+    m_Chunks.erase(PackChunkKey(ChunkX, ChunkZ));
+}
+
+BlockId World::GetBlock(Int32 x, Int32 y, Int32 z) const
+{
+    if (m_Type == WORLD_TYPE_FINITE)
+    {
+        x = std::clamp(x, m_MinBlock, m_MaxBlock);
+        z = std::clamp(z, m_MinBlock, m_MaxBlock);
+
+        const ChunkSlot& Slot = m_Slots[GetSlotIndex(BlockToChunk(x), BlockToChunk(z))];
+        return Slot.IsLoaded ? Slot.Chnk.GetBlock(BlockToLocal(x), y, BlockToLocal(z)) : BlockId{BLOCK_AIR};
+    }
+
+    const Chunk* pChunk = GetChunk(BlockToChunk(x), BlockToChunk(z));
+    return pChunk != nullptr ? pChunk->GetBlock(BlockToLocal(x), y, BlockToLocal(z)) : BlockId{BLOCK_AIR};
+}
+
+bool World::SetBlock(Int32 x, Int32 y, Int32 z, BlockId Id)
+{
+    if (y < 0 || y >= Chunk::Height)
+        return false;
+
+    Chunk* pChunk = GetChunk(BlockToChunk(x), BlockToChunk(z));
+    if (pChunk == nullptr)
+        return false;
+
+    pChunk->SetBlock(BlockToLocal(x), y, BlockToLocal(z), Id);
+    pChunk->SetModified(true);
+    return true;
+}
+
+const ChunkSection* World::GetSection(const int3& SectionPos) const
+{
+    if (SectionPos.y < 0 || SectionPos.y >= Chunk::NumSections)
+        return nullptr;
+
+    const Chunk* pChunk = GetChunk(SectionPos.x, SectionPos.z);
+    return pChunk != nullptr ? &pChunk->GetSection(SectionPos.y) : nullptr;
+}
+
+size_t World::GetMemoryUsage() const
+{
+    size_t Size = sizeof(*this) + m_Slots.capacity() * sizeof(ChunkSlot);
+    for (const auto& Slot : m_Slots)
+    {
+        // Inline bytes are already counted with the slot array
+        if (Slot.IsLoaded)
+            Size += Slot.Chnk.GetMemoryUsage() - sizeof(Chunk);
+    }
+    for (const auto& It : m_Chunks)
+        Size += It.second->GetMemoryUsage();
+    return Size;
+}
+
+} // namespace Diligent
@@ -0,0 +1,182 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "Chunk.hpp"
+
+namespace Diligent
+{
+
+enum WORLD_TYPE : Uint8
+{
+    // Chunks are created anywhere on demand
+    WORLD_TYPE_INFINITE = 0,
+
+    // Legacy Console Edition style world of a fixed size centred on the origin
+    WORLD_TYPE_FINITE
+};
+
+struct WorldCreateInfo
+{
+    WORLD_TYPE Type = WORLD_TYPE_INFINITE;
+
+    // Width and depth of a finite world in chunks. 54 chunks is the 864x864 block
+    // world of the console editions.
+    Int32 SizeInChunks = 54;
+};
+
+// Infinite worlds keep their chunks in a hash map keyed by the packed column
+// coordinates.
+//
+// Finite worlds preallocate one cache-line aligned slot per chunk in a flat array and
+// find chunks by index arithmetic instead of hashing. Chunks outside the border do not
+// exist, and block lookups clamp coordinates to the border, so the outermost columns
+// continue past it.
+class World
+{
+public:
+    explicit World(const WorldCreateInfo& CI = {});
+
+    static Int32 BlockToChunk(Int32 Coord) { return Coord >> 4; }
+    static Int32 BlockToLocal(Int32 Coord) { return Coord & 15; }
+
+    static Uint64 PackChunkKey(Int32 ChunkX, Int32 ChunkZ)
+    {
+        return (Uint64{static_cast<Uint32>(ChunkX)} << 32u) | Uint64{static_cast<Uint32>(ChunkZ)};
+    }
+
+    // Unique key of a section: 28 bits for x and z and 8 bits for y
+    static Uint64 PackSectionKey(const int3& SectionPos)
+    {
+        return (Uint64{static_cast<Uint32>(SectionPos.x) & 0xFFFFFFFu} << 36u) |
+            (Uint64{static_cast<Uint32>(SectionPos.z) & 0xFFFFFFFu} << 8u) |
+            Uint64{static_cast<Uint32>(SectionPos.y) & 0xFFu};
+    }
+
+    Chunk*       GetChunk(Int32 ChunkX, Int32 ChunkZ);
+    const Chunk* GetChunk(Int32 ChunkX, Int32 ChunkZ) const;
+    Chunk&       GetOrCreateChunk(Int32 ChunkX, Int32 ChunkZ);
+    // Takes over a chunk built outside the world, replacing any loaded chunk at its
+    // position. Returns null and drops the chunk if it is past the border of a finite world.
+    Chunk*       AddChunk(std::unique_ptr<Chunk> pChunk);
+    void         UnloadChunk(Int32 ChunkX, Int32 ChunkZ);
+
+    WORLD_TYPE GetType() const { return m_Type; }
+
+    // Always true in infinite worlds. GetOrCreateChunk() must only be called for chunks
+    // inside the border.
+    bool IsChunkInside(Int32 ChunkX, Int32 ChunkZ) const
+    {
+        return m_Type == WORLD_TYPE_INFINITE ||
+            (static_cast<Uint32>(ChunkX - m_MinChunk) < static_cast<Uint32>(m_SizeInChunks) &&
+             static_cast<Uint32>(ChunkZ - m_MinChunk) < static_cast<Uint32>(m_SizeInChunks));
+    }
+
+    // Returns air for unloaded chunks and out-of-range heights. Finite worlds clamp x
+    // and z to the border.
+    BlockId GetBlock(Int32 x, Int32 y, Int32 z) const;
+
+    // Returns false if the chunk is not loaded or y is out of range. Marks the chunk as
+    // modified (see Chunk::IsModified()).
+    bool SetBlock(Int32 x, Int32 y, Int32 z, BlockId Id);
+
+    // Section at section coordinates, or null if it is not loaded
+    const ChunkSection* GetSection(const int3& SectionPos) const;
+
+    size_t GetChunkCount() const { return m_Chunks.size() + m_NumLoadedSlots; }
+    size_t GetMemoryUsage() const;
+
+    // Visits loaded chunks only
+    template <typename HandlerType>
+    void ForEachChunk(HandlerType&& Handler)
+    {
+        for (auto& Slot : m_Slots)
+        {
+            if (Slot.IsLoaded)
+                Handler(Slot.Chnk);
+        }
+        for (auto& It : m_Chunks)
+            Handler(*It.second);
+    }
+
+    template <typename HandlerType>
+    void ForEachChunk(HandlerType&& Handler) const
+    {
+        for (const auto& Slot : m_Slots)
+        {
+            if (Slot.IsLoaded)
+                Handler(static_cast<const Chunk&>(Slot.Chnk));
+        }
+        for (const auto& It : m_Chunks)
+            Handler(static_cast<const Chunk&>(*It.second));
+    }
+
+private:
+    // A chunk of a finite world. Slots never move, so chunk pointers stay valid.
+    struct alignas(64) ChunkSlot
+    {
+        ChunkSlot(Int32 X, Int32 Z) :
+            Chnk{X, Z}
+        {}
+
+        Chunk Chnk;
+        bool  IsLoaded = false;
+    };
+
+    size_t GetSlotIndex(Int32 ChunkX, Int32 ChunkZ) const
+    {
+        VERIFY_EXPR(IsChunkInside(ChunkX, ChunkZ));
+        return static_cast<size_t>(ChunkZ - m_MinChunk) * m_SizeInChunks + static_cast<size_t>(ChunkX - m_MinChunk);
+    }
+
+    // Returns the slot to its freshly created state
+    void ResetSlot(ChunkSlot& Slot);
+
+private:
+    WORLD_TYPE m_Type = WORLD_TYPE_INFINITE;
+
+    // Infinite worlds. Chunks are heap-allocated so that pointers stay valid while the
+    // map rehashes.
+    std::unordered_map<Uint64, std::unique_ptr<Chunk>> m_Chunks;
+
+    // Finite worlds, indexed by GetSlotIndex()
+    std::vector<ChunkSlot> m_Slots;
+    size_t                 m_NumLoadedSlots = 0;
+
+    Int32 m_MinChunk     = 0;
+    Int32 m_SizeInChunks = 0;
+    // First and last block column inside the border
+    Int32 m_MinBlock = 0;
+    Int32 m_MaxBlock = 0;
+};
+
+} // namespace Diligent
@@ -0,0 +1,227 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+// Headless world generation benchmark.
+//
+// Generates and lights the chunks within a radius of the origin, optionally meshes them,
+// and prints the throughput, the time spent in every generation stage and the peak
+// resident set size as JSON. Links only the world code, so it runs on machines without a
+// display or GPU.
+//
+//     WorldGenBenchmark [--seed N] [--radius R] [--threads T] [--mesh]
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#if PLATFORM_WIN32
+#    ifndef NOMINMAX
+#        define NOMINMAX
+#    endif
+#    include <Windows.h>
+#    include <Psapi.h>
+#else
+#    include <sys/resource.h>
+#endif
+
+#include "World.hpp"
+#include "WorldGenerator.hpp"
+#include "GenerationScheduler.hpp"
+#include "LightEngine.hpp"
+#include "MeshScheduler.hpp"
+#include "Common/interface/Timer.hpp"
+
+using namespace Diligent;
+
+namespace
+{
+
+struct BenchmarkArgs
+{
+    Uint32 Seed       = 12345;
+    Int32  Radius     = 8;
+    Uint32 NumThreads = std::max(std::thread::hardware_concurrency(), 1u);
+    bool   Mesh       = false;
+};
+
+bool ParseArgs(int argc, char** argv, BenchmarkArgs& Args)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        const bool HasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "--seed") == 0 && HasValue)
+            Args.Seed = static_cast<Uint32>(std::strtoul(argv[++i], nullptr, 10));
+        else if (std::strcmp(argv[i], "--radius") == 0 && HasValue)
+            Args.Radius = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--threads") == 0 && HasValue)
+            Args.NumThreads = static_cast<Uint32>(std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--mesh") == 0)
+            Args.Mesh = true;
+        else
+            return false;
+    }
+    return Args.Radius >= 0 && Args.NumThreads > 0;
+}
+
+// Peak resident set size of the process in bytes
+size_t GetPeakRSS()
+{
+#if PLATFORM_WIN32
+    PROCESS_MEMORY_COUNTERS Counters{};
+    return GetProcessMemoryInfo(GetCurrentProcess(), &Counters, sizeof(Counters)) ? Counters.PeakWorkingSetSize : 0;
+#else
+    rusage Usage{};
+    getrusage(RUSAGE_SELF, &Usage);
+#    if PLATFORM_MACOS
+    return static_cast<size_t>(Usage.ru_maxrss);
+#    else
+    return static_cast<size_t>(Usage.ru_maxrss) * 1024;
+#    endif
+#endif
+}
+
+// FNV-1a over the blocks of the requested chunks, to tell terrain changes from
+// performance changes when comparing runs
+Uint64 HashBlocks(const World& Wrld, Int32 Radius)
+{
+    Uint64               Hash = 0xCBF29CE484222325ull;
+    std::vector<BlockId> Blocks(ChunkSection::Volume);
+    for (Int32 cz = -Radius; cz <= Radius; ++cz)
+    {
+        for (Int32 cx = -Radius; cx <= Radius; ++cx)
+        {
+            const Chunk* pChunk = Wrld.GetChunk(cx, cz);
+            if (pChunk == nullptr)
+                continue;
+
+            for (Int32 s = 0; s < Chunk::NumSections; ++s)
+            {
+                pChunk->GetSection(s).Decode(Blocks.data());
+                for (BlockId Id : Blocks)
+                    Hash = (Hash ^ Id) * 0x100000001B3ull;
+            }
+        }
+    }
+    return Hash;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    BenchmarkArgs Args;
+    if (!ParseArgs(argc, argv, Args))
+    {
+        std::fprintf(stderr, "Usage: %s [--seed N] [--radius R] [--threads T] [--mesh]\n", argv[0]);
+        return 1;
+    }
+
+    const Int32 NumChunks = (2 * Args.Radius + 1) * (2 * Args.Radius + 1);
+
+    World               Wrld;
+    WorldGenerator      Generator{Args.Seed};
+    LightEngine         Light{Args.NumThreads};
+    GenerationScheduler Scheduler{Generator, Args.NumThreads};
+    for (Int32 cz = -Args.Radius; cz <= Args.Radius; ++cz)
+    {
+        for (Int32 cx = -Args.Radius; cx <= Args.Radius; ++cx)
+            Scheduler.RequestChunk(cx, cz);
+    }
+
+    Timer Tmr;
+    while (Scheduler.HasPendingWork() || Scheduler.GetRunningJobCount() > 0)
+    {
+        Scheduler.Update(Wrld, Light, float3{0, 64, 0});
+        std::this_thread::yield();
+    }
+    const double GenerationTime = Tmr.GetElapsedTime();
+
+    std::printf("{\n");
+    std::printf("  \"seed\": %u,\n", Args.Seed);
+    std::printf("  \"radius\": %d,\n", Args.Radius);
+    std::printf("  \"threads\": %u,\n", Args.NumThreads);
+    std::printf("  \"simd\": \"%s\",\n", GetSimdLevelName(GetMaxSimdLevel()));
+    std::printf("  \"chunks\": %d,\n", NumChunks);
+    // Includes the ring of partially generated chunks the requested ones depend on
+    std::printf("  \"chunks_in_world\": %zu,\n", Wrld.GetChunkCount());
+    std::printf("  \"block_hash\": \"%016llx\",\n", static_cast<unsigned long long>(HashBlocks(Wrld, Args.Radius)));
+    std::printf("  \"generation_seconds\": %.4f,\n", GenerationTime);
+    std::printf("  \"chunks_per_sec\": %.2f,\n", GenerationTime > 0 ? NumChunks / GenerationTime : 0.0);
+
+    // Stage times are summed over all threads
+    std::printf("  \"stages\": {\n");
+    for (Uint32 Stage = CHUNK_STATUS_NOISE; Stage < CHUNK_STATUS_COUNT; ++Stage)
+    {
+        const CHUNK_STATUS Status = static_cast<CHUNK_STATUS>(Stage);
+        const Uint32       Count  = Scheduler.GetStageCount(Status);
+        const double       Time   = Scheduler.GetStageTime(Status);
+        std::printf("    \"%s\": {\"chunks\": %u, \"total_ms\": %.3f, \"ms_per_chunk\": %.4f}%s\n", GetChunkStatusName(Status), Count, Time * 1000.0,
+                    Count > 0 ? Time * 1000.0 / Count : 0.0, Stage + 1 < CHUNK_STATUS_COUNT ? "," : "");
+    }
+    std::printf("  },\n");
+
+    if (Args.Mesh)
+    {
+        // Chunks on the edge have no generated neighbours to mesh against
+        MeshScheduler Meshes{Args.NumThreads};
+        Uint32        NumSections = 0;
+        Tmr.Restart();
+        for (Int32 cz = -Args.Radius + 1; cz <= Args.Radius - 1; ++cz)
+        {
+            for (Int32 cx = -Args.Radius + 1; cx <= Args.Radius - 1; ++cx)
+            {
+                const Chunk* pChunk = Wrld.GetChunk(cx, cz);
+                for (Int32 s = 0; s < Chunk::NumSections; ++s)
+                {
+                    if (!pChunk->GetSection(s).IsEmpty())
+                    {
+                        Meshes.RequestMesh(Wrld, int3{cx, s, cz});
+                        ++NumSections;
+                    }
+                }
+            }
+        }
+
+        size_t NumVertices = 0;
+        while (Meshes.GetPendingCount() > 0)
+        {
+            Meshes.ApplyCompleted([&](const int3&, ChunkMesh&& Mesh) { NumVertices += Mesh.Vertices.size(); },
+                                  1e9, ~size_t{0});
+            std::this_thread::yield();
+        }
+        const double MeshTime = Tmr.GetElapsedTime();
+
+        std::printf("  \"meshing\": {\"sections\": %u, \"vertices\": %zu, \"seconds\": %.4f, \"sections_per_sec\": %.2f},\n", NumSections,
+                    NumVertices, MeshTime, MeshTime > 0 ? NumSections / MeshTime : 0.0);
+    }
+
+    std::printf("  \"peak_rss_mb\": %.2f\n", static_cast<double>(GetPeakRSS()) / (1 << 20));
+    std::printf("}\n");
+    return 0;
+}
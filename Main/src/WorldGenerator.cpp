@@ -0,0 +1,465 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+#include "WorldGenerator.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "Common/interface/FastRand.hpp"
+
+namespace Diligent
+{
+
+namespace
+{
+
+// clang-format off
+// Biome height parameters are averaged over this many cells in each direction
+constexpr Int32 BlendRadius    = 2;
+// 3D density noise moves the surface by up to this many blocks, making overhangs
+constexpr float DensityRange   = 10.f;
+constexpr Int32 BeachHeight    = 50;
+constexpr Int32 DirtDepth      = 3;
+// Surfaces above this height are left as bare stone
+constexpr Int32 BareRockHeight = 92;
+// Tunnels started this many chunks away can still reach a chunk
+constexpr Int32 CarverRadius   = 3;
+
+constexpr Uint32 BedrockSalt   = 0x2C1B3C6Du;
+constexpr Uint32 TunnelSalt    = 0x297A2D39u;
+constexpr Uint32 TreeSalt      = 0x7FEB352Du;
+// clang-format on
+
+Uint32 MixHash(Uint32 h)
+{
+    h ^= h >> 16u;
+    h *= 0x7FEB352Du;
+    h ^= h >> 15u;
+    h *= 0x846CA68Bu;
+    return h ^ (h >> 16u);
+}
+
+// Random float in [0, 1]
+float NextFloat(FastRand& Rand)
+{
+    return static_cast<float>(Rand()) / static_cast<float>(FastRand::Max);
+}
+
+inline Uint32 GetBlockIndex(Int32 x, Int32 y, Int32 z)
+{
+    return (static_cast<Uint32>(y) << 8u) | (static_cast<Uint32>(z) << 4u) | static_cast<Uint32>(x);
+}
+
+NoiseDesc GetHeightNoiseDesc(Uint32 Seed)
+{
+    NoiseDesc Desc;
+    Desc.Seed          = Seed;
+    Desc.Frequency     = 1.f / 256.f;
+    Desc.Octaves       = 5;
+    Desc.WarpAmplitude = 32.f;
+    Desc.WarpFrequency = 1.f / 512.f;
+    Desc.WarpOctaves   = 2;
+    return Desc;
+}
+
+NoiseDesc GetDensityNoiseDesc(Uint32 Seed)
+{
+    NoiseDesc Desc;
+    Desc.Seed      = Seed ^ 0x68E31DA4u;
+    Desc.Frequency = 1.f / 32.f;
+    Desc.Octaves   = 3;
+    return Desc;
+}
+
+} // namespace
+
+const char* GetChunkStatusName(CHUNK_STATUS Status)
+{
+    switch (Status)
+    {
+        // clang-format off
+        case CHUNK_STATUS_EMPTY:    return "Empty";
+        case CHUNK_STATUS_NOISE:    return "Noise";
+        case CHUNK_STATUS_SURFACE:  return "Surface";
+        case CHUNK_STATUS_CARVERS:  return "Carvers";
+        case CHUNK_STATUS_FEATURES: return "Features";
+        case CHUNK_STATUS_LIGHT:    return "Light";
+        default:                    return "Unknown";
+        // clang-format on
+    }
+}
+
+bool StageNeedsNeighbours(CHUNK_STATUS Stage)
+{
+    return Stage == CHUNK_STATUS_FEATURES || Stage == CHUNK_STATUS_LIGHT;
+}
+
+void ChunkHeightmap::Compute(const BlockId* pBlocks)
+{
+    for (Int32 z = 0; z < 16; ++z)
+    {
+        for (Int32 x = 0; x < 16; ++x)
+        {
+            Int32 y = Chunk::Height - 1;
+            while (y > 0 && pBlocks[GetBlockIndex(x, y, z)] == BLOCK_AIR)
+                --y;
+            Height[z * 16 + x]   = static_cast<Uint8>(y);
+            TopBlock[z * 16 + x] = pBlocks[GetBlockIndex(x, y, z)];
+        }
+    }
+}
+
+void ChunkHeightmap::Compute(const Chunk& Chnk)
+{
+    for (Uint32 z = 0; z < 16; ++z)
+    {
+        for (Uint32 x = 0; x < 16; ++x)
+        {
+            Int32 y = Chunk::Height - 1;
+            while (y > 0 && Chnk.GetBlock(x, y, z) == BLOCK_AIR)
+                --y;
+            Height[z * 16 + x]   = static_cast<Uint8>(y);
+            TopBlock[z * 16 + x] = Chnk.GetBlock(x, y, z);
+        }
+    }
+}
+
+WorldGenerator::WorldGenerator(Uint32 Seed) :
+    m_Seed{Seed},
+    m_Biomes{Seed},
+    m_HeightNoise{GetHeightNoiseDesc(Seed)},
+    m_DensityNoise{GetDensityNoiseDesc(Seed)}
+{
+}
+
+Uint32 WorldGenerator::GetChunkSeed(Int32 ChunkX, Int32 ChunkZ, Uint32 Salt) const
+{
+    return MixHash(m_Seed ^ Salt ^ MixHash(static_cast<Uint32>(ChunkX) * 0x9E3779B1u ^ static_cast<Uint32>(ChunkZ) * 0x85EBCA77u));
+}
+
+void WorldGenerator::GenerateNoise(Int32 ChunkX, Int32 ChunkZ, BlockId* pBlocks) const
+{
+    thread_local std::vector<float> HeightValues(NoiseGenerator::ColumnGridSize);
+    thread_local std::vector<float> DensityValues(NoiseGenerator::BlockSize);
+
+    m_HeightNoise.FillColumnGrid(ChunkX * 16, ChunkZ * 16, HeightValues.data());
+
+    // Biome height parameters averaged over nearby cells, for the cells from one before
+    // the chunk to one after it, so that every column lies between two cell centres
+    constexpr Int32 NumBlended = 16 / BiomeSource::CellSize + 2;
+    constexpr Int32 NumCells   = NumBlended + 2 * BlendRadius;
+
+    BIOME Biomes[NumCells * NumCells];
+    m_Biomes.GetBiomes(ChunkX * 4 - 1 - BlendRadius, ChunkZ * 4 - 1 - BlendRadius, NumCells, NumCells, Biomes);
+
+    float BlendedBase[NumBlended * NumBlended];
+    float BlendedScale[NumBlended * NumBlended];
+    for (Int32 bz = 0; bz < NumBlended; ++bz)
+    {
+        for (Int32 bx = 0; bx < NumBlended; ++bx)
+        {
+            float Base  = 0;
+            float Scale = 0;
+            for (Int32 dz = 0; dz <= 2 * BlendRadius; ++dz)
+            {
+                for (Int32 dx = 0; dx <= 2 * BlendRadius; ++dx)
+                {
+                    const BiomeInfo& Info = GetBiomeInfo(Biomes[(bz + dz) * NumCells + (bx + dx)]);
+                    Base += Info.BaseHeight;
+                    Scale += Info.HeightScale;
+                }
+            }
+            constexpr float Weight = 1.f / static_cast<float>((2 * BlendRadius + 1) * (2 * BlendRadius + 1));
+            BlendedBase[bz * NumBlended + bx]  = Base * Weight;
+            BlendedScale[bz * NumBlended + bx] = Scale * Weight;
+        }
+    }
+
+    float Heights[16 * 16];
+    float MinHeight = static_cast<float>(Chunk::Height);
+    float MaxHeight = 0;
+    for (Int32 z = 0; z < 16; ++z)
+    {
+        // Cell b is centred 1.5 blocks past its first column at (b - 1) * 4
+        const float tz = (static_cast<float>(z) + 2.5f) / 4.f;
+        const Int32 bz = static_cast<Int32>(tz);
+        const float fz = tz - static_cast<float>(bz);
+        for (Int32 x = 0; x < 16; ++x)
+        {
+            const float tx = (static_cast<float>(x) + 2.5f) / 4.f;
+            const Int32 bx = static_cast<Int32>(tx);
+            const float fx = tx - static_cast<float>(bx);
+
+            auto Bilerp = [&](const float* pValues) {
+                const float* p   = pValues + bz * NumBlended + bx;
+                const float  Top = p[0] + (p[1] - p[0]) * fx;
+                const float  Bot = p[NumBlended] + (p[NumBlended + 1] - p[NumBlended]) * fx;
+                return Top + (Bot - Top) * fz;
+            };
+
+            const Int32 i = z * 16 + x;
+            Heights[i]    = std::clamp(Bilerp(BlendedBase) + Bilerp(BlendedScale) * HeightValues[i], 4.f, static_cast<float>(Chunk::Height - 8));
+            MinHeight     = std::min(MinHeight, Heights[i]);
+            MaxHeight     = std::max(MaxHeight, Heights[i]);
+        }
+    }
+
+    for (Int32 s = 0; s < Chunk::NumSections; ++s)
+    {
+        const Int32 BaseY    = s * 16;
+        BlockId*    pSection = pBlocks + s * ChunkSection::Volume;
+
+        // Density noise is only needed where it can change the result
+        if (static_cast<float>(BaseY + 16) < MinHeight - DensityRange)
+        {
+            std::fill_n(pSection, ChunkSection::Volume, static_cast<BlockId>(BLOCK_STONE));
+            continue;
+        }
+        if (static_cast<float>(BaseY) > MaxHeight + DensityRange)
+        {
+            std::fill_n(pSection, ChunkSection::Volume, static_cast<BlockId>(BLOCK_AIR));
+            continue;
+        }
+
+        m_DensityNoise.FillBlock(ChunkX * 16, BaseY, ChunkZ * 16, DensityValues.data());
+        for (Uint32 i = 0; i < ChunkSection::Volume; ++i)
+        {
+            const float y       = static_cast<float>(BaseY + static_cast<Int32>(i >> 8u));
+            const float Density = Heights[i & 255u] - y + DensityRange * DensityValues[i];
+            pSection[i]         = Density > 0 ? BLOCK_STONE : BLOCK_AIR;
+        }
+    }
+}
+
+void WorldGenerator::ApplySurface(Int32 ChunkX, Int32 ChunkZ, BlockId* pBlocks) const
+{
+    BIOME Biomes[4 * 4];
+    m_Biomes.GetBiomes(ChunkX * 4, ChunkZ * 4, 4, 4, Biomes);
+
+    const Uint32 BedrockSeed = GetChunkSeed(ChunkX, ChunkZ, BedrockSalt);
+    for (Int32 z = 0; z < 16; ++z)
+    {
+        for (Int32 x = 0; x < 16; ++x)
+        {
+            Int32 Top = Chunk::Height - 1;
+            while (Top > 0 && pBlocks[GetBlockIndex(x, Top, z)] == BLOCK_AIR)
+                --Top;
+
+            if (Top > 0 && Top <= BareRockHeight)
+            {
+                const BiomeInfo& Info    = GetBiomeInfo(Biomes[(z >> 2) * 4 + (x >> 2)]);
+                const bool       IsBeach = Top <= BeachHeight;
+
+                pBlocks[GetBlockIndex(x, Top, z)] = IsBeach ? BlockId{BLOCK_SAND} : Info.TopBlock;
+                for (Int32 y = Top - 1; y > 0 && y >= Top - DirtDepth; --y)
+                {
+                    BlockId& Block = pBlocks[GetBlockIndex(x, y, z)];
+                    if (Block == BLOCK_STONE)
+                        Block = IsBeach ? BlockId{BLOCK_SAND} : Info.FillerBlock;
+                }
+            }
+
+            // Solid bedrock floor with a ragged layer above it
+            pBlocks[GetBlockIndex(x, 0, z)] = BLOCK_BEDROCK;
+            const Uint32 h                  = MixHash(BedrockSeed ^ static_cast<Uint32>(z * 16 + x));
+            for (Int32 y = 1; y <= 3; ++y)
+            {
+                if (((h >> (y * 2)) & 3u) < static_cast<Uint32>(4 - y))
+                    pBlocks[GetBlockIndex(x, y, z)] = BLOCK_BEDROCK;
+            }
+        }
+    }
+}
+
+void WorldGenerator::Carve(Int32 ChunkX, Int32 ChunkZ, BlockId* pBlocks) const
+{
+    // Every chunk that could start a tunnel reaching this one replays its tunnels, and
+    // only the blocks inside this chunk are carved
+    for (Int32 oz = ChunkZ - CarverRadius; oz <= ChunkZ + CarverRadius; ++oz)
+    {
+        for (Int32 ox = ChunkX - CarverRadius; ox <= ChunkX + CarverRadius; ++ox)
+        {
+            const Uint32 ChunkSeed = GetChunkSeed(ox, oz, TunnelSalt);
+            FastRand     Rand{ChunkSeed};
+            const Uint32 NumTunnels = Rand() % 8u < 2u ? 1u + Rand() % 2u : 0u;
+            for (Uint32 t = 0; t < NumTunnels; ++t)
+                CarveTunnel(ChunkX, ChunkZ, ox, oz, MixHash(ChunkSeed + t + 1), pBlocks);
+        }
+    }
+}
+
+void WorldGenerator::CarveTunnel(Int32 ChunkX, Int32 ChunkZ, Int32 OriginX, Int32 OriginZ, Uint32 TunnelSeed, BlockId* pBlocks) const
+{
+    // Only basic float arithmetic and sqrt, which are exactly rounded everywhere, so
+    // tunnels come out the same on every machine
+    FastRand Rand{TunnelSeed};
+
+    float Pos[3] = {
+        static_cast<float>(OriginX * 16) + NextFloat(Rand) * 16.f,
+        12.f + NextFloat(Rand) * 44.f,
+        static_cast<float>(OriginZ * 16) + NextFloat(Rand) * 16.f,
+    };
+    float Dir[3] = {NextFloat(Rand) - 0.5f, (NextFloat(Rand) - 0.5f) * 0.4f, NextFloat(Rand) - 0.5f};
+
+    const float MinX = static_cast<float>(ChunkX * 16);
+    const float MinZ = static_cast<float>(ChunkZ * 16);
+
+    const Uint32 Length = 20 + Rand() % 24u;
+    for (Uint32 Step = 0; Step < Length; ++Step)
+    {
+        const float Len = std::sqrt(Dir[0] * Dir[0] + Dir[1] * Dir[1] + Dir[2] * Dir[2]);
+        if (Len > 0.01f)
+        {
+            for (float& d : Dir)
+                d = d / Len;
+        }
+        else
+        {
+            Dir[0] = 1.f;
+        }
+
+        // Narrow at both ends, widest in the middle
+        const float t      = static_cast<float>(Step) / static_cast<float>(Length);
+        const float Radius = 1.2f + 5.f * t * (1.f - t);
+
+        if (Pos[0] + Radius >= MinX && Pos[0] - Radius <= MinX + 16.f &&
+            Pos[2] + Radius >= MinZ && Pos[2] - Radius <= MinZ + 16.f)
+        {
+            const Int32 x0 = std::max(static_cast<Int32>(std::floor(Pos[0] - Radius)), ChunkX * 16);
+            const Int32 x1 = std::min(static_cast<Int32>(std::floor(Pos[0] + Radius)), ChunkX * 16 + 15);
+            const Int32 y0 = std::max(static_cast<Int32>(std::floor(Pos[1] - Radius)), 1);
+            const Int32 y1 = std::min(static_cast<Int32>(std::floor(Pos[1] + Radius)), Chunk::Height - 1);
+            const Int32 z0 = std::max(static_cast<Int32>(std::floor(Pos[2] - Radius)), ChunkZ * 16);
+            const Int32 z1 = std::min(static_cast<Int32>(std::floor(Pos[2] + Radius)), ChunkZ * 16 + 15);
+            for (Int32 y = y0; y <= y1; ++y)
+            {
+                const float dy = static_cast<float>(y) + 0.5f - Pos[1];
+                for (Int32 z = z0; z <= z1; ++z)
+                {
+                    const float dz = static_cast<float>(z) + 0.5f - Pos[2];
+                    for (Int32 x = x0; x <= x1; ++x)
+                    {
+                        const float dx = static_cast<float>(x) + 0.5f - Pos[0];
+                        if (dx * dx + dy * dy + dz * dz >= Radius * Radius)
+                            continue;
+
+                        BlockId& Block = pBlocks[GetBlockIndex(x - ChunkX * 16, y, z - ChunkZ * 16)];
+                        if (Block != BLOCK_BEDROCK)
+                            Block = BLOCK_AIR;
+                    }
+                }
+            }
+        }
+
+        for (Uint32 c = 0; c < 3; ++c)
+            Pos[c] = Pos[c] + Dir[c];
+
+        // Wander, preferring horizontal tunnels
+        Dir[0] = Dir[0] + (NextFloat(Rand) - 0.5f) * 0.5f;
+        Dir[1] = (Dir[1] + (NextFloat(Rand) - 0.5f) * 0.3f) * 0.7f;
+        Dir[2] = Dir[2] + (NextFloat(Rand) - 0.5f) * 0.5f;
+    }
+}
+
+void WorldGenerator::PlaceFeatures(Chunk& Chnk, const HeightmapNeighbourhood& Heightmaps) const
+{
+    const Int32 BaseX = Chnk.GetX() * 16;
+    const Int32 BaseZ = Chnk.GetZ() * 16;
+
+    auto PlaceBlock = [&](Int32 x, Int32 y, Int32 z, BlockId Id, bool ReplaceLeaves) {
+        const Int32 lx = x - BaseX;
+        const Int32 lz = z - BaseZ;
+        if (lx < 0 || lx >= 16 || lz < 0 || lz >= 16 || y < 0 || y >= Chunk::Height)
+            return;
+
+        const BlockId Current = Chnk.GetBlock(lx, y, lz);
+        if (Current == BLOCK_AIR || (ReplaceLeaves && Current == BLOCK_LEAVES))
+            Chnk.SetBlock(lx, y, lz, Id);
+    };
+
+    // Trees of all nine chunks are replayed in the same (absolute z, then x) order by
+    // every chunk they overlap, so overlapping trees resolve the same way in each
+    for (Int32 dz = -1; dz <= 1; ++dz)
+    {
+        for (Int32 dx = -1; dx <= 1; ++dx)
+        {
+            const ChunkHeightmap* pHeightmap = Heightmaps[(dz + 1) * 3 + (dx + 1)];
+            VERIFY_EXPR(pHeightmap != nullptr);
+
+            const Int32 OriginX = Chnk.GetX() + dx;
+            const Int32 OriginZ = Chnk.GetZ() + dz;
+
+            const BiomeInfo& Info = GetBiomeInfo(m_Biomes.GetBiome(OriginX * 16 + 8, OriginZ * 16 + 8));
+
+            FastRand    Rand{GetChunkSeed(OriginX, OriginZ, TreeSalt)};
+            const Int32 NumTrees = Info.MinTrees + static_cast<Int32>(Rand() % static_cast<Uint32>(Info.MaxTrees - Info.MinTrees + 1));
+            for (Int32 t = 0; t < NumTrees; ++t)
+            {
+                // All random numbers of a tree are drawn up front, so that a skipped tree
+                // does not shift the ones after it
+                const Int32  lx          = static_cast<Int32>(Rand() % 16u);
+                const Int32  lz          = static_cast<Int32>(Rand() % 16u);
+                const Int32  TrunkHeight = 4 + static_cast<Int32>(Rand() % 3u);
+                const Uint32 LeafCorners = Rand();
+                const Int32  Top         = pHeightmap->Height[lz * 16 + lx];
+                if (pHeightmap->TopBlock[lz * 16 + lx] != BLOCK_GRASS || Top + TrunkHeight + 2 >= Chunk::Height)
+                    continue;
+
+                const Int32 x = OriginX * 16 + lx;
+                const Int32 z = OriginZ * 16 + lz;
+
+                // Two 5x5 layers and two 3x3 layers, with some corners left out
+                for (Int32 Layer = 0; Layer < 4; ++Layer)
+                {
+                    const Int32 y = Top + TrunkHeight - 2 + Layer;
+                    const Int32 r = Layer < 2 ? 2 : 1;
+                    for (Int32 oz = -r; oz <= r; ++oz)
+                    {
+                        for (Int32 ox = -r; ox <= r; ++ox)
+                        {
+                            if (std::abs(ox) == r && std::abs(oz) == r)
+                            {
+                                const Uint32 Corner = static_cast<Uint32>(Layer * 4 + (oz > 0 ? 2 : 0) + (ox > 0 ? 1 : 0));
+                                if (Layer == 3 || (LeafCorners >> Corner) & 1u)
+                                    continue;
+                            }
+                            PlaceBlock(x + ox, y, z + oz, BLOCK_LEAVES, false);
+                        }
+                    }
+                }
+
+                for (Int32 y = Top + 1; y <= Top + TrunkHeight; ++y)
+                    PlaceBlock(x, y, z, BLOCK_LOG, true);
+
+                if (x - BaseX >= 0 && x - BaseX < 16 && z - BaseZ >= 0 && z - BaseZ < 16)
+                    Chnk.SetBlock(x - BaseX, Top, z - BaseZ, BLOCK_DIRT);
+            }
+        }
+    }
+}
+
+} // namespace Diligent
@@ -0,0 +1,123 @@
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+#pragma once
+
+#include <array>
+#include <memory>
+
+#include "Chunk.hpp"
+#include "Noise.hpp"
+#include "BiomeSource.hpp"
+
+namespace Diligent
+{
+
+// Generation stages in the order they run. A chunk's status is the last stage it completed.
+enum CHUNK_STATUS : Uint8
+{
+    CHUNK_STATUS_EMPTY = 0,
+
+    // Stone and air from 2D height noise scaled per biome and 3D density noise near the surface
+    CHUNK_STATUS_NOISE,
+
+    // Biome top and filler blocks on the terrain, sand on beaches, bedrock at the bottom
+    CHUNK_STATUS_SURFACE,
+
+    // Caves. The heightmap is final afterwards.
+    CHUNK_STATUS_CARVERS,
+
+    // Trees, including the parts of the neighbours' trees that reach into the chunk.
+    // Blocks are final afterwards.
+    CHUNK_STATUS_FEATURES,
+
+    // Sky and block light; the chunk is fully generated
+    CHUNK_STATUS_LIGHT,
+
+    CHUNK_STATUS_COUNT
+};
+
+const char* GetChunkStatusName(CHUNK_STATUS Status);
+
+// Whether a stage reads the 3x3 chunks around its chunk, which must all have completed
+// the previous stage before it can run
+bool StageNeedsNeighbours(CHUNK_STATUS Stage);
+
+// Highest non-air block of every column, indexed by z * 16 + x
+struct ChunkHeightmap
+{
+    std::array<Uint8, 16 * 16>   Height   = {};
+    std::array<BlockId, 16 * 16> TopBlock = {};
+
+    void Compute(const BlockId* pBlocks);
+    void Compute(const Chunk& Chnk);
+};
+
+// The generation stages of the default terrain.
+//
+// Everything is a pure function of the seed and the chunk position, so a chunk comes out
+// the same whatever order chunks are generated in and however many threads do it. The
+// noise, surface and carver stages only touch their own chunk. Features that reach into
+// neighbouring chunks are placed by every chunk they touch, each writing only its own
+// blocks, which is why the feature stage reads the neighbours' heightmaps. Stages may run
+// concurrently on any number of chunks.
+class WorldGenerator
+{
+public:
+    explicit WorldGenerator(Uint32 Seed);
+
+    Uint32 GetSeed() const { return m_Seed; }
+
+    const BiomeSource& GetBiomeSource() const { return m_Biomes; }
+
+    // Dense blocks of a chunk being generated, in ChunkSection::GetIndex() order section
+    // after section, i.e. pBlocks[(y * 16 + z) * 16 + x]
+    static constexpr Uint32 ChunkVolume = ChunkSection::Volume * Chunk::NumSections;
+
+    void GenerateNoise(Int32 ChunkX, Int32 ChunkZ, BlockId* pBlocks) const;
+    void ApplySurface(Int32 ChunkX, Int32 ChunkZ, BlockId* pBlocks) const;
+    void Carve(Int32 ChunkX, Int32 ChunkZ, BlockId* pBlocks) const;
+
+    // Neighbours are indexed by (dz + 1) * 3 + (dx + 1) and must have completed the carver stage
+    using HeightmapNeighbourhood = std::array<const ChunkHeightmap*, 9>;
+    void PlaceFeatures(Chunk& Chnk, const HeightmapNeighbourhood& Heightmaps) const;
+
+private:
+    // Deterministic per-chunk random seed for one kind of feature
+    Uint32 GetChunkSeed(Int32 ChunkX, Int32 ChunkZ, Uint32 Salt) const;
+
+    // Carves the part of a tunnel started in chunk (OriginX, OriginZ) that lies in this chunk
+    void CarveTunnel(Int32 ChunkX, Int32 ChunkZ, Int32 OriginX, Int32 OriginZ, Uint32 TunnelSeed, BlockId* pBlocks) const;
+
+private:
+    const Uint32 m_Seed;
+
+    BiomeSource    m_Biomes;
+    NoiseGenerator m_HeightNoise;
+    NoiseGenerator m_DensityNoise;
+};
+
+} // namespace Diligent
@@ -25,10 +25,16 @@
  *  of the possibility of such damages.
  */
 
+#include <algorithm>
+#include <cmath>
 #include <random>
+#include <thread>
 #include <vector>
 
 #include "legacyoss.hpp"
+#include "CpuFeatures.hpp"
+#include "Common/interface/Timer.hpp"
+#include "Common/interface/AdvancedMath.hpp"
 #include "Graphics/GraphicsTools/interface/ShaderMacroHelper.hpp"
 #include "Common/interface/CallbackWrapper.hpp"
 
@@ -72,14 +78,13 @@ bool Game::Initialize()
         }
 
         CreatePipelineState();
-        CreateVertexBuffer();
-        CreateIndexBuffer();
+        CreateWorld();
         LoadTexture();
 
-        m_Camera.SetPos(float3(0, 0, -10));
+        m_Camera.SetPos(float3(0, 80, -10));
         m_Camera.SetRotation(0, 0);
         m_Camera.SetRotationSpeed(0.005f);
-        m_Camera.SetMoveSpeed(5.f);
+        m_Camera.SetMoveSpeed(10.f);
         m_Camera.SetSpeedUpScales(5.f, 10.f);
 
         SetInputModeGame();
@@ -92,6 +97,21 @@ bool Game::Initialize()
     }
 }
 
+Game::~Game()
+{
+    // Running jobs finish and queued ones are left for their systems to drop
+    if (m_pThreadPool)
+        m_pThreadPool->StopThreads();
+
+    if (!m_pRegionStorage)
+        return;
+
+    m_World.ForEachChunk([this](const Chunk& Chnk) {
+        if (Chnk.IsModified())
+            m_pRegionStorage->SaveChunk(Chnk);
+    });
+}
+
 void Game::UpdateUI(float dt)
 {
     // Game ui here
@@ -106,14 +126,194 @@ void Game::UpdateUIDebug(float dt)
     ImGui::Text("Delta: %f", dt);
     ImGui::Text("Time: %f", CurrTime);
     ImGui::Text("Rot: %f, %f", m_Camera.GetRot().x, m_Camera.GetRot().y);
+    if (m_Walking)
+    {
+        const float3 Velocity = m_Player.GetVelocity();
+        ImGui::Text("Walking (F to fly), %s, velocity %.2f %.2f %.2f", m_Player.IsOnGround() ? "on ground" : "in air", Velocity.x, Velocity.y, Velocity.z);
+    }
+    else
+    {
+        ImGui::Text("Flying (F to walk)");
+    }
+    ImGui::Text("Tick: %llu (%llu dropped), %.3f ms", static_cast<unsigned long long>(GetSimulationClock().GetTickCount()),
+                static_cast<unsigned long long>(GetSimulationClock().GetDroppedTickCount()), m_TickTime * 1000.0);
     ImGui::Checkbox("Vsync", GetVsync());
     ImGui::Checkbox("Disable Buffer Clearing", &u_NoClear); // i just like the effect, there is no need for this
+    ImGui::Text("Chunks: %zu (%.2f MB, %s world)", m_World.GetChunkCount(), static_cast<double>(m_World.GetMemoryUsage()) / (1 << 20),
+                m_World.GetType() == WORLD_TYPE_FINITE ? "finite" : "infinite");
+    ImGui::Text("Region I/O: %u loaded (%.2f ms), %u saved (%.2f ms)", m_pRegionStorage->GetLoadedChunkCount(), m_pRegionStorage->GetLoadTime() * 1000.0,
+                m_pRegionStorage->GetSavedChunkCount(), m_pRegionStorage->GetSaveTime() * 1000.0);
+    ImGui::Text("Block textures: %u layers, %upx (%.2f MB), loaded in %.1f ms", m_BlockTextures.GetLayerCount(), m_BlockTextures.GetResolution(),
+                static_cast<double>(m_BlockTextures.GetMemoryUsage()) / (1 << 20), m_BlockTextures.GetLoadTime() * 1000.0);
+    {
+        const auto& Stats = m_pChunkRenderer->GetStats();
+        ImGui::Text("Sections drawn: %u (%u in frustum, %u loaded)", Stats.NumVisible, Stats.NumInFrustum, Stats.NumSections);
+        ImGui::Text("Frustum culling: %.3f ms (%s)", Stats.CullTime * 1000.0, GetCpuFeatures().AVX2 ? "AVX2" : "scalar");
+        ImGui::Text("Draw calls: %u (%s)", Stats.NumDrawCalls, m_pChunkRenderer->IsIndirectDrawEnabled() ? "indirect" : "direct");
+        ImGui::Text("Terrain submit: %.3f ms", Stats.SubmitTime * 1000.0);
+        ImGui::Text("Vertex pool: %.2f MB", static_cast<double>(m_pChunkRenderer->GetVertexMemoryUsage()) / (1 << 20));
+    }
+    ImGui::Checkbox("Cave culling", &m_CaveCulling);
+    ImGui::Text("Visible sections: %u (%.3f ms)", m_VisibilityGraph.GetVisibleCount(), m_VisibilityGraph.GetUpdateTime() * 1000.0);
+    ImGui::Text("Pending meshes: %u", m_pMeshScheduler->GetPendingCount());
+    {
+        const CHUNK_STATUS Stages[] = {CHUNK_STATUS_NOISE, CHUNK_STATUS_SURFACE, CHUNK_STATUS_CARVERS, CHUNK_STATUS_FEATURES, CHUNK_STATUS_LIGHT};
+        ImGui::Text("World gen: %zu chunks tracked, %u jobs on %u threads", m_pGenScheduler->GetChunkCount(), m_pGenScheduler->GetRunningJobCount(),
+                    m_pGenScheduler->GetThreadCount());
+        for (CHUNK_STATUS Stage : Stages)
+        {
+            const Uint32 Count = m_pGenScheduler->GetStageCount(Stage);
+            ImGui::Text("  %s: %u chunks, %.3f ms/chunk", GetChunkStatusName(Stage), Count,
+                        Count > 0 ? m_pGenScheduler->GetStageTime(Stage) * 1000.0 / Count : 0.0);
+        }
+    }
+    {
+        const BiomeSource& Biomes    = m_pWorldGenerator->GetBiomeSource();
+        const Uint64       NumLookups = Biomes.GetLookupCount();
+        ImGui::Text("Biomes: %.1f%% cache hits of %llu, %llu regions generated in %.2f ms", NumLookups > 0 ? Biomes.GetHitCount() * 100.0 / NumLookups : 0.0,
+                    static_cast<unsigned long long>(NumLookups), static_cast<unsigned long long>(Biomes.GetGeneratedRegionCount()), Biomes.GetGenerationTime() * 1000.0);
+    }
+    ImGui::Text("Light: %u jobs in %u batches, %.3f ms", m_pLightEngine->GetLastJobCount(), m_pLightEngine->GetLastBatchCount(),
+                m_pLightEngine->GetLastUpdateTime() * 1000.0);
+    {
+        const Uint32 NumChunks = m_pRandomTicker->GetLastChunkCount();
+        ImGui::Text("Random ticks: %.2f us/chunk, %u sections ticked, %u skipped", NumChunks > 0 ? m_pRandomTicker->GetLastTickTime() * 1e6 / NumChunks : 0.0,
+                    m_pRandomTicker->GetLastTickedSectionCount(), m_pRandomTicker->GetLastSkippedSectionCount());
+    }
+    ImGui::Text("Fluids: %zu updates queued (peak %zu), %u run last tick", m_Fluids.GetQueuedCount(), m_Fluids.GetPeakQueuedCount(),
+                m_Fluids.GetLastUpdateCount());
+    ImGui::Text("Entities: %u in %u archetypes, %.3f ms", m_pEntities->GetCount(), m_pEntities->GetArchetypeCount(), m_pEntities->GetLastTickTime() * 1000.0);
+    {
+        const auto& Stats = m_pParticleRenderer->GetStats();
+        ImGui::Text("Particles: %u of %u (%llu dropped), update %.3f ms, submit %.3f ms in %u draws", m_Particles.GetCount(), m_Particles.GetCapacity(),
+                    static_cast<unsigned long long>(m_Particles.GetDroppedCount()), m_Particles.GetLastUpdateTime() * 1000.0, Stats.SubmitTime * 1000.0,
+                    Stats.NumDrawCalls);
+    }
+    ImGui::Text("Redstone: %zu networks, %u updates last tick", m_Redstone.GetNetworkCount(), m_Redstone.GetLastUpdateCount());
+    ImGui::Text("Pathfinding: %.3f ms, %u nodes, %zu pending, %zu cached paths", m_Pathfinder.GetLastTickTime() * 1000.0,
+                m_Pathfinder.GetLastIterationCount(), m_Pathfinder.GetPendingCount(), m_Pathfinder.GetCachedPathCount());
+    if (m_TestPathStatus == PATH_STATUS_FOUND)
+        ImGui::Text("Test path: %zu blocks (P to find another)", m_TestPath.size());
+    else if (m_TestPathStatus == PATH_STATUS_PENDING)
+        ImGui::Text("Test path: searching");
+    else if (m_TestPathStatus == PATH_STATUS_NOT_FOUND)
+        ImGui::Text("Test path: none (P to find another)");
+    {
+        BlockHit Hit;
+        if (RaycastBlocks(m_World, m_Camera.GetRenderPos(), m_Camera.GetWorldAhead(), m_BlockReach, Hit))
+        {
+            ImGui::Text("Looking at %s at %d %d %d, %.2f away", GetBlockInfo(m_World.GetBlock(Hit.Pos.x, Hit.Pos.y, Hit.Pos.z)).Name, Hit.Pos.x, Hit.Pos.y,
+                        Hit.Pos.z, Hit.Distance);
+        }
+        ImGui::Text("Placing %s (middle click picks)", GetBlockInfo(m_PlaceBlock).Name);
+    }
+    ImGui::SliderInt("Render distance", &m_RenderDistance, 2, 32);
+    UpdateBenchmarkUI();
     ImGui::End();
 }
 
+void Game::UpdateBenchmarkUI()
+{
+    if (!ImGui::CollapsingHeader("Benchmarks"))
+        return;
+
+    for (const auto& Bench : GetBenchmarks())
+    {
+        if (!ImGui::Button(Bench.Name))
+            continue;
+
+        // Runs on the main thread, the frame will hitch while it is running
+        auto Result = Bench.Run();
+        for (const auto& Metric : Result.Metrics)
+            LOG_INFO_MESSAGE(Result.Name, ": ", Metric.first, " = ", Metric.second);
+
+        auto It = std::find_if(m_BenchmarkResults.begin(), m_BenchmarkResults.end(),
+                               [&](const BenchmarkResult& R) { return R.Name == Result.Name; });
+        if (It != m_BenchmarkResults.end())
+            *It = std::move(Result);
+        else
+            m_BenchmarkResults.push_back(std::move(Result));
+    }
+
+    for (const auto& Result : m_BenchmarkResults)
+    {
+        ImGui::Text("%s", Result.Name.c_str());
+        for (const auto& Metric : Result.Metrics)
+            ImGui::BulletText("%s: %.3f", Metric.first.c_str(), Metric.second);
+    }
+}
+
+void Game::Tick()
+{
+    Timer Tmr;
+
+    if (m_Walking)
+    {
+        PlayerInput Input;
+        Input.Move  = m_Camera.GetWalkDirection();
+        Input.Jump  = m_Camera.IsJumpHeld();
+        Input.Sneak = m_Camera.IsSneakHeld();
+        m_Player.Tick(m_World, Input);
+        m_Camera.MoveTo(m_Player.GetEyePos());
+    }
+    else
+    {
+        m_Camera.Tick(static_cast<float>(SimulationClock::TickInterval));
+    }
+
+    // Changed blocks are relit right away, but remeshed once per frame after the light
+    // update, however many ticks and blocks changed a section
+    m_pRandomTicker->Tick(m_World);
+    for (const int3& Pos : m_pRandomTicker->GetChangedBlocks())
+        OnBlockChanged(Pos);
+
+    m_Fluids.Tick(m_World);
+    for (const int3& Pos : m_Fluids.GetChangedBlocks())
+    {
+        m_pLightEngine->QueueBlockChange(Pos.x, Pos.y, Pos.z);
+        m_Pathfinder.OnBlockChanged(Pos);
+    }
+    for (const int3& SectionPos : m_Fluids.GetChangedSections())
+        m_ChangedSections.emplace(World::PackSectionKey(SectionPos), SectionPos);
+
+    // Switched torches only change their light and mesh, the engine already knows
+    m_Redstone.Tick(m_World);
+    for (const int3& Pos : m_Redstone.GetChangedBlocks())
+    {
+        m_pLightEngine->QueueBlockChange(Pos.x, Pos.y, Pos.z);
+        ChunkMesher::ForEachSectionSampling(Pos, [this](const int3& SectionPos) {
+            m_ChangedSections.emplace(World::PackSectionKey(SectionPos), SectionPos);
+        });
+    }
+
+    // Falling blocks replace air and fluids where they land, and are lost otherwise
+    m_pEntities->Tick(m_World);
+    for (const EntityStore::LandedBlock& Landed : m_pEntities->GetLandedBlocks())
+    {
+        const int3&   Pos     = Landed.Pos;
+        const BlockId Current = m_World.GetBlock(Pos.x, Pos.y, Pos.z);
+        if ((Current == BLOCK_AIR || GetFluidType(Current) != FLUID_NONE) && m_World.SetBlock(Pos.x, Pos.y, Pos.z, Landed.Block))
+        {
+            if (Current != BLOCK_AIR)
+                m_Particles.EmitSplash(m_World, float3{static_cast<float>(Pos.x) + 0.5f, static_cast<float>(Pos.y + 1), static_cast<float>(Pos.z) + 0.5f});
+            OnBlockChanged(Pos);
+        }
+    }
+
+    // All searches share one node budget, and long ones carry on over several ticks
+    m_Pathfinder.Tick(m_World, m_PathfindingBudget);
+    if (m_TestPathStatus == PATH_STATUS_PENDING)
+        m_TestPathStatus = m_Pathfinder.TakePath(m_TestPathRequest, m_TestPath);
+
+    EmitAmbientParticles();
+
+    m_TickTime = Tmr.GetElapsedTime();
+}
+
 void Game::Update(float dt)
 {
-    m_Camera.UpdateMat();
+    m_Camera.UpdateMat(GetSimulationClock().GetAlpha());
+    m_Particles.Update(dt);
 
     LastTime = CurrTime;
     CurrTime += dt;
@@ -137,6 +337,9 @@ void Game::Update(float dt)
 
     // Compute world-view-projection matrix
     m_WorldViewProjMatrix = View * Proj;
+    ExtractViewFrustumPlanesFromMatrix(m_WorldViewProjMatrix, m_ViewFrustum, GetDevice()->GetDeviceInfo().IsGLDevice());
+
+    UpdateChunks();
 
     UpdateUI(dt);
     if(u_ShowDebug){
@@ -158,35 +361,36 @@ void Game::Draw()
     }
     GetContext()->ClearDepthStencil(pDSV, CLEAR_DEPTH_FLAG, 1.f, 0, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
     
-    {
-        // Map the buffer and write current world-view-projection matrix
-        MapHelper<float4x4> CBConstants(GetContext(), m_VSConstants, MAP_WRITE, MAP_FLAG_DISCARD);
-        *CBConstants = m_WorldViewProjMatrix.Transpose();
-    }
-
-    // Bind vertex and index buffers
-    const Uint64 offset   = 0;
-    IBuffer*     pBuffs[] = {m_CubeVertexBuffer};
-    GetContext()->SetVertexBuffers(0, 1, pBuffs, &offset, RESOURCE_STATE_TRANSITION_MODE_TRANSITION, SET_VERTEX_BUFFERS_FLAG_RESET);
-    GetContext()->SetIndexBuffer(m_CubeIndexBuffer, 0, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
-
     // Set the pipeline state
     GetContext()->SetPipelineState(pPSO);
+    // The chunk quad buffer is recreated when it grows, so it is bound every frame
+    m_SRB->GetVariableByName(SHADER_TYPE_VERTEX, "g_Quads")->Set(m_pChunkRenderer->GetQuadBufferSRV());
     // Commit shader resources. RESOURCE_STATE_TRANSITION_MODE_TRANSITION mode
     // makes sure that resources are transitioned to required states.
     GetContext()->CommitShaderResources(m_SRB, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
 
-    DrawIndexedAttribs DrawAttrs;     // This is an indexed draw call
-    DrawAttrs.IndexType  = VT_UINT32; // Index type
-    DrawAttrs.NumIndices = 36;
-    // Verify the state of vertex and index buffers
-    DrawAttrs.Flags = DRAW_FLAG_VERIFY_ALL;
-    GetContext()->DrawIndexed(DrawAttrs);
+    {
+        // Map the buffer and write current world-view-projection matrix
+        MapHelper<VSConstants> CBConstants(GetContext(), m_VSConstants, MAP_WRITE, MAP_FLAG_DISCARD);
+        CBConstants->WorldViewProj = m_WorldViewProjMatrix.Transpose();
+    }
+
+    m_pChunkRenderer->Draw(m_ViewFrustum, m_CaveCulling ? &m_VisibilityGraph : nullptr);
+
+    // Falling blocks go through the terrain pipeline, with quads of their own
+    UpdateFallingBlocks();
+    if (m_pChunkRenderer->GetLooseBlockCount() > 0)
+    {
+        m_SRB->GetVariableByName(SHADER_TYPE_VERTEX, "g_Quads")->Set(m_pChunkRenderer->GetLooseBlockQuadSRV());
+        GetContext()->CommitShaderResources(m_SRB, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+        m_pChunkRenderer->DrawLooseBlocks();
+    }
+    m_pParticleRenderer->Draw(m_Particles, m_WorldViewProjMatrix, m_Camera.GetWorldRight(), m_Camera.GetWorldUp());
 }
 
 void Game::KeyEvent(Key key, KeyState state)
 {
-    m_Camera.Update(key, state, CurrTime-LastTime);
+    m_Camera.Update(key, state);
 
     // Input repeated
     if (state == KeyState::Press || state == KeyState::Repeat)
@@ -243,6 +447,24 @@ void Game::KeyEvent(Key key, KeyState state)
                     SetInputModeGame();
                 }
                 break;
+
+            case Key::MB_Left:
+            case Key::MB_Right:
+            case Key::MB_Middle:
+                // The debug panel has the mouse
+                if (!u_ShowDebug)
+                    UseBlock(key);
+                break;
+
+            case Key::F:
+                m_Walking = !m_Walking;
+                if (m_Walking)
+                    m_Player.SetPos(m_Camera.GetPos() - float3{0, PlayerPhysics::EyeHeight, 0});
+                break;
+
+            case Key::P:
+                RequestTestPath();
+                break;
         }
     }
 
@@ -311,7 +533,7 @@ void Game::CreatePipelineState()
         GetDevice()->CreateShader(ShaderCI, &pVS);
         // Create dynamic uniform buffer that will store our transformation matrix
         // Dynamic buffers can be frequently updated by the CPU
-        CreateUniformBuffer(GetDevice(), sizeof(float4x4), "VS constants CB", &m_VSConstants);
+        CreateUniformBuffer(GetDevice(), sizeof(VSConstants), "VS constants CB", &m_VSConstants);
     }
 
     // Create a pixel shader
@@ -328,10 +550,11 @@ void Game::CreatePipelineState()
     // Define vertex shader input layout
     LayoutElement LayoutElems[] =
     {
-        // Attribute 0 - vertex position
-        LayoutElement{0, 0, 3, VT_FLOAT32, False},
-        // Attribute 1 - texture coordinates
-        LayoutElement{1, 0, 2, VT_FLOAT32, False}
+        // Attribute 0 - section origin, see ChunkRenderer::SectionInstance. The quads
+        // themselves are read from g_Quads.
+        LayoutElement{0, 0, 3, VT_FLOAT32, False, INPUT_ELEMENT_FREQUENCY_PER_INSTANCE},
+        // Attribute 1 - first quad of the section
+        LayoutElement{1, 0, 1, VT_UINT32, False, INPUT_ELEMENT_FREQUENCY_PER_INSTANCE}
     };
     // clang-format on
 
@@ -349,22 +572,25 @@ void Game::CreatePipelineState()
     // to change on a per-instance basis
     ShaderResourceVariableDesc Vars[] = 
     {
-        {SHADER_TYPE_PIXEL, "g_Texture", SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE}
+        {SHADER_TYPE_PIXEL, "g_Texture", SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE},
+        {SHADER_TYPE_VERTEX, "g_Quads", SHADER_RESOURCE_VARIABLE_TYPE_DYNAMIC}
     };
     // clang-format on
     PSOCreateInfo.PSODesc.ResourceLayout.Variables    = Vars;
     PSOCreateInfo.PSODesc.ResourceLayout.NumVariables = _countof(Vars);
 
     // clang-format off
-    // Define immutable sampler for g_Texture. Immutable samplers should be used whenever possible
-    SamplerDesc SamLinearClampDesc
+    // Define immutable sampler for g_Texture. Immutable samplers should be used whenever possible.
+    // Merged quads span several blocks, so the texture has to wrap. Mips are blended
+    // linearly to keep distant terrain from shimmering.
+    SamplerDesc SamPointWrapDesc
     {
-        FILTER_TYPE_LINEAR, FILTER_TYPE_LINEAR, FILTER_TYPE_LINEAR, 
-        TEXTURE_ADDRESS_CLAMP, TEXTURE_ADDRESS_CLAMP, TEXTURE_ADDRESS_CLAMP
+        FILTER_TYPE_POINT, FILTER_TYPE_POINT, FILTER_TYPE_LINEAR, 
+        TEXTURE_ADDRESS_WRAP, TEXTURE_ADDRESS_WRAP, TEXTURE_ADDRESS_WRAP
     };
     ImmutableSamplerDesc ImtblSamplers[] = 
     {
-        {SHADER_TYPE_PIXEL, "g_Texture", SamLinearClampDesc}
+        {SHADER_TYPE_PIXEL, "g_Texture", SamPointWrapDesc}
     };
     // clang-format on
     PSOCreateInfo.PSODesc.ResourceLayout.ImmutableSamplers    = ImtblSamplers;
@@ -380,118 +606,372 @@ void Game::CreatePipelineState()
     // Since we are using mutable variable, we must create a shader resource binding object
     // http://diligentgraphics.com/2016/03/23/resource-binding-model-in-diligent-engine-2-0/
     pPSO->CreateShaderResourceBinding(&m_SRB, true);
+
+    m_pParticleRenderer = std::make_unique<ParticleRenderer>(GetDevice(), GetContext(), GetSwapChain()->GetDesc().ColorBufferFormat,
+                                                             GetSwapChain()->GetDesc().DepthBufferFormat);
 }
 
-void Game::CreateVertexBuffer()
+void Game::UploadSectionMesh(const int3& SectionPos, ChunkMesh&& Mesh)
 {
-    // Layout of this structure matches the one we defined in the pipeline state
-    struct Vertex
-    {
-        float3 pos;
-        float2 uv;
-    };
+    m_VisibilityGraph.SetConnectivity(SectionPos, Mesh.Connectivity);
+    m_pChunkRenderer->SetSectionMesh(SectionPos, Mesh);
+}
 
-    // Cube vertices
-
-    //      (-1,+1,+1)________________(+1,+1,+1)
-    //               /|              /|
-    //              / |             / |
-    //             /  |            /  |
-    //            /   |           /   |
-    //(-1,-1,+1) /____|__________/(+1,-1,+1)
-    //           |    |__________|____|
-    //           |   /(-1,+1,-1) |    /(+1,+1,-1)
-    //           |  /            |   /
-    //           | /             |  /
-    //           |/              | /
-    //           /_______________|/
-    //        (-1,-1,-1)       (+1,-1,-1)
-    //
+void Game::LoadTexture()
+{
+    m_BlockTextures.LoadPack(GetDevice(), GetContext(), "assets/texturepacks/default");
 
-    // clang-format off
-    // This time we have to duplicate verices because texture coordinates cannot
-    // be shared
-    Vertex CubeVerts[] =
-    {
-        {float3(-1,-1,-1), float2(0,1)},
-        {float3(-1,+1,-1), float2(0,0)},
-        {float3(+1,+1,-1), float2(1,0)},
-        {float3(+1,-1,-1), float2(1,1)},
-
-        {float3(-1,-1,-1), float2(0,1)},
-        {float3(-1,-1,+1), float2(0,0)},
-        {float3(+1,-1,+1), float2(1,0)},
-        {float3(+1,-1,-1), float2(1,1)},
-
-        {float3(+1,-1,-1), float2(0,1)},
-        {float3(+1,-1,+1), float2(1,1)},
-        {float3(+1,+1,+1), float2(1,0)},
-        {float3(+1,+1,-1), float2(0,0)},
-
-        {float3(+1,+1,-1), float2(0,1)},
-        {float3(+1,+1,+1), float2(0,0)},
-        {float3(-1,+1,+1), float2(1,0)},
-        {float3(-1,+1,-1), float2(1,1)},
-
-        {float3(-1,+1,-1), float2(1,0)},
-        {float3(-1,+1,+1), float2(0,0)},
-        {float3(-1,-1,+1), float2(0,1)},
-        {float3(-1,-1,-1), float2(1,1)},
-
-        {float3(-1,-1,+1), float2(1,1)},
-        {float3(+1,-1,+1), float2(0,1)},
-        {float3(+1,+1,+1), float2(0,0)},
-        {float3(-1,+1,+1), float2(1,0)}
+    // Set texture SRV in the SRB
+    m_SRB->GetVariableByName(SHADER_TYPE_PIXEL, "g_Texture")->Set(m_BlockTextures.GetSRV());
+    m_pParticleRenderer->SetBlockTextures(m_BlockTextures.GetSRV());
+}
+
+void Game::CreateWorld()
+{
+    // Finite worlds are saved separately as their terrain stops at the border
+    WorldCreateInfo WorldCI;
+    if (HasCommandLineFlag("--finite-world"))
+        WorldCI.Type = WORLD_TYPE_FINITE;
+    m_World = World{WorldCI};
+
+    // Leave one core for the thread running the main loop. All systems share the workers,
+    // those that wait for their jobs on the main thread going ahead of background jobs.
+    const Uint32 NumCores   = std::max(std::thread::hardware_concurrency(), 2u);
+    const Uint32 NumWorkers = NumCores - 1;
+    m_pThreadPool           = CreateThreadPool(ThreadPoolCreateInfo{NumWorkers});
+    m_pMeshScheduler        = std::make_unique<MeshScheduler>(m_pThreadPool);
+    m_pChunkRenderer        = std::make_unique<ChunkRenderer>(GetDevice(), GetContext());
+    m_pRegionStorage        = std::make_unique<RegionStorage>(WorldCI.Type == WORLD_TYPE_FINITE ? "saves/finite_world/region" : "saves/world/region");
+    m_pLightEngine          = std::make_unique<LightEngine>(m_pThreadPool, NumWorkers);
+    m_pWorldGenerator       = std::make_unique<WorldGenerator>(m_WorldSeed);
+    m_pGenScheduler         = std::make_unique<GenerationScheduler>(*m_pWorldGenerator, m_pThreadPool, NumWorkers, m_pRegionStorage.get());
+    m_pRandomTicker         = std::make_unique<RandomTicker>(m_pThreadPool, NumWorkers, m_WorldSeed);
+    m_pEntities             = std::make_unique<EntityStore>(m_pThreadPool, NumWorkers);
+}
+
+void Game::RequestChunkMeshes(Int32 ChunkX, Int32 ChunkZ)
+{
+    // A chunk is only meshed once all of its neighbours are generated and lit, so border
+    // faces are built once against real data instead of once per arriving neighbour.
+    // Chunks past the border of a finite world never exist and do not hold it back.
+    auto IsLoaded = [this](Int32 x, Int32 z) {
+        return m_pGenScheduler->GetStatus(x, z) == CHUNK_STATUS_LIGHT || !m_World.IsChunkInside(x, z);
     };
-    // clang-format on
+    for (Int32 cz = ChunkZ - 1; cz <= ChunkZ + 1; ++cz)
+    {
+        for (Int32 cx = ChunkX - 1; cx <= ChunkX + 1; ++cx)
+        {
+            const Chunk* pChunk = m_World.GetChunk(cx, cz);
+            if (pChunk == nullptr || m_MeshedChunks.count(World::PackChunkKey(cx, cz)) != 0)
+                continue;
+
+            bool HasAllNeighbours = true;
+            for (Int32 nz = cz - 1; nz <= cz + 1 && HasAllNeighbours; ++nz)
+            {
+                for (Int32 nx = cx - 1; nx <= cx + 1 && HasAllNeighbours; ++nx)
+                    HasAllNeighbours = IsLoaded(nx, nz);
+            }
+            if (!HasAllNeighbours)
+                continue;
+
+            m_MeshedChunks.insert(World::PackChunkKey(cx, cz));
+            for (Int32 s = 0; s < Chunk::NumSections; ++s)
+            {
+                if (!pChunk->GetSection(s).IsEmpty())
+                    m_pMeshScheduler->RequestMesh(m_World, int3{cx, s, cz});
+            }
+        }
+    }
+}
 
-    BufferDesc VertBuffDesc;
-    VertBuffDesc.Name      = "Cube vertex buffer";
-    VertBuffDesc.Usage     = USAGE_IMMUTABLE;
-    VertBuffDesc.BindFlags = BIND_VERTEX_BUFFER;
-    VertBuffDesc.Size      = sizeof(CubeVerts);
-    BufferData VBData;
-    VBData.pData    = CubeVerts;
-    VBData.DataSize = sizeof(CubeVerts);
-    GetDevice()->CreateBuffer(VertBuffDesc, &VBData, &m_CubeVertexBuffer);
+void Game::RemeshRelitSections()
+{
+    // Smooth lighting samples light one block past the section, so a light change also
+    // reaches the meshes of the neighbouring sections
+    std::unordered_set<Uint64> Requested;
+    for (const int3& Changed : m_pLightEngine->GetChangedSections())
+    {
+        for (Int32 dz = -1; dz <= 1; ++dz)
+        {
+            for (Int32 dx = -1; dx <= 1; ++dx)
+            {
+                const Chunk* pChunk = m_World.GetChunk(Changed.x + dx, Changed.z + dz);
+                if (pChunk == nullptr || m_MeshedChunks.count(World::PackChunkKey(Changed.x + dx, Changed.z + dz)) == 0)
+                    continue;
+
+                for (Int32 s = std::max(Changed.y - 1, 0); s <= std::min(Changed.y + 1, Chunk::NumSections - 1); ++s)
+                {
+                    const int3 SectionPos{Changed.x + dx, s, Changed.z + dz};
+                    if (!pChunk->GetSection(s).IsEmpty() && Requested.insert(World::PackSectionKey(SectionPos)).second)
+                        m_pMeshScheduler->RequestMesh(m_World, SectionPos);
+                }
+            }
+        }
+    }
 }
 
-void Game::CreateIndexBuffer()
+void Game::OnBlockChanged(const int3& Pos)
 {
-    // clang-format off
-    Uint32 Indices[] =
-    {
-        2,0,1,    2,3,0,
-        4,6,5,    4,7,6,
-        8,10,9,   8,11,10,
-        12,14,13, 12,15,14,
-        16,18,17, 16,19,18,
-        20,21,22, 20,22,23
+    m_pLightEngine->QueueBlockChange(Pos.x, Pos.y, Pos.z);
+    m_Fluids.OnBlockChanged(m_World, Pos.x, Pos.y, Pos.z);
+    m_Redstone.OnBlockChanged(Pos.x, Pos.y, Pos.z);
+    m_Pathfinder.OnBlockChanged(Pos);
+    ChunkMesher::ForEachSectionSampling(Pos, [this](const int3& SectionPos) {
+        m_ChangedSections.emplace(World::PackSectionKey(SectionPos), SectionPos);
+    });
+
+    // Sand and gravel lose their support. Turning the block into an entity changes the
+    // block above it in turn, so whole columns fall.
+    const int3    Above   = Pos + int3{0, 1, 0};
+    const BlockId AboveId = m_World.GetBlock(Above.x, Above.y, Above.z);
+    if (HasBlockGravity(AboveId) && !IsSolidBlock(m_World.GetBlock(Pos.x, Pos.y, Pos.z)) && m_World.SetBlock(Above.x, Above.y, Above.z, BLOCK_AIR))
+    {
+        EntityDesc Desc;
+        Desc.Components = ENTITY_COMPONENT_GRAVITY | ENTITY_COMPONENT_COLLISION | ENTITY_COMPONENT_BLOCK;
+        Desc.Pos        = float3{static_cast<float>(Above.x) + 0.5f, static_cast<float>(Above.y), static_cast<float>(Above.z) + 0.5f};
+        Desc.Width      = 0.98f;
+        Desc.Height     = 0.98f;
+        Desc.Block      = AboveId;
+        m_pEntities->Create(Desc);
+        OnBlockChanged(Above);
+    }
+}
+
+void Game::UpdateFallingBlocks()
+{
+    // Entities move once per tick, so each block is drawn where its velocity puts it
+    // between the last two ticks. It never goes past where it lands, which is not known
+    // until the next tick.
+    const float Behind = (GetSimulationClock().GetAlpha() - 1.f) * static_cast<float>(SimulationClock::TickInterval);
+
+    m_FallingBlocks.clear();
+    m_pEntities->ForEach(ENTITY_COMPONENT_BLOCK | ENTITY_COMPONENT_VELOCITY, [&](const EntityArchetype& Archetype, Uint32 Row) {
+        const float3 Pos{
+            Archetype.PosX[Row] + Archetype.VelX[Row] * Behind,
+            Archetype.PosY[Row] + Archetype.VelY[Row] * Behind,
+            Archetype.PosZ[Row] + Archetype.VelZ[Row] * Behind,
+        };
+
+        ChunkRenderer::LooseBlock& Block = m_FallingBlocks.emplace_back();
+        Block.Pos                        = Pos - float3{0.5f, 0.f, 0.5f};
+        Block.Block                      = Archetype.Block[Row];
+
+        // Lit like the terrain in the block holding its centre, fully outside loaded sections
+        const int3          Center{static_cast<Int32>(std::floor(Pos.x)), static_cast<Int32>(std::floor(Pos.y + 0.5f)), static_cast<Int32>(std::floor(Pos.z))};
+        const ChunkSection* pSection = m_World.GetSection(int3{World::BlockToChunk(Center.x), Center.y >> 4, World::BlockToChunk(Center.z)});
+        if (pSection != nullptr)
+        {
+            const Uint32 Index = ChunkSection::GetIndex(World::BlockToLocal(Center.x), Center.y & 15, World::BlockToLocal(Center.z));
+            Block.Light        = std::max(pSection->GetSkyLight().Get(Index), pSection->GetBlockLight().Get(Index));
+        }
+    });
+    m_pChunkRenderer->SetLooseBlocks(m_FallingBlocks);
+}
+
+void Game::EditBlock(const int3& Pos, BlockId Id)
+{
+    if (!m_World.SetBlock(Pos.x, Pos.y, Pos.z, Id))
+        return;
+
+    OnBlockChanged(Pos);
+    ChunkMesher::ForEachSectionSampling(Pos, [this](const int3& SectionPos) {
+        m_EditedSections.emplace(World::PackSectionKey(SectionPos), SectionPos);
+    });
+}
+
+void Game::RequestTestPath()
+{
+    // To the top of the block looked at, from as far as the world is loaded
+    BlockHit Hit;
+    if (!RaycastBlocks(m_World, m_Camera.GetRenderPos(), m_Camera.GetWorldAhead(), static_cast<float>(m_RenderDistance * 16), Hit))
+        return;
+
+    const float3 Feet = m_Walking ? m_Player.GetPos() : m_Camera.GetPos() - float3{0, PlayerPhysics::EyeHeight, 0};
+    const int3   Start{
+        static_cast<Int32>(std::floor(Feet.x)),
+        static_cast<Int32>(std::floor(Feet.y)),
+        static_cast<Int32>(std::floor(Feet.z)),
     };
-    // clang-format on
+    m_Pathfinder.Cancel(m_TestPathRequest);
+    m_TestPathRequest = m_Pathfinder.RequestPath(Start, Hit.Pos + int3{0, 1, 0});
+    m_TestPathStatus  = PATH_STATUS_PENDING;
+}
 
-    BufferDesc IndBuffDesc;
-    IndBuffDesc.Name      = "Cube index buffer";
-    IndBuffDesc.Usage     = USAGE_IMMUTABLE;
-    IndBuffDesc.BindFlags = BIND_INDEX_BUFFER;
-    IndBuffDesc.Size      = sizeof(Indices);
-    BufferData IBData;
-    IBData.pData    = Indices;
-    IBData.DataSize = sizeof(Indices);
-    GetDevice()->CreateBuffer(IndBuffDesc, &IBData, &m_CubeIndexBuffer);
+void Game::EmitAmbientParticles()
+{
+    // Only some blocks are looked at every tick, so a torch smokes now and then rather
+    // than in step with the others
+    const float3 CameraPos = m_Camera.GetRenderPos();
+    const int3   Center{
+        static_cast<Int32>(std::floor(CameraPos.x)),
+        static_cast<Int32>(std::floor(CameraPos.y)),
+        static_cast<Int32>(std::floor(CameraPos.z)),
+    };
+    for (Uint32 i = 0; i < m_AmbientParticleChecks; ++i)
+    {
+        const int3 Pos = Center + int3{m_AmbientParticleRand(), m_AmbientParticleRand(), m_AmbientParticleRand()};
+        if (m_World.GetBlock(Pos.x, Pos.y, Pos.z) == BLOCK_TORCH)
+            m_Particles.EmitSmoke(m_World, float3{static_cast<float>(Pos.x) + 0.5f, static_cast<float>(Pos.y) + 0.7f, static_cast<float>(Pos.z) + 0.5f});
+    }
 }
 
-void Game::LoadTexture()
+void Game::UseBlock(Key Button)
 {
-    TextureLoadInfo loadInfo;
-    loadInfo.IsSRGB = true;
-    RefCntAutoPtr<ITexture> Tex;
-    CreateTextureFromFile("assets/base_txt.png", loadInfo, GetDevice(), &Tex);
-    // Get shader resource view from the texture
-    m_TextureSRV = Tex->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE);
+    BlockHit Hit;
+    if (!RaycastBlocks(m_World, m_Camera.GetRenderPos(), m_Camera.GetWorldAhead(), m_BlockReach, Hit))
+        return;
 
-    // Set texture SRV in the SRB
-    m_SRB->GetVariableByName(SHADER_TYPE_PIXEL, "g_Texture")->Set(m_TextureSRV);
+    if (Button == Key::MB_Left)
+    {
+        const BlockId Broken = m_World.GetBlock(Hit.Pos.x, Hit.Pos.y, Hit.Pos.z);
+        EditBlock(Hit.Pos, BLOCK_AIR);
+        m_Particles.EmitBlockBreak(m_World, Hit.Pos, Broken);
+    }
+    else if (Button == Key::MB_Middle)
+    {
+        m_PlaceBlock = m_World.GetBlock(Hit.Pos.x, Hit.Pos.y, Hit.Pos.z);
+    }
+    else if (Hit.Face != BLOCK_FACE_COUNT)
+    {
+        // Blocks replace air and fluids, and solid ones are not placed inside the player
+        const int3    Pos     = Hit.Pos + GetFaceNormal(Hit.Face);
+        const BlockId Current = m_World.GetBlock(Pos.x, Pos.y, Pos.z);
+        if (Current != BLOCK_AIR && GetFluidType(Current) == FLUID_NONE)
+            return;
+        if (m_Walking && IsSolidBlock(m_PlaceBlock))
+        {
+            const BoundBox Box = m_Player.GetBox();
+            if (Box.Min.x < Pos.x + 1 && Box.Max.x > Pos.x && Box.Min.y < Pos.y + 1 && Box.Max.y > Pos.y && Box.Min.z < Pos.z + 1 && Box.Max.z > Pos.z)
+                return;
+        }
+        EditBlock(Pos, m_PlaceBlock);
+    }
+}
+
+void Game::RemeshChangedSections()
+{
+    // Only the sections whose meshes sample an edited block, which is one unless the
+    // block is on a section border
+    for (const auto& It : m_EditedSections)
+    {
+        const int3& SectionPos = It.second;
+        if (m_World.GetChunk(SectionPos.x, SectionPos.z) != nullptr && m_MeshedChunks.count(World::PackChunkKey(SectionPos.x, SectionPos.z)) != 0)
+            m_pMeshScheduler->RequestMesh(m_World, SectionPos, true);
+        m_ChangedSections.erase(It.first);
+    }
+    m_EditedSections.clear();
+
+    for (const auto& It : m_ChangedSections)
+    {
+        // Sections that became empty are remeshed too, to remove their old mesh
+        const int3& SectionPos = It.second;
+        if (m_World.GetChunk(SectionPos.x, SectionPos.z) != nullptr && m_MeshedChunks.count(World::PackChunkKey(SectionPos.x, SectionPos.z)) != 0)
+            m_pMeshScheduler->RequestMesh(m_World, SectionPos);
+    }
+    m_ChangedSections.clear();
+}
+
+void Game::UnloadChunk(Int32 ChunkX, Int32 ChunkZ)
+{
+    for (Int32 s = 0; s < Chunk::NumSections; ++s)
+    {
+        const int3 SectionPos{ChunkX, s, ChunkZ};
+        m_pMeshScheduler->CancelMesh(SectionPos);
+        m_pChunkRenderer->RemoveSection(SectionPos);
+    }
+    m_MeshedChunks.erase(World::PackChunkKey(ChunkX, ChunkZ));
+    m_VisibilityGraph.RemoveChunk(ChunkX, ChunkZ);
+    m_pLightEngine->CancelChunk(ChunkX, ChunkZ);
+    m_Fluids.CancelChunk(ChunkX, ChunkZ);
+    m_Redstone.CancelChunk(ChunkX, ChunkZ);
+    m_Pathfinder.OnChunkChanged(ChunkX, ChunkZ);
+    m_pGenScheduler->OnChunkUnloaded(ChunkX, ChunkZ);
+
+    const Chunk* pChunk = m_World.GetChunk(ChunkX, ChunkZ);
+    if (pChunk != nullptr && pChunk->IsModified())
+        m_pRegionStorage->SaveChunk(*pChunk);
+    m_World.UnloadChunk(ChunkX, ChunkZ);
+}
+
+void Game::UpdateChunks()
+{
+    const float3 CameraPos = m_Camera.GetRenderPos();
+    const Int32  CameraX   = World::BlockToChunk(static_cast<Int32>(std::floor(CameraPos.x)));
+    const Int32  CameraZ   = World::BlockToChunk(static_cast<Int32>(std::floor(CameraPos.z)));
+
+    if (m_ChunkLoadOrderDistance != m_RenderDistance)
+    {
+        m_ChunkLoadOrderDistance = m_RenderDistance;
+        m_ChunkLoadOrder.clear();
+        for (Int32 z = -m_RenderDistance; z <= m_RenderDistance; ++z)
+        {
+            for (Int32 x = -m_RenderDistance; x <= m_RenderDistance; ++x)
+                m_ChunkLoadOrder.emplace_back(x, z);
+        }
+        std::stable_sort(m_ChunkLoadOrder.begin(), m_ChunkLoadOrder.end(), [](const int2& a, const int2& b) {
+            return a.x * a.x + a.y * a.y < b.x * b.x + b.y * b.y;
+        });
+    }
+
+    // Chunks are kept a little past the render distance so that moving back and forth
+    // across a chunk border does not reload them. Generation needs a ring of two chunks
+    // around the requested ones, which is covered by the same margin.
+    const Int32       UnloadDistance = m_RenderDistance + 2;
+    std::vector<int2> ChunksToUnload;
+    m_World.ForEachChunk([&](const Chunk& Chnk) {
+        if (std::abs(Chnk.GetX() - CameraX) > UnloadDistance || std::abs(Chnk.GetZ() - CameraZ) > UnloadDistance)
+        {
+            if (m_pGenScheduler->CanUnload(Chnk.GetX(), Chnk.GetZ()))
+                ChunksToUnload.emplace_back(Chnk.GetX(), Chnk.GetZ());
+        }
+    });
+    for (const auto& Pos : ChunksToUnload)
+        UnloadChunk(Pos.x, Pos.y);
+    m_pGenScheduler->DropDistantChunks(CameraX, CameraZ, UnloadDistance);
+
+    for (const auto& Offset : m_ChunkLoadOrder)
+    {
+        const Int32 ChunkX = CameraX + Offset.x;
+        const Int32 ChunkZ = CameraZ + Offset.y;
+        if (m_World.IsChunkInside(ChunkX, ChunkZ) && !m_pGenScheduler->IsRequested(ChunkX, ChunkZ))
+            m_pGenScheduler->RequestChunk(ChunkX, ChunkZ);
+    }
+
+    // New chunks are lit by the scheduler before they are reported as completed, and
+    // lighting them also changes the light of the meshed chunks next to them
+    m_pGenScheduler->Update(m_World, *m_pLightEngine, m_Camera.GetPos(), m_MaxLitChunksPerFrame, m_MaxChunkLoadsPerFrame);
+    const std::vector<int2>& CompletedChunks = m_pGenScheduler->GetCompletedChunks();
+    if (!CompletedChunks.empty())
+        RemeshRelitSections();
+
+    // Sections are snapshotted for meshing, so they must be lit first. Chunks that are
+    // meshed below for the first time are not remeshed for their own light.
+    if (m_pLightEngine->HasPendingWork())
+    {
+        m_pLightEngine->Update(m_World);
+        RemeshRelitSections();
+    }
+    RemeshChangedSections();
+    for (const auto& Pos : CompletedChunks)
+    {
+        RequestChunkMeshes(Pos.x, Pos.y);
+        m_Pathfinder.OnChunkChanged(Pos.x, Pos.y);
+    }
+
+    m_pMeshScheduler->UpdatePriorities(CameraPos, m_Camera.GetWorldAhead(), m_ViewFrustum);
+    // Edits are meshed first and applied past the budgets, so they show on the next frame
+    m_pMeshScheduler->WaitForUrgent();
+    m_pMeshScheduler->ApplyCompleted(
+        [this](const int3& SectionPos, ChunkMesh&& Mesh) {
+            UploadSectionMesh(SectionPos, std::move(Mesh));
+        },
+        m_MeshUploadTimeBudget, m_MeshUploadByteBudget);
+
+    if (m_CaveCulling)
+    {
+        // Covers every loaded chunk, including the ones kept past the render distance
+        m_VisibilityGraph.Update(CameraPos, m_ViewFrustum, UnloadDistance);
+    }
 }
 
 } // namespace Diligent
@@ -29,6 +29,29 @@
 
 #include "BaseEngine.hpp"
 #include "FirstPersonCamera.hpp"
+#include "World.hpp"
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "ChunkMesher.hpp"
+#include "MeshScheduler.hpp"
+#include "ChunkRenderer.hpp"
+#include "Benchmarks.hpp"
+#include "BlockTextures.hpp"
+#include "RegionFile.hpp"
+#include "LightEngine.hpp"
+#include "WorldGenerator.hpp"
+#include "GenerationScheduler.hpp"
+#include "FluidSimulator.hpp"
+#include "RandomTicker.hpp"
+#include "RedstoneEngine.hpp"
+#include "PlayerPhysics.hpp"
+#include "BlockRaycast.hpp"
+#include "EntityStore.hpp"
+#include "Pathfinder.hpp"
+#include "ParticleSystem.hpp"
+#include "ParticleRenderer.hpp"
 
 namespace Diligent
 {
@@ -36,9 +59,12 @@ namespace Diligent
 class Game final : public BaseEngine
 {
 public:
+    ~Game();
+
     virtual bool Initialize() override;
     virtual void UpdateUI(float dt);
     virtual void UpdateUIDebug(float dt);
+    virtual void Tick() override;
     virtual void Update(float dt) override;
     virtual void Draw() override;
     virtual void KeyEvent(Key key, KeyState state) override;
@@ -46,18 +72,38 @@ public:
 
 private:
     void CreatePipelineState();
-    void CreateVertexBuffer();
-    void CreateIndexBuffer();
     void LoadTexture();
+    void CreateWorld();
+    void UpdateChunks();
+    void RequestChunkMeshes(Int32 ChunkX, Int32 ChunkZ);
+    void RemeshRelitSections();
+    void RemeshChangedSections();
+    void OnBlockChanged(const int3& Pos);
+    // Block broken or placed by the player
+    void EditBlock(const int3& Pos, BlockId Id);
+    void UseBlock(Key Button);
+    void RequestTestPath();
+    // Smoke from torches around the camera
+    void EmitAmbientParticles();
+    // Falling block entities, drawn as loose blocks of the chunk renderer
+    void UpdateFallingBlocks();
+    void UnloadChunk(Int32 ChunkX, Int32 ChunkZ);
+    void UploadSectionMesh(const int3& SectionPos, ChunkMesh&& Mesh);
+    void UpdateBenchmarkUI();
 
 private:
+    // Layout must match the Constants cbuffer in cube.vsh
+    struct VSConstants
+    {
+        float4x4 WorldViewProj;
+    };
+
     RefCntAutoPtr<IPipelineState>           pPSO;
-    RefCntAutoPtr<IBuffer>                  m_CubeVertexBuffer;
-    RefCntAutoPtr<IBuffer>                  m_CubeIndexBuffer;
     RefCntAutoPtr<IBuffer>                  m_VSConstants;
-    RefCntAutoPtr<ITextureView>             m_TextureSRV;
+    BlockTextureArray                       m_BlockTextures;
     RefCntAutoPtr<IShaderResourceBinding>   m_SRB;
     float4x4                                m_WorldViewProjMatrix;
+    ViewFrustum                             m_ViewFrustum;
     RefCntAutoPtr<IBuffer>                  pConstants;
 
     RefCntAutoPtr<IShaderSourceInputStreamFactory> m_pShaderSourceFactory;
@@ -65,11 +111,73 @@ private:
 
     double LastTime = 0;
     double CurrTime = 0;
+    // CPU time of the last simulation tick, in seconds
+    double m_TickTime = 0;
     bool m_bShowUI = true;
     bool u_ShowDebug = false;
     bool u_NoClear = false;
 
     FirstPersonCamera m_Camera;
+    // Walking with collision and gravity instead of flying, toggled with F
+    PlayerPhysics m_Player;
+    bool          m_Walking = false;
+
+    World m_World;
+    // Chunks changed in game are written here when they unload and on exit
+    std::unique_ptr<RegionStorage> m_pRegionStorage;
+
+    std::vector<BenchmarkResult> m_BenchmarkResults;
+
+    // Worker threads shared by meshing, generation, lighting, random ticks and entities
+    RefCntAutoPtr<IThreadPool> m_pThreadPool;
+
+    std::unique_ptr<ChunkRenderer> m_pChunkRenderer;
+    VisibilityGraph                m_VisibilityGraph;
+    bool                           m_CaveCulling = true;
+    std::unique_ptr<MeshScheduler> m_pMeshScheduler;
+    std::unique_ptr<LightEngine>   m_pLightEngine;
+    // Declared after the generator so that its jobs finish before the generator goes away
+    std::unique_ptr<WorldGenerator>      m_pWorldGenerator;
+    std::unique_ptr<GenerationScheduler> m_pGenScheduler;
+    std::unique_ptr<RandomTicker>        m_pRandomTicker;
+    FluidSimulator                       m_Fluids;
+    RedstoneEngine                       m_Redstone;
+    std::unique_ptr<EntityStore>         m_pEntities;
+    Pathfinder                           m_Pathfinder;
+    // Path from the player to the block looked at, asked for with P
+    PathRequestId     m_TestPathRequest = 0;
+    PATH_STATUS       m_TestPathStatus  = PATH_STATUS_INVALID;
+    std::vector<int3> m_TestPath;
+    // Falling block entities as drawn this frame
+    std::vector<ChunkRenderer::LooseBlock> m_FallingBlocks;
+    // Block debris, torch smoke and splashes, drawn after the terrain
+    ParticleSystem                    m_Particles;
+    std::unique_ptr<ParticleRenderer> m_pParticleRenderer;
+    FastRandInt                       m_AmbientParticleRand{0x534D4F4B, -16, 15};
+    // Sections whose blocks ticks changed since the last frame, keyed by PackSectionKey()
+    std::unordered_map<Uint64, int3> m_ChangedSections;
+    // Sections whose blocks the player edited, remeshed ahead of everything else
+    std::unordered_map<Uint64, int3> m_EditedSections;
+    // Placed with the right mouse button, picked with the middle one
+    BlockId m_PlaceBlock = BLOCK_COBBLESTONE;
+    // Chunks whose sections have been sent for meshing
+    std::unordered_set<Uint64> m_MeshedChunks;
+    // Chunk offsets within the render distance, nearest first
+    std::vector<int2> m_ChunkLoadOrder;
+    Int32             m_ChunkLoadOrderDistance = 0;
+
+    Int32  m_RenderDistance        = 8;
+    float  m_BlockReach            = 5.f;
+    Uint32 m_PathfindingBudget     = 2000;
+    // Random blocks within 16 of the camera checked for ambient particles every tick
+    Uint32 m_AmbientParticleChecks = 500;
+    Uint32 m_WorldSeed             = 0x4C434521;
+    double m_MeshUploadTimeBudget  = 0.002;
+    size_t m_MeshUploadByteBudget  = 4 << 20;
+    // New chunks lit and chunks loaded from disk per frame, both on the main thread
+    // (roughly 1.7 ms and 0.2 ms of work each)
+    Uint32 m_MaxLitChunksPerFrame  = 4;
+    Uint32 m_MaxChunkLoadsPerFrame = 8;
 };
 
 } // namespace Diligent